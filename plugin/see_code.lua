@@ -86,8 +86,16 @@ local function start_gui_server()
 
     vim.notify("see_code: Starting GUI server...", vim.log.levels.INFO)
 
+    -- Пути в diff отсчитываются от корня репозитория: оттуда GUI читает контекст ханков
+    local args = { "--verbose" }
+    local toplevel = vim.fn.systemlist("git rev-parse --show-toplevel")[1]
+    if vim.v.shell_error == 0 and toplevel and toplevel ~= "" then
+        table.insert(args, "--work-tree")
+        table.insert(args, toplevel)
+    end
+
     local handle, pid_or_err = uv.spawn(get_config("see_code_binary"), {
-        args = { "--verbose" },
+        args = args,
         stdio = { nil, nil, nil }
     }, function(code, signal)
         vim.schedule(function()
@@ -169,8 +177,24 @@ local function send_to_gui(data_buffer)
 end
 -- --- END CHANGE ---
 
+-- Named diff tabs: the first line of a message selects the tab on the GUI side
+local TAB_COMMAND_PREFIX = "@see_code "
+
+local function tab_diff_command(tab)
+    local base = "git diff --unified=3 --no-color"
+    if tab == "staged" then
+        return base .. " --cached"
+    elseif tab == "unstaged" then
+        return base
+    end
+    return base .. " " .. vim.fn.shellescape(tab)
+end
+
 -- Main function to collect and send diff
-function M.send_diff()
+-- :SeeCodeDiff [staged|unstaged|<rev>] sends the diff into the tab of that name;
+-- without an argument the diff against HEAD replaces the default tab
+function M.send_diff(opts)
+    local tab = opts and opts.args ~= "" and opts.args or nil
     if not user_config.socket_path then load_user_config() end
 
     if not check_dependencies() then
@@ -202,7 +226,7 @@ function M.send_diff()
     end
 
     -- --- CHANGED: Get raw diff text ---
-    local diff_cmd = "git diff --unified=3 --no-color HEAD"
+    local diff_cmd = tab and tab_diff_command(tab) or "git diff --unified=3 --no-color HEAD"
     local diff_output = vim.fn.systemlist(diff_cmd)
     -- --- END CHANGE ---
 
@@ -213,6 +237,9 @@ function M.send_diff()
 
     -- --- CHANGED: Concatenate lines into a single string (raw buffer) ---
     local diff_text = table.concat(diff_output, "\n")
+    if tab then
+        diff_text = TAB_COMMAND_PREFIX .. "tab " .. tab .. "\n" .. diff_text
+    end
     -- --- END CHANGE ---
 
     -- [ИЗМЕНЕНО] Отправляем данные, даже если diff_text пустой
@@ -229,6 +256,22 @@ function M.send_diff()
     -- --- END CHANGE ---
 end
 
+-- Shows a tab that was sent before (:SeeCodeTab <name>)
+function M.switch_tab(opts)
+    if not user_config.socket_path then load_user_config() end
+
+    local tab = opts and opts.args or ""
+    if tab == "" then
+        vim.notify("see_code: Tab name required.", vim.log.levels.ERROR)
+        return
+    end
+    if not check_gui_connection() then
+        vim.notify("see_code: GUI server not running.", vim.log.levels.ERROR)
+        return
+    end
+    send_to_gui(TAB_COMMAND_PREFIX .. "switch " .. tab .. "\n")
+end
+
 -- [НОВАЯ ФУНКЦИЯ] Принудительный запуск сервера
 function M.start_server()
     if not user_config.socket_path then load_user_config() end
@@ -296,7 +339,13 @@ function M.setup()
     load_user_config()
 
     vim.api.nvim_create_user_command('SeeCodeDiff', M.send_diff, {
-        desc = 'Send git diff to see_code GUI'
+        nargs = '?',
+        complete = function() return { "staged", "unstaged", "HEAD~1" } end,
+        desc = 'Send git diff to see_code GUI (optionally into a named tab)'
+    })
+    vim.api.nvim_create_user_command('SeeCodeTab', M.switch_tab, {
+        nargs = 1,
+        desc = 'Switch the see_code GUI to a named diff tab'
     })
     -- [НОВАЯ КОМАНДА]
     vim.api.nvim_create_user_command('SeeCodeStart', M.start_server, {
@@ -306,7 +355,7 @@ function M.setup()
         desc = 'Check see_code system and config status'
     })
 
-    vim.keymap.set('n', '<Leader>sd', M.send_diff, { desc = 'see_code: Send diff', silent = true })
+    vim.keymap.set('n', '<Leader>sd', function() M.send_diff() end, { desc = 'see_code: Send diff', silent = true })
     vim.keymap.set('n', '<Leader>ss', M.status, { desc = 'see_code: Check status' })
 
     vim.notify("see_code: Plugin loaded. Use :SeeCodeDiff or :SeeCodeStart.", vim.log.levels.INFO)
@@ -0,0 +1,351 @@
+// src/bench/bench_parser.c
+// Бенчмарк разбора diff: скорость, число аллокаций и пиковая память
+// для diff_parser_parse_owned(), поиска перенесенных блоков сразу после загрузки
+// (moved_lines_update; файлы ленивого diff еще не разобраны), разбора отложенных
+// файлов (diff_parser_parse_file), интернирования строк (line_pool_build)
+// и для освобождения (diff_data_clear/destroy).
+// Аллокации считаются через -Wl,--wrap=malloc (см. CMakeLists.txt).
+#include "see_code/bench/diff_generator.h"
+#include "see_code/data/diff_data.h"
+#include "see_code/data/diff_parser.h"
+#include "see_code/bench/line_pool.h"
+#include "see_code/data/moved_lines.h"
+#include "see_code/utils/logger.h"
+#include "see_code/utils/thread_pool.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/resource.h>
+
+#define BENCH_MAX_RUNS 100
+
+// --- Подсчет аллокаций ---
+
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t count, size_t size);
+void* __real_realloc(void* ptr, size_t size);
+void __real_free(void* ptr);
+
+static size_t g_allocations = 0;
+static size_t g_allocated_bytes = 0;
+static size_t g_frees = 0;
+
+void* __wrap_malloc(size_t size) {
+    __sync_fetch_and_add(&g_allocations, 1);
+    __sync_fetch_and_add(&g_allocated_bytes, size);
+    return __real_malloc(size);
+}
+
+void* __wrap_calloc(size_t count, size_t size) {
+    __sync_fetch_and_add(&g_allocations, 1);
+    __sync_fetch_and_add(&g_allocated_bytes, count * size);
+    return __real_calloc(count, size);
+}
+
+void* __wrap_realloc(void* ptr, size_t size) {
+    __sync_fetch_and_add(&g_allocations, 1);
+    __sync_fetch_and_add(&g_allocated_bytes, size);
+    return __real_realloc(ptr, size);
+}
+
+void __wrap_free(void* ptr) {
+    if (ptr) __sync_fetch_and_add(&g_frees, 1);
+    __real_free(ptr);
+}
+
+// --- Память процесса ---
+
+// Сбрасывает VmHWM, чтобы пик считался для одной фазы (Linux 4.0+)
+static void reset_peak_rss(void) {
+    FILE* f = fopen("/proc/self/clear_refs", "w");
+    if (f) {
+        fputs("5", f);
+        fclose(f);
+    }
+}
+
+// Пиковый RSS в КБ: VmHWM из /proc, иначе ru_maxrss (пик за все время работы)
+static long peak_rss_kb(void) {
+    FILE* f = fopen("/proc/self/status", "r");
+    if (f) {
+        char line[256];
+        long value = -1;
+        while (fgets(line, sizeof(line), f)) {
+            if (strncmp(line, "VmHWM:", 6) == 0) {
+                value = strtol(line + 6, NULL, 10);
+                break;
+            }
+        }
+        fclose(f);
+        if (value >= 0) return value;
+    }
+    struct rusage usage;
+    return getrusage(RUSAGE_SELF, &usage) == 0 ? usage.ru_maxrss : -1;
+}
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+// --- Замеры ---
+
+typedef struct {
+    double ms[BENCH_MAX_RUNS];
+    size_t allocations;
+    size_t allocated_bytes;
+    size_t frees;
+    long peak_rss_kb;
+} PhaseStats;
+
+typedef struct {
+    size_t allocations;
+    size_t allocated_bytes;
+    size_t frees;
+    double start;
+} PhaseMark;
+
+static PhaseMark phase_begin(void) {
+    reset_peak_rss();
+    PhaseMark mark = { g_allocations, g_allocated_bytes, g_frees, now_ms() };
+    return mark;
+}
+
+static void phase_end(PhaseStats* stats, const PhaseMark* mark, int run) {
+    stats->ms[run] = now_ms() - mark->start;
+    // Аллокации и память одинаковы от прогона к прогону, берем последний
+    stats->allocations = g_allocations - mark->allocations;
+    stats->allocated_bytes = g_allocated_bytes - mark->allocated_bytes;
+    stats->frees = g_frees - mark->frees;
+    long rss = peak_rss_kb();
+    if (rss > stats->peak_rss_kb) stats->peak_rss_kb = rss;
+}
+
+static int compare_double(const void* a, const void* b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return x < y ? -1 : x > y;
+}
+
+// Скорость в MB/s показывается относительно размера входа (имеет смысл для разбора)
+static void report(const char* name, PhaseStats* stats, int runs, size_t input_size, int show_rate) {
+    qsort(stats->ms, (size_t)runs, sizeof(double), compare_double);
+    double best = stats->ms[0];
+    double median = stats->ms[runs / 2];
+    double mb = input_size / (1024.0 * 1024.0);
+    char rate[32] = "           -";
+    if (show_rate && best > 0) {
+        snprintf(rate, sizeof(rate), "%7.1f MB/s", mb / (best / 1000.0));
+    }
+    printf("%-8s best %9.3f ms  median %9.3f ms  %s  allocs %8zu  frees %8zu  alloc %9.1f MB  peak RSS %8.1f MB\n",
+           name, best, median, rate, stats->allocations, stats->frees,
+           stats->allocated_bytes / (1024.0 * 1024.0), stats->peak_rss_kb / 1024.0);
+}
+
+static char* read_file(const char* path, size_t* size) {
+    FILE* f = fopen(path, "rb");
+    if (!f) {
+        fprintf(stderr, "Cannot open %s\n", path);
+        return NULL;
+    }
+    fseek(f, 0, SEEK_END);
+    long length = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    char* data = length > 0 ? malloc((size_t)length) : NULL;
+    if (!data || fread(data, 1, (size_t)length, f) != (size_t)length) {
+        fprintf(stderr, "Cannot read %s\n", path);
+        free(data);
+        fclose(f);
+        return NULL;
+    }
+    fclose(f);
+    *size = (size_t)length;
+    return data;
+}
+
+static void print_usage(const char* program_name) {
+    printf("Usage: %s [OPTIONS]\n", program_name);
+    printf("\nOptions:\n");
+    printf("  --files N        Files in the generated diff (default 2000)\n");
+    printf("  --hunks N        Hunks per file (default 4)\n");
+    printf("  --hunk-lines N   Lines per hunk (default 24)\n");
+    printf("  --line-length N  Average line length in bytes (default 40)\n");
+    printf("  --quoted P       Percent of files with quoted paths (default 5)\n");
+    printf("  --utf8 P         Percent of lines with UTF-8 words (default 10)\n");
+    printf("  --seed N         Generator seed (default 1)\n");
+    printf("  --runs N         Measured runs, at most %d (default 5)\n", BENCH_MAX_RUNS);
+    printf("  --input PATH     Benchmark an existing diff instead of a generated one\n");
+    printf("  --emit           Write the generated diff to stdout and exit\n");
+}
+
+int main(int argc, char* argv[]) {
+    DiffGeneratorOptions options;
+    diff_generator_default_options(&options);
+    int runs = 5;
+    int emit = 0;
+    const char* input_path = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : NULL;
+        if (strcmp(arg, "-h") == 0 || strcmp(arg, "--help") == 0) {
+            print_usage(argv[0]);
+            return 0;
+        } else if (strcmp(arg, "--emit") == 0) {
+            emit = 1;
+            continue;
+        }
+        if (!value) {
+            fprintf(stderr, "Option %s requires a value\n", arg);
+            return 1;
+        }
+        i++;
+        if (strcmp(arg, "--files") == 0) options.file_count = strtoul(value, NULL, 10);
+        else if (strcmp(arg, "--hunks") == 0) options.hunks_per_file = strtoul(value, NULL, 10);
+        else if (strcmp(arg, "--hunk-lines") == 0) options.hunk_lines = strtoul(value, NULL, 10);
+        else if (strcmp(arg, "--line-length") == 0) options.line_length = strtoul(value, NULL, 10);
+        else if (strcmp(arg, "--quoted") == 0) options.quoted_percent = (unsigned)strtoul(value, NULL, 10);
+        else if (strcmp(arg, "--utf8") == 0) options.utf8_percent = (unsigned)strtoul(value, NULL, 10);
+        else if (strcmp(arg, "--seed") == 0) options.seed = strtoull(value, NULL, 10);
+        else if (strcmp(arg, "--runs") == 0) runs = atoi(value);
+        else if (strcmp(arg, "--input") == 0) input_path = value;
+        else {
+            fprintf(stderr, "Unknown option: %s\n", arg);
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    if (runs < 1) runs = 1;
+    if (runs > BENCH_MAX_RUNS) runs = BENCH_MAX_RUNS;
+    logger_set_level(LOG_LEVEL_WARN);
+
+    size_t size = 0;
+    char* input = input_path ? read_file(input_path, &size) : diff_generator_generate(&options, &size);
+    if (!input) {
+        fprintf(stderr, "Failed to prepare input\n");
+        return 1;
+    }
+    if (emit) {
+        fwrite(input, 1, size, stdout);
+        free(input);
+        return 0;
+    }
+
+    PhaseStats parse_stats, files_stats, intern_stats, moved_stats, clear_stats, destroy_stats;
+    memset(&parse_stats, 0, sizeof(parse_stats));
+    memset(&files_stats, 0, sizeof(files_stats));
+    memset(&intern_stats, 0, sizeof(intern_stats));
+    memset(&moved_stats, 0, sizeof(moved_stats));
+    memset(&clear_stats, 0, sizeof(clear_stats));
+    memset(&destroy_stats, 0, sizeof(destroy_stats));
+    size_t files = 0, hunks = 0, lines = 0;
+    LinePool pool;
+    line_pool_init(&pool);
+    size_t interned = 0, distinct = 0, text_bytes = 0, unique_bytes = 0, pool_bytes = 0;
+    MovedLines moved;
+    moved_lines_init(&moved);
+    size_t changed = 0, moved_blocks = 0, moved_lines = 0, unparsed = 0;
+    // Пул потоков создается заранее, чтобы его запуск не попал в первый замер
+    thread_pool_shared();
+
+    for (int run = 0; run < runs; run++) {
+        // Парсер раскодирует пути на месте, поэтому каждому прогону нужна своя копия
+        char* buffer = malloc(size);
+        DiffData* data = diff_data_create();
+        if (!buffer || !data) {
+            fprintf(stderr, "Out of memory\n");
+            return 1;
+        }
+        memcpy(buffer, input, size);
+
+        PhaseMark mark = phase_begin();
+        int ok = diff_parser_parse_owned(data, buffer, size);
+        phase_end(&parse_stats, &mark, run);
+        if (!ok) {
+            fprintf(stderr, "Parse failed\n");
+            return 1;
+        }
+        files = data->file_count;
+        hunks = data->hunk_count;
+        lines = data->line_count;
+
+        // Перенесенные блоки ищутся сразу после загрузки, как в первых кадрах
+        // приложения: файлы ленивого diff еще не разобраны и хешируются по тексту секций
+        unparsed = 0;
+        for (size_t i = 0; i < data->file_count; i++) {
+            unparsed += !diff_data_file_is_parsed(&data->files[i]);
+        }
+        mark = phase_begin();
+        ok = moved_lines_update(&moved, data);
+        // Хеширование идет порциями, поиск блоков - в фоне: замеряется весь проход
+        moved_lines_wait(&moved);
+        phase_end(&moved_stats, &mark, run);
+        if (!ok) {
+            fprintf(stderr, "Moved-code detection failed\n");
+            return 1;
+        }
+        moved_blocks = moved.block_count;
+        moved_lines = moved.moved_lines;
+        moved_lines_clear(&moved);
+
+        // Ленивый diff: интернировать можно только разобранные файлы
+        mark = phase_begin();
+        for (size_t i = 0; ok && i < data->file_count; i++) {
+            ok = diff_data_file_is_parsed(&data->files[i]) || diff_parser_parse_file(data, i);
+        }
+        phase_end(&files_stats, &mark, run);
+        if (!ok) {
+            fprintf(stderr, "Parsing deferred files failed\n");
+            return 1;
+        }
+
+        mark = phase_begin();
+        ok = line_pool_build(&pool, data);
+        phase_end(&intern_stats, &mark, run);
+        if (!ok) {
+            fprintf(stderr, "Interning failed\n");
+            return 1;
+        }
+        changed = 0;
+        for (size_t i = 0; i < data->line_count; i++) {
+            changed += data->lines.types[i] != LINE_TYPE_CONTEXT;
+        }
+        interned = pool.interned_lines;
+        distinct = pool.entry_count;
+        text_bytes = pool.text_bytes;
+        unique_bytes = pool.unique_bytes;
+        pool_bytes = line_pool_memory_usage(&pool);
+        line_pool_destroy(&pool);
+
+
+        mark = phase_begin();
+        diff_data_clear(data);
+        phase_end(&clear_stats, &mark, run);
+
+        mark = phase_begin();
+        diff_data_destroy(data);
+        phase_end(&destroy_stats, &mark, run);
+    }
+
+    printf("input: %.1f MB, %zu files, %zu hunks, %zu lines, %d runs, %zu worker threads\n",
+           size / (1024.0 * 1024.0), files, hunks, lines, runs, thread_pool_size(thread_pool_shared()));
+    report("parse", &parse_stats, runs, size, 1);
+    report("moved", &moved_stats, runs, size, 0);
+    report("files", &files_stats, runs, size, 0);
+    report("intern", &intern_stats, runs, size, 1);
+    report("clear", &clear_stats, runs, size, 0);
+    report("destroy", &destroy_stats, runs, size, 0);
+    // Сколько памяти заняли бы отдельные копии строк и сколько из нее - повторы
+    printf("intern: %zu lines, %zu distinct texts (%.1f%%), text %.1f MB, repeats %.1f MB (%.1f%%), pool %.1f MB\n",
+           interned, distinct, interned ? 100.0 * distinct / interned : 0.0,
+           text_bytes / (1024.0 * 1024.0), (text_bytes - unique_bytes) / (1024.0 * 1024.0),
+           text_bytes ? 100.0 * (text_bytes - unique_bytes) / text_bytes : 0.0, pool_bytes / (1024.0 * 1024.0));
+    printf("moved: %zu changed lines, %zu blocks, %zu moved added lines, %zu of %zu files not parsed yet\n",
+           changed, moved_blocks, moved_lines, unparsed, files);
+
+    moved_lines_destroy(&moved);
+    thread_pool_shared_shutdown();
+    free(input);
+    return 0;
+}
@@ -0,0 +1,177 @@
+// src/bench/diff_generator.c
+#include "see_code/bench/diff_generator.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Наибольшее число строк в ханке, для которого типы строк хранятся на стеке
+#define GENERATOR_MAX_HUNK_LINES 4096
+
+typedef struct {
+    char* data;
+    size_t size;
+    size_t capacity;
+    int failed;
+} OutBuffer;
+
+static void out_reserve(OutBuffer* out, size_t extra) {
+    if (out->failed || out->size + extra <= out->capacity) {
+        return;
+    }
+    size_t capacity = out->capacity ? out->capacity * 2 : 1024 * 1024;
+    while (capacity < out->size + extra) capacity *= 2;
+    char* grown = realloc(out->data, capacity);
+    if (!grown) {
+        out->failed = 1;
+        return;
+    }
+    out->data = grown;
+    out->capacity = capacity;
+}
+
+static void out_bytes(OutBuffer* out, const char* bytes, size_t length) {
+    out_reserve(out, length);
+    if (out->failed) return;
+    memcpy(out->data + out->size, bytes, length);
+    out->size += length;
+}
+
+static void out_str(OutBuffer* out, const char* text) {
+    out_bytes(out, text, strlen(text));
+}
+
+static void out_format(OutBuffer* out, const char* format, size_t a, size_t b, size_t c, size_t d) {
+    char line[128];
+    int length = snprintf(line, sizeof(line), format, a, b, c, d);
+    if (length > 0) out_bytes(out, line, (size_t)length < sizeof(line) ? (size_t)length : sizeof(line) - 1);
+}
+
+// xorshift64*: быстрый и одинаковый на всех платформах
+static uint64_t next_random(uint64_t* state) {
+    uint64_t x = *state;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    *state = x;
+    return x * 0x2545F4914F6CDD1DULL;
+}
+
+static size_t random_below(uint64_t* state, size_t limit) {
+    return limit ? (size_t)(next_random(state) % limit) : 0;
+}
+
+static const char* const ascii_words[] = {
+    "int", "return", "if", "else", "for", "while", "size_t", "const", "char*",
+    "struct", "data", "buffer", "length", "count", "index", "result", "=", "+",
+    "(", ")", "{", "}", ";", "->", "0", "1", "NULL", "static", "void", "ptr"
+};
+static const char* const utf8_words[] = {
+    "привет", "данные", "naïve", "café", "日本語", "über", "строка", "Größe", "émoji✓"
+};
+#define ASCII_WORD_COUNT (sizeof(ascii_words) / sizeof(ascii_words[0]))
+#define UTF8_WORD_COUNT (sizeof(utf8_words) / sizeof(utf8_words[0]))
+
+// Текст строки: отступ и слова, пока не наберется примерно target байт
+static void out_line_text(OutBuffer* out, uint64_t* rng, size_t target, int utf8) {
+    size_t written = 4;
+    out_str(out, "    ");
+    if (target < 8) target = 8;
+    size_t length = target / 2 + random_below(rng, target + 1);
+    while (written < length) {
+        const char* word = utf8 && random_below(rng, 4) == 0 ?
+            utf8_words[random_below(rng, UTF8_WORD_COUNT)] :
+            ascii_words[random_below(rng, ASCII_WORD_COUNT)];
+        if (written > 4) out_str(out, " ");
+        out_str(out, word);
+        written += strlen(word) + 1;
+    }
+    out_str(out, "\n");
+}
+
+// Путь файла; в "кавычечном" варианте есть не-ASCII байты (git пишет их
+// восьмеричными escape-последовательностями), пробел и экранированная кавычка
+static void out_path(OutBuffer* out, size_t file, char side, int quoted) {
+    char path[128];
+    if (quoted) {
+        snprintf(path, sizeof(path), "\"%c/src/dir%zu/\\321\\204\\320\\260\\320\\271\\320\\273 \\\"%zu\\\".c\"",
+                 side, file % 16, file);
+    } else {
+        snprintf(path, sizeof(path), "%c/src/dir%zu/file_%zu.c", side, file % 16, file);
+    }
+    out_str(out, path);
+}
+
+void diff_generator_default_options(DiffGeneratorOptions* options) {
+    if (!options) {
+        return;
+    }
+    options->file_count = 2000;
+    options->hunks_per_file = 4;
+    options->hunk_lines = 24;
+    options->line_length = 40;
+    options->quoted_percent = 5;
+    options->utf8_percent = 10;
+    options->seed = 1;
+}
+
+char* diff_generator_generate(const DiffGeneratorOptions* options, size_t* size) {
+    if (!options || !size) {
+        return NULL;
+    }
+    uint64_t rng = options->seed ? options->seed : 0x9E3779B97F4A7C15ULL;
+    size_t hunk_lines = options->hunk_lines;
+    if (hunk_lines < 1) hunk_lines = 1;
+    if (hunk_lines > GENERATOR_MAX_HUNK_LINES) hunk_lines = GENERATOR_MAX_HUNK_LINES;
+    OutBuffer out = { NULL, 0, 0, 0 };
+    char types[GENERATOR_MAX_HUNK_LINES];
+
+    for (size_t f = 0; f < options->file_count && !out.failed; f++) {
+        int quoted = random_below(&rng, 100) < options->quoted_percent;
+        out_str(&out, "diff --git ");
+        out_path(&out, f, 'a', quoted);
+        out_str(&out, " ");
+        out_path(&out, f, 'b', quoted);
+        out_str(&out, "\nindex 0123456..89abcde 100644\n--- ");
+        out_path(&out, f, 'a', quoted);
+        out_str(&out, "\n+++ ");
+        out_path(&out, f, 'b', quoted);
+        out_str(&out, "\n");
+
+        size_t old_start = 1 + random_below(&rng, 20);
+        size_t new_start = old_start;
+        for (size_t h = 0; h < options->hunks_per_file && !out.failed; h++) {
+            // Сначала выбираем типы строк, чтобы заголовок ханка совпал с содержимым:
+            // примерно треть строк - изменения, удаления идут перед добавлениями
+            size_t old_count = 0, new_count = 0;
+            for (size_t i = 0; i < hunk_lines; ) {
+                size_t roll = random_below(&rng, 6);
+                if (roll < 4 || i + 1 == hunk_lines) {
+                    types[i++] = ' ';
+                    old_count++;
+                    new_count++;
+                } else {
+                    size_t deletes = random_below(&rng, 3);
+                    size_t adds = 1 + random_below(&rng, 3);
+                    for (size_t k = 0; k < deletes && i < hunk_lines; k++, old_count++) types[i++] = '-';
+                    for (size_t k = 0; k < adds && i < hunk_lines; k++, new_count++) types[i++] = '+';
+                }
+            }
+            out_format(&out, "@@ -%zu,%zu +%zu,%zu @@ static int func(void)\n", old_start, old_count, new_start, new_count);
+            for (size_t i = 0; i < hunk_lines; i++) {
+                out_bytes(&out, &types[i], 1);
+                out_line_text(&out, &rng, options->line_length,
+                              random_below(&rng, 100) < options->utf8_percent);
+            }
+            // Следующий ханк начинается ниже, с промежутком неизмененных строк
+            size_t gap = 10 + random_below(&rng, 50);
+            old_start += old_count + gap;
+            new_start += new_count + gap;
+        }
+    }
+    if (out.failed) {
+        free(out.data);
+        return NULL;
+    }
+    *size = out.size;
+    return out.data;
+}
@@ -0,0 +1,27 @@
+// src/bench/diff_generator.h
+#ifndef SEE_CODE_DIFF_GENERATOR_H
+#define SEE_CODE_DIFF_GENERATOR_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Deterministic synthetic `git diff` output for benchmarks.
+// The same options (including the seed) always produce the same bytes.
+// Hunk headers match the lines that follow them, so line numbers parse
+// exactly as they would for a real diff.
+typedef struct {
+    size_t file_count;
+    size_t hunks_per_file;
+    size_t hunk_lines;        // Lines per hunk, context included
+    size_t line_length;       // Average length of a line's text in bytes
+    unsigned quoted_percent;  // Share of files whose paths git has to quote
+    unsigned utf8_percent;    // Share of lines containing multi-byte UTF-8 words
+    uint64_t seed;
+} DiffGeneratorOptions;
+
+void diff_generator_default_options(DiffGeneratorOptions* options);
+
+// Returns a malloc'd diff of *size bytes, or NULL on allocation failure.
+char* diff_generator_generate(const DiffGeneratorOptions* options, size_t* size);
+
+#endif // SEE_CODE_DIFF_GENERATOR_H
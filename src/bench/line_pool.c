@@ -0,0 +1,185 @@
+// src/bench/line_pool.c
+#include "see_code/bench/line_pool.h"
+#include "see_code/data/diff_cold_store.h"
+#include "see_code/utils/hash.h"
+#include "see_code/utils/logger.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Наименьший размер таблицы; она растет вдвое при заполнении на 3/4
+#define LINE_POOL_MIN_SLOTS 1024
+// Строк, хешируемых до вставки: их слоты запрашиваются из памяти заранее и
+// промахи кэша по большой таблице перекрываются, а не идут друг за другом
+#define LINE_POOL_BATCH 32
+
+struct LinePoolSlot {
+    uint32_t id;  // LINE_POOL_NONE = пустой слот
+    uint32_t tag; // Старшие 32 бита хеша записи
+};
+
+void line_pool_init(LinePool* pool) {
+    if (!pool) {
+        return;
+    }
+    memset(pool, 0, sizeof(LinePool));
+}
+
+void line_pool_destroy(LinePool* pool) {
+    if (!pool) {
+        return;
+    }
+    free(pool->ids);
+    free(pool->entries);
+    free(pool->slots);
+    memset(pool, 0, sizeof(LinePool));
+}
+
+// --- Хеш-таблица ---
+
+// Перекладывает записи в таблицу не меньше чем на capacity слотов (хеши хранятся в записях)
+static int grow_slots(LinePool* pool, size_t capacity) {
+    size_t size = pool->slots ? (pool->slot_mask + 1) * 2 : LINE_POOL_MIN_SLOTS;
+    while (size < capacity) size *= 2;
+    struct LinePoolSlot* slots = malloc(size * sizeof(struct LinePoolSlot));
+    if (!slots) {
+        log_error("line_pool: Failed to grow hash table to %zu slots", size);
+        return 0;
+    }
+    memset(slots, 0xFF, size * sizeof(struct LinePoolSlot));
+    const size_t mask = size - 1;
+    for (size_t id = 0; id < pool->entry_count; id++) {
+        const uint64_t hash = pool->entries[id].hash;
+        size_t slot = (size_t)hash & mask;
+        while (slots[slot].id != LINE_POOL_NONE) slot = (slot + 1) & mask;
+        slots[slot].id = (uint32_t)id;
+        slots[slot].tag = (uint32_t)(hash >> 32);
+    }
+    free(pool->slots);
+    pool->slots = slots;
+    pool->slot_mask = mask;
+    return 1;
+}
+
+// Возвращает id записи с текстом [offset, offset + length) и хешем hash,
+// создавая ее при первой встрече
+static uint32_t intern(LinePool* pool, uint32_t offset, uint32_t length, uint64_t hash) {
+    const char* text = pool->data->buffer + offset;
+    const uint32_t tag = (uint32_t)(hash >> 32);
+    size_t slot = (size_t)hash & pool->slot_mask;
+    for (uint32_t id; (id = pool->slots[slot].id) != LINE_POOL_NONE; slot = (slot + 1) & pool->slot_mask) {
+        if (pool->slots[slot].tag != tag) {
+            continue;
+        }
+        const LinePoolEntry* entry = &pool->entries[id];
+        if (entry->hash == hash && entry->length == length &&
+            memcmp(pool->data->buffer + entry->offset, text, length) == 0) {
+            pool->entries[id].count++;
+            return id;
+        }
+    }
+
+    if (pool->entry_count == pool->entry_capacity) {
+        size_t capacity = pool->entry_capacity ? pool->entry_capacity * 2 : LINE_POOL_MIN_SLOTS / 2;
+        LinePoolEntry* entries = realloc(pool->entries, capacity * sizeof(LinePoolEntry));
+        if (!entries) {
+            log_error("line_pool: Failed to grow entries to %zu", capacity);
+            return LINE_POOL_NONE;
+        }
+        pool->entries = entries;
+        pool->entry_capacity = capacity;
+    }
+    const uint32_t id = (uint32_t)pool->entry_count++;
+    LinePoolEntry* entry = &pool->entries[id];
+    entry->hash = hash;
+    entry->offset = offset;
+    entry->length = length;
+    entry->count = 1;
+    pool->slots[slot].id = id;
+    pool->slots[slot].tag = tag;
+    pool->unique_bytes += length;
+    if (pool->entry_count * 4 > (pool->slot_mask + 1) * 3 && !grow_slots(pool, 0)) {
+        return LINE_POOL_NONE;
+    }
+    return id;
+}
+
+// --- Строки файлов ---
+
+static int intern_lines(LinePool* pool, size_t first, size_t count) {
+    const DiffLineTable* lines = &pool->data->lines;
+    uint64_t hashes[LINE_POOL_BATCH];
+    for (size_t batch = first; batch < first + count; batch += LINE_POOL_BATCH) {
+        const size_t end = batch + LINE_POOL_BATCH < first + count ? batch + LINE_POOL_BATCH : first + count;
+        for (size_t line = batch; line < end; line++) {
+            // Текст после маркера '+', '-' или ' '
+            const uint32_t length = lines->lengths[line] > 0 ? lines->lengths[line] - 1 : 0;
+            hashes[line - batch] = hash_bytes(pool->data->buffer + lines->offsets[line] + 1, length);
+            __builtin_prefetch(&pool->slots[(size_t)hashes[line - batch] & pool->slot_mask]);
+        }
+        for (size_t line = batch; line < end; line++) {
+            const uint32_t length = lines->lengths[line] > 0 ? lines->lengths[line] - 1 : 0;
+            const uint32_t id = intern(pool, lines->offsets[line] + 1, length, hashes[line - batch]);
+            if (id == LINE_POOL_NONE) {
+                return 0;
+            }
+            pool->ids[line] = id;
+            pool->text_bytes += length;
+        }
+    }
+    pool->interned_lines += count;
+    return 1;
+}
+
+int line_pool_add_file(LinePool* pool, size_t file) {
+    if (!pool || !pool->data || file >= pool->data->file_count) {
+        return 0;
+    }
+    const DiffFile* entry = &pool->data->files[file];
+    if (!diff_data_file_is_parsed(entry) || entry->line_count == 0 ||
+        pool->ids[entry->first_line] != LINE_POOL_NONE) {
+        return 1; // Нечего добавлять или уже добавлено
+    }
+    // Совпавший текст сравнивается с первой строкой записи, а она может быть где угодно в буфере
+    diff_cold_store_pin(pool->data->cold, 0, pool->data->buffer_size);
+    const int ok = intern_lines(pool, entry->first_line, entry->line_count);
+    diff_cold_store_unpin(pool->data->cold, 0, pool->data->buffer_size);
+    return ok;
+}
+
+int line_pool_build(LinePool* pool, const DiffData* data) {
+    if (!pool || !data) {
+        return 0;
+    }
+    line_pool_destroy(pool);
+    pool->data = data;
+    if (data->line_count == 0) {
+        return 1;
+    }
+    // Таблица сразу на все строки: в обычном diff большинство текстов различны
+    pool->ids = malloc(data->line_count * sizeof(uint32_t));
+    if (!pool->ids || !grow_slots(pool, data->line_count)) {
+        log_error("line_pool: Failed to allocate ids for %zu lines", data->line_count);
+        line_pool_destroy(pool);
+        return 0;
+    }
+    memset(pool->ids, 0xFF, data->line_count * sizeof(uint32_t));
+    pool->line_count = data->line_count;
+
+    for (size_t i = 0; i < data->file_count; i++) {
+        if (!line_pool_add_file(pool, i)) {
+            line_pool_destroy(pool);
+            return 0;
+        }
+    }
+    log_debug("line_pool: %zu lines share %zu distinct texts, %zu of %zu text bytes are repeats",
+              pool->interned_lines, pool->entry_count, pool->text_bytes - pool->unique_bytes, pool->text_bytes);
+    return 1;
+}
+
+size_t line_pool_memory_usage(const LinePool* pool) {
+    if (!pool) {
+        return 0;
+    }
+    return pool->line_count * sizeof(uint32_t) + pool->entry_capacity * sizeof(LinePoolEntry) +
+           (pool->slots ? (pool->slot_mask + 1) * sizeof(struct LinePoolSlot) : 0);
+}
@@ -0,0 +1,80 @@
+// src/bench/line_pool.h
+#ifndef SEE_CODE_LINE_POOL_H
+#define SEE_CODE_LINE_POOL_H
+
+#include "see_code/data/diff_data.h"
+#include <stddef.h>
+#include <stdint.h>
+
+// Hash-consed pool of line texts (marker excluded), used by the parser
+// benchmark to measure how much of a diff's text is repeats. Every distinct
+// text gets one entry and every line gets the id of its entry, so two lines
+// have the same text exactly when their ids are equal.
+//
+// The viewer does not use it: lines are already spans into DiffData.buffer,
+// so there are no per-line copies to share, and an entry stores no copy of
+// its text either (it points at the first line that had it).
+//
+// Lines of files that are not parsed yet (lazily loaded diff) get
+// LINE_POOL_NONE; line_pool_add_file() interns them once the file is parsed.
+// Interning compares with texts anywhere in the buffer, so it pins the whole
+// buffer of a diff with a cold store; callers pin what line_pool_text() returns.
+
+#define LINE_POOL_NONE UINT32_MAX
+
+typedef struct {
+    uint64_t hash;    // hash_bytes() of the text
+    uint32_t offset;  // Text of the first line with it, in DiffData.buffer
+    uint32_t length;
+    uint32_t count;   // Lines with this text
+} LinePoolEntry;
+
+typedef struct {
+    const DiffData* data;   // Diff the ids belong to
+    uint32_t* ids;          // Entry of each line of data, LINE_POOL_NONE if not interned
+    size_t line_count;
+    LinePoolEntry* entries;
+    size_t entry_count;
+    size_t entry_capacity;
+    // Open addressing table: entry id and the high half of its hash, so that
+    // probing rarely has to look at the entries themselves
+    struct LinePoolSlot* slots;
+    size_t slot_mask;
+    // Totals over interned lines: text bytes, and text bytes counted once per entry
+    size_t interned_lines;
+    size_t text_bytes;
+    size_t unique_bytes;
+} LinePool;
+
+void line_pool_init(LinePool* pool);
+void line_pool_destroy(LinePool* pool);
+
+// Interns every line of the parsed files of data, dropping what the pool held.
+// Returns 1 on success, 0 if memory ran out (pool is then empty).
+int line_pool_build(LinePool* pool, const DiffData* data);
+
+// Interns the lines of a file parsed after line_pool_build() (does nothing
+// if they already are). Returns 0 if memory ran out.
+int line_pool_add_file(LinePool* pool, size_t file);
+
+// Entry id of a line, LINE_POOL_NONE if it is not interned
+static inline uint32_t line_pool_id(const LinePool* pool, size_t line) {
+    return line < pool->line_count ? pool->ids[line] : LINE_POOL_NONE;
+}
+
+// Whether two interned lines have the same text
+static inline int line_pool_same_text(const LinePool* pool, size_t a, size_t b) {
+    uint32_t id = line_pool_id(pool, a);
+    return id != LINE_POOL_NONE && id == line_pool_id(pool, b);
+}
+
+// Text of an entry (not null-terminated)
+static inline const char* line_pool_text(const LinePool* pool, uint32_t id, size_t* length) {
+    *length = pool->entries[id].length;
+    return pool->data->buffer + pool->entries[id].offset;
+}
+
+// Bytes held by the pool (ids, entries and hash table)
+size_t line_pool_memory_usage(const LinePool* pool);
+
+#endif // SEE_CODE_LINE_POOL_H
@@ -1,20 +1,35 @@
 // src/core/app.c
 #include "see_code/core/app.h"
 #include "see_code/core/config.h"
+#include "see_code/core/diff_tabs.h"
 #include "see_code/network/socket_server.h"
 #include "see_code/data/diff_data.h"
+#include "see_code/data/diff_cold_store.h"
+#include "see_code/data/diff_parser.h"
+#include "see_code/data/diff_snapshot.h"
+#include "see_code/utils/thread_pool.h"
 #include "see_code/utils/logger.h"
 #include "see_code/gui/termux_gui_backend.h" // Для критического fallback
 #include "see_code/gui/ui_manager.h"
 #include "see_code/gui/renderer.h"
 #include <pthread.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h> // Для usleep
 #define SCROLL_SENSITIVITY 20.0f
+// Первая строка передачи может выбрать вкладку diff:
+//   "@see_code tab <имя>\n"    - дальше идет diff для этой вкладки
+//   "@see_code switch <имя>\n" - только переключиться на уже открытую вкладку
+#define TAB_COMMAND_PREFIX "@see_code "
+#define TAB_HEADER_MAX 128
 // Forward declarations for internal use
 static void* socket_thread_func(void* arg);
-static void on_socket_data(const char* data_buffer, size_t length);
+static void on_socket_data(char* data_buffer, size_t length);
+static void on_stream_begin(void);
+static void on_stream_chunk(const char* data, size_t length);
+static void on_stream_end(int ok);
+static void switch_to_tab(DiffTab* tab);
 // --- Глобальное состояние приложения ---
 // Это упрощает доступ к состоянию из разных функций,
 // но в более крупных проектах можно рассмотреть передачу указателя на AppState.
@@ -26,13 +41,28 @@ static struct {
     SocketServer* socket_server;
     Renderer* renderer;             // GLES2 renderer
     UIManager* ui_manager;
-    DiffData* diff_data;
+    DiffData* diff_data;          // Diff показанной вкладки
+    DiffTabs tabs;                // Разобранные diff по именам, в пределах бюджета памяти
+    DiffTab* stream_tab;          // Вкладка, в которую идет текущая передача (только поток сокета)
+    char stream_header[TAB_HEADER_MAX]; // Начало передачи, пока не ясно, команда ли это
+    size_t stream_header_size;
+    int stream_header_pending;
+    int stream_discard;           // Остаток передачи не diff (переключение или ошибка)
+    DiffStreamParser diff_stream; // Инкрементальный разбор входящего diff
+    // Повторная отправка diff копится целиком и применяется через reload,
+    // который переиспользует неизменившиеся файлы (только поток сокета)
+    char* reload_buffer;
+    size_t reload_size;
+    size_t reload_capacity;
+    int reloading;
+    int reload_failed;
     TermuxGUIBackend* termux_backend; // Backend для критического fallback
     // Threading
     pthread_mutex_t state_mutex;
     pthread_t socket_thread;
     // Application state
     float scroll_y;
+    float scroll_x;
     int needs_redraw;
 } g_app = {0}; // Инициализируем всё нулями
 // --- Вспомогательная функция для проверки состояния текстового рендерера ---
@@ -81,12 +111,15 @@ static int app_init_internal(const AppConfig* config) {
         // Не переходим к cleanup, так как мьютекс не был инициализирован
         return 0;
     }
-    // 2. Создаем контейнер для данных diff
-    g_app.diff_data = diff_data_create();
-    if (!g_app.diff_data) {
+    // 2. Создаем вкладку для diff без имени (ее данные показываются при старте)
+    diff_tabs_init(&g_app.tabs, config->tab_budget);
+    DiffTab* default_tab = diff_tabs_open(&g_app.tabs, DIFF_TAB_DEFAULT_NAME);
+    if (!default_tab) {
         log_error("Failed to create diff data container");
         goto cleanup; // Переход к освобождению ресурсов
     }
+    diff_tabs_set_current(&g_app.tabs, default_tab);
+    g_app.diff_data = default_tab->data;
     // --- ЛОГИКА ИНИЦИАЛИЗАЦИИ ГРАФИЧЕСКОЙ ПОДСИСТЕМЫ ---
     log_info("Attempting to initialize primary GLES2 renderer...");
     // Попытка 1: Инициализация основного GLES2 рендерера
@@ -165,22 +198,43 @@ renderer_success:
     // и g_app.ui_manager создан.
     log_info("Renderer (either GLES2+Text or Termux-GUI) and UI Manager initialized successfully.");
     // --- КОНЕЦ ЛОГИКИ ИНИЦИАЛИЗАЦИИ ГРАФИКИ ---
-    // 3. Создаем и запускаем сервер сокетов
+    // Контекст ханков читается из рабочего дерева, к которому относятся пути diff
+    ui_manager_set_work_tree(g_app.ui_manager, config->work_tree);
+    // В альбомной ориентации старая и новая версии показываются рядом
+    ui_manager_set_side_by_side(g_app.ui_manager, config->landscape_mode && !config->unified);
+    switch_to_tab(default_tab);
+    // 3. Diff из файла (--file): отображается в память и разбирается без копий,
+    // ограничение MAX_MESSAGE_SIZE сокета к нему не относится
+    if (config->diff_path) {
+        if (!diff_data_load_from_file(g_app.diff_data, config->diff_path)) {
+            log_error("Failed to load diff from %s", config->diff_path);
+            goto cleanup;
+        }
+        // Отображенный файл store не получит, прочитанный из stdin - получит
+        diff_cold_store_attach(g_app.diff_data);
+        ui_manager_set_diff_data(g_app.ui_manager, g_app.diff_data);
+    } else if (diff_snapshot_load(g_app.diff_data, SNAPSHOT_PATH)) {
+        // Перезапуск: последний diff показывается из снимка, без повторной отправки и разбора
+        ui_manager_set_diff_data(g_app.ui_manager, g_app.diff_data);
+    }
+    // 4. Создаем и запускаем сервер сокетов (повторные diff приходят через него)
     g_app.socket_server = socket_server_create(config->socket_path, on_socket_data);
     if (!g_app.socket_server) {
         log_error("Failed to create socket server");
         goto cleanup;
     }
+    // Diff разбирается по мере прихода данных, первый экран появляется до конца передачи
+    socket_server_set_stream_callbacks(g_app.socket_server, on_stream_begin, on_stream_chunk, on_stream_end);
     if (socket_server_start(g_app.socket_server) != 0) {
         log_error("Failed to start socket server");
         goto cleanup;
     }
-    // 4. Создаем поток для обработки сокетов
+    // 5. Создаем поток для обработки сокетов
     if (pthread_create(&g_app.socket_thread, NULL, socket_thread_func, NULL) != 0) {
         log_error("Failed to create socket thread");
         goto cleanup;
     }
-    // 5. Финальная настройка состояния приложения
+    // 6. Финальная настройка состояния приложения
     g_app.running = 1;
     g_app.initialized = 1;
     g_app.needs_redraw = 1;
@@ -218,10 +272,9 @@ cleanup:
         termux_gui_backend_destroy(g_app.termux_backend);
         g_app.termux_backend = NULL;
     }
-    if (g_app.diff_data) {
-        diff_data_destroy(g_app.diff_data);
-        g_app.diff_data = NULL;
-    }
+    // Данные вкладок уничтожаются после UI manager: его поиск читает их
+    diff_tabs_destroy(&g_app.tabs);
+    g_app.diff_data = NULL;
     // Уничтожаем мьютекс
     pthread_mutex_destroy(&g_app.state_mutex);
     // Полная очистка состояния
@@ -267,14 +320,15 @@ void app_cleanup() {
         termux_gui_backend_destroy(g_app.termux_backend);
         g_app.termux_backend = NULL;
     }
-    // 6. Уничтожаем данные diff
-    if (g_app.diff_data) {
-        diff_data_destroy(g_app.diff_data);
-        g_app.diff_data = NULL;
-    }
-    // 7. Уничтожаем мьютекс
+    // 6. Уничтожаем вкладки с данными diff
+    diff_tabs_destroy(&g_app.tabs);
+    g_app.diff_data = NULL;
+    free(g_app.reload_buffer);
+    // 7. Останавливаем общий пул потоков (парсер больше не запускается)
+    thread_pool_shared_shutdown();
+    // 8. Уничтожаем мьютекс
     pthread_mutex_destroy(&g_app.state_mutex);
-    // 8. Очищаем состояние
+    // 9. Очищаем состояние
     memset(&g_app, 0, sizeof(g_app));
     log_info("Application shutdown complete.");
 }
@@ -289,11 +343,32 @@ void app_update(float delta_time) {
     if (!g_app.initialized || !g_app.running) {
         return;
     }
-    // Обновляем UI manager
+    // Обновляем UI manager. Результаты фоновых задач забираются под state_mutex:
+    // поток сокета может в это время заменить diff вида и сбросить его кэши
     if (g_app.ui_manager) {
+        pthread_mutex_lock(&g_app.state_mutex);
         ui_manager_update(g_app.ui_manager, delta_time);
+        pthread_mutex_unlock(&g_app.state_mutex);
+    }
+}
+// Держит несжатым не больше бюджета текста показанного diff, а скрытые вкладки
+// сжимает целиком (под state_mutex: вкладки и их diff не меняются)
+static void maintain_cold_stores(void) {
+    const size_t budget = g_app.config.resident_budget ? g_app.config.resident_budget : DIFF_COLD_DEFAULT_BUDGET;
+    for (size_t i = 0; i < g_app.tabs.count; i++) {
+        const DiffTab* tab = g_app.tabs.tabs[i];
+        if (!tab->data || !tab->data->cold) {
+            continue;
+        }
+        if (tab == g_app.tabs.current) {
+            diff_cold_store_maintain(tab->data->cold, budget);
+        } else {
+            diff_cold_store_set_view(tab->data->cold, 0, 0);
+            diff_cold_store_maintain(tab->data->cold, 0);
+        }
     }
 }
+
 int app_render() {
     if (!g_app.initialized || !g_app.running) {
         return 0;
@@ -304,6 +379,8 @@ int app_render() {
     if (g_app.ui_manager) {
         current_renderer_type = ui_manager_get_renderer_type(g_app.ui_manager);
     }
+    // Данные diff могут дополняться потоком сокета прямо во время отрисовки
+    pthread_mutex_lock(&g_app.state_mutex);
     if (current_renderer_type == RENDERER_TYPE_GLES2) {
         if (g_app.renderer && g_app.ui_manager) {
             renderer_begin_frame(g_app.renderer);
@@ -324,6 +401,8 @@ int app_render() {
     } else {
         log_error("Unknown or unsupported renderer type during render call");
     }
+    maintain_cold_stores();
+    pthread_mutex_unlock(&g_app.state_mutex);
     return frame_rendered;
 }
 // --- Обработка ввода ---
@@ -337,18 +416,34 @@ void app_handle_key(int key_code) {
     // Теперь ui_manager_handle_key должен обрабатывать ввод для виджетов
     if (g_app.ui_manager) {
         ui_manager_handle_key(g_app.ui_manager, key_code);
+        // Переход к совпадению поиска прокручивает diff
+        g_app.scroll_y = ui_manager_get_scroll_y(g_app.ui_manager);
+        g_app.scroll_x = ui_manager_get_scroll_x(g_app.ui_manager);
         g_app.needs_redraw = 1;
     }
     pthread_mutex_unlock(&g_app.state_mutex);
 }
 // --- КОНЕЦ ОБНОВЛЕННОЙ ФУНКЦИИ ---
-void app_handle_scroll(float delta_y) {
+void app_handle_scroll(float delta_x, float delta_y) {
     if (!g_app.initialized || !g_app.running) {
         return;
     }
     pthread_mutex_lock(&g_app.state_mutex);
+    if (g_app.ui_manager) {
+        // Прокрутку мог сдвинуть и сам UI manager (переход к совпадению поиска)
+        g_app.scroll_y = ui_manager_get_scroll_y(g_app.ui_manager);
+        g_app.scroll_x = ui_manager_get_scroll_x(g_app.ui_manager);
+    }
     g_app.scroll_y -= delta_y * SCROLL_SENSITIVITY;
     if (g_app.scroll_y < 0) g_app.scroll_y = 0;
+    g_app.scroll_x -= delta_x * SCROLL_SENSITIVITY;
+    if (g_app.ui_manager) {
+        ui_manager_update_layout(g_app.ui_manager, g_app.scroll_y);
+        // UI manager ограничивает сдвиг длиной самой длинной видимой строки
+        g_app.scroll_x = ui_manager_set_scroll_x(g_app.ui_manager, g_app.scroll_x);
+    } else if (g_app.scroll_x < 0) {
+        g_app.scroll_x = 0;
+    }
     g_app.needs_redraw = 1;
     pthread_mutex_unlock(&g_app.state_mutex);
 }
@@ -360,6 +455,13 @@ void app_handle_touch(float x, float y) {
     // Передаем событие в UI manager
     if (g_app.ui_manager) {
         ui_manager_handle_touch(g_app.ui_manager, x, y);
+        // Кнопка меню переключает вкладки diff по кругу
+        if (ui_manager_take_menu_request(g_app.ui_manager)) {
+            DiffTab* next = diff_tabs_next(&g_app.tabs, g_app.tabs.current);
+            if (next && next != g_app.tabs.current) {
+                switch_to_tab(next);
+            }
+        }
         g_app.needs_redraw = 1;
     }
     pthread_mutex_unlock(&g_app.state_mutex);
@@ -386,6 +488,71 @@ void app_set_diff_data(const DiffData* data) {
 const DiffData* app_get_diff_data() {
     return g_app.diff_data;
 }
+// --- Вкладки diff ---
+// Все функции раздела вызываются под state_mutex
+
+static int tab_on_screen(const DiffTab* tab) {
+    return tab && tab == g_app.tabs.current;
+}
+
+// Поиск читает только показанный diff: изменения скрытых вкладок его не касаются
+static void pause_search_for(const DiffTab* tab) {
+    if (tab_on_screen(tab)) {
+        ui_manager_pause_search(g_app.ui_manager);
+    }
+}
+
+static void resume_search_for(const DiffTab* tab) {
+    if (tab_on_screen(tab)) {
+        ui_manager_resume_search(g_app.ui_manager);
+    }
+}
+
+// Сообщает UI, что diff вкладки загружен заново
+// previous - версия, из которой собран tab->data (NULL, если diff загружен заново):
+// кэши отрисовки неизменившихся файлов переносятся из нее
+static void refresh_tab_view(DiffTab* tab, const DiffData* previous) {
+    if (tab_on_screen(tab)) {
+        ui_manager_reload_diff_data(g_app.ui_manager, previous, tab->data);
+        g_app.needs_redraw = 1;
+    } else {
+        // Разметка скрытой вкладки перестроится, когда ее покажут
+        ui_diff_view_reload(tab->view, previous, tab->data);
+    }
+}
+
+static void update_title(void) {
+    const DiffTab* tab = g_app.tabs.current;
+    if (!tab || !g_app.ui_manager) {
+        return;
+    }
+    char title[DIFF_TAB_NAME_MAX + 48];
+    snprintf(title, sizeof(title), "%s (%zu/%zu)", tab->name,
+             diff_tabs_index(&g_app.tabs, tab) + 1, g_app.tabs.count);
+    ui_manager_set_title(g_app.ui_manager, title);
+}
+
+static void enforce_tab_budget(void) {
+    if (diff_tabs_enforce_budget(&g_app.tabs) > 0) {
+        update_title();
+    }
+}
+
+static void switch_to_tab(DiffTab* tab) {
+    diff_tabs_set_current(&g_app.tabs, tab);
+    g_app.diff_data = tab->data;
+    if (g_app.ui_manager) {
+        // Вид вкладки хранит разметку и прокрутку с прошлого показа
+        ui_manager_show_view(g_app.ui_manager, tab->data, tab->view);
+        g_app.scroll_y = ui_manager_get_scroll_y(g_app.ui_manager);
+        g_app.scroll_x = ui_manager_get_scroll_x(g_app.ui_manager);
+    }
+    update_title();
+    // Предыдущая вкладка теперь может быть выгружена
+    enforce_tab_budget();
+    g_app.needs_redraw = 1;
+}
+
 // --- Сетевой слой ---
 // Потоковая функция для сервера сокетов
 static void* socket_thread_func(void* arg) {
@@ -398,21 +565,330 @@ static void* socket_thread_func(void* arg) {
     log_info("Socket server thread finished");
     return NULL;
 }
-// Callback, вызываемый сервером сокетов при получении данных
-static void on_socket_data(const char* data_buffer, size_t length) {
-    log_info("Received %zu raw bytes from client", length);
+// Сохраняет только что разобранный diff вкладки для быстрого перезапуска.
+// Только поток сокета: кроме него diff меняет лишь рендерер, и то только флаги
+// сворачивания (атомарно) и ячейки ленивых файлов, а такие diff не приходят потоком
+// и пишутся до публикации. Снимок один, в нем diff вкладки по умолчанию.
+static void save_snapshot(const DiffTab* tab, const DiffData* data) {
+    if (strcmp(tab->name, DIFF_TAB_DEFAULT_NAME) == 0 && data->file_count > 0) {
+        diff_snapshot_write(data, SNAPSHOT_PATH);
+    }
+}
+
+// --- Замена версии diff ---
+// Новая версия diff собирается без state_mutex в отдельном DiffData, пока рендер
+// и ввод работают со старой, и подменяется одним присваиванием указателя под
+// мьютексом. Кадр и ввод читают diff только под state_mutex, поиск на время
+// подмены остановлен, а подсветка синтаксиса работает с копиями текста: после
+// подмены старую версию никто не видит, и она освобождается в фоне.
+
+static void publish_tab_data(DiffTab* tab, DiffData* next) {
+    DiffData* old = tab->data;
+    // Новую версию пока никто не читает: store подключается до публикации
+    diff_cold_store_attach(next);
+    pause_search_for(tab);
+    tab->data = next;
+    if (tab_on_screen(tab)) {
+        g_app.diff_data = next;
+    }
+    if (g_app.ui_manager) {
+        refresh_tab_view(tab, old);
+    }
+    diff_data_destroy_async(old);
+}
+
+// Только поток сокета: diff вкладки меняет лишь он, а закрепленную вкладку не
+// выгрузят, поэтому tab->data читается без блокировки
+static void rebuild_tab(DiffTab* tab, char* buffer, size_t size) {
+    DiffData* next = diff_parser_rebuild_owned(tab->data, buffer, size);
+    if (!next) {
+        log_error("Failed to load diff '%s', keeping the current one", tab->name);
+        return;
+    }
+    log_info("Diff '%s' loaded: %zu files", tab->name, next->file_count);
+    // Снимок пишется до публикации: I/O не держит мьютекс
+    save_snapshot(tab, next);
     pthread_mutex_lock(&g_app.state_mutex);
-    // Загружаем данные из буфера с помощью парсера
-    if (g_app.diff_data && diff_data_load_from_buffer(g_app.diff_data, data_buffer, length)) {
-        log_info("Successfully loaded data from raw buffer");
-        g_app.needs_redraw = 1;
-        // Обновляем UI с новыми данными
-        if (g_app.ui_manager) {
-            ui_manager_set_diff_data(g_app.ui_manager, g_app.diff_data);
+    publish_tab_data(tab, next);
+    g_app.needs_redraw = 1;
+    pthread_mutex_unlock(&g_app.state_mutex);
+}
+
+// --- Команды вкладок ---
+
+typedef enum {
+    TAB_COMMAND_NONE,   // Обычный diff для вкладки по умолчанию
+    TAB_COMMAND_TAB,    // Diff для вкладки name
+    TAB_COMMAND_SWITCH  // Переключение на вкладку name
+} TabCommandKind;
+
+typedef struct {
+    TabCommandKind kind;
+    char name[DIFF_TAB_NAME_MAX];
+    size_t consumed; // Байты строки команды вместе с '\n'
+} TabCommand;
+
+// Разбирает начало передачи. Возвращает 0, если для решения нужны еще данные
+// (complete == 0 и строка команды еще не пришла целиком).
+static int parse_tab_command(const char* text, size_t length, int complete, TabCommand* command) {
+    memset(command, 0, sizeof(TabCommand));
+    const size_t prefix_length = strlen(TAB_COMMAND_PREFIX);
+    const size_t compared = length < prefix_length ? length : prefix_length;
+    if (memcmp(text, TAB_COMMAND_PREFIX, compared) != 0) {
+        return 1;
+    }
+    const char* newline = memchr(text, '\n', length);
+    if (!newline) {
+        if (!complete && length < TAB_HEADER_MAX) {
+            return 0;
         }
+        log_warn("Unterminated see_code command line, treating it as diff");
+        return 1;
+    }
+    if (compared < prefix_length) {
+        return 1;
+    }
+    command->consumed = (size_t)(newline - text) + 1;
+    const char* verb = text + prefix_length;
+    const char* end = newline;
+    if (end > verb && end[-1] == '\r') end--;
+    const char* name = NULL;
+    if ((size_t)(end - verb) > 4 && memcmp(verb, "tab ", 4) == 0) {
+        command->kind = TAB_COMMAND_TAB;
+        name = verb + 4;
+    } else if ((size_t)(end - verb) > 7 && memcmp(verb, "switch ", 7) == 0) {
+        command->kind = TAB_COMMAND_SWITCH;
+        name = verb + 7;
+    }
+    size_t name_length = name ? (size_t)(end - name) : 0;
+    if (!name || name_length >= DIFF_TAB_NAME_MAX) {
+        // Строка команды отбрасывается, diff уходит во вкладку по умолчанию
+        log_error("Invalid see_code command: %.*s", (int)(end - text), text);
+        command->kind = TAB_COMMAND_NONE;
+        return 1;
+    }
+    memcpy(command->name, name, name_length);
+    command->name[name_length] = '\0';
+    return 1;
+}
+
+// Выбирает и показывает вкладку по команде. Возвращает вкладку, в которую
+// пойдет diff передачи, или NULL, если diff за командой не следует.
+static DiffTab* apply_tab_command(const TabCommand* command) {
+    if (command->kind == TAB_COMMAND_SWITCH) {
+        DiffTab* tab = diff_tabs_find(&g_app.tabs, command->name);
+        if (tab) {
+            switch_to_tab(tab);
+        } else {
+            log_warn("No diff tab named '%s'", command->name);
+        }
+        return NULL;
+    }
+    const char* name = command->kind == TAB_COMMAND_TAB ? command->name : DIFF_TAB_DEFAULT_NAME;
+    DiffTab* tab = diff_tabs_open(&g_app.tabs, name);
+    if (tab) {
+        // Отправленный diff сразу показывается
+        switch_to_tab(tab);
+    }
+    return tab;
+}
+
+// Callback, вызываемый сервером сокетов при получении данных.
+// Буфер принадлежит нам: отдаем его DiffData без копирования.
+static void on_socket_data(char* data_buffer, size_t length) {
+    log_info("Received %zu raw bytes from client", length);
+    TabCommand command;
+    parse_tab_command(data_buffer, length, 1, &command);
+    if (command.consumed > 0) {
+        memmove(data_buffer, data_buffer + command.consumed, length - command.consumed);
+        length -= command.consumed;
+    }
+    pthread_mutex_lock(&g_app.state_mutex);
+    DiffTab* tab = apply_tab_command(&command);
+    if (tab && length > 0) {
+        tab->pinned = 1;
+    }
+    pthread_mutex_unlock(&g_app.state_mutex);
+    if (!tab || length == 0) {
+        free(data_buffer);
+        return;
+    }
+    // Разбор идет без мьютекса; неизменившиеся файлы переиспользуются
+    rebuild_tab(tab, data_buffer, length);
+    pthread_mutex_lock(&g_app.state_mutex);
+    tab->pinned = 0;
+    enforce_tab_budget();
+    g_app.needs_redraw = 1;
+    pthread_mutex_unlock(&g_app.state_mutex);
+}
+// --- Потоковый прием diff ---
+// Первый diff вкладки разбирается по мере прихода: каждый кусок под state_mutex,
+// завершенные файлы сразу видны рендереру. Если у вкладки уже есть diff, новый
+// копится целиком (старый остается на экране) и в конце собирается в новую версию.
+// Строка команды в начале передачи копится отдельно, пока не станет ясно, что это.
+static void on_stream_begin(void) {
+    // Состояние передачи трогает только поток сокета
+    g_app.stream_header_pending = 1;
+    g_app.stream_header_size = 0;
+    g_app.stream_discard = 0;
+    g_app.stream_tab = NULL;
+}
+
+static void begin_tab_stream(const TabCommand* command) {
+    pthread_mutex_lock(&g_app.state_mutex);
+    DiffTab* tab = apply_tab_command(command);
+    if (!tab) {
+        g_app.stream_discard = 1;
+        pthread_mutex_unlock(&g_app.state_mutex);
+        return;
+    }
+    // Вкладка не выгружается, пока в нее идет передача
+    tab->pinned = 1;
+    g_app.stream_tab = tab;
+    if (tab->data->file_count > 0) {
+        g_app.reloading = 1;
+        g_app.reload_failed = 0;
+        g_app.reload_size = 0;
     } else {
-        log_error("Failed to load diff data from buffer");
-        // Можно отобразить сообщение об ошибке в UI
+        pause_search_for(tab);
+        if (diff_stream_begin(&g_app.diff_stream, tab->data)) {
+            if (g_app.ui_manager) {
+                refresh_tab_view(tab, NULL);
+            }
+            g_app.needs_redraw = 1;
+        } else {
+            resume_search_for(tab);
+        }
+    }
+    pthread_mutex_unlock(&g_app.state_mutex);
+}
+
+// Буфер reload трогает только поток сокета, блокировка не нужна
+static void append_reload_chunk(const char* data, size_t length) {
+    if (g_app.reload_failed) {
+        return;
+    }
+    if (g_app.reload_size + length > g_app.reload_capacity) {
+        size_t new_capacity = g_app.reload_capacity ? g_app.reload_capacity * 2 : 64 * 1024;
+        while (new_capacity < g_app.reload_size + length) new_capacity *= 2;
+        char* grown = realloc(g_app.reload_buffer, new_capacity);
+        if (!grown) {
+            log_error("Failed to grow reload buffer to %zu bytes", new_capacity);
+            g_app.reload_failed = 1;
+            return;
+        }
+        g_app.reload_buffer = grown;
+        g_app.reload_capacity = new_capacity;
+    }
+    memcpy(g_app.reload_buffer + g_app.reload_size, data, length);
+    g_app.reload_size += length;
+}
+
+static void feed_stream(const char* data, size_t length) {
+    if (length == 0 || g_app.stream_discard) {
+        return;
     }
+    if (g_app.reloading) {
+        append_reload_chunk(data, length);
+        return;
+    }
+    pthread_mutex_lock(&g_app.state_mutex);
+    DiffTab* tab = g_app.stream_tab;
+    if (tab && g_app.diff_stream.data) {
+        size_t published_before = tab->data->file_count;
+        pause_search_for(tab);
+        if (!diff_stream_feed(&g_app.diff_stream, data, length)) {
+            log_error("Failed to parse incoming diff chunk");
+        } else if (tab->data->file_count != published_before && tab_on_screen(tab)) {
+            g_app.needs_redraw = 1;
+        }
+        // Уже просмотренные части diff не ищутся повторно, только дописанные файлы
+        resume_search_for(tab);
+    }
+    pthread_mutex_unlock(&g_app.state_mutex);
+}
+
+// Копит начало передачи до конца строки команды; complete - передача закончилась
+static void feed_stream_header(const char* data, size_t length, int complete) {
+    size_t taken = TAB_HEADER_MAX - g_app.stream_header_size;
+    if (taken > length) taken = length;
+    memcpy(g_app.stream_header + g_app.stream_header_size, data, taken);
+    g_app.stream_header_size += taken;
+    TabCommand command;
+    if (!parse_tab_command(g_app.stream_header, g_app.stream_header_size, complete, &command)) {
+        return;
+    }
+    g_app.stream_header_pending = 0;
+    begin_tab_stream(&command);
+    // Все, что после строки команды, уже diff
+    feed_stream(g_app.stream_header + command.consumed, g_app.stream_header_size - command.consumed);
+    feed_stream(data + taken, length - taken);
+}
+
+static void on_stream_chunk(const char* data, size_t length) {
+    if (g_app.stream_header_pending) {
+        feed_stream_header(data, length, 0);
+        return;
+    }
+    feed_stream(data, length);
+}
+
+static void finish_reload(DiffTab* tab, int ok) {
+    char* buffer = g_app.reload_buffer;
+    size_t size = g_app.reload_size;
+    // Буфер уходит во владение DiffData
+    g_app.reload_buffer = NULL;
+    g_app.reload_size = 0;
+    g_app.reload_capacity = 0;
+    g_app.reloading = 0;
+    if (!ok || g_app.reload_failed || size == 0) {
+        log_warn("Diff reload aborted, keeping the current diff");
+        free(buffer);
+        return;
+    }
+    rebuild_tab(tab, buffer, size);
+}
+
+static void on_stream_end(int ok) {
+    if (g_app.stream_header_pending && g_app.stream_header_size > 0) {
+        // Передача короче строки команды
+        feed_stream_header("", 0, 1);
+    }
+    g_app.stream_header_pending = 0;
+    DiffTab* tab = g_app.stream_tab;
+    g_app.stream_tab = NULL;
+    if (!tab) {
+        return;
+    }
+    if (g_app.reloading) {
+        finish_reload(tab, ok);
+    }
+    int finished = 0;
+    pthread_mutex_lock(&g_app.state_mutex);
+    if (g_app.diff_stream.data) {
+        pause_search_for(tab);
+        if (diff_stream_finish(&g_app.diff_stream)) {
+            log_info("Diff stream '%s' complete: %zu files%s", tab->name, tab->data->file_count,
+                     ok ? "" : " (connection ended with an error)");
+            // Поиск остановлен, буфер больше не меняется
+            diff_cold_store_attach(tab->data);
+            finished = 1;
+        } else {
+            log_error("Failed to finish diff stream");
+        }
+        g_app.diff_stream.data = NULL;
+        resume_search_for(tab);
+    }
+    pthread_mutex_unlock(&g_app.state_mutex);
+    // Снимок пишется без мьютекса: diff больше не меняется, а закрепленную
+    // вкладку не выгрузят, пока она не откреплена ниже
+    if (finished && ok) {
+        save_snapshot(tab, tab->data);
+    }
+    pthread_mutex_lock(&g_app.state_mutex);
+    tab->pinned = 0;
+    // Новый diff мог вытеснить давно не просмотренные вкладки
+    enforce_tab_budget();
+    g_app.needs_redraw = 1;
     pthread_mutex_unlock(&g_app.state_mutex);
 }
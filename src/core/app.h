@@ -25,7 +25,6 @@ int app_render(void);
 // Event handling
 void app_handle_key(int key_code);
 void app_handle_touch(float x, float y);
-void app_handle_scroll(float delta_y);
 
 // Data functions
 void app_set_diff_data(const DiffData* data);
@@ -36,7 +35,7 @@ int app_update(void);
 void app_shutdown(void);
 void app_handle_resize(int width, int height);
 const AppConfig* app_get_config(void);
-void app_handle_scroll(float dx, float dy);
+void app_handle_scroll(float dx, float dy); // dx - горизонтальная прокрутка строк
 
 // Функция для получения времени (используется в widgets.c)
 unsigned long long app_get_time_millis(void);
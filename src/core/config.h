@@ -2,8 +2,11 @@
 #ifndef SEE_CODE_CONFIG_H
 #define SEE_CODE_CONFIG_H
 
+#include <stddef.h>
+
 // --- Paths ---
 #define SOCKET_PATH "/data/data/com.termux/files/usr/tmp/see_code_socket"
+#define SNAPSHOT_PATH "/data/data/com.termux/files/usr/tmp/see_code_snapshot.bin" // Последний разобранный diff
 #define FREETYPE_FONT_PATH "/system/fonts/Roboto-Regular.ttf"
 #define TRUETYPE_FONT_PATH "/system/fonts/DroidSansMono.ttf"
 #define FALLBACK_FONT_PATH "/data/data/com.termux/files/usr/share/fonts/liberation/LiberationMono-Regular.ttf"
@@ -16,15 +19,41 @@
 #define FILE_HEADER_HEIGHT 30.0f
 #define MARGIN 10.0f
 #define HUNK_PADDING 5.0f
+#define GUTTER_PADDING 4.0f // Отступ по бокам столбца номеров строк
+#define SPLIT_PANE_GAP 10.0f // Промежуток между половинами в режиме "рядом"
 #define SCROLL_SENSITIVITY 10.0f
+#define CONTEXT_EXPAND_LINES 10 // Строки рабочего дерева, добавляемые над ханком за одно касание заголовка
 
 // --- Colors (0xAARRGGBB) ---
 #define COLOR_BACKGROUND 0xFF111111
 #define COLOR_FILE_HEADER 0xFF4444FF
+#define COLOR_FILE_ADDITIONS 0xFF88FF88 // Счетчики строк в заголовке файла
+#define COLOR_FILE_DELETIONS 0xFFFF8888
 #define COLOR_HUNK_HEADER 0xFF00AA00
 #define COLOR_ADD_LINE 0xFF00AA00
 #define COLOR_DEL_LINE 0xFFAA0000
 #define COLOR_CONTEXT_LINE 0xFF888888
+#define COLOR_ADD_WORD 0xFF006600 // Фон измененных слов внутри строки
+#define COLOR_DEL_WORD 0xFF660000
+#define COLOR_LINE_NUMBER 0xFF666666
+#define COLOR_ROW_FILLER 0xFF1A1A1A // Пустая половина ряда в режиме "рядом"
+#define COLOR_SEARCH_MATCH 0xFF665500   // Фон найденного текста
+#define COLOR_SEARCH_CURRENT 0xFFAA7700 // Фон совпадения, на котором стоит навигация
+// Перенесенный код: удаленный блок, найденный в другом месте diff, и его новое место.
+// Соседние блоки чередуют оттенки фона (_ALT)
+#define COLOR_MOVED_DEL_TEXT 0xFFFF66FF
+#define COLOR_MOVED_DEL_BG 0xFF2A0030
+#define COLOR_MOVED_DEL_BG_ALT 0xFF3C0044
+#define COLOR_MOVED_ADD_TEXT 0xFF55DDFF
+#define COLOR_MOVED_ADD_BG 0xFF00262E
+#define COLOR_MOVED_ADD_BG_ALT 0xFF003742
+#define COLOR_MOVED_LINK 0xFFFFFFFF // Подпись "moved to/from файл:строка" у первой строки блока
+// Подсветка синтаксиса (остальной текст рисуется цветом типа строки)
+#define COLOR_SYNTAX_KEYWORD 0xFFC586C0
+#define COLOR_SYNTAX_STRING 0xFFCE9178
+#define COLOR_SYNTAX_NUMBER 0xFFB5CEA8
+#define COLOR_SYNTAX_COMMENT 0xFF6A9955
+#define COLOR_SYNTAX_PREPROCESSOR 0xFF9CDCFE
 
 // --- Font Sizes ---
 #define FONT_SIZE_DEFAULT 14
@@ -41,6 +70,11 @@ typedef struct {
     int landscape_mode;
     int verbose;
     int debug;
+    const char* diff_path; // --file: diff opened at startup ("-" = stdin), NULL = wait for the socket
+    size_t tab_budget;     // --tab-budget: bytes kept for parsed diff tabs, 0 = DIFF_TABS_DEFAULT_BUDGET
+    size_t resident_budget; // --resident-budget: uncompressed diff text of the tab on screen, 0 = DIFF_COLD_DEFAULT_BUDGET
+    const char* work_tree; // --work-tree: directory diff paths are relative to, NULL = current directory
+    int unified;           // --unified: keep the unified layout in landscape mode
 } AppConfig;
 
 #define LOG_FILE_PATH "/data/data/com.termux/files/usr/tmp/see_code.log"
@@ -49,7 +83,7 @@ typedef struct {
 // --- UI Widget Configuration ---
 // Текстовое поле ввода
 #define INPUT_FIELD_HEIGHT 60.0f
-#define INPUT_FIELD_PLACEHOLDER_TEXT "type here"
+#define INPUT_FIELD_PLACEHOLDER_TEXT "search"
 #define INPUT_FIELD_PLACEHOLDER_COLOR 0xFF888888 // Серый
 #define INPUT_FIELD_TEXT_COLOR 0xFF000000       // Черный
 #define INPUT_FIELD_BACKGROUND_COLOR 0xFFFFFFFF // Белый
@@ -0,0 +1,156 @@
+// src/core/diff_tabs.c
+#include "see_code/core/diff_tabs.h"
+#include "see_code/utils/logger.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// --- Создание и поиск ---
+
+void diff_tabs_init(DiffTabs* tabs, size_t budget) {
+    if (!tabs) {
+        return;
+    }
+    memset(tabs, 0, sizeof(DiffTabs));
+    tabs->budget = budget ? budget : DIFF_TABS_DEFAULT_BUDGET;
+}
+
+static void tab_destroy(DiffTab* tab) {
+    ui_diff_view_destroy(tab->view);
+    diff_data_destroy(tab->data);
+    free(tab);
+}
+
+void diff_tabs_destroy(DiffTabs* tabs) {
+    if (!tabs) {
+        return;
+    }
+    for (size_t i = 0; i < tabs->count; i++) {
+        tab_destroy(tabs->tabs[i]);
+    }
+    free(tabs->tabs);
+    memset(tabs, 0, sizeof(DiffTabs));
+}
+
+DiffTab* diff_tabs_find(const DiffTabs* tabs, const char* name) {
+    if (!tabs || !name) {
+        return NULL;
+    }
+    for (size_t i = 0; i < tabs->count; i++) {
+        // Имя сравнивается в том виде, в каком оно сохранено (с обрезкой)
+        if (strncmp(tabs->tabs[i]->name, name, DIFF_TAB_NAME_MAX - 1) == 0) {
+            return tabs->tabs[i];
+        }
+    }
+    return NULL;
+}
+
+DiffTab* diff_tabs_open(DiffTabs* tabs, const char* name) {
+    if (!tabs || !name) {
+        return NULL;
+    }
+    DiffTab* tab = diff_tabs_find(tabs, name);
+    if (tab) {
+        return tab;
+    }
+    if (tabs->count == tabs->capacity) {
+        size_t new_capacity = tabs->capacity ? tabs->capacity * 2 : 4;
+        DiffTab** grown = realloc(tabs->tabs, new_capacity * sizeof(DiffTab*));
+        if (!grown) {
+            log_error("diff_tabs: Failed to grow tab list to %zu", new_capacity);
+            return NULL;
+        }
+        tabs->tabs = grown;
+        tabs->capacity = new_capacity;
+    }
+    tab = calloc(1, sizeof(DiffTab));
+    if (!tab) {
+        log_error("diff_tabs: Failed to allocate tab '%s'", name);
+        return NULL;
+    }
+    snprintf(tab->name, sizeof(tab->name), "%s", name);
+    tab->data = diff_data_create();
+    tab->view = ui_diff_view_create();
+    if (!tab->data || !tab->view) {
+        log_error("diff_tabs: Failed to create diff for tab '%s'", name);
+        tab_destroy(tab);
+        return NULL;
+    }
+    tabs->tabs[tabs->count++] = tab;
+    log_info("diff_tabs: Opened tab '%s'", tab->name);
+    return tab;
+}
+
+// --- Переключение ---
+
+void diff_tabs_set_current(DiffTabs* tabs, DiffTab* tab) {
+    if (!tabs || !tab) {
+        return;
+    }
+    tabs->current = tab;
+    tab->last_viewed = ++tabs->clock;
+}
+
+size_t diff_tabs_index(const DiffTabs* tabs, const DiffTab* tab) {
+    if (!tabs) {
+        return 0;
+    }
+    size_t i = 0;
+    while (i < tabs->count && tabs->tabs[i] != tab) i++;
+    return i;
+}
+
+DiffTab* diff_tabs_next(const DiffTabs* tabs, const DiffTab* tab) {
+    if (!tabs || tabs->count == 0) {
+        return NULL;
+    }
+    size_t i = diff_tabs_index(tabs, tab);
+    return tabs->tabs[i < tabs->count ? (i + 1) % tabs->count : 0];
+}
+
+// --- Бюджет памяти ---
+
+size_t diff_tab_memory_usage(const DiffTab* tab) {
+    if (!tab) {
+        return 0;
+    }
+    return sizeof(DiffTab) + diff_data_memory_usage(tab->data) + ui_diff_view_memory_usage(tab->view);
+}
+
+size_t diff_tabs_enforce_budget(DiffTabs* tabs) {
+    if (!tabs) {
+        return 0;
+    }
+    size_t total = 0;
+    for (size_t i = 0; i < tabs->count; i++) {
+        total += diff_tab_memory_usage(tabs->tabs[i]);
+    }
+    size_t evicted = 0;
+    while (total > tabs->budget) {
+        // Дольше всех не просмотренная вкладка, которую можно выгрузить
+        size_t victim = tabs->count;
+        for (size_t i = 0; i < tabs->count; i++) {
+            const DiffTab* tab = tabs->tabs[i];
+            if (tab == tabs->current || tab->pinned) {
+                continue;
+            }
+            if (victim == tabs->count || tab->last_viewed < tabs->tabs[victim]->last_viewed) {
+                victim = i;
+            }
+        }
+        if (victim == tabs->count) {
+            // Остались только показанная и принимаемые вкладки: бюджет превышен ими самими
+            break;
+        }
+        DiffTab* tab = tabs->tabs[victim];
+        const size_t bytes = diff_tab_memory_usage(tab);
+        log_info("diff_tabs: Evicting tab '%s' (%zu bytes, %zu of %zu in use)",
+                 tab->name, bytes, total, tabs->budget);
+        total -= bytes;
+        memmove(tabs->tabs + victim, tabs->tabs + victim + 1, (tabs->count - victim - 1) * sizeof(DiffTab*));
+        tabs->count--;
+        tab_destroy(tab);
+        evicted++;
+    }
+    return evicted;
+}
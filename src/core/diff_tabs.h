@@ -0,0 +1,62 @@
+// src/core/diff_tabs.h
+#ifndef SEE_CODE_DIFF_TABS_H
+#define SEE_CODE_DIFF_TABS_H
+
+#include "see_code/data/diff_data.h"
+#include "see_code/gui/ui_manager.h"
+#include <stddef.h>
+#include <stdint.h>
+
+// Named diffs ("unstaged", "staged", "HEAD~1", ...) kept parsed side by side.
+//
+// Every tab owns its DiffData and the UIDiffView holding its layout index,
+// render caches and scroll position, so switching back to a tab shows it
+// without parsing or measuring anything again. The memory of all tabs is kept
+// under a budget by dropping the least recently viewed ones; the tab on
+// screen and pinned tabs (a diff still being received) are never dropped.
+//
+// Not thread-safe: the application calls it under its state mutex.
+
+#define DIFF_TAB_NAME_MAX 64
+#define DIFF_TAB_DEFAULT_NAME "diff" // Tab of diffs sent without a name
+#define DIFF_TABS_DEFAULT_BUDGET ((size_t)256 * 1024 * 1024)
+
+typedef struct {
+    char name[DIFF_TAB_NAME_MAX];
+    DiffData* data;
+    UIDiffView* view;
+    uint64_t last_viewed; // Value of DiffTabs.clock when the tab was last shown
+    int pinned;           // Not evicted while set
+} DiffTab;
+
+typedef struct {
+    DiffTab** tabs;       // In creation order
+    size_t count;
+    size_t capacity;
+    DiffTab* current;     // Tab on screen (NULL if there are no tabs)
+    size_t budget;        // Bytes all tabs may take together
+    uint64_t clock;
+} DiffTabs;
+
+// budget == 0 selects DIFF_TABS_DEFAULT_BUDGET
+void diff_tabs_init(DiffTabs* tabs, size_t budget);
+void diff_tabs_destroy(DiffTabs* tabs);
+
+DiffTab* diff_tabs_find(const DiffTabs* tabs, const char* name);
+// Returns the tab called name, creating an empty one if there is none.
+// Longer names are truncated. Returns NULL on allocation failure.
+DiffTab* diff_tabs_open(DiffTabs* tabs, const char* name);
+// Makes tab the one on screen and marks it as just viewed
+void diff_tabs_set_current(DiffTabs* tabs, DiffTab* tab);
+// Tab after tab in creation order, wrapping around
+DiffTab* diff_tabs_next(const DiffTabs* tabs, const DiffTab* tab);
+// Position of tab in creation order (tabs->count if it is not there)
+size_t diff_tabs_index(const DiffTabs* tabs, const DiffTab* tab);
+
+// Bytes held by the tab's diff and layout index
+size_t diff_tab_memory_usage(const DiffTab* tab);
+// Evicts least recently viewed tabs until all of them fit into the budget.
+// Returns the number of evicted tabs.
+size_t diff_tabs_enforce_budget(DiffTabs* tabs);
+
+#endif // SEE_CODE_DIFF_TABS_H
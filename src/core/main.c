@@ -6,6 +6,8 @@
 
 #include "see_code/core/app.h"
 #include "see_code/core/config.h"
+#include "see_code/core/diff_tabs.h"
+#include "see_code/data/diff_cold_store.h"
 #include "see_code/utils/logger.h"
 #include "see_code/utils/deps_check.h"
 
@@ -25,6 +27,13 @@ void print_usage(const char* program_name) {
     printf("  -h, --help     Show this help message\n");
     printf("  -v, --verbose  Enable verbose logging\n");
     printf("  -d, --debug    Enable debug mode\n");
+    printf("  -f, --file PATH  Open a saved diff (\"-\" reads standard input)\n");
+    printf("  --tab-budget MB  Memory kept for parsed diff tabs (default %zu)\n",
+           DIFF_TABS_DEFAULT_BUDGET / (1024 * 1024));
+    printf("  --resident-budget MB  Uncompressed text kept for the diff on screen (default %zu)\n",
+           DIFF_COLD_DEFAULT_BUDGET / (1024 * 1024));
+    printf("  --work-tree DIR  Directory the diff paths are relative to (default: current)\n");
+    printf("  --unified      Show one column in landscape mode instead of old and new side by side\n");
     printf("  --check-deps   Check system dependencies and exit\n");
     printf("\nSee_code - Interactive Git Diff Viewer for Termux\n");
     printf("Connect from Neovim using :SeeCodeDiff command\n");
@@ -35,6 +44,11 @@ int main(int argc, char* argv[]) {
     int verbose = 0;
     int debug = 0;
     int check_only = 0;
+    const char* diff_path = NULL;
+    size_t tab_budget = 0;
+    size_t resident_budget = 0;
+    const char* work_tree = NULL;
+    int unified = 0;
     
     for (int i = 1; i < argc; i++) {
         if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) {
@@ -44,6 +58,42 @@ int main(int argc, char* argv[]) {
             verbose = 1;
         } else if (strcmp(argv[i], "-d") == 0 || strcmp(argv[i], "--debug") == 0) {
             debug = 1;
+        } else if (strcmp(argv[i], "-f") == 0 || strcmp(argv[i], "--file") == 0) {
+            if (i + 1 >= argc) {
+                printf("Option %s requires a path\n", argv[i]);
+                print_usage(argv[0]);
+                return 1;
+            }
+            diff_path = argv[++i];
+        } else if (strcmp(argv[i], "--tab-budget") == 0) {
+            char* end = NULL;
+            unsigned long megabytes = i + 1 < argc ? strtoul(argv[i + 1], &end, 10) : 0;
+            if (megabytes == 0 || !end || *end != '\0') {
+                printf("Option %s requires a size in megabytes\n", argv[i]);
+                print_usage(argv[0]);
+                return 1;
+            }
+            tab_budget = (size_t)megabytes * 1024 * 1024;
+            i++;
+        } else if (strcmp(argv[i], "--resident-budget") == 0) {
+            char* end = NULL;
+            unsigned long megabytes = i + 1 < argc ? strtoul(argv[i + 1], &end, 10) : 0;
+            if (megabytes == 0 || !end || *end != '\0') {
+                printf("Option %s requires a size in megabytes\n", argv[i]);
+                print_usage(argv[0]);
+                return 1;
+            }
+            resident_budget = (size_t)megabytes * 1024 * 1024;
+            i++;
+        } else if (strcmp(argv[i], "--work-tree") == 0) {
+            if (i + 1 >= argc) {
+                printf("Option %s requires a directory\n", argv[i]);
+                print_usage(argv[0]);
+                return 1;
+            }
+            work_tree = argv[++i];
+        } else if (strcmp(argv[i], "--unified") == 0) {
+            unified = 1;
         } else if (strcmp(argv[i], "--check-deps") == 0) {
             check_only = 1;
         } else {
@@ -87,7 +137,12 @@ int main(int argc, char* argv[]) {
         .window_height = 2400,
         .landscape_mode = 1,
         .verbose = verbose,
-        .debug = debug
+        .debug = debug,
+        .diff_path = diff_path,
+        .tab_budget = tab_budget,
+        .resident_budget = resident_budget,
+        .work_tree = work_tree,
+        .unified = unified
     };
     
     if (!app_init(&config)) {
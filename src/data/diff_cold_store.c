@@ -0,0 +1,442 @@
+// src/data/diff_cold_store.c
+#include "see_code/data/diff_cold_store.h"
+#include "see_code/utils/logger.h"
+#include "see_code/utils/thread_pool.h"
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+// Обход блоков в diff_cold_store_maintain() не чаще, чем раз в это время
+#define COLD_MAINTAIN_INTERVAL_MS 250
+// Сжатий, поставленных в очередь за один обход
+#define COLD_MAINTAIN_BATCH 16
+// Блок, сжатый хуже этой доли, остается в памяти как есть
+#define COLD_MAX_COMPRESSED_PERCENT 85
+
+typedef enum {
+    BLOCK_RESIDENT = 0,
+    BLOCK_COLD,    // Страницы отданы системе, данные в compressed
+    BLOCK_THAWING  // Блок распаковывается на место, остальные ждут
+} BlockState;
+
+typedef struct {
+    char* compressed;
+    uint32_t compressed_size;
+    uint32_t pins;
+    uint8_t state;          // BlockState
+    uint8_t queued;         // Для блока стоит задача в пуле
+    uint8_t incompressible; // Сжатие не окупилось, больше не пытаемся
+    uint64_t last_used_ms;
+} ColdBlock;
+
+struct DiffColdStore {
+    char* base;             // Начало первого блока: первая граница страницы в буфере
+    size_t base_offset;     // Его смещение в буфере
+    size_t buffer_size;
+    ColdBlock* blocks;
+    size_t block_count;
+    size_t view_first;      // Блоки [view_first, view_end) на экране
+    size_t view_end;
+    uint64_t last_maintain_ms;
+    pthread_mutex_t mutex;
+    pthread_cond_t changed; // Блок оттаял или фоновая задача отпустила буфер
+    size_t refs;            // Сам store и задачи в очереди пула
+    size_t running;         // Кто сейчас сжимает или распаковывает блок
+    int closing;
+    DiffColdStats stats;
+};
+
+typedef struct {
+    DiffColdStore* store;
+    size_t block;
+    int thaw; // 1 = распаковать заранее, 0 = сжать
+} ColdJob;
+
+static uint64_t now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+}
+
+static char* block_ptr(const DiffColdStore* store, size_t block) {
+    return store->base + block * DIFF_COLD_BLOCK_SIZE;
+}
+
+// Блоки, пересекающие [offset, offset + length) буфера: [*first, *end).
+// Байты до первого и после последнего целого блока всегда в памяти.
+static void block_range(const DiffColdStore* store, size_t offset, size_t length, size_t* first, size_t* end) {
+    *first = *end = 0;
+    if (length == 0 || offset >= store->buffer_size) {
+        return;
+    }
+    const size_t last = (length > store->buffer_size - offset ? store->buffer_size : offset + length) - 1;
+    if (last < store->base_offset) {
+        return;
+    }
+    *first = offset < store->base_offset ? 0 : (offset - store->base_offset) / DIFF_COLD_BLOCK_SIZE;
+    *end = (last - store->base_offset) / DIFF_COLD_BLOCK_SIZE + 1;
+    if (*end > store->block_count) *end = store->block_count;
+    if (*first > *end) *first = *end;
+}
+
+// --- Создание и освобождение ---
+
+int diff_cold_store_attach(DiffData* data) {
+    if (!data || !data->buffer || data->mapping || data->cold) {
+        return 0;
+    }
+    const long page = sysconf(_SC_PAGESIZE);
+    if (page <= 0 || DIFF_COLD_BLOCK_SIZE % (size_t)page != 0) {
+        return 0;
+    }
+    const uintptr_t start = (uintptr_t)data->buffer;
+    const uintptr_t base = (start + (uintptr_t)page - 1) & ~((uintptr_t)page - 1);
+    if (base - start >= data->buffer_size) {
+        return 0;
+    }
+    const size_t block_count = (data->buffer_size - (base - start)) / DIFF_COLD_BLOCK_SIZE;
+    if (block_count < 2) {
+        return 0; // Маленький diff: сжимать нечего
+    }
+    DiffColdStore* store = calloc(1, sizeof(DiffColdStore));
+    ColdBlock* blocks = store ? calloc(block_count, sizeof(ColdBlock)) : NULL;
+    if (!blocks) {
+        log_error("diff_cold_store: Failed to allocate %zu blocks", block_count);
+        free(store);
+        return 0;
+    }
+    store->base = (char*)base;
+    store->base_offset = base - start;
+    store->buffer_size = data->buffer_size;
+    store->blocks = blocks;
+    store->block_count = block_count;
+    store->refs = 1;
+    store->stats.block_count = block_count;
+    store->stats.resident_bytes = data->buffer_size;
+    const uint64_t now = now_ms();
+    for (size_t i = 0; i < block_count; i++) {
+        blocks[i].last_used_ms = now; // Отсчет простоя начинается с загрузки
+    }
+    pthread_mutex_init(&store->mutex, NULL);
+    pthread_cond_init(&store->changed, NULL);
+    data->cold = store;
+    return 1;
+}
+
+// Отпускает ссылку (мьютекс взят и освобождается здесь); последняя освобождает store
+static void release_locked(DiffColdStore* store) {
+    const int last = --store->refs == 0;
+    pthread_mutex_unlock(&store->mutex);
+    if (last) {
+        pthread_cond_destroy(&store->changed);
+        pthread_mutex_destroy(&store->mutex);
+        free(store->blocks);
+        free(store);
+    }
+}
+
+void diff_cold_store_destroy(DiffColdStore* store) {
+    if (!store) {
+        return;
+    }
+    pthread_mutex_lock(&store->mutex);
+    store->closing = 1;
+    // Задачи в очереди увидят closing и не тронут буфер; ждем только работающие
+    while (store->running > 0) {
+        pthread_cond_wait(&store->changed, &store->mutex);
+    }
+    log_debug("diff_cold_store: %llu hits, %llu misses, %llu prefetched, %llu compressed",
+              (unsigned long long)store->stats.hits, (unsigned long long)store->stats.misses,
+              (unsigned long long)store->stats.prefetches, (unsigned long long)store->stats.compressions);
+    for (size_t i = 0; i < store->block_count; i++) {
+        free(store->blocks[i].compressed);
+        store->blocks[i].compressed = NULL;
+    }
+    release_locked(store);
+}
+
+// --- Сжатие и распаковка ---
+
+// Распаковывает холодный блок на место. Мьютекс взят; на время распаковки отпускается.
+static void thaw_locked(DiffColdStore* store, size_t index) {
+    ColdBlock* block = &store->blocks[index];
+    block->state = BLOCK_THAWING;
+    store->running++;
+    pthread_mutex_unlock(&store->mutex);
+    // Страницы были отданы системе и читаются нулями: запись возвращает их в память
+    if (!lz_decompress(block->compressed, block->compressed_size, block_ptr(store, index), DIFF_COLD_BLOCK_SIZE)) {
+        log_error("diff_cold_store: Block %zu is corrupted", index);
+    }
+    pthread_mutex_lock(&store->mutex);
+    free(block->compressed);
+    store->stats.compressed_bytes -= block->compressed_size;
+    store->stats.resident_bytes += DIFF_COLD_BLOCK_SIZE;
+    store->stats.cold_blocks--;
+    block->compressed = NULL;
+    block->compressed_size = 0;
+    block->state = BLOCK_RESIDENT;
+    store->running--;
+    pthread_cond_broadcast(&store->changed);
+}
+
+// Сжимает блок и отдает его страницы системе, если за время сжатия его никто не закрепил
+static void compress_locked(DiffColdStore* store, size_t index) {
+    ColdBlock* block = &store->blocks[index];
+    store->running++;
+    pthread_mutex_unlock(&store->mutex);
+    // Читать блок можно без мьютекса: буфер не меняется, а отдать страницы
+    // может только эта задача (queued не дает поставить вторую)
+    const size_t capacity = lz_compress_bound(DIFF_COLD_BLOCK_SIZE);
+    char* compressed = malloc(capacity);
+    size_t size = compressed ? lz_compress(block_ptr(store, index), DIFF_COLD_BLOCK_SIZE, compressed, capacity) : 0;
+    if (size > 0) {
+        char* shrunk = realloc(compressed, size);
+        if (shrunk) compressed = shrunk;
+    }
+    pthread_mutex_lock(&store->mutex);
+    store->running--;
+    pthread_cond_broadcast(&store->changed);
+    if (!compressed) {
+        log_error("diff_cold_store: Failed to allocate %zu bytes to compress block %zu", capacity, index);
+        return;
+    }
+    if (size == 0 || size * 100 > (size_t)DIFF_COLD_BLOCK_SIZE * COLD_MAX_COMPRESSED_PERCENT) {
+        block->incompressible = 1;
+        free(compressed);
+        return;
+    }
+    if (store->closing || block->pins > 0 || block->state != BLOCK_RESIDENT ||
+        now_ms() - block->last_used_ms < DIFF_COLD_IDLE_MS) {
+        free(compressed); // Блок понадобился, пока сжимался
+        return;
+    }
+    // Под мьютексом: закрепить блок, пока страницы отдаются, никто не успеет
+    madvise(block_ptr(store, index), DIFF_COLD_BLOCK_SIZE, MADV_DONTNEED);
+    block->compressed = compressed;
+    block->compressed_size = (uint32_t)size;
+    block->state = BLOCK_COLD;
+    store->stats.cold_blocks++;
+    store->stats.compressions++;
+    store->stats.compressed_bytes += size;
+    store->stats.resident_bytes -= DIFF_COLD_BLOCK_SIZE;
+}
+
+static void job_run(void* arg) {
+    ColdJob* job = (ColdJob*)arg;
+    DiffColdStore* store = job->store;
+    ColdBlock* block = &store->blocks[job->block];
+    pthread_mutex_lock(&store->mutex);
+    if (!store->closing) {
+        if (job->thaw && block->state == BLOCK_COLD) {
+            store->stats.prefetches++;
+            thaw_locked(store, job->block);
+        } else if (!job->thaw && block->state == BLOCK_RESIDENT && block->pins == 0) {
+            compress_locked(store, job->block);
+        }
+    }
+    block->queued = 0;
+    free(job);
+    release_locked(store);
+}
+
+// Ставит задачу для блока в пул. Без рабочих потоков фоновой работы нет:
+// блоки тогда размораживаются при закреплении и сжимаются в maintain.
+static int queue_job_locked(DiffColdStore* store, size_t index, int thaw) {
+    ThreadPool* pool = thread_pool_shared();
+    if (!pool || thread_pool_size(pool) == 0) {
+        return 0;
+    }
+    ColdJob* job = malloc(sizeof(ColdJob));
+    if (!job) {
+        return 0;
+    }
+    job->store = store;
+    job->block = index;
+    job->thaw = thaw;
+    store->blocks[index].queued = 1;
+    store->refs++;
+    if (!thread_pool_submit(pool, job_run, job)) {
+        store->blocks[index].queued = 0;
+        store->refs--;
+        free(job);
+        return 0;
+    }
+    return 1;
+}
+
+// --- Закрепление ---
+
+// Делает блоки читаемыми (размораживая холодные на месте) и отмечает их использование
+static void touch_blocks_locked(DiffColdStore* store, size_t first, size_t end, uint64_t now) {
+    for (size_t i = first; i < end; i++) {
+        ColdBlock* block = &store->blocks[i];
+        while (block->state == BLOCK_THAWING) {
+            pthread_cond_wait(&store->changed, &store->mutex);
+        }
+        if (block->state == BLOCK_COLD) {
+            store->stats.misses++;
+            thaw_locked(store, i);
+        } else {
+            store->stats.hits++;
+        }
+        block->last_used_ms = now;
+    }
+}
+
+static void unpin_blocks_locked(DiffColdStore* store, size_t first, size_t end, uint64_t now) {
+    for (size_t i = first; i < end; i++) {
+        if (store->blocks[i].pins > 0) {
+            store->blocks[i].pins--;
+        }
+        store->blocks[i].last_used_ms = now;
+    }
+}
+
+void diff_cold_store_pin(DiffColdStore* store, size_t offset, size_t length) {
+    if (!store) {
+        return;
+    }
+    size_t first, end;
+    block_range(store, offset, length, &first, &end);
+    if (first == end) {
+        return;
+    }
+    pthread_mutex_lock(&store->mutex);
+    touch_blocks_locked(store, first, end, now_ms());
+    for (size_t i = first; i < end; i++) {
+        store->blocks[i].pins++;
+    }
+    pthread_mutex_unlock(&store->mutex);
+}
+
+void diff_cold_store_unpin(DiffColdStore* store, size_t offset, size_t length) {
+    if (!store) {
+        return;
+    }
+    size_t first, end;
+    block_range(store, offset, length, &first, &end);
+    if (first == end) {
+        return;
+    }
+    pthread_mutex_lock(&store->mutex);
+    unpin_blocks_locked(store, first, end, now_ms());
+    pthread_mutex_unlock(&store->mutex);
+}
+
+void diff_cold_store_set_view(DiffColdStore* store, size_t offset, size_t length) {
+    if (!store) {
+        return;
+    }
+    size_t first, end;
+    block_range(store, offset, length, &first, &end);
+    const uint64_t now = now_ms();
+    pthread_mutex_lock(&store->mutex);
+    // Вид не закрепляется (его diff может смениться без предупреждения), а только
+    // размораживается и отмечается: сжатие берет блоки, простоявшие DIFF_COLD_IDLE_MS,
+    // и не трогает окрестность вида
+    touch_blocks_locked(store, first, end, now);
+    store->view_first = first;
+    store->view_end = end;
+    if (first < end) {
+        // Соседние блоки размораживаются заранее, чтобы прокрутка до них не ждала
+        const size_t margin = DIFF_COLD_PREFETCH_BYTES / DIFF_COLD_BLOCK_SIZE;
+        const size_t lo = first > margin ? first - margin : 0;
+        const size_t hi = end + margin < store->block_count ? end + margin : store->block_count;
+        for (size_t i = lo; i < hi; i++) {
+            if (store->blocks[i].state == BLOCK_COLD && !store->blocks[i].queued) {
+                queue_job_locked(store, i, 1);
+            }
+        }
+    }
+    pthread_mutex_unlock(&store->mutex);
+}
+
+// --- Вытеснение ---
+
+// Блок можно сжать: в памяти, никем не закреплен и давно не нужен
+static int is_compress_candidate(const DiffColdStore* store, size_t index, uint64_t now) {
+    const ColdBlock* block = &store->blocks[index];
+    return block->state == BLOCK_RESIDENT && block->pins == 0 && !block->queued && !block->incompressible &&
+           now - block->last_used_ms >= DIFF_COLD_IDLE_MS;
+}
+
+void diff_cold_store_maintain(DiffColdStore* store, size_t budget) {
+    if (!store) {
+        return;
+    }
+    const uint64_t now = now_ms();
+    pthread_mutex_lock(&store->mutex);
+    if (now - store->last_maintain_ms < COLD_MAINTAIN_INTERVAL_MS || store->closing) {
+        pthread_mutex_unlock(&store->mutex);
+        return;
+    }
+    store->last_maintain_ms = now;
+    // Блоки, уже стоящие в очереди на сжатие, считаются сжатыми
+    size_t resident = store->stats.resident_bytes;
+    for (size_t i = 0; i < store->block_count; i++) {
+        if (store->blocks[i].queued && store->blocks[i].state == BLOCK_RESIDENT) {
+            resident -= DIFF_COLD_BLOCK_SIZE;
+        }
+    }
+    // Самые дальние от вида блоки сжимаются первыми: идем с двух концов к виду
+    const size_t margin = DIFF_COLD_PREFETCH_BYTES / DIFF_COLD_BLOCK_SIZE;
+    const size_t keep_first = store->view_first > margin ? store->view_first - margin : 0;
+    const size_t keep_end = store->view_end + margin < store->block_count ? store->view_end + margin : store->block_count;
+    const int has_view = store->view_first < store->view_end;
+    size_t lo = 0;
+    size_t hi = store->block_count;
+    size_t queued = 0;
+    while (resident > budget && queued < COLD_MAINTAIN_BATCH && lo < hi) {
+        size_t index;
+        if (!has_view) {
+            index = lo++;
+        } else if (lo < keep_first && (hi <= keep_end || keep_first - lo >= hi - keep_end)) {
+            index = lo++;
+        } else if (hi > keep_end) {
+            index = --hi;
+        } else {
+            break; // Остались только блоки у вида
+        }
+        if (!is_compress_candidate(store, index, now)) {
+            continue;
+        }
+        if (queue_job_locked(store, index, 0)) {
+            resident -= DIFF_COLD_BLOCK_SIZE;
+            queued++;
+        } else {
+            // Без пула сжимаем сами, но понемногу: это время кадра
+            store->blocks[index].queued = 1;
+            compress_locked(store, index);
+            store->blocks[index].queued = 0;
+            resident = store->stats.resident_bytes;
+            queued += COLD_MAINTAIN_BATCH / 4;
+        }
+    }
+    pthread_mutex_unlock(&store->mutex);
+}
+
+// --- Статистика ---
+
+void diff_cold_store_stats(DiffColdStore* store, DiffColdStats* stats) {
+    memset(stats, 0, sizeof(DiffColdStats));
+    if (!store) {
+        return;
+    }
+    pthread_mutex_lock(&store->mutex);
+    *stats = store->stats;
+    pthread_mutex_unlock(&store->mutex);
+}
+
+size_t diff_cold_store_saved_bytes(DiffColdStore* store) {
+    if (!store) {
+        return 0;
+    }
+    pthread_mutex_lock(&store->mutex);
+    const size_t saved = store->stats.cold_blocks * DIFF_COLD_BLOCK_SIZE - store->stats.compressed_bytes;
+    pthread_mutex_unlock(&store->mutex);
+    return saved;
+}
@@ -0,0 +1,73 @@
+// src/data/diff_cold_store.h
+#ifndef SEE_CODE_DIFF_COLD_STORE_H
+#define SEE_CODE_DIFF_COLD_STORE_H
+
+#include "see_code/data/diff_data.h"
+#include "see_code/utils/lz.h"
+#include <stddef.h>
+#include <stdint.h>
+
+// Keeps the parts of a diff's buffer that are far from the screen compressed.
+//
+// The buffer is cut into page-aligned blocks of DIFF_COLD_BLOCK_SIZE bytes.
+// A cold block is compressed with the in-tree LZ codec (utils/lz.h) and its
+// pages are handed back to the system; thawing decompresses it into the same
+// pages. Spans and line offsets therefore stay valid, but the bytes of a cold
+// block read as zeros: code that reads text must pin the range first, which
+// thaws cold blocks on the spot (a miss).
+//
+// The UI sets the files around the screen as the view each frame, which thaws
+// them; cold blocks within DIFF_COLD_PREFETCH_BYTES of the view are thawed
+// ahead of time on the shared thread pool. Blocks outside that zone that
+// nobody used for DIFF_COLD_IDLE_MS are compressed in the background while
+// the resident part of the buffer exceeds the budget.
+//
+// Only a buffer in anonymous memory (received or copied) gets a store: a
+// mapped diff file is page cache the system can already drop and read again.
+// The buffer must not change while the store exists.
+
+#define DIFF_COLD_BLOCK_SIZE LZ_MAX_BLOCK
+#define DIFF_COLD_PREFETCH_BYTES (1024 * 1024)
+#define DIFF_COLD_IDLE_MS 5000
+// Resident bytes of the diff on screen when the configuration does not say
+#define DIFF_COLD_DEFAULT_BUDGET ((size_t)32 * 1024 * 1024)
+
+typedef struct {
+    size_t block_count;
+    size_t cold_blocks;
+    size_t resident_bytes;   // Buffer bytes readable right now
+    size_t compressed_bytes; // Memory held by the compressed blocks
+    uint64_t hits;           // Pinned blocks that were resident
+    uint64_t misses;         // Pinned blocks the caller had to thaw
+    uint64_t prefetches;     // Blocks thawed ahead of time in the background
+    uint64_t compressions;   // Blocks compressed so far
+} DiffColdStats;
+
+// Creates data->cold once the diff is complete (not while it is streamed).
+// Returns 0 if the buffer is mapped, too small or already has a store.
+int diff_cold_store_attach(DiffData* data);
+
+// Frees the store without thawing anything: the buffer is released right
+// after. Waits for background work that is reading or writing the buffer.
+void diff_cold_store_destroy(DiffColdStore* store);
+
+// Makes [offset, offset + length) of the buffer readable until the matching
+// unpin. Does nothing for a NULL store. Safe from any thread.
+void diff_cold_store_pin(DiffColdStore* store, size_t offset, size_t length);
+void diff_cold_store_unpin(DiffColdStore* store, size_t offset, size_t length);
+
+// Replaces the range the UI reads while drawing (length 0 drops it), thaws
+// it and queues thawing of cold blocks around it. The view is not pinned:
+// it stays readable because it was used less than DIFF_COLD_IDLE_MS ago.
+void diff_cold_store_set_view(DiffColdStore* store, size_t offset, size_t length);
+
+// Queues compression of idle blocks, farthest from the view first, while the
+// resident bytes exceed budget. Cheap to call every frame.
+void diff_cold_store_maintain(DiffColdStore* store, size_t budget);
+
+void diff_cold_store_stats(DiffColdStore* store, DiffColdStats* stats);
+
+// Bytes the store currently saves: released blocks minus their compressed copies
+size_t diff_cold_store_saved_bytes(DiffColdStore* store);
+
+#endif // SEE_CODE_DIFF_COLD_STORE_H
@@ -1,9 +1,19 @@
 // src/data/diff_data.c
 #include "see_code/data/diff_data.h"
+#include "see_code/data/diff_cold_store.h"
 #include "see_code/data/diff_parser.h" // Подключаем новый парсер
 #include "see_code/utils/logger.h"
+#include "see_code/utils/thread_pool.h"
 #include <stdlib.h>
 #include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Шаг чтения stdin, когда его нельзя отобразить в память (канал)
+#define DIFF_READ_CHUNK (1024 * 1024)
 
 DiffData* diff_data_create(void) {
     DiffData* data = malloc(sizeof(DiffData));
@@ -12,14 +22,32 @@ DiffData* diff_data_create(void) {
         return NULL;
     }
     memset(data, 0, sizeof(DiffData));
+    arena_init(&data->arena, ARENA_DEFAULT_BLOCK_SIZE);
+    arena_init(&data->spare_arena, ARENA_DEFAULT_BLOCK_SIZE);
     return data;
 }
 
+static void destroy_task(void* arg) {
+    diff_data_destroy(arg);
+}
+
+void diff_data_destroy_async(DiffData* data) {
+    if (!data) {
+        return;
+    }
+    ThreadPool* pool = thread_pool_shared();
+    if (!pool || thread_pool_size(pool) == 0 || !thread_pool_submit(pool, destroy_task, data)) {
+        diff_data_destroy(data);
+    }
+}
+
 void diff_data_destroy(DiffData* data) {
     if (!data) {
         return;
     }
     diff_data_clear(data);
+    arena_destroy(&data->arena);
+    arena_destroy(&data->spare_arena);
     free(data);
 }
 
@@ -34,38 +62,234 @@ int diff_data_load_from_buffer(DiffData* data, const char* buffer, size_t buffer
     // Очищаем существующие данные
     diff_data_clear(data);
 
-    // Делегируем парсинг новому модулю
-    int result = diff_parser_parse(data, buffer, buffer_size);
+    // Делегируем парсинг новому модулю (он делает одну копию буфера)
+    return diff_parser_parse(data, buffer, buffer_size);
+}
+// --- КОНЕЦ ОБНОВЛЕННОЙ ФУНКЦИИ ЗАГРУЗКИ ---
 
-    // Логирование результата делегируется внутрь diff_parser_parse
-    // if (result) {
-    //     log_info("Successfully loaded diff data with %zu files", data->file_count);
-    // } else {
-    //     log_error("Failed to load diff data from buffer");
-    // }
+int diff_data_load_from_owned_buffer(DiffData* data, char* buffer, size_t buffer_size) {
+    if (!data || !buffer || buffer_size == 0) {
+        log_error("Invalid arguments to diff_data_load_from_owned_buffer");
+        free(buffer);
+        return 0;
+    }
+
+    diff_data_clear(data);
 
-    return result;
+    // Буфер переходит во владение DiffData без копирования
+    return diff_parser_parse_owned(data, buffer, buffer_size);
 }
-// --- КОНЕЦ ОБНОВЛЕННОЙ ФУНКЦИИ ЗАГРУЗКИ ---
 
-void diff_data_clear(DiffData* data) {
-    if (!data) {
-        return;
+int diff_data_reload_from_owned_buffer(DiffData* data, char* buffer, size_t buffer_size) {
+    if (!data || !buffer || buffer_size == 0) {
+        log_error("Invalid arguments to diff_data_reload_from_owned_buffer");
+        free(buffer);
+        return 0;
+    }
+    if (data->file_count == 0) {
+        // Переиспользовать нечего
+        return diff_data_load_from_owned_buffer(data, buffer, buffer_size);
     }
-    for (size_t i = 0; i < data->file_count; i++) {
-        DiffFile* file = &data->files[i];
-        free(file->path);
-        for (size_t j = 0; j < file->hunk_count; j++) {
-            DiffHunk* hunk = &file->hunks[j];
-            free(hunk->header);
-            for (size_t k = 0; k < hunk->line_count; k++) {
-                free(hunk->lines[k].content);
+    return diff_parser_reparse_owned(data, buffer, buffer_size);
+}
+
+// --- ЗАГРУЗКА ИЗ ФАЙЛА ---
+
+// Читает канал целиком в malloc'd буфер
+static char* read_all(int fd, size_t* size) {
+    size_t capacity = DIFF_READ_CHUNK;
+    size_t length = 0;
+    char* buffer = malloc(capacity);
+    if (!buffer) {
+        log_error("Failed to allocate %zu bytes for diff input", capacity);
+        return NULL;
+    }
+    for (;;) {
+        if (length == capacity) {
+            char* grown = realloc(buffer, capacity * 2);
+            if (!grown) {
+                log_error("Failed to grow diff input buffer to %zu bytes", capacity * 2);
+                free(buffer);
+                return NULL;
             }
-            free(hunk->lines);
+            buffer = grown;
+            capacity *= 2;
+        }
+        ssize_t got = read(fd, buffer + length, capacity - length);
+        if (got == 0) {
+            break;
+        }
+        if (got < 0) {
+            if (errno == EINTR) continue;
+            log_error("Failed to read diff input: %s", strerror(errno));
+            free(buffer);
+            return NULL;
+        }
+        length += (size_t)got;
+    }
+    *size = length;
+    return buffer;
+}
+
+int diff_data_load_from_file(DiffData* data, const char* path) {
+    if (!data || !path) {
+        log_error("Invalid arguments to diff_data_load_from_file");
+        return 0;
+    }
+    const int use_stdin = strcmp(path, "-") == 0;
+    int fd = use_stdin ? STDIN_FILENO : open(path, O_RDONLY);
+    if (fd < 0) {
+        log_error("Failed to open diff file %s: %s", path, strerror(errno));
+        return 0;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        log_error("Failed to stat diff file %s: %s", path, strerror(errno));
+        if (!use_stdin) close(fd);
+        return 0;
+    }
+
+    if (!S_ISREG(st.st_mode)) {
+        // Канал или терминал не отображается в память: читаем его целиком
+        size_t size = 0;
+        char* buffer = read_all(fd, &size);
+        if (!use_stdin) close(fd);
+        if (!buffer) {
+            return 0;
+        }
+        if (size == 0) {
+            log_error("Diff input %s is empty", path);
+            free(buffer);
+            return 0;
         }
-        free(file->hunks);
+        return diff_data_load_from_owned_buffer(data, buffer, size);
+    }
+
+    size_t size = (size_t)st.st_size;
+    if (size == 0) {
+        log_error("Diff file %s is empty", path);
+        if (!use_stdin) close(fd);
+        return 0;
+    }
+    // Приватное отображение с правом записи: парсер раскодирует пути в кавычках
+    // на месте, такие страницы копируются ядром, а файл на диске не меняется
+    void* mapped = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    if (!use_stdin) close(fd); // Отображение остается действительным и после close
+    if (mapped == MAP_FAILED) {
+        log_error("Failed to map diff file %s (%zu bytes): %s", path, size, strerror(errno));
+        return 0;
+    }
+    // Парсер проходит файл целиком, пусть ядро читает страницы заранее
+    madvise(mapped, size, MADV_WILLNEED);
+
+    diff_data_clear(data);
+    data->buffer = mapped;
+    data->buffer_size = size;
+    data->mapping = mapped;
+    data->mapping_size = size;
+    if (!diff_parser_parse_in_place(data)) {
+        diff_data_clear(data);
+        return 0;
+    }
+    log_info("Loaded diff file %s (%zu bytes, %zu files)", path, size, data->file_count);
+    return 1;
+}
+
+void diff_data_release_buffer(DiffData* data) {
+    if (!data) {
+        return;
+    }
+    // Store только освобождается: холодные блоки буфера уже никто не прочтет
+    diff_cold_store_destroy(data->cold);
+    data->cold = NULL;
+    if (data->mapping) {
+        munmap(data->mapping, data->mapping_size);
+    } else if (data->buffer_owned) {
+        free(data->buffer);
+    }
+    data->buffer = NULL;
+    data->buffer_size = 0;
+    data->buffer_owned = 0;
+    data->mapping = NULL;
+    data->mapping_size = 0;
+}
+
+size_t diff_data_memory_usage(const DiffData* data) {
+    if (!data) {
+        return 0;
+    }
+    // Скопированный буфер лежит в арене и уже учтен в ее блоках
+    size_t bytes = sizeof(DiffData) + arena_bytes_reserved(&data->arena) + arena_bytes_reserved(&data->spare_arena);
+    if (data->mapping) {
+        bytes += data->mapping_size;
+    } else if (data->buffer_owned) {
+        bytes += data->buffer_size;
+    }
+    // Холодные блоки буфера отданы системе, вместо них лежат сжатые копии
+    const size_t saved = diff_cold_store_saved_bytes(data->cold);
+    return bytes > saved ? bytes - saved : 0;
+}
+
+size_t diff_data_line_file(const DiffData* data, size_t line) {
+    // Последний файл с first_line <= line: файлы без строк пропускаются сами
+    size_t lo = 0, hi = data->file_count;
+    while (hi - lo > 1) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (data->files[mid].first_line <= line) lo = mid; else hi = mid;
+    }
+    return lo;
+}
+
+// Файл previous, скопированный в data без изменений (DIFF_NOT_REUSED, если нет)
+static size_t reused_file(const DiffData* data, const DiffData* previous, size_t file) {
+    if (!data->reused_files || file >= data->reused_file_count || file >= previous->file_count) {
+        return DIFF_NOT_REUSED;
+    }
+    return data->reused_files[file];
+}
+
+size_t diff_data_reused_hunk(const DiffData* data, const DiffData* previous, size_t hunk) {
+    if (!data || !previous || hunk >= previous->hunk_count || previous->file_count == 0) {
+        return DIFF_NOT_REUSED;
+    }
+    // Последний файл с first_hunk <= hunk
+    size_t lo = 0, hi = previous->file_count;
+    while (hi - lo > 1) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (previous->files[mid].first_hunk <= hunk) lo = mid; else hi = mid;
+    }
+    const size_t file = reused_file(data, previous, lo);
+    if (file == DIFF_NOT_REUSED || hunk - previous->files[lo].first_hunk >= previous->files[lo].hunk_count) {
+        return DIFF_NOT_REUSED;
+    }
+    return data->files[file].first_hunk + (hunk - previous->files[lo].first_hunk);
+}
+
+size_t diff_data_reused_line(const DiffData* data, const DiffData* previous, size_t line) {
+    if (!data || !previous || line >= previous->line_count || previous->file_count == 0) {
+        return DIFF_NOT_REUSED;
+    }
+    const size_t old_file = diff_data_line_file(previous, line);
+    const size_t file = reused_file(data, previous, old_file);
+    if (file == DIFF_NOT_REUSED || line - previous->files[old_file].first_line >= previous->files[old_file].line_count) {
+        return DIFF_NOT_REUSED;
+    }
+    return data->files[file].first_line + (line - previous->files[old_file].first_line);
+}
+
+void diff_data_clear(DiffData* data) {
+    if (!data) {
+        return;
     }
-    free(data->files);
-    // Важно: обнуляем все поля структуры
+    // Файлы, ханки, строки и скопированный буфер живут в арене:
+    // один сброс вместо обхода структур, блоки остаются для следующей загрузки
+    diff_data_release_buffer(data);
+    arena_reset(&data->arena);
+    arena_reset(&data->spare_arena);
+    // Важно: обнуляем все поля структуры, кроме арен
+    Arena arena = data->arena;
+    Arena spare_arena = data->spare_arena;
     memset(data, 0, sizeof(DiffData));
+    data->arena = arena;
+    data->spare_arena = spare_arena;
 }
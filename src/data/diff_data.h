@@ -3,6 +3,9 @@
 #define SEE_CODE_DIFF_DATA_H
 
 #include <stddef.h> // for size_t
+#include <stdint.h>
+#include "see_code/utils/arena.h"
+#include "see_code/data/diff_scanner.h"
 
 // Enums for line types
 typedef enum {
@@ -11,48 +14,208 @@ typedef enum {
     LINE_TYPE_DELETE
 } DiffLineType;
 
-// Structure to hold information about a single line in a diff hunk
+// View into DiffData.buffer: [offset, offset + length).
+// Spans are not null-terminated; use diff_data_span_ptr() together with length.
 typedef struct {
-    char* content;
+    size_t offset;
     size_t length;
+} DiffSpan;
+
+// Columns taken by a tab in display widths, and spaces it is drawn as
+#define DIFF_TAB_WIDTH 4
+
+// Marks the empty side of a side-by-side row (see DiffLineTable.row_left)
+#define DIFF_ROW_FILLER UINT32_MAX
+
+// Every line of the diff, stored column-wise so that culling and layout
+// walk dense arrays instead of records. Indexed by the global line number;
+// hunks and files refer to it through [first_line, first_line + line_count).
+typedef struct {
+    uint8_t* types;     // DiffLineType
+    uint32_t* offsets;  // Line start in DiffData.buffer, including the '+', '-' or ' ' marker
+    uint32_t* lengths;  // Line length in bytes, including the marker
+    uint32_t* widths;   // Display width of the text after the marker, in columns
+                        // (see diff_scan_text()), measured while parsing
+    uint8_t* text_flags; // DIFF_TEXT_* classes of that text; 0 = printable ASCII
+    uint32_t* old_numbers; // Line number in the old file, 0 for added lines
+    uint32_t* new_numbers; // Line number in the new file, 0 for deleted lines
+    // Side-by-side alignment of each hunk, built while parsing. A hunk has
+    // row_count <= line_count rows, stored in the slots of its first row_count
+    // lines: row r shows line first_line + row_left[first_line + r] in the old
+    // pane and first_line + row_right[first_line + r] in the new one (hunk-relative
+    // indices, DIFF_ROW_FILLER for an empty cell). Context lines take both
+    // cells of a row; a run of deletions and the additions that follow it are
+    // paired row by row, the shorter side padded with fillers.
+    uint32_t* row_left;
+    uint32_t* row_right;
+} DiffLineTable;
+
+// A single line assembled from DiffLineTable (see diff_data_line())
+typedef struct {
+    DiffSpan content; // Full line including the leading '+', '-' or ' '
     DiffLineType type;
 } DiffLine;
 
-// Structure to hold information about a diff hunk
+// Structure to hold information about a diff hunk.
+// Its lines are rows first_line .. first_line + line_count of DiffData.lines.
 typedef struct {
-    char* header;
-    size_t header_length;
-    DiffLine* lines;
+    DiffSpan header; // "@@ -a,b +c,d @@ ..."
+    // Ranges from the header (an omitted count is 1; all 0 if the header is malformed)
+    uint32_t old_start;
+    uint32_t old_count;
+    uint32_t new_start;
+    uint32_t new_count;
+    size_t first_line;
     size_t line_count;
-    size_t line_capacity; // For potential dynamic resizing
+    size_t row_count; // Rows in the side-by-side layout (see DiffLineTable.row_left)
     // --- Добавлено для сворачивания ---
     int is_collapsed; // 0 = развернут, 1 = свернут
     // --- Конец добавления ---
 } DiffHunk;
 
-// Structure to hold information about a file in the diff
+// Structure to hold information about a file in the diff.
+// Its hunks are DiffData.hunks[first_hunk .. first_hunk + hunk_count),
+// the lines of all those hunks are rows first_line .. first_line + line_count.
+//
+// In a diff with many files only the headers are scanned at load time
+// (is_parsed = 0, hunk_count = line_count = 0). The slots the file's hunks
+// and lines will take are reserved right away, up to the next file's
+// first_hunk / first_line, and diff_parser_parse_file() fills them in.
 typedef struct {
-    char* path;
-    size_t path_length;
-    DiffHunk* hunks;
+    DiffSpan path; // Path without the "b/" prefix, quoted paths are unescaped in place
+    size_t first_hunk;
     size_t hunk_count;
-    size_t hunk_capacity; // For potential dynamic resizing
+    size_t first_line;
+    size_t line_count;
+    size_t additions; // Added and deleted lines, known before the hunks are parsed
+    size_t deletions;
+    int is_parsed;    // Hunks and lines are filled in; see diff_data_file_is_parsed()
+    // Whole "diff --git" section of this file and a hash of its raw bytes
+    // (0 = not computed yet), used to reuse unchanged files on reload
+    DiffSpan section;
+    uint64_t section_hash;
     // --- Добавлено для сворачивания ---
     int is_collapsed; // 0 = развернут, 1 = свернут
     // --- Конец добавления ---
 } DiffFile;
 
-// Structure to hold the entire diff data
+// Marks a file of the previous version that a reload did not copy (see DiffData.reused_files)
+#define DIFF_NOT_REUSED SIZE_MAX
+
+// Compressed cold parts of DiffData.buffer, see diff_cold_store.h
+typedef struct DiffColdStore DiffColdStore;
+
+// Structure to hold the entire diff data.
+// Files, hunks and lines live in flat arrays allocated from the arena;
+// diff_data_clear() resets the arena and keeps its blocks for the next load.
 typedef struct {
+    Arena arena;
+    // A reload builds the new arrays here while the old ones are still read,
+    // then the two arenas swap places
+    Arena spare_arena;
+    // Raw diff text received from the client, every DiffSpan above points into it.
+    // Either allocated from the arena (copied input), a malloc'd block
+    // handed over by the caller (buffer_owned = 1) or part of a private
+    // file mapping (mapping != NULL).
+    char* buffer;
+    size_t buffer_size;
+    int buffer_owned;
+    // Mapped diff file or snapshot. For a snapshot the files, hunks and
+    // line table below point into the same mapping.
+    void* mapping;
+    size_t mapping_size;
+    // Blocks of the buffer kept compressed while they are far from the screen
+    // (NULL = all of it is resident). Code reading text outside the files on
+    // screen pins it through diff_cold_store_pin().
+    DiffColdStore* cold;
     DiffFile* files;
     size_t file_count;
-    size_t file_capacity; // For potential dynamic resizing
+    DiffHunk* hunks;
+    size_t hunk_count;
+    DiffLineTable lines;
+    size_t line_count;
+    // Set by a reload: for each file of the previous version, the file it
+    // was copied to unchanged (DIFF_NOT_REUSED if it changed, was dropped or
+    // had not been parsed yet). Lets the UI keep render caches of those files.
+    size_t* reused_files;
+    size_t reused_file_count;
 } DiffData;
 
 // Function declarations
 DiffData* diff_data_create(void);
 void diff_data_destroy(DiffData* data);
+// Destroys data on the shared thread pool: freeing the arena and the buffer
+// (or unmapping a large diff) takes a while. Nothing may use data any more.
+void diff_data_destroy_async(DiffData* data);
 int diff_data_load_from_buffer(DiffData* data, const char* buffer, size_t buffer_size);
+// Same as above, but takes ownership of a malloc'd buffer instead of copying it.
+// The buffer is released by diff_data_clear() even if parsing fails.
+int diff_data_load_from_owned_buffer(DiffData* data, char* buffer, size_t buffer_size);
+// Maps a diff file and parses it in place, without copying it. path "-"
+// reads standard input (mapped too if it is redirected from a regular file).
+int diff_data_load_from_file(DiffData* data, const char* path);
 void diff_data_clear(DiffData* data);
+// Frees or unmaps data->buffer and forgets it. Arrays in the arena are kept,
+// arrays mapped from a snapshot go away with the mapping.
+void diff_data_release_buffer(DiffData* data);
+// Bytes held by the diff: arena blocks plus the owned or mapped buffer
+size_t diff_data_memory_usage(const DiffData* data);
+
+// File whose lines include line (binary search over first_line)
+size_t diff_data_line_file(const DiffData* data, size_t line);
+
+// Index in data of a hunk / line of previous, the version data was reloaded
+// from, if its file was copied unchanged; DIFF_NOT_REUSED otherwise
+size_t diff_data_reused_hunk(const DiffData* data, const DiffData* previous, size_t hunk);
+size_t diff_data_reused_line(const DiffData* data, const DiffData* previous, size_t line);
+
+// Replaces the diff with a new one (ownership of the malloc'd buffer is
+// transferred). Files whose section is byte-for-byte unchanged keep their
+// parsed hunks, lines, cached widths and collapse state; only changed
+// sections are parsed.
+int diff_data_reload_from_owned_buffer(DiffData* data, char* buffer, size_t buffer_size);
+
+// Returns a pointer to the first byte of the span inside data->buffer
+static inline const char* diff_data_span_ptr(const DiffData* data, DiffSpan span) {
+    return data->buffer + span.offset;
+}
+
+// Whether the hunks and lines of a file are filled in. The UI thread parses
+// files of a lazily loaded diff while other threads read it: it publishes
+// hunk_count and line_count before setting the flag (release), so a reader
+// that sees the flag also sees them.
+static inline int diff_data_file_is_parsed(const DiffFile* file) {
+    return __atomic_load_n(&file->is_parsed, __ATOMIC_ACQUIRE);
+}
+
+// Returns the hunks of a file as an array of file->hunk_count elements
+static inline DiffHunk* diff_data_file_hunks(const DiffData* data, const DiffFile* file) {
+    return data->hunks + file->first_hunk;
+}
+
+static inline DiffLineType diff_data_line_type(const DiffData* data, size_t line) {
+    return (DiffLineType)data->lines.types[line];
+}
+
+// Returns the full line (marker included) as a span into data->buffer
+static inline DiffSpan diff_data_line_span(const DiffData* data, size_t line) {
+    DiffSpan span = { data->lines.offsets[line], data->lines.lengths[line] };
+    return span;
+}
+
+// Display width of a line's text (marker excluded) in columns
+static inline uint32_t diff_data_line_width(const DiffData* data, size_t line) {
+    return data->lines.widths[line];
+}
+
+// Whether a line's text is printable ASCII, where byte offsets are columns
+static inline int diff_data_line_is_plain(const DiffData* data, size_t line) {
+    return data->lines.text_flags[line] == 0;
+}
+
+static inline DiffLine diff_data_line(const DiffData* data, size_t line) {
+    DiffLine result = { diff_data_line_span(data, line), diff_data_line_type(data, line) };
+    return result;
+}
 
 #endif // SEE_CODE_DIFF_DATA_H
@@ -1,116 +1,1229 @@
 // src/data/diff_parser.c
 // УЛУЧШЕНИЕ: Парсер теперь корректно обрабатывает имена файлов с пробелами (в кавычках).
 #include "see_code/data/diff_parser.h"
+#include "see_code/data/diff_cold_store.h"
+#include "see_code/data/diff_scanner.h"
+#include "see_code/utils/hash.h"
 #include "see_code/utils/logger.h"
+#include "see_code/utils/thread_pool.h"
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
 #include <ctype.h>
-static int ensure_files_capacity(DiffData* data) {
-    if (data->file_count >= data->file_capacity) {
-        size_t new_cap = data->file_capacity == 0 ? 8 : data->file_capacity * 2;
-        DiffFile* new_files = realloc(data->files, new_cap * sizeof(DiffFile));
-        if (!new_files) return 0;
-        data->files = new_files;
-        data->file_capacity = new_cap;
+// Сколько концов строк сканер отдает за один вызов
+#define PARSER_LINE_BATCH 256
+// Буферы меньше этого размера разбираются в одном потоке: старт потоков дороже выигрыша
+#define PARSER_PARALLEL_MIN_BYTES (4 * 1024 * 1024)
+// Минимальный размер куска для одного потока и число кусков на поток
+// (несколько кусков на поток выравнивают нагрузку при разных размерах файлов)
+#define PARSER_PARALLEL_MIN_RANGE (1024 * 1024)
+#define PARSER_PARALLEL_RANGES_PER_THREAD 4
+// Diff с таким числом файлов загружается лениво: сначала только заголовки файлов
+#define PARSER_LAZY_MIN_FILES 1000
+// Секций на одну задачу параллельного чтения заголовков
+#define PARSER_SCAN_BATCH 512
+// Таблица строк хранит смещения в 32 битах
+#define PARSER_MAX_BUFFER_SIZE ((size_t)UINT32_MAX)
+
+// Вспомогательная функция для парсинга пути из "diff --git"
+// Обрабатывает как обычные пути, так и пути в кавычках.
+// Путь в кавычках раскодируется на месте: результат никогда не длиннее исходника,
+// поэтому он записывается поверх него же в data->buffer, без отдельной аллокации.
+static DiffSpan parse_git_path(char* buffer, size_t* pos, size_t line_end) {
+    size_t p = *pos;
+    while (p < line_end && isspace((unsigned char)buffer[p])) p++;
+    DiffSpan span = { p, 0 };
+    if (p < line_end && buffer[p] == '"') {
+        p++; // Пропускаем открывающую кавычку
+        size_t out = span.offset;
+        while (p < line_end && buffer[p] != '"') {
+            if (buffer[p] == '\\') {
+                p++; // Пропускаем escape-символ
+                if (p >= line_end) break; // Внезапный конец строки
+                // git экранирует не-ASCII байты восьмеричными последовательностями (\303\244)
+                if (buffer[p] >= '0' && buffer[p] <= '7') {
+                    int value = 0;
+                    for (int digits = 0; digits < 3 && p < line_end && buffer[p] >= '0' && buffer[p] <= '7'; digits++) {
+                        value = value * 8 + (buffer[p++] - '0');
+                    }
+                    buffer[out++] = (char)value;
+                    continue;
+                }
+                switch (buffer[p]) {
+                    case 't': buffer[p] = '\t'; break;
+                    case 'n': buffer[p] = '\n'; break;
+                    default: break;
+                }
+            }
+            buffer[out++] = buffer[p++];
+        }
+        if (p < line_end && buffer[p] == '"') p++;
+        span.length = out - span.offset;
+    } else {
+        while (p < line_end && !isspace((unsigned char)buffer[p])) p++;
+        span.length = p - span.offset;
+    }
+    *pos = p;
+    return span;
+}
+
+// Отрезает префикс "a/" или "b/" от пути
+static DiffSpan strip_git_prefix(const char* buffer, DiffSpan span, char side) {
+    if (span.length >= 2 && buffer[span.offset] == side && buffer[span.offset + 1] == '/') {
+        span.offset += 2;
+        span.length -= 2;
+    }
+    return span;
+}
+
+static size_t grow_capacity(size_t capacity, size_t needed) {
+    size_t new_capacity = capacity ? capacity * 2 : 64;
+    return new_capacity < needed ? needed : new_capacity;
+}
+
+// Заполняет запись файла по строке "diff --git a/... b/..." в [line_start, line_end)
+static void parse_file_header(DiffFile* file, char* buffer, size_t line_start, size_t line_end) {
+    size_t p = line_start + 11;
+    DiffSpan path_a = parse_git_path(buffer, &p, line_end);
+    DiffSpan path_b = parse_git_path(buffer, &p, line_end);
+    (void)path_a;
+    memset(file, 0, sizeof(DiffFile));
+    file->section.offset = line_start;
+    file->path = strip_git_prefix(buffer, path_b, 'b');
+}
+
+// Увеличивает массив из арены до needed элементов (с запасом, геометрически)
+static int reserve_array(Arena* arena, void** array, size_t* capacity, size_t needed, size_t element_size) {
+    if (needed <= *capacity) {
+        return 1;
     }
+    size_t new_capacity = grow_capacity(*capacity, needed);
+    void* grown = arena_realloc(arena, *array, *capacity * element_size, new_capacity * element_size);
+    if (!grown) {
+        log_error("diff_parser: Failed to grow diff array to %zu elements", new_capacity);
+        return 0;
+    }
+    *array = grown;
+    *capacity = new_capacity;
     return 1;
 }
-static int ensure_hunks_capacity(DiffFile* file) {
-    if (file->hunk_count >= file->hunk_capacity) {
-        size_t new_cap = file->hunk_capacity == 0 ? 8 : file->hunk_capacity * 2;
-        DiffHunk* new_hunks = realloc(file->hunks, new_cap * sizeof(DiffHunk));
-        if (!new_hunks) return 0;
-        file->hunks = new_hunks;
-        file->hunk_capacity = new_cap;
+
+// То же для таблицы строк: все столбцы растут вместе
+static int reserve_lines(Arena* arena, DiffLineTable* table, size_t* capacity, size_t needed) {
+    if (needed <= *capacity) {
+        return 1;
+    }
+    size_t old_capacity = *capacity;
+    size_t new_capacity = grow_capacity(old_capacity, needed);
+    uint8_t* types = arena_realloc(arena, table->types, old_capacity, new_capacity);
+    if (types) table->types = types;
+    uint32_t* offsets = arena_realloc(arena, table->offsets, old_capacity * sizeof(uint32_t), new_capacity * sizeof(uint32_t));
+    if (offsets) table->offsets = offsets;
+    uint32_t* lengths = arena_realloc(arena, table->lengths, old_capacity * sizeof(uint32_t), new_capacity * sizeof(uint32_t));
+    if (lengths) table->lengths = lengths;
+    uint32_t* widths = arena_realloc(arena, table->widths, old_capacity * sizeof(uint32_t), new_capacity * sizeof(uint32_t));
+    if (widths) table->widths = widths;
+    uint8_t* text_flags = arena_realloc(arena, table->text_flags, old_capacity, new_capacity);
+    if (text_flags) table->text_flags = text_flags;
+    uint32_t* old_numbers = arena_realloc(arena, table->old_numbers, old_capacity * sizeof(uint32_t), new_capacity * sizeof(uint32_t));
+    if (old_numbers) table->old_numbers = old_numbers;
+    uint32_t* new_numbers = arena_realloc(arena, table->new_numbers, old_capacity * sizeof(uint32_t), new_capacity * sizeof(uint32_t));
+    if (new_numbers) table->new_numbers = new_numbers;
+    uint32_t* row_left = arena_realloc(arena, table->row_left, old_capacity * sizeof(uint32_t), new_capacity * sizeof(uint32_t));
+    if (row_left) table->row_left = row_left;
+    uint32_t* row_right = arena_realloc(arena, table->row_right, old_capacity * sizeof(uint32_t), new_capacity * sizeof(uint32_t));
+    if (row_right) table->row_right = row_right;
+    if (!types || !offsets || !lengths || !widths || !text_flags || !old_numbers || !new_numbers || !row_left || !row_right) {
+        log_error("diff_parser: Failed to grow line table to %zu lines", new_capacity);
+        return 0;
     }
+    *capacity = new_capacity;
     return 1;
 }
-static int ensure_lines_capacity(DiffHunk* hunk) {
-     if (hunk->line_count >= hunk->line_capacity) {
-        size_t new_cap = hunk->line_capacity == 0 ? 16 : hunk->line_capacity * 2;
-        DiffLine* new_lines = realloc(hunk->lines, new_cap * sizeof(DiffLine));
-        if (!new_lines) return 0;
-        hunk->lines = new_lines;
-        hunk->line_capacity = new_cap;
+
+// Читает "start[,count]" диапазона заголовка ханка; без count он равен 1
+static int parse_hunk_range(const char* line, size_t* pos, size_t length, uint32_t* start, uint32_t* count) {
+    size_t p = *pos;
+    uint32_t value = 0;
+    size_t digits_begin = p;
+    while (p < length && line[p] >= '0' && line[p] <= '9') value = value * 10 + (uint32_t)(line[p++] - '0');
+    if (p == digits_begin) return 0;
+    *start = value;
+    *count = 1;
+    if (p < length && line[p] == ',') {
+        p++;
+        value = 0;
+        digits_begin = p;
+        while (p < length && line[p] >= '0' && line[p] <= '9') value = value * 10 + (uint32_t)(line[p++] - '0');
+        if (p == digits_begin) return 0;
+        *count = value;
     }
+    *pos = p;
     return 1;
 }
-// Вспомогательная функция для парсинга пути из "diff --git"
-// Обрабатывает как обычные пути, так и пути в кавычках
-static char* parse_git_path(const char** p_ptr) {
-    const char* p = *p_ptr;
-    while (*p && isspace((unsigned char)*p)) p++;
-    char* path_buffer = malloc(1024); // Предполагаем, что путь не длиннее
-    if (!path_buffer) return NULL;
-    char* q = path_buffer;
-    if (*p == '"') {
-        p++; // Пропускаем открывающую кавычку
-        while (*p && *p != '"') {
-            if (*p == '\\') {
-                p++; // Пропускаем escape-символ
-                if (!*p) break; // Внезапный конец строки
+
+// Разбирает "@@ -a,b +c,d @@" в числа ханка; при ошибке все поля остаются нулями
+static void parse_hunk_header(DiffHunk* hunk, const char* line, size_t length) {
+    uint32_t old_start, old_count, new_start, new_count;
+    size_t p = 3;
+    if (length < 3 || line[2] != ' ' || !(p < length && line[p++] == '-') ||
+        !parse_hunk_range(line, &p, length, &old_start, &old_count) ||
+        !(p + 1 < length && line[p] == ' ' && line[p + 1] == '+')) {
+        return;
+    }
+    p += 2;
+    if (!parse_hunk_range(line, &p, length, &new_start, &new_count)) {
+        return;
+    }
+    hunk->old_start = old_start;
+    hunk->old_count = old_count;
+    hunk->new_start = new_start;
+    hunk->new_count = new_count;
+}
+
+// Ставит строку index (последнюю в ханке) в ряд разметки "рядом". Ряды хранятся
+// в ячейках первых строк ханка: рядов не больше, чем строк, поэтому ряд,
+// добавленный сейчас, попадает в ячейку не дальше текущей строки.
+static void align_line(DiffStreamParser* parser, DiffHunk* hunk, size_t index, DiffLineType type) {
+    DiffLineTable* table = &parser->data->lines;
+    uint32_t* left = table->row_left + hunk->first_line;
+    uint32_t* right = table->row_right + hunk->first_line;
+    const uint32_t line = (uint32_t)(index - hunk->first_line);
+    left[line] = DIFF_ROW_FILLER;
+    right[line] = DIFF_ROW_FILLER;
+    size_t row;
+    switch (type) {
+        case LINE_TYPE_CONTEXT:
+            // Строка контекста занимает обе половины ряда и закрывает серию изменений
+            row = hunk->row_count++;
+            left[row] = line;
+            right[row] = line;
+            parser->run_row = (uint32_t)hunk->row_count;
+            parser->run_deletes = 0;
+            parser->run_adds = 0;
+            return;
+        case LINE_TYPE_DELETE:
+            if (parser->run_adds > 0) {
+                // Удаление после добавлений начинает новую серию
+                parser->run_row = (uint32_t)hunk->row_count;
+                parser->run_deletes = 0;
+                parser->run_adds = 0;
             }
-            *q++ = *p++;
+            row = parser->run_row + parser->run_deletes++;
+            if (row == hunk->row_count) hunk->row_count++;
+            left[row] = line;
+            return;
+        case LINE_TYPE_ADD:
+            // Добавления встают напротив удалений своей серии, лишние - напротив пустых ячеек
+            row = parser->run_row + parser->run_adds++;
+            if (row == hunk->row_count) hunk->row_count++;
+            right[row] = line;
+            return;
+    }
+}
+
+// Публикует файл, который сейчас заполняется: вместе с ним становятся видны его ханки и строки
+// section_end - начало следующего файла (или конец данных)
+static void commit_pending_file(DiffStreamParser* parser, size_t section_end) {
+    DiffData* data = parser->data;
+    if (!parser->has_file) {
+        return;
+    }
+    DiffFile* file = &data->files[data->file_count];
+    file->section.length = section_end - file->section.offset;
+    data->hunk_count += parser->pending_hunks;
+    data->line_count += parser->pending_lines;
+    data->file_count++;
+    parser->pending_hunks = 0;
+    parser->pending_lines = 0;
+    parser->has_file = 0;
+}
+
+// Разбирает строки data->buffer от parser->parsed до end. Ничего не копирует:
+// все строки, заголовки и пути хранятся как смещения в буфер, который принадлежит DiffData.
+// Незаконченный файл хранится сразу за опубликованными элементами и не входит в *_count,
+// поэтому читатели видят только полностью разобранные файлы.
+static int parse_lines(DiffStreamParser* parser, size_t end) {
+    DiffData* data = parser->data;
+    char* buffer = data->buffer;
+    DiffFile* current_file = parser->has_file ? &data->files[data->file_count] : NULL;
+    DiffHunk* current_hunk = parser->pending_hunks > 0 ?
+        &data->hunks[data->hunk_count + parser->pending_hunks - 1] : NULL;
+    DiffScanner scanner;
+    diff_scanner_init(&scanner, buffer, end);
+    scanner.pos = parser->parsed;
+    size_t line_ends[PARSER_LINE_BATCH];
+    size_t batch_count;
+    size_t line_start = parser->parsed;
+    while ((batch_count = diff_scanner_next_lines(&scanner, line_ends, PARSER_LINE_BATCH)) > 0) {
+        for (size_t b = 0; b < batch_count; b++) {
+            const size_t line_end = line_ends[b];
+            const size_t line_length = line_end - line_start;
+            const char* line = buffer + line_start;
+            // Пустые строки пропускаются, как и раньше со strtok_r
+            DiffScanKind kind = line_length ? diff_scan_classify((unsigned char)line[0]) : DIFF_SCAN_KIND_OTHER;
+            switch (kind) {
+                case DIFF_SCAN_KIND_FILE:
+                    if (line_length >= 11 && memcmp(line, "diff --git ", 11) == 0) {
+                        commit_pending_file(parser, line_start);
+                        if (!reserve_array(&data->arena, (void**)&data->files, &parser->file_capacity,
+                                           data->file_count + 1, sizeof(DiffFile))) {
+                            return 0;
+                        }
+                        current_file = &data->files[data->file_count];
+                        parse_file_header(current_file, buffer, line_start, line_end);
+                        current_file->first_hunk = data->hunk_count;
+                        current_file->first_line = data->line_count;
+                        current_file->is_parsed = 1;
+                        current_hunk = NULL;
+                        parser->has_file = 1;
+                    }
+                    break;
+                case DIFF_SCAN_KIND_HUNK:
+                    if (current_file && line_length >= 2 && line[1] == '@') {
+                        size_t index = data->hunk_count + parser->pending_hunks;
+                        if (!reserve_array(&data->arena, (void**)&data->hunks, &parser->hunk_capacity,
+                                           index + 1, sizeof(DiffHunk))) {
+                            return 0;
+                        }
+                        current_hunk = &data->hunks[index];
+                        memset(current_hunk, 0, sizeof(DiffHunk));
+                        current_hunk->header.offset = line_start;
+                        current_hunk->header.length = line_length;
+                        current_hunk->first_line = data->line_count + parser->pending_lines;
+                        parse_hunk_header(current_hunk, line, line_length);
+                        parser->next_old_line = current_hunk->old_start;
+                        parser->next_new_line = current_hunk->new_start;
+                        parser->run_row = 0;
+                        parser->run_deletes = 0;
+                        parser->run_adds = 0;
+                        current_file->hunk_count++;
+                        parser->pending_hunks++;
+                    }
+                    break;
+                case DIFF_SCAN_KIND_ADD:
+                case DIFF_SCAN_KIND_DELETE:
+                case DIFF_SCAN_KIND_CONTEXT:
+                    if (current_hunk) {
+                        size_t index = data->line_count + parser->pending_lines;
+                        if (index >= parser->line_capacity &&
+                            !reserve_lines(&data->arena, &data->lines, &parser->line_capacity, index + 1)) {
+                            return 0;
+                        }
+                        DiffLineTable* table = &data->lines;
+                        const DiffLineType type = kind == DIFF_SCAN_KIND_ADD ? LINE_TYPE_ADD :
+                                                  kind == DIFF_SCAN_KIND_DELETE ? LINE_TYPE_DELETE : LINE_TYPE_CONTEXT;
+                        table->types[index] = (uint8_t)type;
+                        table->offsets[index] = (uint32_t)line_start;
+                        table->lengths[index] = (uint32_t)line_length;
+                        // Проверка UTF-8 и ширина в столбцах текста после маркера
+                        table->text_flags[index] = (uint8_t)diff_scan_text(line + 1, line_length - 1, DIFF_TAB_WIDTH,
+                                                                           &table->widths[index]);
+                        // Номера строк идут подряд: удаленная строка есть только в старом файле,
+                        // добавленная - только в новом
+                        table->old_numbers[index] = kind != DIFF_SCAN_KIND_ADD ? parser->next_old_line++ : 0;
+                        table->new_numbers[index] = kind != DIFF_SCAN_KIND_DELETE ? parser->next_new_line++ : 0;
+                        align_line(parser, current_hunk, index, type);
+                        current_hunk->line_count++;
+                        current_file->line_count++;
+                        current_file->additions += kind == DIFF_SCAN_KIND_ADD;
+                        current_file->deletions += kind == DIFF_SCAN_KIND_DELETE;
+                        parser->pending_lines++;
+                    }
+                    break;
+                default:
+                    break;
+            }
+            line_start = line_end + 1;
         }
-        if (*p == '"') p++;
+    }
+    parser->parsed = line_start < end ? line_start : end;
+    return 1;
+}
+
+static void stream_state_init(DiffStreamParser* parser, DiffData* data) {
+    memset(parser, 0, sizeof(DiffStreamParser));
+    parser->data = data;
+}
+
+// Разбирает [begin, end) в массивы parser->data, заранее выделенные по верхним границам.
+// Векторный подсчет по первому байту дает эти границы, поэтому каждый массив
+// выделяется из арены одним запросом.
+static int parse_range(DiffStreamParser* parser, size_t begin, size_t end) {
+    DiffData* data = parser->data;
+    size_t counts[DIFF_SCAN_KIND_COUNT];
+    diff_scan_count_kinds(data->buffer + begin, end - begin, counts);
+    size_t max_files = counts[DIFF_SCAN_KIND_FILE];
+    size_t max_hunks = counts[DIFF_SCAN_KIND_HUNK];
+    size_t max_lines = counts[DIFF_SCAN_KIND_ADD] + counts[DIFF_SCAN_KIND_DELETE] + counts[DIFF_SCAN_KIND_CONTEXT];
+    if (!reserve_array(&data->arena, (void**)&data->files, &parser->file_capacity, max_files ? max_files : 1, sizeof(DiffFile)) ||
+        !reserve_array(&data->arena, (void**)&data->hunks, &parser->hunk_capacity, max_hunks ? max_hunks : 1, sizeof(DiffHunk)) ||
+        !reserve_lines(&data->arena, &data->lines, &parser->line_capacity, max_lines ? max_lines : 1)) {
+        log_error("diff_parser: Failed to allocate diff arrays (%zu files, %zu hunks, %zu lines)",
+                  max_files, max_hunks, max_lines);
+        return 0;
+    }
+    parser->parsed = begin;
+    if (!parse_lines(parser, end)) {
+        return 0;
+    }
+    commit_pending_file(parser, end);
+    return 1;
+}
+
+// --- ПАРАЛЛЕЛЬНЫЙ РАЗБОР ---
+// Буфер режется на куски по границам "diff --git", каждый кусок разбирается
+// отдельным потоком в собственную арену, затем результаты копируются
+// в data по порядку. Смещения срезов абсолютные, поэтому при слиянии
+// поправляются только индексы first_hunk/first_line.
+
+typedef struct {
+    size_t begin;
+    size_t end;
+    DiffData part;       // Арена и массивы куска; buffer указывает на общий буфер
+    size_t file_base;    // Куда кусок попадает в итоговых массивах
+    size_t hunk_base;
+    size_t line_base;
+    int ok;
+} ParseRange;
+
+typedef struct {
+    DiffData* data;
+    ParseRange* ranges;
+} ParallelParse;
+
+static void parse_range_task(void* context, size_t index) {
+    ParallelParse* job = (ParallelParse*)context;
+    ParseRange* range = &job->ranges[index];
+    DiffStreamParser parser;
+    stream_state_init(&parser, &range->part);
+    range->ok = parse_range(&parser, range->begin, range->end);
+}
+
+static void merge_range_task(void* context, size_t index) {
+    ParallelParse* job = (ParallelParse*)context;
+    const ParseRange* range = &job->ranges[index];
+    DiffData* data = job->data;
+    const DiffData* part = &range->part;
+    DiffFile* files = data->files + range->file_base;
+    for (size_t i = 0; i < part->file_count; i++) {
+        files[i] = part->files[i];
+        files[i].first_hunk += range->hunk_base;
+        files[i].first_line += range->line_base;
+    }
+    DiffHunk* hunks = data->hunks + range->hunk_base;
+    for (size_t i = 0; i < part->hunk_count; i++) {
+        hunks[i] = part->hunks[i];
+        hunks[i].first_line += range->line_base;
+    }
+    // Смещения в таблице строк абсолютные, столбцы копируются как есть
+    size_t lines = part->line_count;
+    if (lines > 0) {
+        memcpy(data->lines.types + range->line_base, part->lines.types, lines);
+        memcpy(data->lines.offsets + range->line_base, part->lines.offsets, lines * sizeof(uint32_t));
+        memcpy(data->lines.lengths + range->line_base, part->lines.lengths, lines * sizeof(uint32_t));
+        memcpy(data->lines.widths + range->line_base, part->lines.widths, lines * sizeof(uint32_t));
+        memcpy(data->lines.text_flags + range->line_base, part->lines.text_flags, lines);
+        memcpy(data->lines.old_numbers + range->line_base, part->lines.old_numbers, lines * sizeof(uint32_t));
+        memcpy(data->lines.new_numbers + range->line_base, part->lines.new_numbers, lines * sizeof(uint32_t));
+        // Ряды "рядом" ссылаются на строки относительно ханка и не сдвигаются
+        memcpy(data->lines.row_left + range->line_base, part->lines.row_left, lines * sizeof(uint32_t));
+        memcpy(data->lines.row_right + range->line_base, part->lines.row_right, lines * sizeof(uint32_t));
+    }
+}
+
+static int parse_parallel(DiffData* data, ThreadPool* pool) {
+    size_t threads = thread_pool_size(pool) + 1;
+    size_t max_ranges = threads * PARSER_PARALLEL_RANGES_PER_THREAD;
+    if (max_ranges > data->buffer_size / PARSER_PARALLEL_MIN_RANGE) {
+        max_ranges = data->buffer_size / PARSER_PARALLEL_MIN_RANGE;
+    }
+    if (max_ranges < 2) max_ranges = 2;
+    ParseRange* ranges = calloc(max_ranges, sizeof(ParseRange));
+    if (!ranges) {
+        log_error("diff_parser: Failed to allocate %zu parse ranges", max_ranges);
+        return 0;
+    }
+
+    // Границы ищутся от равномерно расставленных точек; соседние точки внутри
+    // одного большого файла дают одну и ту же границу, такие куски сливаются
+    size_t range_count = 0;
+    size_t begin = 0;
+    for (size_t i = 1; i <= max_ranges && begin < data->buffer_size; i++) {
+        size_t end = i == max_ranges ? data->buffer_size :
+            diff_scan_find_file_header(data->buffer, data->buffer_size, data->buffer_size / max_ranges * i);
+        if (end <= begin) continue;
+        ParseRange* range = &ranges[range_count++];
+        range->begin = begin;
+        range->end = end;
+        arena_init(&range->part.arena, ARENA_DEFAULT_BLOCK_SIZE);
+        range->part.buffer = data->buffer;
+        range->part.buffer_size = data->buffer_size;
+        begin = end;
+    }
+
+    ParallelParse job = { data, ranges };
+    thread_pool_parallel_for(pool, range_count, parse_range_task, &job);
+
+    int ok = 1;
+    size_t total_files = 0, total_hunks = 0, total_lines = 0;
+    for (size_t i = 0; i < range_count; i++) {
+        ok = ok && ranges[i].ok;
+        ranges[i].file_base = total_files;
+        ranges[i].hunk_base = total_hunks;
+        ranges[i].line_base = total_lines;
+        total_files += ranges[i].part.file_count;
+        total_hunks += ranges[i].part.hunk_count;
+        total_lines += ranges[i].part.line_count;
+    }
+    if (ok) {
+        data->files = arena_alloc(&data->arena, (total_files ? total_files : 1) * sizeof(DiffFile));
+        data->hunks = arena_alloc(&data->arena, (total_hunks ? total_hunks : 1) * sizeof(DiffHunk));
+        size_t line_capacity = 0;
+        ok = data->files && data->hunks &&
+             reserve_lines(&data->arena, &data->lines, &line_capacity, total_lines ? total_lines : 1);
+    }
+    if (ok) {
+        thread_pool_parallel_for(pool, range_count, merge_range_task, &job);
+        data->file_count = total_files;
+        data->hunk_count = total_hunks;
+        data->line_count = total_lines;
+        log_debug("diff_parser: Parsed %zu files in %zu ranges on %zu threads", total_files, range_count, threads);
+    }
+    for (size_t i = 0; i < range_count; i++) {
+        arena_destroy(&ranges[i].part.arena);
+    }
+    free(ranges);
+    return ok;
+}
+
+// --- ЛЕНИВЫЙ РАЗБОР ---
+// В diff из тысяч файлов большинство файлов так и не раскрывают, поэтому при
+// загрузке читаются только заголовки секций: путь, срез секции и число
+// добавленных и удаленных строк. Подсчет по первому байту от первого "@@"
+// секции дает ровно столько ханков и строк, сколько потом разберет parse_lines,
+// поэтому каждому файлу сразу отводятся его ячейки в общих массивах. Разбор
+// файла (diff_parser_parse_file) пишет только в свои ячейки: массивы не
+// переезжают и остаются в порядке diff, как после полного разбора.
+
+// Начала всех секций "diff --git". Возвращает malloc'd массив
+// из *count начал и завершающего элемента size.
+static size_t* find_file_sections(const char* buffer, size_t size, size_t* count) {
+    size_t capacity = 256;
+    size_t* starts = malloc(capacity * sizeof(size_t));
+    if (!starts) {
+        log_error("diff_parser: Failed to allocate section list");
+        return NULL;
+    }
+    *count = 0;
+    size_t start = diff_scan_find_file_header(buffer, size, 0);
+    while (start < size) {
+        if (*count + 1 >= capacity) {
+            size_t* grown = realloc(starts, capacity * 2 * sizeof(size_t));
+            if (!grown) {
+                log_error("diff_parser: Failed to grow section list");
+                free(starts);
+                return NULL;
+            }
+            starts = grown;
+            capacity *= 2;
+        }
+        starts[(*count)++] = start;
+        start = diff_scan_find_file_header(buffer, size, start + 1);
+    }
+    starts[*count] = size;
+    return starts;
+}
+
+// Считает строки секции от первого заголовка ханка после from (from - конец
+// строки "diff --git"). Строки "---"/"+++" перед первым ханком не считаются.
+static void count_section(const char* buffer, size_t from, size_t end, size_t counts[DIFF_SCAN_KIND_COUNT]) {
+    // Строк перед первым ханком (index, ---, +++) несколько, проще пройти их по одной
+    size_t pos = from;
+    while (pos < end) {
+        const char* newline = memchr(buffer + pos, '\n', end - pos);
+        if (!newline) {
+            break;
+        }
+        pos = (size_t)(newline - buffer) + 1;
+        if (pos + 1 < end && buffer[pos] == '@' && buffer[pos + 1] == '@') {
+            diff_scan_count_kinds(buffer + pos, end - pos, counts);
+            return;
+        }
+    }
+    memset(counts, 0, DIFF_SCAN_KIND_COUNT * sizeof(size_t));
+}
+
+// Конец строки "diff --git" в начале секции
+static size_t section_header_end(const char* buffer, size_t start, size_t end) {
+    const char* newline = memchr(buffer + start, '\n', end - start);
+    return newline ? (size_t)(newline - buffer) : end;
+}
+
+typedef struct {
+    DiffData* data;
+    const size_t* starts;
+    size_t section_count;
+} SectionScan;
+
+// Читает заголовки секций одной пачки. Пока идет подсчет, first_hunk и first_line
+// файла хранят число его ханков и строк; scan_sections превращает их в начала
+static void scan_section_batch(void* context, size_t batch) {
+    const SectionScan* scan = (const SectionScan*)context;
+    char* buffer = scan->data->buffer;
+    size_t last = (batch + 1) * PARSER_SCAN_BATCH;
+    if (last > scan->section_count) last = scan->section_count;
+    for (size_t s = batch * PARSER_SCAN_BATCH; s < last; s++) {
+        const size_t start = scan->starts[s];
+        const size_t end = scan->starts[s + 1];
+        const size_t header_end = section_header_end(buffer, start, end);
+        DiffFile* file = &scan->data->files[s];
+        parse_file_header(file, buffer, start, header_end);
+        file->section.length = end - start;
+        file->is_collapsed = 1;
+        size_t counts[DIFF_SCAN_KIND_COUNT];
+        count_section(buffer, header_end, end, counts);
+        file->additions = counts[DIFF_SCAN_KIND_ADD];
+        file->deletions = counts[DIFF_SCAN_KIND_DELETE];
+        // Файлу без ханков (бинарному, со сменой режима) разбирать нечего
+        file->is_parsed = counts[DIFF_SCAN_KIND_HUNK] == 0;
+        file->first_hunk = counts[DIFF_SCAN_KIND_HUNK];
+        file->first_line = counts[DIFF_SCAN_KIND_ADD] + counts[DIFF_SCAN_KIND_DELETE] + counts[DIFF_SCAN_KIND_CONTEXT];
+    }
+}
+
+// Заполняет пустой data записями файлов по section_count началам секций
+// (с завершающим buffer_size) и отводит ячейки под их ханки и строки.
+// Все файлы начинаются свернутыми.
+static int scan_sections(DiffData* data, const size_t* starts, size_t section_count) {
+    data->files = arena_alloc(&data->arena, (section_count ? section_count : 1) * sizeof(DiffFile));
+    if (!data->files) {
+        log_error("diff_parser: Failed to allocate %zu file headers", section_count);
+        return 0;
+    }
+    // Секции независимы: большой diff читается пачками в пуле потоков
+    SectionScan scan = { data, starts, section_count };
+    const size_t batches = (section_count + PARSER_SCAN_BATCH - 1) / PARSER_SCAN_BATCH;
+    ThreadPool* pool = data->buffer_size >= PARSER_PARALLEL_MIN_BYTES ? thread_pool_shared() : NULL;
+    if (pool && thread_pool_size(pool) > 0) {
+        thread_pool_parallel_for(pool, batches, scan_section_batch, &scan);
     } else {
-        while (*p && !isspace((unsigned char)*p)) {
-            *q++ = *p++;
+        for (size_t b = 0; b < batches; b++) {
+            scan_section_batch(&scan, b);
         }
     }
-    *q = '\0';
-    *p_ptr = p;
-    return path_buffer;
+    size_t total_hunks = 0, total_lines = 0;
+    for (size_t i = 0; i < section_count; i++) {
+        DiffFile* file = &data->files[i];
+        const size_t hunks = file->first_hunk;
+        const size_t lines = file->first_line;
+        file->first_hunk = total_hunks;
+        file->first_line = total_lines;
+        total_hunks += hunks;
+        total_lines += lines;
+    }
+
+    // Неразобранные ячейки обнулены: снимок и проверка снимка видят пустые ханки и строки
+    size_t line_capacity = 0;
+    data->hunks = arena_alloc(&data->arena, (total_hunks ? total_hunks : 1) * sizeof(DiffHunk));
+    if (!data->hunks || !reserve_lines(&data->arena, &data->lines, &line_capacity, total_lines ? total_lines : 1)) {
+        log_error("diff_parser: Failed to reserve %zu hunks and %zu lines", total_hunks, total_lines);
+        return 0;
+    }
+    memset(data->hunks, 0, total_hunks * sizeof(DiffHunk));
+    DiffLineTable* table = &data->lines;
+    memset(table->types, 0, total_lines);
+    memset(table->text_flags, 0, total_lines);
+    memset(table->offsets, 0, total_lines * sizeof(uint32_t));
+    memset(table->lengths, 0, total_lines * sizeof(uint32_t));
+    memset(table->widths, 0, total_lines * sizeof(uint32_t));
+    memset(table->old_numbers, 0, total_lines * sizeof(uint32_t));
+    memset(table->new_numbers, 0, total_lines * sizeof(uint32_t));
+    memset(table->row_left, 0, total_lines * sizeof(uint32_t));
+    memset(table->row_right, 0, total_lines * sizeof(uint32_t));
+    data->file_count = section_count;
+    data->hunk_count = total_hunks;
+    data->line_count = total_lines;
+    log_debug("diff_parser: Scanned %zu file headers (%zu hunks, %zu lines parsed on demand)",
+              section_count, total_hunks, total_lines);
+    return 1;
+}
+
+int diff_parser_parse_file(DiffData* data, size_t index) {
+    if (!data || index >= data->file_count) {
+        return 0;
+    }
+    DiffFile* file = &data->files[index];
+    if (diff_data_file_is_parsed(file)) {
+        return 1;
+    }
+    const int is_last = index + 1 == data->file_count;
+    const size_t hunk_slots = (is_last ? data->hunk_count : data->files[index + 1].first_hunk) - file->first_hunk;
+    const size_t line_slots = (is_last ? data->line_count : data->files[index + 1].first_line) - file->first_line;
+    const size_t start = file->section.offset;
+    const size_t end = start + file->section.length;
+    diff_cold_store_pin(data->cold, start, end - start);
+    const size_t header_end = section_header_end(data->buffer, start, end);
+    // Пересчет защищает ячейки соседей, если запись файла не соответствует секции (поврежденный снимок)
+    size_t counts[DIFF_SCAN_KIND_COUNT];
+    count_section(data->buffer, header_end, end, counts);
+    if (counts[DIFF_SCAN_KIND_HUNK] > hunk_slots ||
+        counts[DIFF_SCAN_KIND_ADD] + counts[DIFF_SCAN_KIND_DELETE] + counts[DIFF_SCAN_KIND_CONTEXT] > line_slots) {
+        log_error("diff_parser: File %zu does not fit the %zu hunks and %zu lines reserved for it",
+                  index, hunk_slots, line_slots);
+        diff_cold_store_unpin(data->cold, start, end - start);
+        return 0;
+    }
+
+    // Окно на ячейки файла: parse_lines заполняет его как пустой diff из одного
+    // файла, строка "diff --git" уже разобрана (путь в кавычках раскодирован на месте)
+    DiffFile pending;
+    memset(&pending, 0, sizeof(DiffFile));
+    pending.section.offset = start;
+    DiffData window;
+    memset(&window, 0, sizeof(DiffData));
+    window.buffer = data->buffer;
+    window.buffer_size = data->buffer_size;
+    window.files = &pending;
+    window.hunks = data->hunks + file->first_hunk;
+    const size_t base = file->first_line;
+    window.lines.types = data->lines.types + base;
+    window.lines.offsets = data->lines.offsets + base;
+    window.lines.lengths = data->lines.lengths + base;
+    window.lines.widths = data->lines.widths + base;
+    window.lines.text_flags = data->lines.text_flags + base;
+    window.lines.old_numbers = data->lines.old_numbers + base;
+    window.lines.new_numbers = data->lines.new_numbers + base;
+    window.lines.row_left = data->lines.row_left + base;
+    window.lines.row_right = data->lines.row_right + base;
+    DiffStreamParser parser;
+    stream_state_init(&parser, &window);
+    // Емкости равны отведенным ячейкам: пересчет выше гарантирует, что массивы не растут
+    parser.file_capacity = 1;
+    parser.hunk_capacity = hunk_slots;
+    parser.line_capacity = line_slots;
+    parser.has_file = 1;
+    parser.parsed = header_end < end ? header_end + 1 : end;
+    const int parsed = parse_lines(&parser, end);
+    diff_cold_store_unpin(data->cold, start, end - start);
+    if (!parsed) {
+        return 0;
+    }
+    commit_pending_file(&parser, end);
+    for (size_t i = 0; i < window.hunk_count; i++) {
+        window.hunks[i].first_line += base;
+    }
+    file->hunk_count = pending.hunk_count;
+    file->line_count = pending.line_count;
+    file->additions = pending.additions;
+    file->deletions = pending.deletions;
+    __atomic_store_n(&file->is_parsed, 1, __ATOMIC_RELEASE);
+    return 1;
 }
+
+// Разбор целиком загруженного буфера
+static int parse_owned_buffer(DiffData* data) {
+    if (data->buffer_size > PARSER_MAX_BUFFER_SIZE) {
+        log_error("diff_parser: Diff of %zu bytes exceeds the %zu byte limit", data->buffer_size, (size_t)PARSER_MAX_BUFFER_SIZE);
+        return 0;
+    }
+    size_t section_count = 0;
+    size_t* section_starts = find_file_sections(data->buffer, data->buffer_size, &section_count);
+    if (section_starts && section_count >= PARSER_LAZY_MIN_FILES) {
+        int ok = scan_sections(data, section_starts, section_count);
+        free(section_starts);
+        return ok;
+    }
+    free(section_starts);
+    if (data->buffer_size >= PARSER_PARALLEL_MIN_BYTES) {
+        ThreadPool* pool = thread_pool_shared();
+        if (thread_pool_size(pool) > 0) {
+            return parse_parallel(data, pool);
+        }
+    }
+    DiffStreamParser parser;
+    stream_state_init(&parser, data);
+    return parse_range(&parser, 0, data->buffer_size);
+}
+
+int diff_parser_parse_owned(DiffData* data, char* buffer, size_t buffer_size) {
+    if (!data || !buffer || buffer_size == 0) {
+        free(buffer);
+        return 0;
+    }
+    // С этого момента буфер принадлежит DiffData и освобождается в diff_data_clear
+    data->buffer = buffer;
+    data->buffer_size = buffer_size;
+    data->buffer_owned = 1;
+    return parse_owned_buffer(data);
+}
+
+int diff_parser_parse_in_place(DiffData* data) {
+    if (!data || !data->buffer || data->buffer_size == 0) return 0;
+    return parse_owned_buffer(data);
+}
+
 int diff_parser_parse(DiffData* data, const char* buffer, size_t buffer_size) {
     if (!data || !buffer || buffer_size == 0) return 0;
-    char* buffer_copy = malloc(buffer_size + 1);
+    // Единственная копия, прямо в арене: дальше парсер работает со срезами этого блока
+    char* buffer_copy = arena_alloc(&data->arena, buffer_size);
     if (!buffer_copy) return 0;
     memcpy(buffer_copy, buffer, buffer_size);
-    buffer_copy[buffer_size] = '\0';
-    char *saveptr = NULL;
-    char *line = strtok_r(buffer_copy, "
-", &saveptr);
-    DiffFile* current_file = NULL;
-    DiffHunk* current_hunk = NULL;
-    while (line != NULL) {
-        if (strncmp(line, "diff --git ", 11) == 0) {
-            const char* p = line + 11;
-            char* path_a_raw = parse_git_path(&p);
-            char* path_b_raw = parse_git_path(&p);
-            char* path_a = (strncmp(path_a_raw, "a/", 2) == 0) ? path_a_raw + 2 : path_a_raw;
-            char* path_b = (strncmp(path_b_raw, "b/", 2) == 0) ? path_b_raw + 2 : path_b_raw;
-            if (!ensure_files_capacity(data)) { free(path_a_raw); free(path_b_raw); return 0; }
-            current_file = &data->files[data->file_count];
-            memset(current_file, 0, sizeof(DiffFile));
-            current_file->path = strdup(path_b);
-            free(path_a_raw);
-            free(path_b_raw);
-            data->file_count++;
-            current_hunk = NULL;
-        } else if (current_file && strncmp(line, "@@", 2) == 0) {
-            if (!ensure_hunks_capacity(current_file)) { return 0; }
-            current_hunk = &current_file->hunks[current_file->hunk_count];
-            memset(current_hunk, 0, sizeof(DiffHunk));
-            current_hunk->header = strdup(line);
-            current_file->hunk_count++;
-        } else if (current_hunk && (line[0] == ' ' || line[0] == '+' || line[0] == '-')) {
-            if (!ensure_lines_capacity(current_hunk)) { return 0; }
-            DiffLine* new_line = &current_hunk->lines[current_hunk->line_count];
-            new_line->content = strdup(line);
-            switch(line[0]) {
-                case '+': new_line->type = LINE_TYPE_ADD; break;
-                case '-': new_line->type = LINE_TYPE_DELETE; break;
-                default: new_line->type = LINE_TYPE_CONTEXT; break;
+    data->buffer = buffer_copy;
+    data->buffer_size = buffer_size;
+    data->buffer_owned = 0;
+    return parse_owned_buffer(data);
+}
+
+// --- ПОВТОРНАЯ ЗАГРУЗКА ---
+// Новый diff режется на секции "diff --git", каждая хешируется. Секция, совпавшая
+// по хешу и длине с файлом текущего diff, не разбирается: его ханки и строки
+// копируются со сдвигом смещений. Разбираются только изменившиеся секции.
+
+#define SECTION_NOT_FOUND ((size_t)-1)
+
+// Открытая адресация: ключ (hash, length), значение - индекс файла старого diff
+typedef struct {
+    uint64_t hash;
+    size_t length;
+    size_t file; // SECTION_NOT_FOUND = пустой слот
+} SectionSlot;
+
+typedef struct {
+    SectionSlot* slots;
+    size_t mask;
+} SectionTable;
+
+static int section_table_init(SectionTable* table, size_t count) {
+    size_t capacity = 16;
+    while (capacity < count * 2) capacity *= 2;
+    table->slots = malloc(capacity * sizeof(SectionSlot));
+    if (!table->slots) {
+        log_error("diff_parser: Failed to allocate section table of %zu slots", capacity);
+        return 0;
+    }
+    for (size_t i = 0; i < capacity; i++) {
+        table->slots[i].file = SECTION_NOT_FOUND;
+    }
+    table->mask = capacity - 1;
+    return 1;
+}
+
+static void section_table_insert(SectionTable* table, uint64_t hash, size_t length, size_t file) {
+    size_t i = (size_t)hash & table->mask;
+    while (table->slots[i].file != SECTION_NOT_FOUND) {
+        i = (i + 1) & table->mask;
+    }
+    table->slots[i].hash = hash;
+    table->slots[i].length = length;
+    table->slots[i].file = file;
+}
+
+// Первый файл с таким ключом, начиная со слота *cursor (для перебора совпадений)
+static size_t section_table_next(const SectionTable* table, uint64_t hash, size_t length, size_t* cursor) {
+    size_t i = *cursor;
+    while (table->slots[i].file != SECTION_NOT_FOUND) {
+        const SectionSlot* slot = &table->slots[i];
+        i = (i + 1) & table->mask;
+        if (slot->hash == hash && slot->length == length) {
+            *cursor = i;
+            return slot->file;
+        }
+    }
+    *cursor = i;
+    return SECTION_NOT_FOUND;
+}
+
+// Хеш секции файла; для файлов из полного разбора считается при первой перезагрузке
+// (старый diff только читается, поэтому хеш запоминается уже в копии файла).
+// Если парсер раскодировал путь в кавычках на месте, хеш считается по уже измененным
+// байтам и с исходным текстом новой секции не совпадет - такой файл просто разберется заново.
+static uint64_t file_section_hash(const DiffData* data, const DiffFile* file) {
+    if (file->section_hash == 0) {
+        return hash_bytes(diff_data_span_ptr(data, file->section), file->section.length);
+    }
+    return file->section_hash;
+}
+
+// Копирует ханки и строки разобранного файла старого diff в ячейки data,
+// начиная с first_hunk и first_line. delta - сдвиг секции файла в новом буфере
+// (может быть отрицательным: арифметика по модулю дает верный результат).
+// Флаги сворачивания может в это же время менять поток UI, поэтому они читаются атомарно.
+static void copy_file_contents(DiffData* data, size_t first_hunk, size_t first_line,
+                               const DiffData* old, const DiffFile* old_file, size_t delta) {
+    const uint32_t delta32 = (uint32_t)delta;
+    const DiffHunk* old_hunks = diff_data_file_hunks(old, old_file);
+    DiffHunk* hunks = data->hunks + first_hunk;
+    for (size_t i = 0; i < old_file->hunk_count; i++) {
+        const DiffHunk* old_hunk = &old_hunks[i];
+        DiffHunk* hunk = &hunks[i];
+        memset(hunk, 0, sizeof(DiffHunk));
+        hunk->header.offset = old_hunk->header.offset + delta;
+        hunk->header.length = old_hunk->header.length;
+        hunk->old_start = old_hunk->old_start;
+        hunk->old_count = old_hunk->old_count;
+        hunk->new_start = old_hunk->new_start;
+        hunk->new_count = old_hunk->new_count;
+        hunk->first_line = old_hunk->first_line - old_file->first_line + first_line;
+        hunk->line_count = old_hunk->line_count;
+        hunk->row_count = old_hunk->row_count;
+        hunk->is_collapsed = __atomic_load_n(&old_hunk->is_collapsed, __ATOMIC_RELAXED);
+    }
+
+    const size_t from = old_file->first_line;
+    const size_t to = first_line;
+    const size_t count = old_file->line_count;
+    memcpy(data->lines.types + to, old->lines.types + from, count);
+    memcpy(data->lines.lengths + to, old->lines.lengths + from, count * sizeof(uint32_t));
+    memcpy(data->lines.widths + to, old->lines.widths + from, count * sizeof(uint32_t));
+    memcpy(data->lines.text_flags + to, old->lines.text_flags + from, count);
+    memcpy(data->lines.old_numbers + to, old->lines.old_numbers + from, count * sizeof(uint32_t));
+    memcpy(data->lines.new_numbers + to, old->lines.new_numbers + from, count * sizeof(uint32_t));
+    memcpy(data->lines.row_left + to, old->lines.row_left + from, count * sizeof(uint32_t));
+    memcpy(data->lines.row_right + to, old->lines.row_right + from, count * sizeof(uint32_t));
+    for (size_t i = 0; i < count; i++) {
+        data->lines.offsets[to + i] = old->lines.offsets[from + i] + delta32;
+    }
+}
+
+// Копирует разобранный файл старого diff в конец parser->data, сдвигая смещения
+// на новое положение его секции. Кэш ширин и флаги сворачивания сохраняются.
+static int append_unchanged_file(DiffStreamParser* parser, const DiffData* old, const DiffFile* old_file,
+                                 size_t section_offset, uint64_t section_hash) {
+    DiffData* data = parser->data;
+    if (!reserve_array(&data->arena, (void**)&data->files, &parser->file_capacity,
+                       data->file_count + 1, sizeof(DiffFile)) ||
+        !reserve_array(&data->arena, (void**)&data->hunks, &parser->hunk_capacity,
+                       data->hunk_count + old_file->hunk_count, sizeof(DiffHunk)) ||
+        !reserve_lines(&data->arena, &data->lines, &parser->line_capacity,
+                       data->line_count + old_file->line_count)) {
+        return 0;
+    }
+    const size_t delta = section_offset - old_file->section.offset;
+
+    // Записи копируются по полям: флаг сворачивания читается атомарно
+    DiffFile* file = &data->files[data->file_count];
+    memset(file, 0, sizeof(DiffFile));
+    file->path.offset = old_file->path.offset + delta;
+    file->path.length = old_file->path.length;
+    file->first_hunk = data->hunk_count;
+    file->hunk_count = old_file->hunk_count;
+    file->first_line = data->line_count;
+    file->line_count = old_file->line_count;
+    file->section.offset = section_offset;
+    file->section.length = old_file->section.length;
+    file->section_hash = section_hash;
+    file->additions = old_file->additions;
+    file->deletions = old_file->deletions;
+    file->is_parsed = 1;
+    file->is_collapsed = __atomic_load_n(&old_file->is_collapsed, __ATOMIC_RELAXED);
+    copy_file_contents(data, data->hunk_count, data->line_count, old, old_file, delta);
+
+    data->file_count++;
+    data->hunk_count += old_file->hunk_count;
+    data->line_count += old_file->line_count;
+    return 1;
+}
+
+// Заново разобранный файл сохраняет свернутость, если путь не изменился
+static void carry_collapse_state(const DiffData* old, const SectionTable* paths,
+                                 const DiffData* data, DiffFile* file) {
+    const char* path = diff_data_span_ptr(data, file->path);
+    uint64_t hash = hash_bytes(path, file->path.length);
+    size_t cursor = (size_t)hash & paths->mask;
+    size_t old_index;
+    while ((old_index = section_table_next(paths, hash, file->path.length, &cursor)) != SECTION_NOT_FOUND) {
+        const DiffFile* old_file = &old->files[old_index];
+        if (memcmp(diff_data_span_ptr(old, old_file->path), path, file->path.length) == 0) {
+            file->is_collapsed = __atomic_load_n(&old_file->is_collapsed, __ATOMIC_RELAXED);
+            return;
+        }
+    }
+}
+
+// Большой diff после scan_sections: файл, секция которого совпала с уже
+// разобранным файлом old, копируется в отведенные ему ячейки и сразу считается
+// разобранным; остальные разберутся при показе и только сохраняют свернутость.
+// Хеш считается по байтам после разбора заголовка (путь в кавычках раскодирован
+// на месте) - так же, как у файлов old, прочитанных по заголовкам.
+static int reuse_scanned_files(const DiffData* old, const SectionTable* sections,
+                               const SectionTable* paths, DiffData* next) {
+    next->reused_files = arena_alloc(&next->arena, old->file_count * sizeof(size_t));
+    if (!next->reused_files) {
+        log_error("diff_parser: Failed to allocate reuse table for %zu files", old->file_count);
+        return 0;
+    }
+    for (size_t i = 0; i < old->file_count; i++) {
+        next->reused_files[i] = DIFF_NOT_REUSED;
+    }
+    next->reused_file_count = old->file_count;
+    size_t reused = 0;
+    for (size_t index = 0; index < next->file_count; index++) {
+        DiffFile* file = &next->files[index];
+        const int is_last = index + 1 == next->file_count;
+        const size_t hunk_slots = (is_last ? next->hunk_count : next->files[index + 1].first_hunk) - file->first_hunk;
+        const size_t line_slots = (is_last ? next->line_count : next->files[index + 1].first_line) - file->first_line;
+        const uint64_t hash = hash_bytes(diff_data_span_ptr(next, file->section), file->section.length);
+        size_t cursor = (size_t)hash & sections->mask;
+        const size_t old_index = section_table_next(sections, hash, file->section.length, &cursor);
+        const DiffFile* old_file = old_index != SECTION_NOT_FOUND ? &old->files[old_index] : NULL;
+        if (!old_file || !diff_data_file_is_parsed(old_file) ||
+            old_file->hunk_count > hunk_slots || old_file->line_count > line_slots) {
+            carry_collapse_state(old, paths, next, file);
+            continue;
+        }
+        copy_file_contents(next, file->first_hunk, file->first_line, old, old_file,
+                           file->section.offset - old_file->section.offset);
+        file->hunk_count = old_file->hunk_count;
+        file->line_count = old_file->line_count;
+        file->additions = old_file->additions;
+        file->deletions = old_file->deletions;
+        file->is_collapsed = __atomic_load_n(&old_file->is_collapsed, __ATOMIC_RELAXED);
+        file->is_parsed = 1;
+        if (next->reused_files[old_index] == DIFF_NOT_REUSED) {
+            next->reused_files[old_index] = index;
+        }
+        reused++;
+    }
+    log_debug("diff_parser: Reloaded %zu files by headers, %zu parsed ones reused", next->file_count, reused);
+    return 1;
+}
+
+// Собирает в next (пустой, с уже присоединенным буфером) новый diff, копируя
+// неизменившиеся файлы из old. old только читается.
+static int reparse_into(const DiffData* old, DiffData* next) {
+    const char* buffer = next->buffer;
+    const size_t buffer_size = next->buffer_size;
+    if (old->file_count == 0) {
+        // Переиспользовать нечего
+        return parse_owned_buffer(next);
+    }
+
+    SectionTable sections = { NULL, 0 };
+    SectionTable paths = { NULL, 0 };
+    size_t section_count = 0;
+    size_t* section_starts = find_file_sections(buffer, buffer_size, &section_count);
+    if (!section_starts || !section_table_init(&sections, old->file_count) ||
+        !section_table_init(&paths, old->file_count)) {
+        // Без таблиц переиспользовать нечего: обычный полный разбор
+        free(section_starts);
+        free(sections.slots);
+        return parse_owned_buffer(next);
+    }
+    for (size_t i = 0; i < old->file_count; i++) {
+        const DiffFile* file = &old->files[i];
+        section_table_insert(&sections, file_section_hash(old, file), file->section.length, i);
+        section_table_insert(&paths, hash_bytes(diff_data_span_ptr(old, file->path), file->path.length),
+                             file->path.length, i);
+    }
+
+    if (section_count >= PARSER_LAZY_MIN_FILES) {
+        // Большой diff снова читается по заголовкам; уже разобранные файлы переносятся
+        int ok = scan_sections(next, section_starts, section_count) &&
+                 reuse_scanned_files(old, &sections, &paths, next);
+        free(section_starts);
+        free(sections.slots);
+        free(paths.slots);
+        return ok;
+    }
+
+    DiffStreamParser parser;
+    stream_state_init(&parser, next);
+
+    // Размеры старого diff - хорошая оценка для нового
+    int ok = reserve_array(&next->arena, (void**)&next->files, &parser.file_capacity, old->file_count + 1, sizeof(DiffFile)) &&
+             reserve_array(&next->arena, (void**)&next->hunks, &parser.hunk_capacity, old->hunk_count + 1, sizeof(DiffHunk)) &&
+             reserve_lines(&next->arena, &next->lines, &parser.line_capacity, old->line_count + 1);
+    // Куда попали неизменившиеся файлы: по этой таблице UI переносит свои кэши
+    next->reused_files = ok ? arena_alloc(&next->arena, old->file_count * sizeof(size_t)) : NULL;
+    ok = ok && next->reused_files;
+    for (size_t i = 0; ok && i < old->file_count; i++) {
+        next->reused_files[i] = DIFF_NOT_REUSED;
+    }
+    next->reused_file_count = ok ? old->file_count : 0;
+    size_t reused = 0;
+    for (size_t s = 0; ok && s < section_count; s++) {
+        const size_t start = section_starts[s];
+        const size_t end = section_starts[s + 1];
+        uint64_t hash = hash_bytes(buffer + start, end - start);
+        size_t cursor = (size_t)hash & sections.mask;
+        size_t old_index = section_table_next(&sections, hash, end - start, &cursor);
+        // Файл старого diff, загруженного лениво, копируется, только если его уже разобрали
+        if (old_index != SECTION_NOT_FOUND && diff_data_file_is_parsed(&old->files[old_index])) {
+            if (next->reused_files[old_index] == DIFF_NOT_REUSED) {
+                next->reused_files[old_index] = next->file_count;
+            }
+            ok = append_unchanged_file(&parser, old, &old->files[old_index], start, hash);
+            reused++;
+        } else {
+            size_t index = next->file_count;
+            parser.parsed = start;
+            ok = parse_lines(&parser, end);
+            if (ok) {
+                commit_pending_file(&parser, end);
+            }
+            if (ok && next->file_count > index) {
+                DiffFile* file = &next->files[index];
+                // Хеш исходных байт годится, только если разбор их не менял (путь без кавычек)
+                const char* header_end = memchr(buffer + start, '\n', end - start);
+                size_t header_length = header_end ? (size_t)(header_end - (buffer + start)) : end - start;
+                if (!memchr(buffer + start, '"', header_length)) {
+                    file->section_hash = hash;
+                }
+                carry_collapse_state(old, &paths, next, file);
             }
-            current_hunk->line_count++;
         }
-        line = strtok_r(NULL, "
-", &saveptr);
     }
-    // --- ИСПРАВЛЕНИЕ: Освобождаем buffer_copy при успешном завершении ---
-    free(buffer_copy);
-    // --- КОНЕЦ ИСПРАВЛЕНИЯ ---
+    free(section_starts);
+    free(sections.slots);
+    free(paths.slots);
+    if (ok) {
+        log_debug("diff_parser: Reloaded %zu files, %zu reused unchanged", next->file_count, reused);
+    }
+    return ok;
+}
+
+// Сборка читает заголовки всех файлов старого diff и секции без запомненного
+// хеша, поэтому его буфер закрепляется целиком
+static int reparse_into_pinned(const DiffData* old, DiffData* next) {
+    diff_cold_store_pin(old->cold, 0, old->buffer_size);
+    const int ok = reparse_into(old, next);
+    diff_cold_store_unpin(old->cold, 0, old->buffer_size);
+    return ok;
+}
+
+int diff_parser_reparse_owned(DiffData* data, char* buffer, size_t buffer_size) {
+    if (!data || !buffer || buffer_size == 0) {
+        free(buffer);
+        return 0;
+    }
+    if (buffer_size > PARSER_MAX_BUFFER_SIZE) {
+        log_error("diff_parser: Diff of %zu bytes exceeds the %zu byte limit", buffer_size, (size_t)PARSER_MAX_BUFFER_SIZE);
+        free(buffer);
+        diff_data_clear(data);
+        return 0;
+    }
+
+    // Новые массивы строятся в запасной арене, старые читаются до конца сборки
+    arena_reset(&data->spare_arena);
+    DiffData next;
+    memset(&next, 0, sizeof(DiffData));
+    next.arena = data->spare_arena;
+    next.buffer = buffer;
+    next.buffer_size = buffer_size;
+    next.buffer_owned = 1;
+    int ok = reparse_into_pinned(data, &next);
+
+    // Меняем арены местами: старые массивы остаются в запасной до следующей перезагрузки
+    diff_data_release_buffer(data);
+    Arena old_arena = data->arena;
+    data->arena = next.arena;
+    data->spare_arena = old_arena;
+    data->buffer = next.buffer;
+    data->buffer_size = next.buffer_size;
+    data->buffer_owned = 1;
+    data->files = next.files;
+    data->file_count = next.file_count;
+    data->hunks = next.hunks;
+    data->hunk_count = next.hunk_count;
+    data->lines = next.lines;
+    data->line_count = next.line_count;
+    data->reused_files = next.reused_files;
+    data->reused_file_count = next.reused_file_count;
+    if (!ok) {
+        log_error("diff_parser: Reload failed, diff cleared");
+        diff_data_clear(data);
+        return 0;
+    }
+    return 1;
+}
+
+DiffData* diff_parser_rebuild_owned(const DiffData* old, char* buffer, size_t buffer_size) {
+    if (!old || !buffer || buffer_size == 0) {
+        free(buffer);
+        return NULL;
+    }
+    if (buffer_size > PARSER_MAX_BUFFER_SIZE) {
+        log_error("diff_parser: Diff of %zu bytes exceeds the %zu byte limit", buffer_size, (size_t)PARSER_MAX_BUFFER_SIZE);
+        free(buffer);
+        return NULL;
+    }
+    DiffData* next = diff_data_create();
+    if (!next) {
+        free(buffer);
+        return NULL;
+    }
+    // С этого момента буфер принадлежит next
+    next->buffer = buffer;
+    next->buffer_size = buffer_size;
+    next->buffer_owned = 1;
+    if (!reparse_into_pinned(old, next)) {
+        log_error("diff_parser: Rebuild failed, keeping the previous diff");
+        diff_data_destroy(next);
+        return NULL;
+    }
+    return next;
+}
+
+// --- ПОТОКОВЫЙ РАЗБОР ---
+
+int diff_stream_begin(DiffStreamParser* parser, DiffData* data) {
+    if (!parser || !data) {
+        return 0;
+    }
+    diff_data_clear(data);
+    stream_state_init(parser, data);
+    data->buffer_owned = 1; // Буфер растет через realloc по мере прихода данных
+    return 1;
+}
+
+int diff_stream_feed(DiffStreamParser* parser, const char* chunk, size_t length) {
+    if (!parser || !parser->data || (!chunk && length > 0)) {
+        return 0;
+    }
+    DiffData* data = parser->data;
+    if (length == 0) {
+        return 1;
+    }
+    if (data->buffer_size + length > PARSER_MAX_BUFFER_SIZE) {
+        log_error("diff_parser: Streamed diff exceeds the %zu byte limit", (size_t)PARSER_MAX_BUFFER_SIZE);
+        return 0;
+    }
+    if (data->buffer_size + length > parser->buffer_capacity) {
+        size_t new_capacity = parser->buffer_capacity ? parser->buffer_capacity * 2 : 64 * 1024;
+        while (new_capacity < data->buffer_size + length) new_capacity *= 2;
+        // Срезы хранят смещения, поэтому перенос буфера их не инвалидирует
+        char* grown = realloc(data->buffer, new_capacity);
+        if (!grown) {
+            log_error("diff_parser: Failed to grow stream buffer to %zu bytes", new_capacity);
+            return 0;
+        }
+        data->buffer = grown;
+        parser->buffer_capacity = new_capacity;
+    }
+    memcpy(data->buffer + data->buffer_size, chunk, length);
+    data->buffer_size += length;
+
+    // Разбираем только целые строки: ищем последний '\n' в новом куске,
+    // остаток строки, разрезанной границей куска, ждет следующего вызова
+    const char* p = data->buffer + data->buffer_size;
+    const char* chunk_start = data->buffer + data->buffer_size - length;
+    while (p > chunk_start && p[-1] != '\n') p--;
+    if (p == chunk_start) {
+        return 1;
+    }
+    return parse_lines(parser, (size_t)(p - data->buffer));
+}
+
+int diff_stream_finish(DiffStreamParser* parser) {
+    if (!parser || !parser->data) {
+        return 0;
+    }
+    DiffData* data = parser->data;
+    // Последняя строка может прийти без завершающего '\n'
+    if (parser->parsed < data->buffer_size && !parse_lines(parser, data->buffer_size)) {
+        return 0;
+    }
+    commit_pending_file(parser, data->buffer_size);
     return 1;
 }
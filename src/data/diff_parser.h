@@ -10,13 +10,142 @@
  *
  * This function takes a buffer containing the output of `git diff` and
  * parses it into the internal `DiffData` structure for further processing
- * and rendering.
+ * and rendering. The buffer is copied once into `data->buffer`; lines,
+ * hunk headers and paths are stored as spans into that copy.
+ *
+ * A diff with a thousand files or more is only scanned for file headers:
+ * paths, section ranges and added/deleted line counts. Its files start
+ * collapsed, and the hunks and lines of each are parsed by
+ * diff_parser_parse_file() when it is first shown. The same applies to
+ * diff_parser_parse_owned(), diff_parser_parse_in_place() and reloads.
  *
  * @param data Pointer to the DiffData structure to populate.
- * @param buffer Pointer to the null-terminated string containing the diff.
+ * @param buffer Pointer to the diff text (does not need to be null-terminated).
  * @param buffer_size Size of the buffer in bytes.
  * @return 1 on success, 0 on failure.
  */
 int diff_parser_parse(DiffData* data, const char* buffer, size_t buffer_size);
 
+/**
+ * @brief Zero-copy variant of diff_parser_parse().
+ *
+ * Takes ownership of a malloc'd buffer and parses it in place. The buffer
+ * is attached to `data` before parsing starts, so it is released by
+ * diff_data_clear() whether or not parsing succeeds.
+ *
+ * @param data Pointer to an empty DiffData structure to populate.
+ * @param buffer malloc'd buffer containing the diff. Ownership is transferred.
+ * @param buffer_size Size of the buffer in bytes.
+ * @return 1 on success, 0 on failure.
+ */
+int diff_parser_parse_owned(DiffData* data, char* buffer, size_t buffer_size);
+
+/**
+ * @brief Parses the buffer already attached to `data` (e.g. a mapped file).
+ *
+ * `data->buffer` and `data->buffer_size` must be set and the arrays empty.
+ * The buffer is parsed in place and released later by diff_data_clear().
+ *
+ * @param data DiffData with an attached buffer.
+ * @return 1 on success, 0 on failure.
+ */
+int diff_parser_parse_in_place(DiffData* data);
+
+/**
+ * @brief Parses the hunks and lines of one file of a lazily loaded diff.
+ *
+ * They are written into the slots reserved for the file when its header was
+ * scanned, so no other file, hunk or line moves. Does nothing if the file is
+ * already parsed. Only one thread may call it for a given DiffData; readers
+ * on other threads (the search scan included) check diff_data_file_is_parsed()
+ * before reading the file's hunks, lines or line_count.
+ *
+ * @param data DiffData loaded by one of the functions above.
+ * @param file Index in data->files.
+ * @return 1 on success, 0 on failure.
+ */
+int diff_parser_parse_file(DiffData* data, size_t file);
+
+/**
+ * @brief Replaces the contents of a populated DiffData with a new diff.
+ *
+ * The new buffer is split into "diff --git" sections and each section is
+ * hashed. Sections whose hash and length match a file of the current diff
+ * are not parsed again: that file's hunks and lines (including widths,
+ * text classes and collapse flags) are copied with their offsets moved to the new
+ * position. Only changed sections are parsed; a changed file keeps its
+ * collapse state if its path is unchanged. A new diff with a thousand files
+ * or more is read by headers; files already parsed in the current diff are
+ * copied into the slots reserved for them and need no parsing when shown.
+ * The new arrays are built in `data->spare_arena`, which then becomes the
+ * main arena.
+ *
+ * @param data DiffData holding the previous diff.
+ * @param buffer malloc'd buffer containing the new diff. Ownership is transferred.
+ * @param buffer_size Size of the buffer in bytes.
+ * @return 1 on success, 0 on failure (data is then left empty).
+ */
+int diff_parser_reparse_owned(DiffData* data, char* buffer, size_t buffer_size);
+
+/**
+ * @brief Builds a new DiffData from a new diff, reusing the files of `old`.
+ *
+ * Same reuse of unchanged sections as diff_parser_reparse_owned(), but the
+ * result is a separate DiffData and `old` is only read, so it may stay on
+ * screen while the new diff is parsed. Collapse flags of `old` are read
+ * atomically: the UI thread may keep updating them.
+ *
+ * @param old DiffData holding the previous diff (not modified).
+ * @param buffer malloc'd buffer containing the new diff. Ownership is transferred.
+ * @param buffer_size Size of the buffer in bytes.
+ * @return The new DiffData, or NULL on failure.
+ */
+DiffData* diff_parser_rebuild_owned(const DiffData* old, char* buffer, size_t buffer_size);
+
+/**
+ * @brief State of an incremental (streaming) parse.
+ *
+ * Chunks are appended to `data->buffer` as they arrive and every complete
+ * line is parsed right away; a line split across chunks waits for the rest.
+ * A file only becomes visible through `data->file_count` once its section is
+ * finished (the next "diff --git" arrived or the stream ended), so a reader
+ * never sees a half-parsed file. Callers must serialize access to `data`.
+ */
+typedef struct {
+    DiffData* data;
+    size_t parsed;          // Offset in data->buffer where the next unparsed line starts
+    size_t buffer_capacity;
+    size_t file_capacity;
+    size_t hunk_capacity;
+    size_t line_capacity;
+    int has_file;           // data->files[data->file_count] is being filled
+    size_t pending_hunks;   // Hunks/lines of that file, stored past hunk_count/line_count
+    size_t pending_lines;
+    uint32_t next_old_line; // Running line numbers inside the current hunk
+    uint32_t next_new_line;
+    // Change run of the current hunk being aligned side by side: the row it
+    // starts at and the deletions and additions seen so far
+    uint32_t run_row;
+    uint32_t run_deletes;
+    uint32_t run_adds;
+} DiffStreamParser;
+
+/**
+ * @brief Clears `data` and prepares `parser` to receive a new diff.
+ * @return 1 on success, 0 on failure.
+ */
+int diff_stream_begin(DiffStreamParser* parser, DiffData* data);
+
+/**
+ * @brief Appends a chunk and parses all lines completed by it.
+ * @return 1 on success, 0 on allocation failure.
+ */
+int diff_stream_feed(DiffStreamParser* parser, const char* chunk, size_t length);
+
+/**
+ * @brief Parses the trailing line (if any) and publishes the last file.
+ * @return 1 on success, 0 on failure.
+ */
+int diff_stream_finish(DiffStreamParser* parser);
+
 #endif // SEE_CODE_DIFF_PARSER_H
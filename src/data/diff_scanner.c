@@ -0,0 +1,402 @@
+// src/data/diff_scanner.c
+// Векторный поиск '\n': за одну итерацию сравниваются 16 байт, а найденные
+// переводы строк снимаются с битовой маски через ctz.
+#include "see_code/data/diff_scanner.h"
+#include "see_code/utils/utf8.h"
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define DIFF_SCAN_SIMD 1
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define DIFF_SCAN_SIMD 1
+#else
+#define DIFF_SCAN_SIMD 0
+#endif
+
+#define DIFF_SCAN_BLOCK 16
+
+const unsigned char diff_scan_kind_table[256] = {
+    ['d'] = DIFF_SCAN_KIND_FILE,
+    ['@'] = DIFF_SCAN_KIND_HUNK,
+    ['+'] = DIFF_SCAN_KIND_ADD,
+    ['-'] = DIFF_SCAN_KIND_DELETE,
+    [' '] = DIFF_SCAN_KIND_CONTEXT,
+};
+
+#if DIFF_SCAN_SIMD
+// Маска переводов строк в 16-байтовом блоке.
+// SSE2: бит i соответствует байту i. NEON: на каждый байт приходится 4 бита
+// (сужение сдвигом вместо отсутствующего movemask), поэтому индекс = ctz / 4.
+#if defined(__SSE2__)
+#define DIFF_SCAN_MASK_SHIFT 0
+#define DIFF_SCAN_BLOCK_MASK 0xFFFFULL
+static inline uint64_t newline_mask(const char* p) {
+    __m128i chunk = _mm_loadu_si128((const __m128i*)p);
+    __m128i eq = _mm_cmpeq_epi8(chunk, _mm_set1_epi8('\n'));
+    return (uint64_t)(unsigned)_mm_movemask_epi8(eq);
+}
+
+// Маска позиций '\n', за которыми сразу идет 'd' (кандидаты в "diff --git")
+static inline uint64_t file_header_mask(const char* p) {
+    __m128i newlines = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)p), _mm_set1_epi8('\n'));
+    __m128i next = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(p + 1)), _mm_set1_epi8('d'));
+    return (uint64_t)(unsigned)_mm_movemask_epi8(_mm_and_si128(newlines, next));
+}
+
+// Маска позиций, где байт (после OR с fold) равен c: для поиска подстроки
+static inline uint64_t byte_mask(const char* p, unsigned char c, unsigned char fold) {
+    __m128i chunk = _mm_or_si128(_mm_loadu_si128((const __m128i*)p), _mm_set1_epi8((char)fold));
+    return (uint64_t)(unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, _mm_set1_epi8((char)c)));
+}
+
+// Маска байтов вне печатного ASCII: знаковое сравнение с 0x20 ловит
+// и управляющие байты, и байты >= 0x80 (они отрицательные)
+static inline uint64_t non_printable_mask(const char* p) {
+    __m128i chunk = _mm_loadu_si128((const __m128i*)p);
+    return (uint64_t)(unsigned)_mm_movemask_epi8(_mm_cmplt_epi8(chunk, _mm_set1_epi8(0x20)));
+}
+
+// Маски байтов >= 0x80, байтов продолжения 80..BF и начал двухбайтовых
+// последовательностей C2..DF (в знаковом виде -128..-65 и -62..-33)
+static inline void utf8_masks(const char* p, uint64_t* high, uint64_t* continuation, uint64_t* lead2) {
+    __m128i chunk = _mm_loadu_si128((const __m128i*)p);
+    *high = (uint64_t)(unsigned)_mm_movemask_epi8(chunk);
+    *continuation = (uint64_t)(unsigned)_mm_movemask_epi8(_mm_cmplt_epi8(chunk, _mm_set1_epi8(-64)));
+    __m128i lead = _mm_and_si128(_mm_cmpgt_epi8(chunk, _mm_set1_epi8(-63)), _mm_cmplt_epi8(chunk, _mm_set1_epi8(-32)));
+    *lead2 = (uint64_t)(unsigned)_mm_movemask_epi8(lead);
+}
+#else
+#define DIFF_SCAN_MASK_SHIFT 2
+#define DIFF_SCAN_BLOCK_MASK UINT64_MAX
+static inline uint64_t newline_mask(const char* p) {
+    uint8x16_t chunk = vld1q_u8((const uint8_t*)p);
+    uint8x16_t eq = vceqq_u8(chunk, vdupq_n_u8('\n'));
+    uint8x8_t narrowed = vshrn_n_u16(vreinterpretq_u16_u8(eq), 4);
+    return vget_lane_u64(vreinterpret_u64_u8(narrowed), 0);
+}
+
+static inline uint64_t file_header_mask(const char* p) {
+    uint8x16_t newlines = vceqq_u8(vld1q_u8((const uint8_t*)p), vdupq_n_u8('\n'));
+    uint8x16_t next = vceqq_u8(vld1q_u8((const uint8_t*)(p + 1)), vdupq_n_u8('d'));
+    uint8x8_t narrowed = vshrn_n_u16(vreinterpretq_u16_u8(vandq_u8(newlines, next)), 4);
+    return vget_lane_u64(vreinterpret_u64_u8(narrowed), 0);
+}
+
+static inline uint64_t byte_mask(const char* p, unsigned char c, unsigned char fold) {
+    uint8x16_t chunk = vorrq_u8(vld1q_u8((const uint8_t*)p), vdupq_n_u8(fold));
+    uint8x8_t narrowed = vshrn_n_u16(vreinterpretq_u16_u8(vceqq_u8(chunk, vdupq_n_u8(c))), 4);
+    return vget_lane_u64(vreinterpret_u64_u8(narrowed), 0);
+}
+
+static inline uint64_t non_printable_mask(const char* p) {
+    int8x16_t chunk = vreinterpretq_s8_u8(vld1q_u8((const uint8_t*)p));
+    uint8x8_t narrowed = vshrn_n_u16(vreinterpretq_u16_u8(vcltq_s8(chunk, vdupq_n_s8(0x20))), 4);
+    return vget_lane_u64(vreinterpret_u64_u8(narrowed), 0);
+}
+
+static inline uint64_t narrow_mask(uint8x16_t mask) {
+    return vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(mask), 4)), 0);
+}
+
+static inline void utf8_masks(const char* p, uint64_t* high, uint64_t* continuation, uint64_t* lead2) {
+    int8x16_t chunk = vreinterpretq_s8_u8(vld1q_u8((const uint8_t*)p));
+    *high = narrow_mask(vcltq_s8(chunk, vdupq_n_s8(0)));
+    *continuation = narrow_mask(vcltq_s8(chunk, vdupq_n_s8(-64)));
+    *lead2 = narrow_mask(vandq_u8(vcgtq_s8(chunk, vdupq_n_s8(-63)), vcltq_s8(chunk, vdupq_n_s8(-32))));
+}
+#endif
+#endif // DIFF_SCAN_SIMD
+
+void diff_scanner_init(DiffScanner* scanner, const char* buffer, size_t size) {
+    scanner->buffer = buffer;
+    scanner->size = size;
+    scanner->pos = 0;
+}
+
+size_t diff_scanner_next_lines(DiffScanner* scanner, size_t* line_ends, size_t max_lines) {
+    const char* buffer = scanner->buffer;
+    const size_t size = scanner->size;
+    size_t pos = scanner->pos;
+    size_t count = 0;
+    if (max_lines == 0 || pos >= size) {
+        return 0;
+    }
+#if DIFF_SCAN_SIMD
+    // Блок целиком обрабатывается только если в выходном массиве хватит места
+    // на все его переводы строк. Последний (даже полный) блок всегда дочитывается
+    // скалярно, чтобы строка без завершающего '\n' получила свой конец
+    while (pos + DIFF_SCAN_BLOCK < size && max_lines - count >= DIFF_SCAN_BLOCK) {
+        uint64_t mask = newline_mask(buffer + pos);
+        while (mask) {
+            line_ends[count++] = pos + ((size_t)__builtin_ctzll(mask) >> DIFF_SCAN_MASK_SHIFT);
+#if DIFF_SCAN_MASK_SHIFT
+            mask &= ~((uint64_t)0xF << (__builtin_ctzll(mask) & ~3));
+#else
+            mask &= mask - 1;
+#endif
+        }
+        pos += DIFF_SCAN_BLOCK;
+    }
+    if (count > 0) {
+        scanner->pos = pos;
+        return count;
+    }
+#endif
+    // Хвост буфера (или сборка без SIMD)
+    while (pos < size && count < max_lines) {
+        const char* nl = memchr(buffer + pos, '\n', size - pos);
+        size_t end = nl ? (size_t)(nl - buffer) : size;
+        line_ends[count++] = end;
+        pos = end + 1;
+    }
+    scanner->pos = pos;
+    return count;
+}
+
+void diff_scan_count_kinds(const char* buffer, size_t size, size_t counts[DIFF_SCAN_KIND_COUNT]) {
+    memset(counts, 0, DIFF_SCAN_KIND_COUNT * sizeof(size_t));
+    if (!buffer || size == 0) {
+        return;
+    }
+    // Первая строка начинается с начала буфера, каждая следующая - после '\n'.
+    // Строка, начинающаяся с '\n', пуста и попадает в DIFF_SCAN_KIND_OTHER.
+    counts[diff_scan_kind_table[(unsigned char)buffer[0]]]++;
+    size_t pos = 0;
+#if DIFF_SCAN_SIMD
+    // Последний байт не проверяем в блоке: после него нет начала строки
+    while (pos + DIFF_SCAN_BLOCK < size) {
+        uint64_t mask = newline_mask(buffer + pos);
+        while (mask) {
+            size_t nl = pos + ((size_t)__builtin_ctzll(mask) >> DIFF_SCAN_MASK_SHIFT);
+            counts[diff_scan_kind_table[(unsigned char)buffer[nl + 1]]]++;
+#if DIFF_SCAN_MASK_SHIFT
+            mask &= ~((uint64_t)0xF << (__builtin_ctzll(mask) & ~3));
+#else
+            mask &= mask - 1;
+#endif
+        }
+        pos += DIFF_SCAN_BLOCK;
+    }
+#endif
+    while (pos + 1 < size) {
+        const char* nl = memchr(buffer + pos, '\n', size - pos - 1);
+        if (!nl) {
+            break;
+        }
+        pos = (size_t)(nl - buffer) + 1;
+        counts[diff_scan_kind_table[(unsigned char)buffer[pos]]]++;
+    }
+    counts[DIFF_SCAN_KIND_OTHER] = 0; // Пустые и служебные строки не интересны
+}
+
+static int is_file_header(const char* buffer, size_t size, size_t start) {
+    return size - start >= 11 && memcmp(buffer + start, "diff --git ", 11) == 0;
+}
+
+size_t diff_scan_find_file_header(const char* buffer, size_t size, size_t from) {
+    if (!buffer || from >= size) {
+        return size;
+    }
+    if ((from == 0 || buffer[from - 1] == '\n') && is_file_header(buffer, size, from)) {
+        return from;
+    }
+    // Дальше заголовок может начаться только сразу после '\n' из [from, size)
+    size_t pos = from;
+#if DIFF_SCAN_SIMD
+    // Строк много, а "\nd" редкость: проверяется пара байт, а не каждая строка
+    while (pos + DIFF_SCAN_BLOCK < size) {
+        uint64_t mask = file_header_mask(buffer + pos);
+        while (mask) {
+            size_t start = pos + ((size_t)__builtin_ctzll(mask) >> DIFF_SCAN_MASK_SHIFT) + 1;
+            if (is_file_header(buffer, size, start)) {
+                return start;
+            }
+#if DIFF_SCAN_MASK_SHIFT
+            mask &= ~((uint64_t)0xF << (__builtin_ctzll(mask) & ~3));
+#else
+            mask &= mask - 1;
+#endif
+        }
+        pos += DIFF_SCAN_BLOCK;
+    }
+#endif
+    while (pos < size) {
+        const char* nl = memchr(buffer + pos, '\n', size - pos);
+        if (!nl) {
+            break;
+        }
+        pos = (size_t)(nl - buffer) + 1;
+        if (is_file_header(buffer, size, pos)) {
+            return pos;
+        }
+    }
+    return size;
+}
+
+// --- Поиск подстроки ---
+
+static inline int is_ascii_letter(unsigned char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+}
+
+static inline unsigned char fold_ascii(unsigned char c) {
+    return c >= 'A' && c <= 'Z' ? (unsigned char)(c | 0x20) : c;
+}
+
+static int needle_at(const char* p, const DiffScanNeedle* needle) {
+    if (!needle->ignore_case) {
+        return memcmp(p, needle->bytes, needle->length) == 0;
+    }
+    for (size_t i = 0; i < needle->length; i++) {
+        if (fold_ascii((unsigned char)p[i]) != fold_ascii((unsigned char)needle->bytes[i])) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+size_t diff_scan_find(const char* buffer, size_t size, size_t from, const DiffScanNeedle* needle) {
+    if (!buffer || !needle || needle->length == 0 || from >= size || size - from < needle->length) {
+        return size;
+    }
+    const size_t last = needle->length - 1;
+    const unsigned char first_byte = (unsigned char)needle->bytes[0];
+    const unsigned char last_byte = (unsigned char)needle->bytes[last];
+    size_t pos = from;
+#if DIFF_SCAN_SIMD
+    // Без учета регистра буквы сравниваются после OR 0x20; у не-букв это дает
+    // лишние кандидаты, которые отсеет полная проверка
+    const int fold_first = needle->ignore_case && is_ascii_letter(first_byte);
+    const int fold_last = needle->ignore_case && is_ascii_letter(last_byte);
+    const unsigned char first_fold = fold_first ? 0x20 : 0, last_fold = fold_last ? 0x20 : 0;
+    const unsigned char first_key = first_byte | first_fold, last_key = last_byte | last_fold;
+    while (pos + last + DIFF_SCAN_BLOCK <= size) {
+        uint64_t mask = byte_mask(buffer + pos, first_key, first_fold) &
+                        byte_mask(buffer + pos + last, last_key, last_fold);
+        while (mask) {
+            size_t candidate = pos + ((size_t)__builtin_ctzll(mask) >> DIFF_SCAN_MASK_SHIFT);
+            if (needle_at(buffer + candidate, needle)) {
+                return candidate;
+            }
+#if DIFF_SCAN_MASK_SHIFT
+            mask &= ~((uint64_t)0xF << (__builtin_ctzll(mask) & ~3));
+#else
+            mask &= mask - 1;
+#endif
+        }
+        pos += DIFF_SCAN_BLOCK;
+    }
+#endif
+    // Хвост буфера (или сборка без SIMD)
+    const unsigned char first_folded = fold_ascii(first_byte);
+    for (; pos + last < size; pos++) {
+        unsigned char c = (unsigned char)buffer[pos];
+        if ((needle->ignore_case ? fold_ascii(c) == first_folded : c == first_byte) &&
+            needle_at(buffer + pos, needle)) {
+            return pos;
+        }
+    }
+    return size;
+}
+
+// --- Классификация текста строки ---
+
+// Можно ли продолжить с позиции i блоками
+#if DIFF_SCAN_SIMD
+#define TEXT_BLOCK_READY(i, length) ((length) >= DIFF_SCAN_BLOCK)
+#else
+#define TEXT_BLOCK_READY(i, length) ((length) - (i) >= 8)
+#endif
+
+unsigned diff_scan_text(const char* text, size_t length, unsigned tab_width, uint32_t* columns) {
+    unsigned flags = 0;
+    uint32_t width = 0;
+    size_t i = 0;
+    while (i < length) {
+        // Печатный ASCII пропускается блоками: байт - это столбец
+#if DIFF_SCAN_SIMD
+        // Двухбайтовые последовательности (кириллица, греческий, латиница
+        // с диакритикой) тоже проверяются блоком: за каждым началом C2..DF
+        // ровно один байт продолжения, других байтов >= 0x80 нет. Начало
+        // в последнем байте блока переносится в следующий (carry).
+        const unsigned unit = 1u << DIFF_SCAN_MASK_SHIFT; // Битов маски на байт
+        uint64_t carry = 0;
+        while (i + DIFF_SCAN_BLOCK <= length) {
+            const uint64_t special = non_printable_mask(text + i);
+            if (special == 0 && carry == 0) {
+                width += DIFF_SCAN_BLOCK;
+                i += DIFF_SCAN_BLOCK;
+                continue;
+            }
+            uint64_t high, continuation, lead2;
+            utf8_masks(text + i, &high, &continuation, &lead2);
+            if ((special & ~high) != 0 || high != (continuation | lead2) ||
+                continuation != (((lead2 << unit) | carry) & DIFF_SCAN_BLOCK_MASK)) {
+                break; // Управляющие байты, длинные или неверные последовательности
+            }
+            carry = lead2 >> ((DIFF_SCAN_BLOCK - 1) << DIFF_SCAN_MASK_SHIFT);
+            flags |= DIFF_TEXT_NON_ASCII;
+            width += DIFF_SCAN_BLOCK - ((uint32_t)__builtin_popcountll(continuation) >> DIFF_SCAN_MASK_SHIFT);
+            i += DIFF_SCAN_BLOCK;
+        }
+        if (carry) {
+            // Последовательность не дочитана: возвращаемся к ее началу
+            i--;
+            width--;
+        }
+        // Хвост короче блока проверяется блоком, выровненным по концу текста,
+        // без уже пройденных байтов
+        if (i < length && i + DIFF_SCAN_BLOCK > length && length >= DIFF_SCAN_BLOCK) {
+            const size_t block = length - DIFF_SCAN_BLOCK;
+            uint64_t mask = non_printable_mask(text + block) >> ((i - block) << DIFF_SCAN_MASK_SHIFT);
+            size_t skip = mask ? (size_t)__builtin_ctzll(mask) >> DIFF_SCAN_MASK_SHIFT : length - i;
+            width += (uint32_t)skip;
+            i += skip;
+        }
+#else
+        // SWAR: вычитание 0x20 занимает старший бит у управляющих байтов
+        for (; i + 8 <= length; i += 8, width += 8) {
+            uint64_t word;
+            memcpy(&word, text + i, sizeof(word));
+            if (((word - 0x2020202020202020ULL) | word) & 0x8080808080808080ULL) {
+                break;
+            }
+        }
+#endif
+        // Посимвольно: подряд идущие байты вне печатного ASCII, а в тексте
+        // короче блока - все
+        while (i < length) {
+            const unsigned char c = (unsigned char)text[i];
+            if (c >= 0x20 && c < 0x80) {
+                width++;
+                i++;
+                if (TEXT_BLOCK_READY(i, length)) {
+                    break;
+                }
+            } else if (c == '\t') {
+                flags |= DIFF_TEXT_TAB;
+                width += tab_width;
+                i++;
+            } else if (c < 0x20) {
+                flags |= DIFF_TEXT_CONTROL;
+                i++;
+            } else {
+                flags |= DIFF_TEXT_NON_ASCII;
+                uint32_t codepoint;
+                size_t sequence = utf8_decode(text + i, length - i, &codepoint);
+                if (sequence == 0) {
+                    // Неверный байт занимает столбец, как и заменяющий его глиф
+                    flags |= DIFF_TEXT_INVALID_UTF8;
+                    sequence = 1;
+                }
+                width++;
+                i += sequence;
+            }
+        }
+    }
+    *columns = width;
+    return flags;
+}
@@ -0,0 +1,108 @@
+// src/data/diff_scanner.h
+#ifndef SEE_CODE_DIFF_SCANNER_H
+#define SEE_CODE_DIFF_SCANNER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Line kinds, decided by the first byte of a line
+typedef enum {
+    DIFF_SCAN_KIND_OTHER = 0,
+    DIFF_SCAN_KIND_FILE,     // 'd' ("diff --git ", needs a full prefix check)
+    DIFF_SCAN_KIND_HUNK,     // '@' ("@@", needs a second byte check)
+    DIFF_SCAN_KIND_ADD,      // '+'
+    DIFF_SCAN_KIND_DELETE,   // '-'
+    DIFF_SCAN_KIND_CONTEXT,  // ' '
+    DIFF_SCAN_KIND_COUNT
+} DiffScanKind;
+
+extern const unsigned char diff_scan_kind_table[256];
+
+static inline DiffScanKind diff_scan_classify(unsigned char first_byte) {
+    return (DiffScanKind)diff_scan_kind_table[first_byte];
+}
+
+// Vectorized line splitter (SSE2 on x86_64, NEON on aarch64, scalar otherwise).
+// Line boundaries are produced in batches so the parser loop does not pay
+// a function call per line.
+typedef struct {
+    const char* buffer;
+    size_t size;
+    size_t pos; // Offset the next scan starts at
+} DiffScanner;
+
+void diff_scanner_init(DiffScanner* scanner, const char* buffer, size_t size);
+
+/**
+ * @brief Finds the ends of the next lines.
+ *
+ * Writes up to max_lines offsets into line_ends. Each offset is the position
+ * of a '\n', or `size` for a trailing line without one. The line itself starts
+ * right after the previous end (or at 0).
+ *
+ * @return Number of offsets written; 0 once the buffer is exhausted.
+ */
+size_t diff_scanner_next_lines(DiffScanner* scanner, size_t* line_ends, size_t max_lines);
+
+/**
+ * @brief Counts lines of each kind in one vectorized pass.
+ *
+ * Empty lines are not counted. Used to size the DiffData arrays up front.
+ *
+ * @param counts Array of DIFF_SCAN_KIND_COUNT elements, overwritten.
+ */
+void diff_scan_count_kinds(const char* buffer, size_t size, size_t counts[DIFF_SCAN_KIND_COUNT]);
+
+/**
+ * @brief Finds the next line starting with "diff --git ".
+ *
+ * Vectorized search for "\nd" pairs, so it is much cheaper than walking
+ * every line when only file boundaries are needed.
+ *
+ * @return Offset of the first such line starting at or after `from`, or `size`.
+ */
+size_t diff_scan_find_file_header(const char* buffer, size_t size, size_t from);
+
+// Substring to look for with diff_scan_find()
+typedef struct {
+    const char* bytes;
+    size_t length;
+    int ignore_case; // ASCII letters match in either case
+} DiffScanNeedle;
+
+/**
+ * @brief Finds the next occurrence of a substring.
+ *
+ * Vectorized: the first and the last byte of the needle are compared with
+ * 16 candidate positions at once, and only positions where both match are
+ * compared in full.
+ *
+ * @return Offset of the first occurrence starting at or after `from` and
+ *         ending within `size`, or `size` if there is none.
+ */
+size_t diff_scan_find(const char* buffer, size_t size, size_t from, const DiffScanNeedle* needle);
+
+// Text classes reported by diff_scan_text(). A line with none of them set is
+// printable ASCII: one byte is one glyph is one column.
+enum {
+    DIFF_TEXT_NON_ASCII = 1 << 0,    // Bytes >= 0x80
+    DIFF_TEXT_TAB = 1 << 1,          // '\t'
+    DIFF_TEXT_CONTROL = 1 << 2,      // Other bytes below 0x20 ('\r' of CRLF files)
+    DIFF_TEXT_INVALID_UTF8 = 1 << 3  // Non-ASCII bytes that are not valid UTF-8
+};
+
+/**
+ * @brief Validates UTF-8 and measures the display width of a line's text.
+ *
+ * 16-byte blocks of printable ASCII are skipped with one vector compare;
+ * only the remaining bytes are decoded. A code point, as well as every byte
+ * of an invalid sequence, takes one column, a tab takes tab_width columns
+ * wherever it stands (so widths of parts of a line add up), other control
+ * bytes take none.
+ *
+ * @param columns Receives the width in columns.
+ * @return Combination of DIFF_TEXT_* flags.
+ */
+unsigned diff_scan_text(const char* text, size_t length, unsigned tab_width, uint32_t* columns);
+
+#endif // SEE_CODE_DIFF_SCANNER_H
@@ -0,0 +1,593 @@
+// src/data/diff_search.c
+#include "see_code/data/diff_search.h"
+#include "see_code/data/diff_cold_store.h"
+#include "see_code/utils/logger.h"
+#include "see_code/utils/thread_pool.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Промежуток между соседними строками (заголовки ханков и файлов), который
+// еще просматривается одним вызовом diff_scan_find вместе со строками
+#define SEARCH_MAX_GAP 4096
+// Строк в одном непрерывном куске: между кусками проверяется отмена
+#define SEARCH_RUN_LINES 4096
+
+struct DiffSearchRun {
+    const DiffData* data;
+    DiffScanNeedle needle;   // bytes указывают на собственную копию запроса
+    size_t line_count;       // Строки и файлы, опубликованные к началу поиска
+    size_t file_count;
+    size_t unit_count;
+    DiffSearchUnit* units;
+    DiffSearch* owner;
+    int cancelled;           // Доступ через __atomic
+    int refs;
+    int updated;
+    size_t match_count;
+    size_t units_done;
+};
+
+// --- Жизненный цикл прохода ---
+
+static DiffSearchRun* run_create(DiffSearch* search, const DiffData* data) {
+    DiffSearchRun* run = calloc(1, sizeof(DiffSearchRun) + search->query_length);
+    if (!run) {
+        log_error("diff_search: Failed to allocate search run");
+        return NULL;
+    }
+    char* query = (char*)(run + 1);
+    memcpy(query, search->query, search->query_length);
+    run->needle.bytes = query;
+    run->needle.length = search->query_length;
+    // "Умный" регистр: запрос без заглавных букв ищется без учета регистра
+    run->needle.ignore_case = 1;
+    for (size_t i = 0; i < search->query_length; i++) {
+        if (query[i] >= 'A' && query[i] <= 'Z') {
+            run->needle.ignore_case = 0;
+            break;
+        }
+    }
+    run->data = data;
+    run->owner = search;
+    run->refs = 1;
+    run->line_count = data ? data->line_count : 0;
+    run->file_count = data ? data->file_count : 0;
+    if (run->line_count > 0 || run->file_count > 0) {
+        run->unit_count = run->line_count / DIFF_SEARCH_UNIT_LINES + 1;
+        if (run->line_count % DIFF_SEARCH_UNIT_LINES == 0 && run->line_count > 0) {
+            run->unit_count--;
+        }
+        run->units = calloc(run->unit_count, sizeof(DiffSearchUnit));
+        if (!run->units) {
+            log_error("diff_search: Failed to allocate %zu search units", run->unit_count);
+            free(run);
+            return NULL;
+        }
+    }
+    return run;
+}
+
+static void run_release(DiffSearchRun* run) {
+    if (!run || __atomic_sub_fetch(&run->refs, 1, __ATOMIC_ACQ_REL) != 0) {
+        return;
+    }
+    for (size_t u = 0; u < run->unit_count; u++) {
+        free(run->units[u].matches);
+    }
+    free(run->units);
+    free(run);
+}
+
+static int run_cancelled(const DiffSearchRun* run) {
+    return __atomic_load_n(&run->cancelled, __ATOMIC_RELAXED);
+}
+
+static size_t unit_of_line(const DiffSearchRun* run, size_t line) {
+    size_t unit = line / DIFF_SEARCH_UNIT_LINES;
+    return unit < run->unit_count ? unit : run->unit_count - 1;
+}
+
+// --- Сканирование ---
+
+typedef struct {
+    DiffSearchMatch* items;
+    size_t count;
+    size_t capacity;
+    int failed;
+} MatchList;
+
+static void add_match(MatchList* list, size_t line, size_t file, size_t start, size_t length, int is_path) {
+    if (list->failed) {
+        return;
+    }
+    if (list->count == list->capacity) {
+        size_t capacity = list->capacity ? list->capacity * 2 : 64;
+        DiffSearchMatch* grown = realloc(list->items, capacity * sizeof(DiffSearchMatch));
+        if (!grown) {
+            log_error("diff_search: Failed to grow match list to %zu entries", capacity);
+            list->failed = 1;
+            return;
+        }
+        list->items = grown;
+        list->capacity = capacity;
+    }
+    DiffSearchMatch* match = &list->items[list->count++];
+    match->line = line;
+    match->file = file;
+    match->start = (uint32_t)start;
+    match->length = (uint32_t)length;
+    match->is_path = is_path;
+}
+
+// Строки [first, last) файла file. Соседние строки лежат в буфере подряд,
+// поэтому подстрока ищется сразу по куску буфера, а найденное смещение
+// относится к строке продвижением по смещениям строк
+static void scan_lines(const DiffSearchRun* run, size_t first, size_t last, size_t file, MatchList* out) {
+    const DiffData* data = run->data;
+    const uint32_t* offsets = data->lines.offsets;
+    const uint32_t* lengths = data->lines.lengths;
+    const size_t n = run->needle.length;
+    size_t line = first;
+    while (line < last && !run_cancelled(run)) {
+        size_t run_end = line + 1;
+        size_t end = (size_t)offsets[line] + lengths[line];
+        while (run_end < last && run_end - line < SEARCH_RUN_LINES && offsets[run_end] >= end &&
+               offsets[run_end] - end <= SEARCH_MAX_GAP) {
+            end = (size_t)offsets[run_end] + lengths[run_end];
+            run_end++;
+        }
+        size_t k = line;
+        size_t pos = (size_t)offsets[line] + 1; // Маркер '+', '-', ' ' не ищется
+        const size_t run_start = offsets[line];
+        diff_cold_store_pin(data->cold, run_start, end - run_start);
+        while ((pos = diff_scan_find(data->buffer, end, pos, &run->needle)) < end) {
+            while (k + 1 < run_end && offsets[k + 1] <= pos) k++;
+            const size_t text = (size_t)offsets[k] + 1;
+            if (pos >= text && pos + n <= (size_t)offsets[k] + lengths[k]) {
+                add_match(out, k, file, pos - text, n, 0);
+                pos += n;
+            } else {
+                pos++; // Совпадение в заголовке или на стыке строк
+            }
+        }
+        diff_cold_store_unpin(data->cold, run_start, end - run_start);
+        line = run_end;
+    }
+}
+
+static void scan_path(const DiffSearchRun* run, size_t file, MatchList* out) {
+    const DiffFile* diff_file = &run->data->files[file];
+    const char* path = diff_data_span_ptr(run->data, diff_file->path);
+    const size_t length = diff_file->path.length;
+    size_t pos = 0;
+    diff_cold_store_pin(run->data->cold, diff_file->path.offset, length);
+    while ((pos = diff_scan_find(path, length, pos, &run->needle)) < length) {
+        add_match(out, diff_file->first_line, file, pos, run->needle.length, 1);
+        pos += run->needle.length;
+    }
+    diff_cold_store_unpin(run->data->cold, diff_file->path.offset, length);
+}
+
+// Первый файл с first_line >= line
+static size_t first_file_from(const DiffSearchRun* run, size_t line) {
+    size_t lo = 0, hi = run->file_count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (run->data->files[mid].first_line < line) lo = mid + 1; else hi = mid;
+    }
+    return lo;
+}
+
+// Строки с такой первой буквой становятся строками ханка
+static int is_hunk_line(DiffScanKind kind) {
+    return kind == DIFF_SCAN_KIND_ADD || kind == DIFF_SCAN_KIND_DELETE || kind == DIFF_SCAN_KIND_CONTEXT;
+}
+
+// Строки [first, last) файла ленивого diff, который еще не разобран: его ячейки
+// пусты, поэтому ищется сырой текст секции. Строки секции от первого "@@"
+// считаются так же, как при отведении ячеек (по первому байту, см.
+// diff_scan_count_kinds), и k-я из них займет ячейку first_line + k: совпадения
+// сразу указывают на строки, какими они будут после разбора файла.
+static void scan_section(const DiffSearchRun* run, size_t file, size_t first, size_t last, MatchList* out) {
+    const DiffData* data = run->data;
+    const DiffFile* diff_file = &data->files[file];
+    const char* buffer = data->buffer;
+    const size_t start = diff_file->section.offset;
+    const size_t end = start + diff_file->section.length;
+    const size_t n = run->needle.length;
+    if (first >= last || end <= start) {
+        return;
+    }
+    diff_cold_store_pin(data->cold, start, end - start);
+    // Первый заголовок ханка после строки "diff --git"
+    size_t line = end;
+    const char* newline = memchr(buffer + start, '\n', end - start);
+    while (newline) {
+        const size_t next = (size_t)(newline - buffer) + 1;
+        if (next + 1 < end && buffer[next] == '@' && buffer[next + 1] == '@') {
+            line = next;
+            break;
+        }
+        newline = next < end ? memchr(buffer + next, '\n', end - next) : NULL;
+    }
+    size_t row = diff_file->first_line; // Ячейка текущей строки, если это строка ханка
+    size_t line_end = end;
+    int is_text = 0;
+    if (line < end) {
+        newline = memchr(buffer + line, '\n', end - line);
+        line_end = newline ? (size_t)(newline - buffer) : end;
+        is_text = line < line_end && is_hunk_line(diff_scan_classify((unsigned char)buffer[line]));
+    }
+    size_t pos = line;
+    while (row < last && !run_cancelled(run) && (pos = diff_scan_find(buffer, end, pos, &run->needle)) < end) {
+        // Переход к строке, в которой найдено совпадение
+        while (pos > line_end) {
+            row += is_text;
+            line = line_end + 1;
+            newline = memchr(buffer + line, '\n', end - line);
+            line_end = newline ? (size_t)(newline - buffer) : end;
+            is_text = line < line_end && is_hunk_line(diff_scan_classify((unsigned char)buffer[line]));
+        }
+        if (row >= last) {
+            break;
+        }
+        if (is_text && row >= first && pos > line && pos + n <= line_end) {
+            add_match(out, row, file, pos - line - 1, n, 0);
+            pos += n;
+        } else {
+            pos++; // Совпадение в заголовке, на стыке строк или до начала единицы
+        }
+    }
+    diff_cold_store_unpin(data->cold, start, end - start);
+}
+
+// Строки [first, last) файла file: разобранного - по таблице строк (у файла
+// ленивой загрузки за ними идут пустые отведенные ячейки), неразобранного - по
+// тексту секции. Число строк файла читается только после флага разбора:
+// diff_parser_parse_file() может в это время разбирать файл на потоке UI.
+static void scan_file_lines(const DiffSearchRun* run, size_t file, size_t first, size_t last, MatchList* out) {
+    if (run->file_count == 0) {
+        scan_lines(run, first, last, file, out);
+        return;
+    }
+    const DiffFile* diff_file = &run->data->files[file];
+    if (!diff_data_file_is_parsed(diff_file)) {
+        scan_section(run, file, first, last, out);
+        return;
+    }
+    const size_t file_end = diff_file->first_line + diff_file->line_count;
+    scan_lines(run, first, file_end < last ? file_end : last, file, out);
+}
+
+// Единица: строки [u * UNIT, (u + 1) * UNIT) и пути файлов, которые в них начинаются
+// (последней единице достаются и файлы без строк в самом конце)
+static void scan_unit(void* context, size_t u) {
+    DiffSearchRun* run = (DiffSearchRun*)context;
+    DiffSearchUnit* unit = &run->units[u];
+    if (run_cancelled(run) || __atomic_load_n(&unit->done, __ATOMIC_ACQUIRE)) {
+        return; // Отменено или перенесено из прошлого прохода
+    }
+    const size_t first = u * DIFF_SEARCH_UNIT_LINES;
+    size_t last = first + DIFF_SEARCH_UNIT_LINES;
+    if (last > run->line_count) last = run->line_count;
+    const int is_last_unit = u + 1 == run->unit_count;
+
+    MatchList list = { NULL, 0, 0, 0 };
+    size_t file = first_file_from(run, first);
+    size_t line = first;
+    // Строки до первого файла единицы принадлежат предыдущему файлу
+    size_t owner = file > 0 ? file - 1 : 0;
+    for (; file < run->file_count && (run->data->files[file].first_line < last || is_last_unit); file++) {
+        const size_t file_line = run->data->files[file].first_line;
+        scan_file_lines(run, owner, line, file_line, &list);
+        scan_path(run, file, &list);
+        line = file_line;
+        owner = file;
+    }
+    scan_file_lines(run, owner, line, last, &list);
+
+    if (run_cancelled(run)) {
+        free(list.items);
+        return;
+    }
+    // При нехватке памяти публикуется то, что успели найти, иначе поиск не закончится
+    unit->matches = list.items;
+    unit->count = list.count;
+    __atomic_store_n(&unit->done, 1, __ATOMIC_RELEASE);
+    __atomic_add_fetch(&run->match_count, list.count, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&run->units_done, 1, __ATOMIC_RELEASE);
+    __atomic_store_n(&run->updated, 1, __ATOMIC_RELEASE);
+}
+
+static void scan_task(void* arg) {
+    DiffSearchRun* run = (DiffSearchRun*)arg;
+    DiffSearch* search = run->owner;
+    // Поток задачи сам участвует в parallel_for, поэтому остальные рабочие
+    // потоки пула берут единицы, только когда свободны
+    thread_pool_parallel_for(thread_pool_shared(), run->unit_count, scan_unit, run);
+    pthread_mutex_lock(&search->mutex);
+    search->active_scans--;
+    if (search->active_scans == 0) {
+        pthread_cond_broadcast(&search->idle);
+    }
+    pthread_mutex_unlock(&search->mutex);
+    run_release(run);
+}
+
+static void* scan_thread_main(void* arg) {
+    scan_task(arg);
+    return NULL;
+}
+
+// Запускает проход в фоне: в пуле, а если в нем нет рабочих потоков - в отдельном потоке
+static int run_launch(DiffSearch* search, DiffSearchRun* run) {
+    __atomic_add_fetch(&run->refs, 1, __ATOMIC_RELAXED);
+    pthread_mutex_lock(&search->mutex);
+    search->active_scans++;
+    pthread_mutex_unlock(&search->mutex);
+    if (thread_pool_submit(thread_pool_shared(), scan_task, run)) {
+        return 1;
+    }
+    pthread_t thread;
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    int created = pthread_create(&thread, &attr, scan_thread_main, run) == 0;
+    pthread_attr_destroy(&attr);
+    if (created) {
+        return 1;
+    }
+    log_error("diff_search: Failed to start the search thread");
+    pthread_mutex_lock(&search->mutex);
+    search->active_scans--;
+    pthread_cond_broadcast(&search->idle);
+    pthread_mutex_unlock(&search->mutex);
+    run_release(run);
+    return 0;
+}
+
+// Отменяет текущий проход, не дожидаясь его рабочих
+static void retire_run(DiffSearch* search) {
+    if (search->run) {
+        __atomic_store_n(&search->run->cancelled, 1, __ATOMIC_RELAXED);
+        run_release(search->run);
+        search->run = NULL;
+    }
+    search->has_current = 0;
+}
+
+// --- Публичный интерфейс ---
+
+int diff_search_init(DiffSearch* search) {
+    if (!search) {
+        return 0;
+    }
+    memset(search, 0, sizeof(DiffSearch));
+    if (pthread_mutex_init(&search->mutex, NULL) != 0) {
+        log_error("diff_search: Failed to initialize mutex");
+        return 0;
+    }
+    if (pthread_cond_init(&search->idle, NULL) != 0) {
+        log_error("diff_search: Failed to initialize condition variable");
+        pthread_mutex_destroy(&search->mutex);
+        return 0;
+    }
+    return 1;
+}
+
+void diff_search_destroy(DiffSearch* search) {
+    if (!search) {
+        return;
+    }
+    diff_search_stop(search);
+    retire_run(search);
+    free(search->query);
+    pthread_cond_destroy(&search->idle);
+    pthread_mutex_destroy(&search->mutex);
+    memset(search, 0, sizeof(DiffSearch));
+}
+
+int diff_search_start(DiffSearch* search, const DiffData* data, const char* query, size_t length) {
+    if (!search) {
+        return 0;
+    }
+    retire_run(search);
+    char* copy = NULL;
+    if (length > 0) {
+        copy = malloc(length);
+        if (!copy) {
+            log_error("diff_search: Failed to copy query");
+            return 0;
+        }
+        memcpy(copy, query, length);
+    }
+    free(search->query);
+    search->query = copy;
+    search->query_length = length;
+    return diff_search_refresh(search, data, 0);
+}
+
+void diff_search_stop(DiffSearch* search) {
+    if (!search) {
+        return;
+    }
+    if (search->run) {
+        __atomic_store_n(&search->run->cancelled, 1, __ATOMIC_RELAXED);
+    }
+    pthread_mutex_lock(&search->mutex);
+    while (search->active_scans > 0) {
+        pthread_cond_wait(&search->idle, &search->mutex);
+    }
+    pthread_mutex_unlock(&search->mutex);
+}
+
+int diff_search_refresh(DiffSearch* search, const DiffData* data, int appended) {
+    if (!search) {
+        return 0;
+    }
+    DiffSearchRun* previous = search->run;
+    search->run = NULL;
+    if (search->query_length == 0 || !data) {
+        run_release(previous);
+        search->has_current = 0;
+        return 1;
+    }
+    DiffSearchRun* run = run_create(search, data);
+    if (!run) {
+        run_release(previous);
+        search->has_current = 0;
+        return 0;
+    }
+    // Diff только дописан: готовые единицы целиком до старого конца не меняются.
+    // Предыдущий проход остановлен (diff_search_stop), его рабочих уже нет
+    if (appended && previous && previous->data == data && previous->line_count <= run->line_count) {
+        for (size_t u = 0; u < previous->unit_count && u < run->unit_count; u++) {
+            DiffSearchUnit* old_unit = &previous->units[u];
+            if ((u + 1) * DIFF_SEARCH_UNIT_LINES >= previous->line_count || !old_unit->done) {
+                break;
+            }
+            run->units[u] = *old_unit;
+            old_unit->matches = NULL;
+            old_unit->count = 0;
+            run->match_count += run->units[u].count;
+            run->units_done++;
+        }
+        if (search->has_current && search->current_unit >= run->units_done) {
+            search->has_current = 0;
+        }
+        run->updated = 1;
+    } else {
+        search->has_current = 0;
+    }
+    run_release(previous);
+    search->run = run;
+    if (run->units_done == run->unit_count) {
+        return 1; // Искать больше нечего
+    }
+    return run_launch(search, run);
+}
+
+const char* diff_search_query(const DiffSearch* search, size_t* length) {
+    if (length) *length = search ? search->query_length : 0;
+    return search ? search->query : NULL;
+}
+
+int diff_search_take_updates(DiffSearch* search) {
+    if (!search || !search->run) {
+        return 0;
+    }
+    return __atomic_exchange_n(&search->run->updated, 0, __ATOMIC_ACQ_REL);
+}
+
+int diff_search_is_running(const DiffSearch* search) {
+    return search && search->run &&
+           __atomic_load_n(&search->run->units_done, __ATOMIC_ACQUIRE) < search->run->unit_count;
+}
+
+size_t diff_search_match_count(const DiffSearch* search) {
+    return search && search->run ? __atomic_load_n(&search->run->match_count, __ATOMIC_RELAXED) : 0;
+}
+
+static const DiffSearchUnit* published_unit(const DiffSearch* search, size_t u) {
+    const DiffSearchUnit* unit = &search->run->units[u];
+    return __atomic_load_n(&unit->done, __ATOMIC_ACQUIRE) ? unit : NULL;
+}
+
+// Первое совпадение единицы не раньше позиции (line, is_path): пути файла идут перед его строками
+static size_t lower_bound(const DiffSearchUnit* unit, size_t line, int is_path) {
+    size_t lo = 0, hi = unit->count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        const DiffSearchMatch* match = &unit->matches[mid];
+        if (match->line < line || (match->line == line && match->is_path > is_path)) lo = mid + 1; else hi = mid;
+    }
+    return lo;
+}
+
+const DiffSearchMatch* diff_search_line_matches(const DiffSearch* search, size_t line, size_t* count) {
+    *count = 0;
+    if (!search || !search->run || line >= search->run->line_count) {
+        return NULL;
+    }
+    const DiffSearchUnit* unit = published_unit(search, unit_of_line(search->run, line));
+    if (!unit) {
+        return NULL;
+    }
+    size_t first = lower_bound(unit, line, 0);
+    size_t last = first;
+    while (last < unit->count && unit->matches[last].line == line && !unit->matches[last].is_path) last++;
+    *count = last - first;
+    return unit->matches + first;
+}
+
+const DiffSearchMatch* diff_search_path_matches(const DiffSearch* search, size_t file, size_t first_line, size_t* count) {
+    *count = 0;
+    if (!search || !search->run || file >= search->run->file_count) {
+        return NULL;
+    }
+    const DiffSearchUnit* unit = published_unit(search, unit_of_line(search->run, first_line));
+    if (!unit) {
+        return NULL;
+    }
+    // Пути файлов без строк делят first_line со следующим файлом
+    size_t first = lower_bound(unit, first_line, 1);
+    while (first < unit->count && unit->matches[first].is_path &&
+           unit->matches[first].line == first_line && unit->matches[first].file < file) first++;
+    size_t last = first;
+    while (last < unit->count && unit->matches[last].is_path && unit->matches[last].file == file) last++;
+    *count = last - first;
+    return unit->matches + first;
+}
+
+const DiffSearchMatch* diff_search_step(DiffSearch* search, int direction) {
+    if (!search || !search->run || search->run->unit_count == 0) {
+        return NULL;
+    }
+    const size_t units = search->run->unit_count;
+    size_t u = search->current_unit;
+    // Без текущего совпадения шаг вперед начинается перед первой единицей, назад - после последней
+    if (search->has_current) {
+        const DiffSearchUnit* unit = published_unit(search, u);
+        if (direction > 0 && search->current_index + 1 < unit->count) {
+            search->current_index++;
+            return &unit->matches[search->current_index];
+        }
+        if (direction < 0 && search->current_index > 0) {
+            search->current_index--;
+            return &unit->matches[search->current_index];
+        }
+    } else {
+        u = direction > 0 ? units - 1 : 0;
+    }
+    // Следующая опубликованная единица с совпадениями, по кругу
+    for (size_t step = 0; step < units; step++) {
+        u = direction > 0 ? (u + 1) % units : (u + units - 1) % units;
+        const DiffSearchUnit* unit = published_unit(search, u);
+        if (unit && unit->count > 0) {
+            search->has_current = 1;
+            search->current_unit = u;
+            search->current_index = direction > 0 ? 0 : unit->count - 1;
+            return &unit->matches[search->current_index];
+        }
+    }
+    return NULL;
+}
+
+const DiffSearchMatch* diff_search_current(const DiffSearch* search) {
+    if (!search || !search->run || !search->has_current) {
+        return NULL;
+    }
+    return &search->run->units[search->current_unit].matches[search->current_index];
+}
+
+size_t diff_search_current_number(const DiffSearch* search) {
+    if (!diff_search_current(search)) {
+        return 0;
+    }
+    size_t number = search->current_index + 1;
+    for (size_t u = 0; u < search->current_unit; u++) {
+        const DiffSearchUnit* unit = published_unit(search, u);
+        if (unit) number += unit->count;
+    }
+    return number;
+}
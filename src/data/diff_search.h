@@ -0,0 +1,101 @@
+// src/data/diff_search.h
+#ifndef SEE_CODE_DIFF_SEARCH_H
+#define SEE_CODE_DIFF_SEARCH_H
+
+#include "see_code/data/diff_data.h"
+#include "see_code/data/diff_scanner.h"
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Background substring search over line texts and file paths of a diff.
+//
+// The lines are split into units of DIFF_SEARCH_UNIT_LINES rows. A unit also
+// owns the paths of the files that start inside it, so the matches of a unit
+// form one sorted block of the whole result. Units are scanned in parallel on
+// the shared thread pool with diff_scan_find() and published one by one as
+// they finish: the UI thread reads finished units without taking a lock and
+// never waits for the scan.
+//
+// Starting a new query cancels the running scan without waiting for it. The
+// scan reads DiffData without any lock, so whoever changes the diff must call
+// diff_search_stop() first and diff_search_refresh() afterwards.
+//
+// Queries without upper case letters match case-insensitively (ASCII only).
+// In a lazily loaded diff, files not parsed yet are searched in the raw text
+// of their section. Their matches already carry the rows the lines will take
+// (see diff_parser_parse_file()), so parsing a file does not change the
+// results and needs no diff_search_stop().
+
+#define DIFF_SEARCH_UNIT_LINES 16384
+
+typedef struct {
+    size_t line;      // Row in DiffData.lines; for a path match, the file's first_line
+    size_t file;      // File containing the match
+    uint32_t start;   // Relative to the line text after the marker, or to the path
+    uint32_t length;
+    int is_path;
+} DiffSearchMatch;
+
+typedef struct DiffSearchUnit {
+    DiffSearchMatch* matches; // Sorted by position in the diff
+    size_t count;
+    int done;                 // Set (release) after matches and count are written
+} DiffSearchUnit;
+
+typedef struct DiffSearchRun DiffSearchRun;
+
+typedef struct {
+    DiffSearchRun* run;  // Scan of the current query (NULL if there is none)
+    char* query;
+    size_t query_length;
+    // Published match the navigation is on
+    int has_current;
+    size_t current_unit;
+    size_t current_index;
+    // Scans still running, including cancelled ones
+    pthread_mutex_t mutex;
+    pthread_cond_t idle;
+    size_t active_scans;
+} DiffSearch;
+
+int diff_search_init(DiffSearch* search);
+// Stops the scan and frees everything
+void diff_search_destroy(DiffSearch* search);
+
+// Starts searching data for query, cancelling the previous scan without
+// waiting for it. An empty query clears the results. Returns 0 only on
+// allocation failure.
+int diff_search_start(DiffSearch* search, const DiffData* data, const char* query, size_t length);
+
+// Cancels the scan and waits until no worker reads the diff any more.
+// Call before changing the DiffData being searched.
+void diff_search_stop(DiffSearch* search);
+
+// Scans data again for the current query after diff_search_stop().
+// If appended is set, data only got new files at the end (streaming), and
+// the finished units that lie entirely before the old end are kept.
+int diff_search_refresh(DiffSearch* search, const DiffData* data, int appended);
+
+// Current query (not NUL-terminated) and its length
+const char* diff_search_query(const DiffSearch* search, size_t* length);
+
+// Returns 1 once after units were published since the last call
+int diff_search_take_updates(DiffSearch* search);
+int diff_search_is_running(const DiffSearch* search);
+// Matches published so far
+size_t diff_search_match_count(const DiffSearch* search);
+
+// Published matches inside line (line >= data->line_count returns none)
+const DiffSearchMatch* diff_search_line_matches(const DiffSearch* search, size_t line, size_t* count);
+// Published matches inside the path of a file; first_line is the file's first_line
+const DiffSearchMatch* diff_search_path_matches(const DiffSearch* search, size_t file, size_t first_line, size_t* count);
+
+// Moves to the next (direction > 0) or previous published match, wrapping
+// around. Returns the new current match or NULL if there are no matches.
+const DiffSearchMatch* diff_search_step(DiffSearch* search, int direction);
+const DiffSearchMatch* diff_search_current(const DiffSearch* search);
+// 1-based number of the current match among the published ones (0 if none)
+size_t diff_search_current_number(const DiffSearch* search);
+
+#endif // SEE_CODE_DIFF_SEARCH_H
@@ -0,0 +1,294 @@
+// src/data/diff_snapshot.c
+#include "see_code/data/diff_snapshot.h"
+#include "see_code/data/diff_cold_store.h"
+#include "see_code/utils/logger.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define SNAPSHOT_MAGIC "SEECODE\0"
+#define SNAPSHOT_BYTE_ORDER 0x01020304u
+#define SNAPSHOT_ALIGN 8
+
+// Секции файла в порядке записи
+enum {
+    SECTION_BUFFER = 0,
+    SECTION_FILES,
+    SECTION_HUNKS,
+    SECTION_LINE_TYPES,
+    SECTION_LINE_TEXT_FLAGS,
+    SECTION_LINE_OFFSETS,
+    SECTION_LINE_LENGTHS,
+    SECTION_LINE_WIDTHS,
+    SECTION_LINE_OLD_NUMBERS,
+    SECTION_LINE_NEW_NUMBERS,
+    SECTION_LINE_ROW_LEFT,
+    SECTION_LINE_ROW_RIGHT,
+    SECTION_COUNT
+};
+
+typedef struct {
+    uint64_t offset; // От начала файла
+    uint64_t size;
+} SnapshotSection;
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint32_t file_record_size;  // sizeof(DiffFile) собравшей снимок программы
+    uint32_t hunk_record_size;  // sizeof(DiffHunk)
+    uint64_t file_size;
+    uint64_t file_count;
+    uint64_t hunk_count;
+    uint64_t line_count;
+    SnapshotSection sections[SECTION_COUNT];
+} SnapshotHeader;
+
+static uint64_t align_up(uint64_t value) {
+    return (value + SNAPSHOT_ALIGN - 1) & ~(uint64_t)(SNAPSHOT_ALIGN - 1);
+}
+
+// --- Запись ---
+
+static int write_all(int fd, const void* bytes, size_t size) {
+    const char* p = (const char*)bytes;
+    while (size > 0) {
+        ssize_t written = write(fd, p, size);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return 0;
+        }
+        p += written;
+        size -= (size_t)written;
+    }
+    return 1;
+}
+
+int diff_snapshot_write(const DiffData* data, const char* path) {
+    if (!data || !path || !data->buffer) {
+        log_error("Invalid arguments to diff_snapshot_write");
+        return 0;
+    }
+    const size_t lines = data->line_count;
+    const void* sources[SECTION_COUNT] = {
+        data->buffer, data->files, data->hunks,
+        data->lines.types, data->lines.text_flags, data->lines.offsets, data->lines.lengths,
+        data->lines.widths, data->lines.old_numbers, data->lines.new_numbers,
+        data->lines.row_left, data->lines.row_right
+    };
+    SnapshotHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.version = DIFF_SNAPSHOT_VERSION;
+    header.byte_order = SNAPSHOT_BYTE_ORDER;
+    header.file_record_size = sizeof(DiffFile);
+    header.hunk_record_size = sizeof(DiffHunk);
+    header.file_count = data->file_count;
+    header.hunk_count = data->hunk_count;
+    header.line_count = lines;
+    header.sections[SECTION_BUFFER].size = data->buffer_size;
+    header.sections[SECTION_FILES].size = data->file_count * sizeof(DiffFile);
+    header.sections[SECTION_HUNKS].size = data->hunk_count * sizeof(DiffHunk);
+    header.sections[SECTION_LINE_TYPES].size = lines;
+    header.sections[SECTION_LINE_TEXT_FLAGS].size = lines;
+    for (int s = SECTION_LINE_OFFSETS; s < SECTION_COUNT; s++) {
+        header.sections[s].size = lines * sizeof(uint32_t);
+    }
+    uint64_t offset = align_up(sizeof(SnapshotHeader));
+    for (int s = 0; s < SECTION_COUNT; s++) {
+        header.sections[s].offset = offset;
+        offset = align_up(offset + header.sections[s].size);
+    }
+    header.file_size = offset;
+
+    // Пишем во временный файл рядом и переименовываем: rename атомарен
+    size_t path_length = strlen(path);
+    char* temp_path = malloc(path_length + 5);
+    if (!temp_path) {
+        log_error("diff_snapshot: Failed to allocate temporary path");
+        return 0;
+    }
+    memcpy(temp_path, path, path_length);
+    memcpy(temp_path + path_length, ".tmp", 5);
+    int fd = open(temp_path, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    if (fd < 0) {
+        log_error("diff_snapshot: Failed to create %s: %s", temp_path, strerror(errno));
+        free(temp_path);
+        return 0;
+    }
+    static const char padding[SNAPSHOT_ALIGN] = { 0 };
+    uint64_t written = sizeof(SnapshotHeader);
+    diff_cold_store_pin(data->cold, 0, data->buffer_size);
+    int ok = write_all(fd, &header, sizeof(header));
+    for (int s = 0; ok && s < SECTION_COUNT; s++) {
+        ok = write_all(fd, padding, (size_t)(header.sections[s].offset - written)) &&
+             (header.sections[s].size == 0 || write_all(fd, sources[s], (size_t)header.sections[s].size));
+        written = header.sections[s].offset + header.sections[s].size;
+    }
+    ok = ok && write_all(fd, padding, (size_t)(header.file_size - written));
+    diff_cold_store_unpin(data->cold, 0, data->buffer_size);
+    if (close(fd) != 0) ok = 0;
+    if (ok && rename(temp_path, path) != 0) ok = 0;
+    if (!ok) {
+        log_error("diff_snapshot: Failed to write %s: %s", path, strerror(errno));
+        unlink(temp_path);
+    } else {
+        log_debug("diff_snapshot: Wrote %s (%llu bytes)", path, (unsigned long long)header.file_size);
+    }
+    free(temp_path);
+    return ok;
+}
+
+// --- Загрузка ---
+
+static int span_in_buffer(DiffSpan span, size_t buffer_size) {
+    return span.offset <= buffer_size && span.length <= buffer_size - span.offset;
+}
+
+static int range_in(size_t first, size_t count, size_t total) {
+    return first <= total && count <= total - first;
+}
+
+// Проверяет, что все индексы и срезы снимка указывают внутрь его массивов,
+// чтобы поврежденный файл не приводил к чтению за границами отображения
+static int validate(const DiffData* data) {
+    for (size_t i = 0; i < data->file_count; i++) {
+        const DiffFile* file = &data->files[i];
+        // Ячейки неразобранного файла ленивой загрузки кончаются там, где начинаются ячейки следующего
+        const DiffFile* previous = i > 0 ? &data->files[i - 1] : NULL;
+        if ((previous && (file->first_hunk < previous->first_hunk || file->first_line < previous->first_line)) ||
+            !range_in(file->first_hunk, file->hunk_count, data->hunk_count) ||
+            !range_in(file->first_line, file->line_count, data->line_count) ||
+            !span_in_buffer(file->path, data->buffer_size) ||
+            !span_in_buffer(file->section, data->buffer_size)) {
+            log_error("diff_snapshot: File record %zu is out of range", i);
+            return 0;
+        }
+    }
+    for (size_t i = 0; i < data->hunk_count; i++) {
+        const DiffHunk* hunk = &data->hunks[i];
+        if (!range_in(hunk->first_line, hunk->line_count, data->line_count) ||
+            hunk->row_count > hunk->line_count ||
+            !span_in_buffer(hunk->header, data->buffer_size)) {
+            log_error("diff_snapshot: Hunk record %zu is out of range", i);
+            return 0;
+        }
+        // Ряды "рядом" указывают на строки своего ханка
+        for (size_t r = 0; r < hunk->row_count; r++) {
+            const uint32_t left = data->lines.row_left[hunk->first_line + r];
+            const uint32_t right = data->lines.row_right[hunk->first_line + r];
+            if ((left != DIFF_ROW_FILLER && left >= hunk->line_count) ||
+                (right != DIFF_ROW_FILLER && right >= hunk->line_count)) {
+                log_error("diff_snapshot: Row %zu of hunk %zu is out of range", r, i);
+                return 0;
+            }
+        }
+    }
+    const DiffLineTable* table = &data->lines;
+    for (size_t i = 0; i < data->line_count; i++) {
+        if (table->types[i] > LINE_TYPE_DELETE ||
+            (uint64_t)table->offsets[i] + table->lengths[i] > data->buffer_size) {
+            log_error("diff_snapshot: Line %zu is out of range", i);
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static int header_is_valid(const SnapshotHeader* header, size_t file_size) {
+    if (memcmp(header->magic, SNAPSHOT_MAGIC, sizeof(header->magic)) != 0 ||
+        header->version != DIFF_SNAPSHOT_VERSION || header->byte_order != SNAPSHOT_BYTE_ORDER ||
+        header->file_record_size != sizeof(DiffFile) || header->hunk_record_size != sizeof(DiffHunk) ||
+        header->file_size != file_size) {
+        return 0;
+    }
+    // Размеры секций должны соответствовать счетчикам (с проверкой переполнения)
+    const uint64_t lines = header->line_count;
+    if (header->file_count > UINT64_MAX / sizeof(DiffFile) || header->hunk_count > UINT64_MAX / sizeof(DiffHunk) ||
+        lines > UINT64_MAX / sizeof(uint32_t) ||
+        header->sections[SECTION_FILES].size != header->file_count * sizeof(DiffFile) ||
+        header->sections[SECTION_HUNKS].size != header->hunk_count * sizeof(DiffHunk) ||
+        header->sections[SECTION_LINE_TYPES].size != lines ||
+        header->sections[SECTION_LINE_TEXT_FLAGS].size != lines ||
+        header->sections[SECTION_BUFFER].size == 0) {
+        return 0;
+    }
+    for (int s = SECTION_LINE_OFFSETS; s < SECTION_COUNT; s++) {
+        if (header->sections[s].size != lines * sizeof(uint32_t)) return 0;
+    }
+    for (int s = 0; s < SECTION_COUNT; s++) {
+        const SnapshotSection* section = &header->sections[s];
+        if (section->offset % SNAPSHOT_ALIGN != 0 || section->offset < sizeof(SnapshotHeader) ||
+            section->offset > file_size || section->size > file_size - section->offset) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+int diff_snapshot_load(DiffData* data, const char* path) {
+    if (!data || !path) {
+        log_error("Invalid arguments to diff_snapshot_load");
+        return 0;
+    }
+    diff_data_clear(data);
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        if (errno != ENOENT) {
+            log_warn("diff_snapshot: Failed to open %s: %s", path, strerror(errno));
+        }
+        return 0;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(SnapshotHeader)) {
+        log_warn("diff_snapshot: %s is not a snapshot", path);
+        close(fd);
+        return 0;
+    }
+    size_t size = (size_t)st.st_size;
+    // Приватное отображение: флаги сворачивания меняются в памяти, файл остается прежним
+    void* mapping = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        log_error("diff_snapshot: Failed to map %s: %s", path, strerror(errno));
+        return 0;
+    }
+    const SnapshotHeader* header = (const SnapshotHeader*)mapping;
+    if (!header_is_valid(header, size)) {
+        log_warn("diff_snapshot: %s was written by another version or is damaged, ignoring it", path);
+        munmap(mapping, size);
+        return 0;
+    }
+
+    char* base = (char*)mapping;
+    data->mapping = mapping;
+    data->mapping_size = size;
+    data->buffer = base + header->sections[SECTION_BUFFER].offset;
+    data->buffer_size = (size_t)header->sections[SECTION_BUFFER].size;
+    data->files = (DiffFile*)(base + header->sections[SECTION_FILES].offset);
+    data->file_count = (size_t)header->file_count;
+    data->hunks = (DiffHunk*)(base + header->sections[SECTION_HUNKS].offset);
+    data->hunk_count = (size_t)header->hunk_count;
+    data->lines.types = (uint8_t*)(base + header->sections[SECTION_LINE_TYPES].offset);
+    data->lines.text_flags = (uint8_t*)(base + header->sections[SECTION_LINE_TEXT_FLAGS].offset);
+    data->lines.offsets = (uint32_t*)(base + header->sections[SECTION_LINE_OFFSETS].offset);
+    data->lines.lengths = (uint32_t*)(base + header->sections[SECTION_LINE_LENGTHS].offset);
+    data->lines.widths = (uint32_t*)(base + header->sections[SECTION_LINE_WIDTHS].offset);
+    data->lines.old_numbers = (uint32_t*)(base + header->sections[SECTION_LINE_OLD_NUMBERS].offset);
+    data->lines.new_numbers = (uint32_t*)(base + header->sections[SECTION_LINE_NEW_NUMBERS].offset);
+    data->lines.row_left = (uint32_t*)(base + header->sections[SECTION_LINE_ROW_LEFT].offset);
+    data->lines.row_right = (uint32_t*)(base + header->sections[SECTION_LINE_ROW_RIGHT].offset);
+    data->line_count = (size_t)header->line_count;
+    if (!validate(data)) {
+        diff_data_clear(data);
+        return 0;
+    }
+    log_info("diff_snapshot: Restored %zu files from %s", data->file_count, path);
+    return 1;
+}
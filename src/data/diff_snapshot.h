@@ -0,0 +1,32 @@
+// src/data/diff_snapshot.h
+#ifndef SEE_CODE_DIFF_SNAPSHOT_H
+#define SEE_CODE_DIFF_SNAPSHOT_H
+
+#include "see_code/data/diff_data.h"
+
+// Binary image of a parsed DiffData, so a restarted server shows the last
+// diff without receiving or parsing it again.
+//
+// The file is a header followed by 8-byte aligned sections: the diff text
+// (every span points into it), the DiffFile and DiffHunk arrays and the
+// columns of the line table. All references are offsets or indices, never
+// pointers, so the image is mapped and used in place. Line widths and
+// text classes, section hashes and collapse flags are saved with the records.
+// Files of a lazily loaded diff that were not parsed yet keep their reserved
+// (zeroed) slots and are parsed on demand after loading as well.
+//
+// The format is tied to the build that wrote it: the header stores the
+// version, byte order and record sizes, and any mismatch rejects the file.
+#define DIFF_SNAPSHOT_VERSION 4
+
+// Writes data to path (through a temporary file and rename, so a crash
+// never leaves a half-written snapshot). Returns 1 on success, 0 on failure.
+int diff_snapshot_write(const DiffData* data, const char* path);
+
+// Replaces the contents of data with the snapshot at path, mapped privately
+// (pages are read on first access, writes stay in memory). The snapshot is
+// validated, so a damaged or foreign file is rejected. Returns 1 on success,
+// 0 on failure (data is then left empty).
+int diff_snapshot_load(DiffData* data, const char* path);
+
+#endif // SEE_CODE_DIFF_SNAPSHOT_H
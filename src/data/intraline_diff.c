@@ -0,0 +1,489 @@
+// src/data/intraline_diff.c
+#include "see_code/data/intraline_diff.h"
+#include "see_code/utils/logger.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Предел числа правок Myers на пару строк. Если строки различаются сильнее,
+// подсвечивать отдельные слова бессмысленно: вся строка помечается измененной.
+#define INTRALINE_MAX_EDITS 128
+// Предел числа токенов строки (после отбрасывания общих начала и конца)
+#define INTRALINE_MAX_TOKENS 2048
+
+typedef struct {
+    uint32_t start;
+    uint32_t length;
+    uint32_t hash;
+} Token;
+
+// Диапазон, еще не разложенный по строкам ханка
+typedef struct {
+    uint32_t line; // Относительно начала ханка
+    IntralineRange range;
+} PendingRange;
+
+struct IntralineScratch {
+    Token* tokens;        // Токены старой строки, за ними токены новой
+    uint8_t* changed;     // Флаг "изменен" для каждого токена
+    size_t token_capacity;
+    int* v;               // Самый дальний x на каждой диагонали k
+    int* trace;           // Копии v после каждого шага d, строка d занимает [d*d, d*d + 2d + 1)
+    PendingRange* pending;
+    size_t pending_count;
+    size_t pending_capacity;
+};
+
+// --- Токенизация ---
+
+static int is_word_byte(unsigned char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') ||
+           c == '_' || c >= 0x80; // Байты UTF-8 считаются частью слова
+}
+
+static int is_space_byte(unsigned char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+static int reserve_tokens(struct IntralineScratch* scratch, size_t needed) {
+    if (needed <= scratch->token_capacity) {
+        return 1;
+    }
+    size_t new_capacity = scratch->token_capacity ? scratch->token_capacity * 2 : 256;
+    while (new_capacity < needed) new_capacity *= 2;
+    Token* tokens = realloc(scratch->tokens, new_capacity * sizeof(Token));
+    if (tokens) scratch->tokens = tokens;
+    uint8_t* changed = realloc(scratch->changed, new_capacity);
+    if (changed) scratch->changed = changed;
+    if (!tokens || !changed) {
+        log_error("intraline_diff: Failed to grow token buffer to %zu entries", new_capacity);
+        return 0;
+    }
+    scratch->token_capacity = new_capacity;
+    return 1;
+}
+
+// Дописывает токены text в scratch->tokens начиная с *count
+static int tokenize(struct IntralineScratch* scratch, const char* text, size_t length, size_t* count) {
+    const unsigned char* bytes = (const unsigned char*)text;
+    size_t pos = 0;
+    while (pos < length) {
+        size_t end = pos + 1;
+        if (is_word_byte(bytes[pos])) {
+            while (end < length && is_word_byte(bytes[end])) end++;
+        } else if (is_space_byte(bytes[pos])) {
+            while (end < length && is_space_byte(bytes[end])) end++;
+        }
+        if (!reserve_tokens(scratch, *count + 1)) {
+            return 0;
+        }
+        uint32_t hash = 2166136261u; // FNV-1a
+        for (size_t i = pos; i < end; i++) {
+            hash = (hash ^ bytes[i]) * 16777619u;
+        }
+        Token* token = &scratch->tokens[(*count)++];
+        token->start = (uint32_t)pos;
+        token->length = (uint32_t)(end - pos);
+        token->hash = hash;
+        pos = end;
+    }
+    return 1;
+}
+
+static int tokens_equal(const char* a_text, const Token* a, const char* b_text, const Token* b) {
+    return a->hash == b->hash && a->length == b->length &&
+           memcmp(a_text + a->start, b_text + b->start, a->length) == 0;
+}
+
+// --- Myers ---
+
+// Помечает в old_changed/new_changed токены, не вошедшие в наибольшую общую
+// подпоследовательность. Возвращает 0, если правок больше INTRALINE_MAX_EDITS.
+static int myers_diff(struct IntralineScratch* scratch,
+                      const char* a_text, const Token* a, uint8_t* a_changed, int n,
+                      const char* b_text, const Token* b, uint8_t* b_changed, int m) {
+    const int offset = INTRALINE_MAX_EDITS + 1;
+    int* v = scratch->v;
+    int* trace = scratch->trace;
+    int max_d = n + m < INTRALINE_MAX_EDITS ? n + m : INTRALINE_MAX_EDITS;
+    int found = -1;
+
+    v[offset + 1] = 0;
+    for (int d = 0; d <= max_d && found < 0; d++) {
+        for (int k = -d; k <= d; k += 2) {
+            int x;
+            if (k == -d || (k != d && v[offset + k - 1] < v[offset + k + 1])) {
+                x = v[offset + k + 1];     // Шаг вниз: вставка из b
+            } else {
+                x = v[offset + k - 1] + 1; // Шаг вправо: удаление из a
+            }
+            int y = x - k;
+            while (x < n && y < m && tokens_equal(a_text, &a[x], b_text, &b[y])) {
+                x++;
+                y++;
+            }
+            v[offset + k] = x;
+            if (x >= n && y >= m) {
+                found = d;
+                break;
+            }
+        }
+        if (found < 0) {
+            memcpy(trace + d * d, v + offset - d, (size_t)(2 * d + 1) * sizeof(int));
+        }
+    }
+    if (found < 0) {
+        return 0;
+    }
+
+    // Обратный проход: по сохраненным строкам восстанавливаем, откуда пришли на каждом шаге
+    int x = n;
+    int y = m;
+    for (int d = found; d > 0; d--) {
+        const int* prev = trace + (d - 1) * (d - 1) + (d - 1); // prev[k] для k из [-(d-1), d-1]
+        int k = x - y;
+        int prev_k;
+        if (k == -d || (k != d && prev[k - 1] < prev[k + 1])) {
+            prev_k = k + 1;
+        } else {
+            prev_k = k - 1;
+        }
+        int prev_x = prev[prev_k];
+        int prev_y = prev_x - prev_k;
+        if (prev_k == k + 1) {
+            b_changed[prev_y] = 1;
+        } else {
+            a_changed[prev_x] = 1;
+        }
+        x = prev_x;
+        y = prev_y;
+    }
+    return 1;
+}
+
+// --- Построение диапазонов ---
+
+static int push_range(struct IntralineScratch* scratch, uint32_t line, uint32_t start, uint32_t length) {
+    if (scratch->pending_count == scratch->pending_capacity) {
+        size_t new_capacity = scratch->pending_capacity ? scratch->pending_capacity * 2 : 256;
+        PendingRange* pending = realloc(scratch->pending, new_capacity * sizeof(PendingRange));
+        if (!pending) {
+            log_error("intraline_diff: Failed to grow range buffer to %zu entries", new_capacity);
+            return 0;
+        }
+        scratch->pending = pending;
+        scratch->pending_capacity = new_capacity;
+    }
+    PendingRange* pending = &scratch->pending[scratch->pending_count++];
+    pending->line = line;
+    pending->range.start = start;
+    pending->range.length = length;
+    return 1;
+}
+
+// Склеивает подряд идущие измененные токены в диапазоны байтов.
+// Одиночный пробел между двумя изменениями входит в диапазон, чтобы
+// замена нескольких слов подсвечивалась одним куском.
+static int emit_ranges(struct IntralineScratch* scratch, uint32_t line, const char* text,
+                       const Token* tokens, const uint8_t* changed, size_t count) {
+    size_t i = 0;
+    while (i < count) {
+        if (!changed[i]) {
+            i++;
+            continue;
+        }
+        size_t end = i + 1;
+        for (;;) {
+            if (end < count && changed[end]) {
+                end++;
+            } else if (end + 1 < count && changed[end + 1] &&
+                       is_space_byte((unsigned char)text[tokens[end].start])) {
+                end += 2;
+            } else {
+                break;
+            }
+        }
+        uint32_t start = tokens[i].start;
+        uint32_t stop = tokens[end - 1].start + tokens[end - 1].length;
+        if (!push_range(scratch, line, start, stop - start)) {
+            return 0;
+        }
+        i = end;
+    }
+    return 1;
+}
+
+// Сравнивает пару строк (тексты без маркера) и добавляет их диапазоны
+static int diff_pair(struct IntralineScratch* scratch,
+                     uint32_t old_line, const char* old_text, size_t old_length,
+                     uint32_t new_line, const char* new_text, size_t new_length) {
+    size_t old_count = 0;
+    if (!tokenize(scratch, old_text, old_length, &old_count)) {
+        return 0;
+    }
+    size_t total = old_count;
+    if (!tokenize(scratch, new_text, new_length, &total)) {
+        return 0;
+    }
+    size_t new_count = total - old_count;
+    const Token* a = scratch->tokens;
+    const Token* b = scratch->tokens + old_count;
+    uint8_t* a_changed = scratch->changed;
+    uint8_t* b_changed = scratch->changed + old_count;
+    memset(scratch->changed, 0, total);
+
+    // Общие начало и конец не участвуют в поиске
+    size_t prefix = 0;
+    while (prefix < old_count && prefix < new_count &&
+           tokens_equal(old_text, &a[prefix], new_text, &b[prefix])) {
+        prefix++;
+    }
+    size_t suffix = 0;
+    while (suffix < old_count - prefix && suffix < new_count - prefix &&
+           tokens_equal(old_text, &a[old_count - 1 - suffix], new_text, &b[new_count - 1 - suffix])) {
+        suffix++;
+    }
+    size_t n = old_count - prefix - suffix;
+    size_t m = new_count - prefix - suffix;
+
+    int ok = n <= INTRALINE_MAX_TOKENS && m <= INTRALINE_MAX_TOKENS &&
+             myers_diff(scratch, old_text, a + prefix, a_changed + prefix, (int)n,
+                        new_text, b + prefix, b_changed + prefix, (int)m);
+    if (!ok) {
+        // Строки слишком разные: изменена вся строка
+        if (old_length > 0 && !push_range(scratch, old_line, 0, (uint32_t)old_length)) return 0;
+        if (new_length > 0 && !push_range(scratch, new_line, 0, (uint32_t)new_length)) return 0;
+        return 1;
+    }
+    return emit_ranges(scratch, old_line, old_text, a, a_changed, old_count) &&
+           emit_ranges(scratch, new_line, new_text, b, b_changed, new_count);
+}
+
+// Текст строки после маркера '+', '-' или ' '
+static const char* line_text(const DiffData* data, size_t line, size_t* length) {
+    *length = data->lines.lengths[line] > 0 ? data->lines.lengths[line] - 1 : 0;
+    return data->buffer + data->lines.offsets[line] + 1;
+}
+
+static IntralineHunk* compute_hunk(struct IntralineScratch* scratch, const DiffData* data, size_t hunk_index) {
+    const DiffHunk* hunk = &data->hunks[hunk_index];
+    const uint8_t* types = data->lines.types + hunk->first_line;
+    scratch->pending_count = 0;
+
+    // Удаленные строки, за которыми идут добавленные, сравниваются попарно
+    size_t k = 0;
+    while (k < hunk->line_count) {
+        if (types[k] != LINE_TYPE_DELETE) {
+            k++;
+            continue;
+        }
+        size_t del_start = k;
+        while (k < hunk->line_count && types[k] == LINE_TYPE_DELETE) k++;
+        size_t add_start = k;
+        while (k < hunk->line_count && types[k] == LINE_TYPE_ADD) k++;
+        size_t pairs = add_start - del_start < k - add_start ? add_start - del_start : k - add_start;
+        for (size_t i = 0; i < pairs; i++) {
+            size_t old_length, new_length;
+            const char* old_text = line_text(data, hunk->first_line + del_start + i, &old_length);
+            const char* new_text = line_text(data, hunk->first_line + add_start + i, &new_length);
+            if (!diff_pair(scratch, (uint32_t)(del_start + i), old_text, old_length,
+                           (uint32_t)(add_start + i), new_text, new_length)) {
+                return NULL;
+            }
+        }
+    }
+
+    // Один блок: заголовок, смещения по строкам и сами диапазоны
+    size_t range_count = scratch->pending_count;
+    size_t size = sizeof(IntralineHunk) + (hunk->line_count + 1) * sizeof(uint32_t) +
+                  range_count * sizeof(IntralineRange);
+    IntralineHunk* result = malloc(size);
+    if (!result) {
+        log_error("intraline_diff: Failed to allocate %zu bytes for hunk %zu", size, hunk_index);
+        return NULL;
+    }
+    memset(result, 0, sizeof(IntralineHunk));
+    result->hunk = hunk_index;
+    result->first_line = hunk->first_line;
+    result->line_count = hunk->line_count;
+    result->range_offsets = (uint32_t*)(result + 1);
+    result->ranges = (IntralineRange*)(result->range_offsets + hunk->line_count + 1);
+
+    // Раскладываем диапазоны по строкам подсчетом (порядок внутри строки сохраняется)
+    uint32_t* offsets = result->range_offsets;
+    memset(offsets, 0, (hunk->line_count + 1) * sizeof(uint32_t));
+    for (size_t i = 0; i < range_count; i++) {
+        offsets[scratch->pending[i].line + 1]++;
+    }
+    for (size_t line = 0; line < hunk->line_count; line++) {
+        offsets[line + 1] += offsets[line];
+    }
+    for (size_t i = 0; i < range_count; i++) {
+        // offsets[line] служит курсором записи и после цикла сдвигается на одну строку
+        result->ranges[offsets[scratch->pending[i].line]++] = scratch->pending[i].range;
+    }
+    for (size_t line = hunk->line_count; line > 0; line--) {
+        offsets[line] = offsets[line - 1];
+    }
+    offsets[0] = 0;
+    return result;
+}
+
+// --- LRU-кэш ---
+
+static size_t bucket_of(size_t hunk) {
+    return hunk % (INTRALINE_CACHE_HUNKS * 2);
+}
+
+static void lru_unlink(IntralineCache* cache, IntralineHunk* entry) {
+    if (entry->prev) entry->prev->next = entry->next; else cache->head = entry->next;
+    if (entry->next) entry->next->prev = entry->prev; else cache->tail = entry->prev;
+    entry->prev = NULL;
+    entry->next = NULL;
+}
+
+static void lru_push_front(IntralineCache* cache, IntralineHunk* entry) {
+    entry->prev = NULL;
+    entry->next = cache->head;
+    if (cache->head) cache->head->prev = entry; else cache->tail = entry;
+    cache->head = entry;
+}
+
+static void remove_entry(IntralineCache* cache, IntralineHunk* entry) {
+    IntralineHunk** link = &cache->buckets[bucket_of(entry->hunk)];
+    while (*link != entry) link = &(*link)->bucket_next;
+    *link = entry->bucket_next;
+    lru_unlink(cache, entry);
+    cache->count--;
+    free(entry);
+}
+
+void intraline_cache_init(IntralineCache* cache) {
+    if (!cache) {
+        return;
+    }
+    memset(cache, 0, sizeof(IntralineCache));
+}
+
+void intraline_cache_clear(IntralineCache* cache) {
+    if (!cache) {
+        return;
+    }
+    while (cache->head) {
+        IntralineHunk* entry = cache->head;
+        cache->head = entry->next;
+        free(entry);
+    }
+    memset(cache->buckets, 0, sizeof(cache->buckets));
+    cache->tail = NULL;
+    cache->count = 0;
+    cache->data = NULL;
+}
+
+void intraline_cache_remap(IntralineCache* cache, const DiffData* previous, const DiffData* data) {
+    if (!cache) {
+        return;
+    }
+    if (cache->data != previous || !previous || !data) {
+        intraline_cache_clear(cache);
+        return;
+    }
+    // Номера ханков сдвинулись: корзины собираются заново, порядок LRU сохраняется
+    memset(cache->buckets, 0, sizeof(cache->buckets));
+    IntralineHunk* entry = cache->head;
+    while (entry) {
+        IntralineHunk* next = entry->next;
+        const size_t hunk = diff_data_reused_hunk(data, previous, entry->hunk);
+        if (hunk == DIFF_NOT_REUSED) {
+            lru_unlink(cache, entry);
+            cache->count--;
+            free(entry);
+        } else {
+            entry->hunk = hunk;
+            entry->first_line = data->hunks[hunk].first_line;
+            entry->bucket_next = cache->buckets[bucket_of(hunk)];
+            cache->buckets[bucket_of(hunk)] = entry;
+        }
+        entry = next;
+    }
+    cache->data = data;
+}
+
+void intraline_cache_destroy(IntralineCache* cache) {
+    if (!cache) {
+        return;
+    }
+    intraline_cache_clear(cache);
+    if (cache->scratch) {
+        free(cache->scratch->tokens);
+        free(cache->scratch->changed);
+        free(cache->scratch->v);
+        free(cache->scratch->trace);
+        free(cache->scratch->pending);
+        free(cache->scratch);
+        cache->scratch = NULL;
+    }
+}
+
+static struct IntralineScratch* get_scratch(IntralineCache* cache) {
+    if (cache->scratch) {
+        return cache->scratch;
+    }
+    struct IntralineScratch* scratch = calloc(1, sizeof(struct IntralineScratch));
+    if (!scratch) {
+        log_error("intraline_diff: Failed to allocate scratch buffers");
+        return NULL;
+    }
+    scratch->v = malloc((2 * INTRALINE_MAX_EDITS + 3) * sizeof(int));
+    scratch->trace = malloc((size_t)(INTRALINE_MAX_EDITS + 1) * (INTRALINE_MAX_EDITS + 1) * sizeof(int));
+    if (!scratch->v || !scratch->trace) {
+        log_error("intraline_diff: Failed to allocate Myers buffers");
+        free(scratch->v);
+        free(scratch->trace);
+        free(scratch);
+        return NULL;
+    }
+    cache->scratch = scratch;
+    return scratch;
+}
+
+const IntralineHunk* intraline_cache_get(IntralineCache* cache, const DiffData* data, size_t hunk) {
+    if (!cache || !data || hunk >= data->hunk_count) {
+        return NULL;
+    }
+    if (cache->data != data) {
+        intraline_cache_clear(cache);
+        cache->data = data;
+    }
+
+    const DiffHunk* diff_hunk = &data->hunks[hunk];
+    for (IntralineHunk* entry = cache->buckets[bucket_of(hunk)]; entry; entry = entry->bucket_next) {
+        if (entry->hunk != hunk) {
+            continue;
+        }
+        if (entry->first_line != diff_hunk->first_line || entry->line_count != diff_hunk->line_count) {
+            // Ханк с этим номером уже другой (diff перезагружен без очистки кэша)
+            remove_entry(cache, entry);
+            break;
+        }
+        lru_unlink(cache, entry);
+        lru_push_front(cache, entry);
+        return entry;
+    }
+
+    struct IntralineScratch* scratch = get_scratch(cache);
+    if (!scratch) {
+        return NULL;
+    }
+    IntralineHunk* entry = compute_hunk(scratch, data, hunk);
+    if (!entry) {
+        return NULL;
+    }
+    if (cache->count >= INTRALINE_CACHE_HUNKS) {
+        remove_entry(cache, cache->tail);
+    }
+    entry->bucket_next = cache->buckets[bucket_of(hunk)];
+    cache->buckets[bucket_of(hunk)] = entry;
+    lru_push_front(cache, entry);
+    cache->count++;
+    return entry;
+}
@@ -0,0 +1,71 @@
+// src/data/intraline_diff.h
+#ifndef SEE_CODE_INTRALINE_DIFF_H
+#define SEE_CODE_INTRALINE_DIFF_H
+
+#include "see_code/data/diff_data.h"
+#include <stddef.h>
+#include <stdint.h>
+
+// Word-level changes inside modified lines.
+//
+// In every run of '-' lines followed by '+' lines of a hunk, the i-th deleted
+// line is paired with the i-th added one and the two are compared token by
+// token (Myers diff). Tokens are words, runs of whitespace and single
+// punctuation characters. Lines without a partner get no ranges: the whole
+// line is already a change.
+//
+// Results are computed per hunk on first request and kept in a small LRU,
+// so only hunks that were actually on screen are ever diffed.
+
+// Changed bytes of a line, relative to the first byte after the '+'/'-' marker
+typedef struct {
+    uint32_t start;
+    uint32_t length;
+} IntralineRange;
+
+// Maximum number of hunks kept in an IntralineCache
+#define INTRALINE_CACHE_HUNKS 64
+
+typedef struct IntralineHunk {
+    size_t hunk;        // Index in DiffData.hunks
+    size_t first_line;  // Copy of the hunk's rows, to detect a replaced diff
+    size_t line_count;
+    // Ranges of line k of the hunk are ranges[range_offsets[k] .. range_offsets[k + 1])
+    uint32_t* range_offsets;
+    IntralineRange* ranges;
+    // LRU list (most recent first) and hash bucket chain
+    struct IntralineHunk* prev;
+    struct IntralineHunk* next;
+    struct IntralineHunk* bucket_next;
+} IntralineHunk;
+
+typedef struct {
+    const DiffData* data;  // Diff the cached hunks belong to
+    IntralineHunk* buckets[INTRALINE_CACHE_HUNKS * 2];
+    IntralineHunk* head;   // Most recently used
+    IntralineHunk* tail;   // Evicted first
+    size_t count;
+    struct IntralineScratch* scratch; // Work buffers reused between hunks
+} IntralineCache;
+
+void intraline_cache_init(IntralineCache* cache);
+void intraline_cache_destroy(IntralineCache* cache);
+// Drops every cached hunk (call when the diff is replaced or reloaded)
+void intraline_cache_clear(IntralineCache* cache);
+// Moves the cached hunks of files that data, reloaded from previous, copied
+// unchanged to their new indices and drops the rest. A cache that does not
+// hold previous is cleared.
+void intraline_cache_remap(IntralineCache* cache, const DiffData* previous, const DiffData* data);
+
+// Returns the word-level changes of a hunk, diffing it on the first request.
+// The result stays valid until the next call on the same cache.
+// Returns NULL if hunk is out of range or memory ran out.
+const IntralineHunk* intraline_cache_get(IntralineCache* cache, const DiffData* data, size_t hunk);
+
+// Changed ranges of line k of the hunk (k is relative to hunk->first_line)
+static inline const IntralineRange* intraline_hunk_line_ranges(const IntralineHunk* hunk, size_t k, size_t* count) {
+    *count = hunk->range_offsets[k + 1] - hunk->range_offsets[k];
+    return hunk->ranges + hunk->range_offsets[k];
+}
+
+#endif // SEE_CODE_INTRALINE_DIFF_H
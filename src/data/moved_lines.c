@@ -0,0 +1,773 @@
+// src/data/moved_lines.c
+#include "see_code/data/moved_lines.h"
+#include "see_code/data/diff_cold_store.h"
+#include "see_code/data/diff_scanner.h"
+#include "see_code/utils/hash.h"
+#include "see_code/utils/logger.h"
+#include "see_code/utils/thread_pool.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Строк в единице параллельной работы (единица - подряд идущие файлы или ханки)
+#define MOVED_UNIT_LINES 8192
+// Меньший объем обрабатывается одним потоком: запуск пула дороже
+#define MOVED_PARALLEL_MIN_LINES 32768
+// Текст без пробелов хешируется кусками такого размера
+#define MOVED_HASH_CHUNK 256
+// Строк, хешируемых за один вызов moved_lines_update: первый кадр большого diff
+// не ждет всех файлов, остальные хешируются следующими кадрами
+#define MOVED_HASH_BUDGET_LINES 65536
+// Байт kinds: DiffLineType и отметка первой строки ханка
+#define MOVED_KIND_TYPE 0x3
+#define MOVED_KIND_HUNK_START 0x4
+
+typedef struct {
+    uint32_t add_first; // Первая добавленная строка блока
+    uint32_t del_first; // Удаленная строка, которой она равна
+    uint32_t length;
+} MovedBlock;
+
+// Подряд идущие файлы (хеширование) или ханки (поиск блоков)
+typedef struct {
+    size_t first;
+    size_t end;
+    MovedBlock* blocks;
+    size_t block_count;
+    size_t block_capacity;
+    int failed;
+} MovedUnit;
+
+// Удаленные строки, сгруппированные по хешу: строки с хешем slot.hash -
+// grouped[slot.start .. slot.start + slot.count), по возрастанию номера
+typedef struct {
+    uint64_t hash; // 0 = пустой слот
+    uint32_t start;
+    uint32_t count;
+} DeletedSlot;
+
+typedef struct {
+    uint32_t first_line;
+    uint32_t end_line;
+} MovedHunk;
+
+// Поиск блоков в фоне. Работает только со своими копиями типов и хешей строк
+// (ханки восстанавливаются по отметкам в kinds), поэтому diff может
+// дописываться и даже освобождаться, пока он идет. Владелец бросает задачу,
+// не дожидаясь ее (cancelled), и забирает результат, когда done.
+struct MovedJob {
+    size_t line_count;
+    uint8_t* kinds;         // После разметки ханков - только DiffLineType
+    uint64_t* hashes;
+    uint8_t* alnum;
+    MovedHunk* hunks;
+    size_t hunk_count;
+    MovedUnit* units;
+    size_t unit_count;
+    DeletedSlot* slots;
+    size_t slot_mask;
+    uint32_t* grouped;
+    // Результат
+    uint32_t* counterparts;
+    uint8_t* marks;
+    size_t block_count;
+    size_t moved_lines;
+    int ok;
+    size_t bytes;           // Память копий, для moved_lines_memory_usage
+    pthread_mutex_t mutex;
+    pthread_cond_t finished;
+    int done;               // Доступ через __atomic
+    int cancelled;          // Доступ через __atomic
+    int refs;
+};
+
+// --- Хеширование строк ---
+
+// Хеш текста без пробельных символов; *alnum - число букв и цифр в нем
+static uint64_t hash_normalized(const char* text, size_t length, uint8_t* alnum) {
+    char chunk[MOVED_HASH_CHUNK];
+    size_t used = 0;
+    size_t letters = 0;
+    uint64_t h = 0;
+    for (size_t i = 0; i < length; i++) {
+        const unsigned char c = (unsigned char)text[i];
+        if (c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f') {
+            continue;
+        }
+        letters += (c >= '0' && c <= '9') || ((c | 0x20) >= 'a' && (c | 0x20) <= 'z') || c >= 0x80;
+        chunk[used++] = (char)c;
+        if (used == MOVED_HASH_CHUNK) {
+            h = hash_round(h, hash_bytes(chunk, used));
+            used = 0;
+        }
+    }
+    h = hash_round(h, hash_bytes(chunk, used));
+    *alnum = (uint8_t)(letters < 255 ? letters : 255);
+    return h ? h : 1;
+}
+
+static void hash_line(MovedLines* moved, size_t line, DiffLineType type, int hunk_start, const char* text, size_t length) {
+    moved->kinds[line] = (uint8_t)(type | (hunk_start ? MOVED_KIND_HUNK_START : 0));
+    moved->hashes[line] = type == LINE_TYPE_CONTEXT ? 0 : hash_normalized(text, length, &moved->alnum[line]);
+}
+
+// Разобранный файл: строки из таблицы строк
+static void hash_parsed_file(MovedLines* moved, const DiffData* data, size_t file) {
+    const DiffFile* entry = &data->files[file];
+    const DiffLineTable* lines = &data->lines;
+    const DiffHunk* hunks = diff_data_file_hunks(data, entry);
+    diff_cold_store_pin(data->cold, entry->section.offset, entry->section.length);
+    for (size_t h = 0; h < entry->hunk_count; h++) {
+        const size_t first = hunks[h].first_line;
+        for (size_t line = first; line < first + hunks[h].line_count; line++) {
+            // Текст после маркера '+', '-' или ' '
+            const uint32_t length = lines->lengths[line] > 0 ? lines->lengths[line] - 1 : 0;
+            hash_line(moved, line, (DiffLineType)lines->types[line], line == first,
+                      data->buffer + lines->offsets[line] + 1, length);
+        }
+    }
+    diff_cold_store_unpin(data->cold, entry->section.offset, entry->section.length);
+}
+
+// Файл ленивого diff, который еще не разобран: строки берутся из текста секции.
+// Они считаются от первого "@@" по первому байту, как при отведении ячеек
+// (diff_scan_count_kinds), и k-я из них займет ячейку first_line + k - хеши
+// остаются верными и после разбора файла.
+static void hash_section(MovedLines* moved, const DiffData* data, size_t file, size_t end_row) {
+    const DiffFile* entry = &data->files[file];
+    const char* buffer = data->buffer;
+    const size_t start = entry->section.offset;
+    const size_t end = start + entry->section.length;
+    if (end <= start) {
+        return;
+    }
+    diff_cold_store_pin(data->cold, start, end - start);
+    // Строки до первого заголовка ханка (diff --git, index, ---, +++) пропускаются
+    size_t line = end;
+    const char* newline = memchr(buffer + start, '\n', end - start);
+    while (newline) {
+        const size_t next = (size_t)(newline - buffer) + 1;
+        if (next + 1 < end && buffer[next] == '@' && buffer[next + 1] == '@') {
+            line = next;
+            break;
+        }
+        newline = next < end ? memchr(buffer + next, '\n', end - next) : NULL;
+    }
+    size_t row = entry->first_line;
+    int hunk_start = 0;
+    while (line < end && row < end_row) {
+        newline = memchr(buffer + line, '\n', end - line);
+        const size_t line_end = newline ? (size_t)(newline - buffer) : end;
+        const DiffScanKind kind = line < line_end ? diff_scan_classify((unsigned char)buffer[line]) : DIFF_SCAN_KIND_OTHER;
+        if (kind == DIFF_SCAN_KIND_HUNK) {
+            hunk_start = 1;
+        } else if (kind == DIFF_SCAN_KIND_ADD || kind == DIFF_SCAN_KIND_DELETE || kind == DIFF_SCAN_KIND_CONTEXT) {
+            const DiffLineType type = kind == DIFF_SCAN_KIND_ADD ? LINE_TYPE_ADD :
+                                      kind == DIFF_SCAN_KIND_DELETE ? LINE_TYPE_DELETE : LINE_TYPE_CONTEXT;
+            hash_line(moved, row++, type, hunk_start, buffer + line + 1, line_end - line - 1);
+            hunk_start = 0;
+        }
+        line = line_end + 1;
+    }
+    diff_cold_store_unpin(data->cold, start, end - start);
+}
+
+// Конец ячеек файла: у файла ленивого diff они отведены до начала следующего
+static size_t file_end_row(const DiffData* data, size_t file) {
+    return file + 1 < data->file_count ? data->files[file + 1].first_line : data->line_count;
+}
+
+static void hash_file(MovedLines* moved, const DiffData* data, size_t file) {
+    if (diff_data_file_is_parsed(&data->files[file])) {
+        hash_parsed_file(moved, data, file);
+    } else {
+        hash_section(moved, data, file, file_end_row(data, file));
+    }
+}
+
+typedef struct {
+    MovedLines* moved;
+    const DiffData* data;
+    const MovedUnit* units;
+} HashPass;
+
+static void hash_unit(void* context, size_t u) {
+    HashPass* pass = (HashPass*)context;
+    for (size_t file = pass->units[u].first; file < pass->units[u].end; file++) {
+        hash_file(pass->moved, pass->data, file);
+    }
+}
+
+// Делит файлы [first, end) на единицы примерно по MOVED_UNIT_LINES строк
+static MovedUnit* make_file_units(const DiffData* data, size_t first, size_t end, size_t lines, size_t* count) {
+    const size_t capacity = lines / MOVED_UNIT_LINES + 2;
+    MovedUnit* units = calloc(capacity, sizeof(MovedUnit));
+    if (!units) {
+        return NULL;
+    }
+    size_t n = 0;
+    lines = 0;
+    units[0].first = first;
+    for (size_t file = first; file < end; file++) {
+        lines += file_end_row(data, file) - data->files[file].first_line;
+        if (lines >= MOVED_UNIT_LINES && n + 1 < capacity) {
+            units[n].end = file + 1;
+            units[++n].first = file + 1;
+            lines = 0;
+        }
+    }
+    units[n].end = end;
+    *count = n + 1;
+    return units;
+}
+
+// Хеширует следующие файлы, пока не наберется MOVED_HASH_BUDGET_LINES строк
+// (хотя бы один файл). Разобран ли файл, не важно. Возвращает число
+// хешированных файлов.
+static size_t hash_next_files(MovedLines* moved, const DiffData* data) {
+    const size_t first = moved->hashed_files;
+    size_t end = first, lines = 0;
+    while (end < data->file_count && (end == first || lines < MOVED_HASH_BUDGET_LINES)) {
+        lines += file_end_row(data, end) - data->files[end].first_line;
+        end++;
+    }
+    ThreadPool* pool = lines >= MOVED_PARALLEL_MIN_LINES ? thread_pool_shared() : NULL;
+    size_t unit_count = 0;
+    MovedUnit* units = pool && thread_pool_size(pool) > 0 ? make_file_units(data, first, end, lines, &unit_count) : NULL;
+    if (units) {
+        HashPass pass = { moved, data, units };
+        thread_pool_parallel_for(pool, unit_count, hash_unit, &pass);
+        free(units);
+    } else {
+        for (size_t file = first; file < end; file++) {
+            hash_file(moved, data, file);
+        }
+    }
+    moved->hashed_files = end;
+    moved->hashed_lines = file_end_row(data, end - 1);
+    return end - first;
+}
+
+// --- Задача поиска ---
+
+// Промежуточные копии задачи; результат (counterparts, marks) остается
+static void job_free_copies(MovedJob* job) {
+    for (size_t u = 0; job->units && u < job->unit_count; u++) {
+        free(job->units[u].blocks);
+    }
+    free(job->units);
+    free(job->kinds);
+    free(job->hashes);
+    free(job->alnum);
+    free(job->hunks);
+    free(job->slots);
+    free(job->grouped);
+    job->units = NULL;
+    job->kinds = NULL;
+    job->hashes = NULL;
+    job->alnum = NULL;
+    job->hunks = NULL;
+    job->slots = NULL;
+    job->grouped = NULL;
+}
+
+static void job_release(MovedJob* job) {
+    if (!job || __atomic_sub_fetch(&job->refs, 1, __ATOMIC_ACQ_REL) != 0) {
+        return;
+    }
+    job_free_copies(job);
+    free(job->counterparts);
+    free(job->marks);
+    pthread_cond_destroy(&job->finished);
+    pthread_mutex_destroy(&job->mutex);
+    free(job);
+}
+
+static int job_cancelled(const MovedJob* job) {
+    return __atomic_load_n(&job->cancelled, __ATOMIC_RELAXED);
+}
+
+// --- Группировка удаленных строк ---
+
+static DeletedSlot* find_slot(const MovedJob* job, uint64_t hash) {
+    size_t slot = (size_t)hash & job->slot_mask;
+    while (job->slots[slot].hash != 0 && job->slots[slot].hash != hash) {
+        slot = (slot + 1) & job->slot_mask;
+    }
+    return &job->slots[slot];
+}
+
+// Два прохода по удаленным строкам: подсчет по хешам, затем раскладка
+// по началам групп (сортировка подсчетом)
+static int group_deleted(MovedJob* job) {
+    const uint8_t* types = job->kinds;
+    size_t deleted = 0;
+    for (size_t h = 0; h < job->hunk_count; h++) {
+        for (size_t line = job->hunks[h].first_line; line < job->hunks[h].end_line; line++) {
+            deleted += types[line] == LINE_TYPE_DELETE;
+        }
+    }
+    size_t size = 16;
+    while (size < deleted * 2) size *= 2;
+    job->slots = calloc(size, sizeof(DeletedSlot));
+    job->grouped = malloc((deleted ? deleted : 1) * sizeof(uint32_t));
+    if (!job->slots || !job->grouped) {
+        log_error("moved_lines: Failed to allocate groups for %zu deleted lines", deleted);
+        return 0;
+    }
+    job->slot_mask = size - 1;
+
+    for (size_t h = 0; h < job->hunk_count; h++) {
+        for (size_t line = job->hunks[h].first_line; line < job->hunks[h].end_line; line++) {
+            if (types[line] == LINE_TYPE_DELETE) {
+                DeletedSlot* slot = find_slot(job, job->hashes[line]);
+                slot->hash = job->hashes[line];
+                slot->count++;
+            }
+        }
+    }
+    uint32_t start = 0;
+    for (size_t i = 0; i < size; i++) {
+        job->slots[i].start = start;
+        start += job->slots[i].count;
+        job->slots[i].count = 0; // Заполняется заново при раскладке
+    }
+    for (size_t h = 0; h < job->hunk_count; h++) {
+        for (size_t line = job->hunks[h].first_line; line < job->hunks[h].end_line; line++) {
+            if (types[line] == LINE_TYPE_DELETE) {
+                DeletedSlot* slot = find_slot(job, job->hashes[line]);
+                job->grouped[slot->start + slot->count++] = (uint32_t)line;
+            }
+        }
+    }
+    return 1;
+}
+
+// --- Поиск блоков ---
+
+static void push_block(MovedUnit* unit, uint32_t add_first, uint32_t del_first, uint32_t length) {
+    if (unit->failed) {
+        return;
+    }
+    if (unit->block_count == unit->block_capacity) {
+        size_t capacity = unit->block_capacity ? unit->block_capacity * 2 : 64;
+        MovedBlock* blocks = realloc(unit->blocks, capacity * sizeof(MovedBlock));
+        if (!blocks) {
+            log_error("moved_lines: Failed to grow block list to %zu", capacity);
+            unit->failed = 1;
+            return;
+        }
+        unit->blocks = blocks;
+        unit->block_capacity = capacity;
+    }
+    MovedBlock* block = &unit->blocks[unit->block_count++];
+    block->add_first = add_first;
+    block->del_first = del_first;
+    block->length = length;
+}
+
+// Проходит добавленные строки ханка [first, end). Кандидаты - удаленные строки,
+// на которых продолжаются еще живые совпадения текущего блока; блок
+// заканчивается, когда не продолжается ни одно. Удаления того же ханка -
+// это правка на месте, а не перенос.
+static void walk_hunk(const MovedJob* job, MovedUnit* unit, size_t first, size_t end) {
+    const uint8_t* types = job->kinds;
+    const uint64_t* hashes = job->hashes;
+    const size_t line_count = job->line_count;
+    uint32_t candidates[MOVED_MAX_CANDIDATES];
+    size_t candidate_count = 0;
+    size_t block_first = 0, length = 0, letters = 0;
+    for (size_t line = first; line <= end; line++) {
+        const int is_add = line < end && types[line] == LINE_TYPE_ADD;
+        const uint64_t hash = is_add ? hashes[line] : 0;
+        if (length > 0) {
+            size_t kept = 0;
+            for (size_t c = 0; is_add && c < candidate_count; c++) {
+                const size_t next = (size_t)candidates[c] + 1;
+                if (next < line_count && (next < first || next >= end) &&
+                    types[next] == LINE_TYPE_DELETE && hashes[next] == hash) {
+                    candidates[kept++] = (uint32_t)next;
+                }
+            }
+            if (kept > 0) {
+                candidate_count = kept;
+                length++;
+                letters += job->alnum[line];
+                continue;
+            }
+            // Все кандидаты прошлой строки прошли одинаковую длину: берется первый
+            if (letters >= MOVED_MIN_ALNUM) {
+                push_block(unit, (uint32_t)block_first, candidates[0] - (uint32_t)(length - 1), (uint32_t)length);
+            }
+            length = 0;
+        }
+        if (!is_add) {
+            continue;
+        }
+        const DeletedSlot* slot = find_slot(job, hash);
+        if (slot->hash == 0 || slot->count > MOVED_MAX_CANDIDATES) {
+            continue;
+        }
+        candidate_count = 0;
+        for (uint32_t i = 0; i < slot->count; i++) {
+            const uint32_t deleted = job->grouped[slot->start + i];
+            if (deleted < first || deleted >= end) {
+                candidates[candidate_count++] = deleted;
+            }
+        }
+        if (candidate_count > 0) {
+            block_first = line;
+            length = 1;
+            letters = job->alnum[line];
+        }
+    }
+}
+
+static void walk_unit(void* context, size_t u) {
+    MovedJob* job = (MovedJob*)context;
+    MovedUnit* unit = &job->units[u];
+    if (job_cancelled(job)) {
+        return;
+    }
+    for (size_t h = unit->first; h < unit->end; h++) {
+        walk_hunk(job, unit, job->hunks[h].first_line, job->hunks[h].end_line);
+    }
+}
+
+// Размечает строки найденных блоков. Удаленная строка, совпавшая с несколькими
+// блоками (код скопирован в несколько мест), ведет к первому.
+static int mark_blocks(MovedJob* job) {
+    const size_t n = job->line_count ? job->line_count : 1;
+    job->counterparts = malloc(n * sizeof(uint32_t));
+    job->marks = malloc(n);
+    if (!job->counterparts || !job->marks) {
+        log_error("moved_lines: Failed to allocate marks for %zu lines", job->line_count);
+        return 0;
+    }
+    memset(job->counterparts, 0xFF, n * sizeof(uint32_t));
+    memset(job->marks, MOVED_MARK_NONE, n);
+    uint32_t previous_end = MOVED_NONE;
+    uint8_t mark = MOVED_MARK_BLOCK_ALT;
+    for (size_t u = 0; u < job->unit_count; u++) {
+        for (size_t b = 0; b < job->units[u].block_count; b++) {
+            const MovedBlock* block = &job->units[u].blocks[b];
+            // Соседние блоки чередуют оттенок, чтобы граница между ними была видна
+            mark = block->add_first == previous_end && mark == MOVED_MARK_BLOCK ? MOVED_MARK_BLOCK_ALT : MOVED_MARK_BLOCK;
+            for (uint32_t i = 0; i < block->length; i++) {
+                job->counterparts[block->add_first + i] = block->del_first + i;
+                job->marks[block->add_first + i] = mark;
+                if (job->counterparts[block->del_first + i] == MOVED_NONE) {
+                    job->counterparts[block->del_first + i] = block->add_first + i;
+                    job->marks[block->del_first + i] = mark;
+                }
+            }
+            previous_end = block->add_first + block->length;
+            job->block_count++;
+            job->moved_lines += block->length;
+        }
+    }
+    return 1;
+}
+
+// Ханки по отметкам первых строк; строка без отметки продолжает ханк выше
+static int find_hunks(MovedJob* job) {
+    size_t count = 0;
+    for (size_t line = 0; line < job->line_count; line++) {
+        count += (job->kinds[line] & MOVED_KIND_HUNK_START) != 0;
+    }
+    job->hunks = malloc((count ? count : 1) * sizeof(MovedHunk));
+    if (!job->hunks) {
+        log_error("moved_lines: Failed to allocate %zu hunks", count);
+        return 0;
+    }
+    for (size_t line = 0; line < job->line_count; line++) {
+        if (job->kinds[line] & MOVED_KIND_HUNK_START) {
+            if (job->hunk_count > 0) {
+                job->hunks[job->hunk_count - 1].end_line = (uint32_t)line;
+            }
+            job->hunks[job->hunk_count].first_line = (uint32_t)line;
+            job->hunk_count++;
+        }
+        job->kinds[line] &= MOVED_KIND_TYPE;
+    }
+    if (job->hunk_count > 0) {
+        job->hunks[job->hunk_count - 1].end_line = (uint32_t)job->line_count;
+    }
+    return 1;
+}
+
+static int make_hunk_units(MovedJob* job);
+
+static void job_run(MovedJob* job) {
+    int ok = find_hunks(job);
+    if (ok && !make_hunk_units(job)) {
+        log_error("moved_lines: Failed to allocate work units");
+        ok = 0;
+    }
+    ok = ok && group_deleted(job);
+    ThreadPool* pool = job->line_count >= MOVED_PARALLEL_MIN_LINES ? thread_pool_shared() : NULL;
+    if (ok && pool && thread_pool_size(pool) > 0) {
+        // Поток задачи сам участвует в parallel_for
+        thread_pool_parallel_for(pool, job->unit_count, walk_unit, job);
+    } else {
+        for (size_t u = 0; ok && u < job->unit_count; u++) walk_unit(job, u);
+    }
+    for (size_t u = 0; ok && u < job->unit_count; u++) {
+        ok = !job->units[u].failed;
+    }
+    job->ok = ok && !job_cancelled(job) && mark_blocks(job);
+}
+
+static void job_task(void* arg) {
+    MovedJob* job = (MovedJob*)arg;
+    if (!job_cancelled(job)) {
+        job_run(job);
+    }
+    job_free_copies(job);
+    pthread_mutex_lock(&job->mutex);
+    __atomic_store_n(&job->done, 1, __ATOMIC_RELEASE);
+    pthread_cond_broadcast(&job->finished);
+    pthread_mutex_unlock(&job->mutex);
+    job_release(job);
+}
+
+static void* job_thread_main(void* arg) {
+    job_task(arg);
+    return NULL;
+}
+
+// Делит ханки задачи на единицы примерно по MOVED_UNIT_LINES строк
+static int make_hunk_units(MovedJob* job) {
+    const size_t capacity = job->line_count / MOVED_UNIT_LINES + 2;
+    job->units = calloc(capacity, sizeof(MovedUnit));
+    if (!job->units) {
+        return 0;
+    }
+    size_t n = 0, lines = 0;
+    for (size_t h = 0; h < job->hunk_count; h++) {
+        lines += job->hunks[h].end_line - job->hunks[h].first_line;
+        if (lines >= MOVED_UNIT_LINES && n + 1 < capacity) {
+            job->units[n].end = h + 1;
+            job->units[++n].first = h + 1;
+            lines = 0;
+        }
+    }
+    job->units[n].end = job->hunk_count;
+    job->unit_count = n + 1;
+    return 1;
+}
+
+// Снимок хешей и ханков хешированных файлов
+static MovedJob* job_create(const MovedLines* moved) {
+    MovedJob* job = calloc(1, sizeof(MovedJob));
+    if (!job) {
+        log_error("moved_lines: Failed to allocate moved-block search");
+        return NULL;
+    }
+    if (pthread_mutex_init(&job->mutex, NULL) != 0) {
+        log_error("moved_lines: Failed to initialize mutex");
+        free(job);
+        return NULL;
+    }
+    if (pthread_cond_init(&job->finished, NULL) != 0) {
+        log_error("moved_lines: Failed to initialize condition variable");
+        pthread_mutex_destroy(&job->mutex);
+        free(job);
+        return NULL;
+    }
+    job->refs = 1;
+    job->line_count = moved->hashed_lines;
+    const size_t n = job->line_count ? job->line_count : 1;
+    job->kinds = malloc(n);
+    job->hashes = malloc(n * sizeof(uint64_t));
+    job->alnum = malloc(n);
+    if (!job->kinds || !job->hashes || !job->alnum) {
+        log_error("moved_lines: Failed to copy %zu lines for moved-block search", job->line_count);
+        job_release(job);
+        return NULL;
+    }
+    memcpy(job->kinds, moved->kinds, job->line_count);
+    memcpy(job->hashes, moved->hashes, job->line_count * sizeof(uint64_t));
+    memcpy(job->alnum, moved->alnum, job->line_count);
+    job->bytes = sizeof(MovedJob) + job->line_count * (sizeof(uint64_t) + sizeof(uint32_t) + 3);
+    return job;
+}
+
+// Запускает поиск в фоне: в пуле, а если в нем нет рабочих потоков - в отдельном потоке
+static int job_launch(MovedLines* moved) {
+    MovedJob* job = job_create(moved);
+    if (!job) {
+        return 0;
+    }
+    __atomic_add_fetch(&job->refs, 1, __ATOMIC_RELAXED);
+    if (!thread_pool_submit(thread_pool_shared(), job_task, job)) {
+        pthread_t thread;
+        pthread_attr_t attr;
+        pthread_attr_init(&attr);
+        pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+        int created = pthread_create(&thread, &attr, job_thread_main, job) == 0;
+        pthread_attr_destroy(&attr);
+        if (!created) {
+            log_error("moved_lines: Failed to start the moved-block search thread");
+            job_release(job);
+            job_release(job);
+            return 0;
+        }
+    }
+    moved->job = job;
+    return 1;
+}
+
+// Публикует результат законченного поиска; возвращает 1, если он был
+static int job_collect(MovedLines* moved) {
+    MovedJob* job = moved->job;
+    if (!job || !__atomic_load_n(&job->done, __ATOMIC_ACQUIRE)) {
+        return 0;
+    }
+    free(moved->counterparts);
+    free(moved->marks);
+    moved->counterparts = NULL;
+    moved->marks = NULL;
+    moved->line_count = 0;
+    moved->block_count = 0;
+    moved->moved_lines = 0;
+    if (job->ok) {
+        moved->counterparts = job->counterparts;
+        moved->marks = job->marks;
+        moved->line_count = job->line_count;
+        moved->block_count = job->block_count;
+        moved->moved_lines = job->moved_lines;
+        job->counterparts = NULL;
+        job->marks = NULL;
+        log_debug("moved_lines: %zu moved blocks, %zu lines", moved->block_count, moved->moved_lines);
+    }
+    moved->job = NULL;
+    job_release(job);
+    return 1;
+}
+
+// --- Публичный интерфейс ---
+
+void moved_lines_init(MovedLines* moved) {
+    if (!moved) {
+        return;
+    }
+    memset(moved, 0, sizeof(MovedLines));
+}
+
+void moved_lines_destroy(MovedLines* moved) {
+    if (!moved) {
+        return;
+    }
+    if (moved->job) {
+        __atomic_store_n(&moved->job->cancelled, 1, __ATOMIC_RELAXED);
+        job_release(moved->job);
+    }
+    free(moved->kinds);
+    free(moved->hashes);
+    free(moved->alnum);
+    free(moved->counterparts);
+    free(moved->marks);
+    memset(moved, 0, sizeof(MovedLines));
+}
+
+void moved_lines_clear(MovedLines* moved) {
+    moved_lines_destroy(moved);
+}
+
+size_t moved_lines_memory_usage(const MovedLines* moved) {
+    if (!moved) {
+        return 0;
+    }
+    return moved->hash_capacity * (sizeof(uint64_t) + 2) +
+           moved->line_count * (sizeof(uint32_t) + 1) + (moved->job ? moved->job->bytes : 0);
+}
+
+// Растит массивы хешей под число строк data; новые строки еще не хешированы
+static int reserve(MovedLines* moved, const DiffData* data) {
+    if (data->line_count <= moved->hash_capacity) {
+        return 1;
+    }
+    // Потоковый diff растет понемногу: запас, чтобы не копировать массивы каждый кадр
+    size_t capacity = moved->hash_capacity * 2;
+    if (capacity < data->line_count) capacity = data->line_count;
+    uint8_t* kinds = realloc(moved->kinds, capacity);
+    if (kinds) moved->kinds = kinds;
+    uint64_t* hashes = realloc(moved->hashes, capacity * sizeof(uint64_t));
+    if (hashes) moved->hashes = hashes;
+    uint8_t* alnum = realloc(moved->alnum, capacity);
+    if (alnum) moved->alnum = alnum;
+    if (!kinds || !hashes || !alnum) {
+        log_error("moved_lines: Failed to grow line arrays to %zu lines", capacity);
+        return 0;
+    }
+    // Ячейки, которые секция не заняла, остаются контекстом с хешем 0:
+    // 0 не совпадает ни с одним хешем
+    memset(moved->kinds + moved->hash_capacity, LINE_TYPE_CONTEXT, capacity - moved->hash_capacity);
+    memset(moved->hashes + moved->hash_capacity, 0, (capacity - moved->hash_capacity) * sizeof(uint64_t));
+    memset(moved->alnum + moved->hash_capacity, 0, capacity - moved->hash_capacity);
+    moved->hash_capacity = capacity;
+    return 1;
+}
+
+int moved_lines_update(MovedLines* moved, const DiffData* data) {
+    if (!moved || !data) {
+        return 0;
+    }
+    if (moved->data != data) {
+        moved_lines_clear(moved);
+        moved->data = data;
+    }
+    job_collect(moved);
+    moved->hashing = 0;
+    if (moved->hashed_files < data->file_count) {
+        if (!reserve(moved, data)) {
+            return 0;
+        }
+        hash_next_files(moved, data);
+        moved->pending = 1;
+        // Остальные файлы хешируются следующими кадрами
+        if (moved->hashed_files < data->file_count) {
+            moved->hashing = 1;
+            return 1;
+        }
+    }
+    // Пока идет прошлый поиск, новые файлы только хешируются: их подберет следующий
+    if (!moved->pending || moved->job) {
+        return 1;
+    }
+    moved->pending = 0;
+    return job_launch(moved);
+}
+
+int moved_lines_take_updates(MovedLines* moved) {
+    if (!moved) {
+        return 0;
+    }
+    // Пока не все файлы хешированы, нужен еще кадр, чтобы продолжить
+    return job_collect(moved) || moved->hashing;
+}
+
+void moved_lines_wait(MovedLines* moved) {
+    if (!moved) {
+        return;
+    }
+    for (;;) {
+        MovedJob* job = moved->job;
+        if (job) {
+            pthread_mutex_lock(&job->mutex);
+            while (!__atomic_load_n(&job->done, __ATOMIC_ACQUIRE)) {
+                pthread_cond_wait(&job->finished, &job->mutex);
+            }
+            pthread_mutex_unlock(&job->mutex);
+            job_collect(moved);
+        }
+        // Оставшиеся файлы и файлы, хешированные за время поиска, ищутся сразу же
+        if (!moved->data || (!moved->hashing && !moved->pending) || !moved_lines_update(moved, moved->data)) {
+            return;
+        }
+        if (!moved->job && !moved->hashing) {
+            return;
+        }
+    }
+}
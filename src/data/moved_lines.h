@@ -0,0 +1,105 @@
+// src/data/moved_lines.h
+#ifndef SEE_CODE_MOVED_LINES_H
+#define SEE_CODE_MOVED_LINES_H
+
+#include "see_code/data/diff_data.h"
+#include <stddef.h>
+#include <stdint.h>
+
+// Moved-code detection: runs of deleted lines that reappear as added lines
+// elsewhere in the diff (another file or another hunk), like
+// `git diff --color-moved`.
+//
+// Every added and deleted line is hashed once with its whitespace removed,
+// so re-indented code still matches. Hashing happens on the calling thread,
+// at most MOVED_HASH_BUDGET_LINES lines per update (see moved_lines.c), so a
+// large diff is hashed over several frames. Files of a lazily loaded diff
+// that are not parsed yet are hashed straight from their section text, with
+// the lines they will take once parsed, so every file takes part and parsing
+// a file changes nothing. The join then runs in the background on a copy of
+// the hashes: deleted lines are grouped by hash (counting sort into an
+// open-addressing table), and every run of added lines walks its
+// candidates. A block grows while the next added line equals the line after
+// its deleted counterpart, and ends when no candidate continues. Both passes
+// are linear; they are spread over the shared thread pool for large diffs.
+// One join runs at a time, after every file is hashed: files that arrive
+// meanwhile (a streamed diff) are picked up by the next one, and the marks
+// of the last finished join stay visible until then.
+//
+// A block is reported when it has at least MOVED_MIN_ALNUM letters and
+// digits, so moved braces and blank lines alone do not count. Lines whose
+// text is deleted more than MOVED_MAX_CANDIDATES times (a lone "return 0;")
+// cannot start a block, only continue one.
+
+#define MOVED_NONE UINT32_MAX
+#define MOVED_MIN_ALNUM 20
+#define MOVED_MAX_CANDIDATES 32
+
+typedef enum {
+    MOVED_MARK_NONE = 0,
+    MOVED_MARK_BLOCK,     // Line of a moved block
+    MOVED_MARK_BLOCK_ALT  // Same, in a block that touches the previous one (drawn in another shade)
+} MovedMark;
+
+// Join running in the background, see moved_lines.c
+typedef struct MovedJob MovedJob;
+
+typedef struct {
+    const DiffData* data;   // Diff the arrays describe
+    // Hashes, owned by the calling thread
+    size_t hashed_files;    // Files 0 .. hashed_files - 1 are hashed
+    size_t hashed_lines;    // Lines covered by kinds, hashes and alnum
+    size_t hash_capacity;
+    uint8_t* kinds;         // Line type, plus a flag on the first line of a hunk
+    uint64_t* hashes;       // Hash of a changed line's text without whitespace, 0 = not hashed
+    uint8_t* alnum;         // Letters and digits of the line (saturated at 255)
+    int hashing;            // The last update ran out of budget before the last file
+    int pending;            // Hashes changed since the running join was started
+    MovedJob* job;          // Join in the background (NULL if none)
+    // Result of the last finished join; lines from line_count on are not marked yet
+    size_t line_count;
+    uint32_t* counterparts; // Matching line on the other side of a moved line, MOVED_NONE otherwise
+    uint8_t* marks;         // MovedMark of each line
+    size_t block_count;     // Moved blocks found by the last join
+    size_t moved_lines;     // Added lines in them
+} MovedLines;
+
+void moved_lines_init(MovedLines* moved);
+// Abandons a running join without waiting for it (it only reads its own copy)
+void moved_lines_destroy(MovedLines* moved);
+// Drops everything (call when the diff is replaced or reloaded)
+void moved_lines_clear(MovedLines* moved);
+// Hashes the next files of data it has not seen, publishes the result of a
+// finished join and starts a new one once every file is hashed and the
+// hashes changed since the last. Cheap when nothing changed. Returns 0 if
+// memory ran out.
+int moved_lines_update(MovedLines* moved, const DiffData* data);
+
+// Publishes a finished join; returns 1 once after new marks were published,
+// and while files are left to hash (the frame should be drawn again)
+int moved_lines_take_updates(MovedLines* moved);
+
+// Hashes the remaining files and blocks until the marks cover all of them
+// (tools and tests)
+void moved_lines_wait(MovedLines* moved);
+
+static inline MovedMark moved_lines_mark(const MovedLines* moved, size_t line) {
+    return line < moved->line_count ? (MovedMark)moved->marks[line] : MOVED_MARK_NONE;
+}
+
+// Line on the other side of a moved line (MOVED_NONE if it is not moved)
+static inline uint32_t moved_lines_counterpart(const MovedLines* moved, size_t line) {
+    return line < moved->line_count ? moved->counterparts[line] : MOVED_NONE;
+}
+
+// First line of a moved block: the line above belongs to another block or none
+static inline int moved_lines_block_start(const MovedLines* moved, size_t line) {
+    const uint32_t counterpart = moved_lines_counterpart(moved, line);
+    return counterpart != MOVED_NONE &&
+           (line == 0 || moved->marks[line - 1] != moved->marks[line] ||
+            moved->counterparts[line - 1] + 1 != counterpart);
+}
+
+size_t moved_lines_memory_usage(const MovedLines* moved);
+
+#endif // SEE_CODE_MOVED_LINES_H
@@ -0,0 +1,296 @@
+// src/data/source_file.c
+#include "see_code/data/source_file.h"
+#include "see_code/utils/logger.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// --- Чтение файла ---
+
+// Текст читается по мере надобности в свой буфер, а не отображается: файл,
+// который редактор укоротил и переписывает на месте, дал бы SIGBUS при чтении
+// отображения. Укороченный файл просто дочитывается до нового конца.
+#define SOURCE_READ_CHUNK (64 * 1024)
+
+static int64_t mtime_ns(const struct stat* st) {
+    return (int64_t)st->st_mtim.tv_sec * 1000000000 + st->st_mtim.tv_nsec;
+}
+
+// Открывает файл по file->path; прочитанный текст и индекс строк начинаются заново
+static int open_file(SourceFile* file) {
+    int fd = open(file->path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        log_warn("source_file: Failed to open %s: %s", file->path, strerror(errno));
+        return 0;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        log_warn("source_file: %s is not a regular file", file->path);
+        close(fd);
+        return 0;
+    }
+    if ((uint64_t)st.st_size > UINT32_MAX) {
+        // Смещения строк 32-битные, как и в таблице строк diff
+        log_warn("source_file: %s is too large (%lld bytes)", file->path, (long long)st.st_size);
+        close(fd);
+        return 0;
+    }
+    file->fd = fd;
+    file->size = (size_t)st.st_size;
+    file->loaded = 0;
+    file->inode = (uint64_t)st.st_ino;
+    file->mtime_ns = mtime_ns(&st);
+    file->line_count = 0;
+    file->scanned = 0;
+    return 1;
+}
+
+static void close_file(SourceFile* file) {
+    if (file->fd >= 0) {
+        close(file->fd);
+    }
+    file->fd = -1;
+    file->size = 0;
+    file->loaded = 0;
+    file->line_count = 0;
+    file->scanned = 0;
+}
+
+// Дочитывает файл хотя бы до end байт (или до конца). Буфер растет вдвое, чтобы
+// поиск строк не читал файл по кусочку. Если файл укоротили после открытия,
+// его размером становится прочитанное. Возвращает 0 при ошибке чтения.
+static int load_until(SourceFile* file, size_t end) {
+    if (end > file->size) end = file->size;
+    if (file->loaded >= end) {
+        return 1;
+    }
+    size_t target = file->loaded * 2;
+    if (target < end) target = end;
+    if (target < SOURCE_READ_CHUNK) target = SOURCE_READ_CHUNK;
+    if (target > file->size) target = file->size;
+    if (target > file->text_capacity) {
+        char* grown = realloc(file->text, target);
+        if (!grown) {
+            log_error("source_file: Failed to allocate %zu bytes for %s", target, file->path);
+            return 0;
+        }
+        file->text = grown;
+        file->text_capacity = target;
+    }
+    while (file->loaded < target) {
+        ssize_t n = pread(file->fd, file->text + file->loaded, target - file->loaded, (off_t)file->loaded);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            log_warn("source_file: Failed to read %s: %s", file->path, strerror(errno));
+            return 0;
+        }
+        if (n == 0) {
+            file->size = file->loaded;
+            break;
+        }
+        file->loaded += (size_t)n;
+    }
+    return 1;
+}
+
+// Смещение перевода строки, начиная с from (file->size, если его нет до конца
+// файла; SIZE_MAX при ошибке чтения)
+static size_t find_newline(SourceFile* file, size_t from) {
+    for (;;) {
+        const char* newline = from < file->loaded ? memchr(file->text + from, '\n', file->loaded - from) : NULL;
+        if (newline) {
+            return (size_t)(newline - file->text);
+        }
+        if (file->loaded >= file->size) {
+            return file->size;
+        }
+        if (from < file->loaded) from = file->loaded;
+        if (!load_until(file, file->loaded + 1)) {
+            return SIZE_MAX;
+        }
+    }
+}
+
+int source_file_open(SourceFile* file, const char* path) {
+    if (!file || !path) {
+        return 0;
+    }
+    memset(file, 0, sizeof(SourceFile));
+    file->fd = -1;
+    file->path = strdup(path);
+    if (!file->path) {
+        log_error("source_file: Failed to copy path %s", path);
+        return 0;
+    }
+    if (!open_file(file)) {
+        source_file_close(file);
+        return 0;
+    }
+    return 1;
+}
+
+void source_file_close(SourceFile* file) {
+    if (!file) {
+        return;
+    }
+    close_file(file);
+    free(file->path);
+    free(file->text);
+    free(file->line_starts);
+    memset(file, 0, sizeof(SourceFile));
+    file->fd = -1;
+}
+
+int source_file_refresh(SourceFile* file) {
+    if (!file || !file->path) {
+        return 0;
+    }
+    struct stat st;
+    if (stat(file->path, &st) != 0) {
+        close_file(file);
+        return 0;
+    }
+    if (file->fd >= 0 && (uint64_t)st.st_ino == file->inode && (size_t)st.st_size == file->size &&
+        mtime_ns(&st) == file->mtime_ns) {
+        return 1;
+    }
+    log_debug("source_file: %s changed on disk, reading it again", file->path);
+    close_file(file);
+    return open_file(file);
+}
+
+// --- Индекс строк ---
+
+// Дописывает начала строк, пока не проиндексирована строка number или не кончится файл
+static int index_lines(SourceFile* file, size_t number) {
+    while (file->line_count < number) {
+        if (file->line_count > 0 && file->scanned >= file->size) {
+            return 0; // Файл кончился
+        }
+        if (file->line_count == file->line_capacity) {
+            size_t capacity = file->line_capacity ? file->line_capacity * 2 : 1024;
+            uint32_t* grown = realloc(file->line_starts, capacity * sizeof(uint32_t));
+            if (!grown) {
+                log_error("source_file: Failed to grow line index of %s", file->path);
+                return 0;
+            }
+            file->line_starts = grown;
+            file->line_capacity = capacity;
+        }
+        if (file->line_count == 0) {
+            if (file->size == 0) {
+                return 0;
+            }
+            file->line_starts[file->line_count++] = 0;
+            continue;
+        }
+        const size_t newline = find_newline(file, file->scanned);
+        if (newline == SIZE_MAX) {
+            return 0; // Ошибка чтения: попробуем снова при следующем запросе
+        }
+        if (newline + 1 >= file->size) {
+            // Последняя строка (с завершающим '\n' или без него)
+            file->scanned = file->size;
+            return 0;
+        }
+        file->scanned = newline + 1;
+        file->line_starts[file->line_count++] = (uint32_t)file->scanned;
+    }
+    return 1;
+}
+
+int source_file_line(SourceFile* file, uint32_t number, const char** text, size_t* length) {
+    if (!file || file->fd < 0 || number == 0 || !index_lines(file, number)) {
+        return 0;
+    }
+    const size_t start = file->line_starts[number - 1];
+    const size_t end = find_newline(file, start);
+    if (end == SIZE_MAX || start > end) {
+        return 0;
+    }
+    // Указатель берется после чтения: буфер мог переехать
+    *text = file->text + start;
+    *length = end - start;
+    return 1;
+}
+
+// --- Кэш файлов вида ---
+
+void source_file_cache_init(SourceFileCache* cache) {
+    if (!cache) {
+        return;
+    }
+    memset(cache, 0, sizeof(SourceFileCache));
+}
+
+void source_file_cache_clear(SourceFileCache* cache) {
+    if (!cache) {
+        return;
+    }
+    for (size_t i = 0; i < SOURCE_FILE_CACHE_SIZE; i++) {
+        if (cache->entries[i].is_open) {
+            source_file_close(&cache->entries[i].source);
+        }
+    }
+    memset(cache, 0, sizeof(SourceFileCache));
+}
+
+void source_file_cache_destroy(SourceFileCache* cache) {
+    source_file_cache_clear(cache);
+}
+
+SourceFile* source_file_cache_get(SourceFileCache* cache, const DiffData* data, size_t file, const char* root) {
+    if (!cache || !data || file >= data->file_count || data->files[file].path.length == 0) {
+        return NULL;
+    }
+    if (cache->data != data) {
+        source_file_cache_clear(cache);
+        cache->data = data;
+    }
+    size_t victim = 0;
+    for (size_t i = 0; i < SOURCE_FILE_CACHE_SIZE; i++) {
+        if (cache->entries[i].is_open && cache->entries[i].file == file) {
+            cache->entries[i].last_used = ++cache->clock;
+            return source_file_refresh(&cache->entries[i].source) ? &cache->entries[i].source : NULL;
+        }
+        if (!cache->entries[i].is_open ||
+            (cache->entries[victim].is_open && cache->entries[i].last_used < cache->entries[victim].last_used)) {
+            victim = i;
+        }
+    }
+
+    // Путь в diff относительно корня рабочего дерева
+    const DiffSpan span = data->files[file].path;
+    char path[4096];
+    int written = root && root[0] ? snprintf(path, sizeof(path), "%s/%.*s", root, (int)span.length, diff_data_span_ptr(data, span))
+                                  : snprintf(path, sizeof(path), "%.*s", (int)span.length, diff_data_span_ptr(data, span));
+    if (written < 0 || (size_t)written >= sizeof(path)) {
+        log_warn("source_file: Path of file %zu is too long", file);
+        return NULL;
+    }
+    if (cache->entries[victim].is_open) {
+        source_file_close(&cache->entries[victim].source);
+        cache->entries[victim].is_open = 0;
+    }
+    if (!source_file_open(&cache->entries[victim].source, path)) {
+        return NULL;
+    }
+    cache->entries[victim].is_open = 1;
+    cache->entries[victim].file = file;
+    cache->entries[victim].last_used = ++cache->clock;
+    return &cache->entries[victim].source;
+}
+
+size_t source_file_cache_memory_usage(const SourceFileCache* cache) {
+    size_t bytes = 0;
+    for (size_t i = 0; cache && i < SOURCE_FILE_CACHE_SIZE; i++) {
+        if (cache->entries[i].is_open) {
+            bytes += cache->entries[i].source.text_capacity + cache->entries[i].source.line_capacity * sizeof(uint32_t);
+        }
+    }
+    return bytes;
+}
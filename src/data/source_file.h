@@ -0,0 +1,71 @@
+// src/data/source_file.h
+#ifndef SEE_CODE_SOURCE_FILE_H
+#define SEE_CODE_SOURCE_FILE_H
+
+#include "see_code/data/diff_data.h"
+#include <stddef.h>
+#include <stdint.h>
+
+// A working-tree file, for showing context lines that the diff does not
+// contain. The text is read with pread() into an owned buffer as far as it is
+// needed (not mapped: an editor truncating the file in place would turn reads
+// of a mapping into SIGBUS). Line starts are indexed lazily: asking for line
+// n reads and scans the file only up to line n, and only the first time.
+typedef struct {
+    char* path;
+    int fd;                // Open file (-1 after it could not be read again)
+    char* text;            // First `loaded` bytes of the file
+    size_t loaded;
+    size_t text_capacity;
+    size_t size;           // Size when opened (less if it turned out truncated)
+    // Identity of the opened version, to notice the file changing on disk
+    uint64_t inode;
+    int64_t mtime_ns;
+    uint32_t* line_starts; // line_starts[i] is the offset of line i + 1
+    size_t line_count;     // Lines indexed so far
+    size_t line_capacity;
+    size_t scanned;        // Bytes already searched for newlines
+} SourceFile;
+
+// Opens the file at path. Returns 1 on success, 0 on failure (file is then
+// left empty).
+int source_file_open(SourceFile* file, const char* path);
+void source_file_close(SourceFile* file);
+
+// Opens the file again if it was modified or replaced since it was opened,
+// dropping the text read so far. Returns 0 if it can no longer be read.
+int source_file_refresh(SourceFile* file);
+
+// Line number (1-based) without its line break, valid until the next call.
+// Returns 0 if the file has fewer lines.
+int source_file_line(SourceFile* file, uint32_t number, const char** text, size_t* length);
+
+// Open working-tree files of the diff shown in a view, at most
+// SOURCE_FILE_CACHE_SIZE at a time (least recently used ones are closed).
+#define SOURCE_FILE_CACHE_SIZE 8
+
+typedef struct {
+    const DiffData* data; // Diff the file indices refer to
+    struct {
+        size_t file;      // Index in data->files
+        uint64_t last_used;
+        int is_open;
+        SourceFile source;
+    } entries[SOURCE_FILE_CACHE_SIZE];
+    uint64_t clock;
+} SourceFileCache;
+
+void source_file_cache_init(SourceFileCache* cache);
+void source_file_cache_destroy(SourceFileCache* cache);
+// Closes every file (call when the diff is replaced)
+void source_file_cache_clear(SourceFileCache* cache);
+
+// Working-tree file of data->files[file], resolved against root (NULL means
+// the current directory) and opened on the first request. Returns NULL if
+// it cannot be read. The result stays valid until the next call.
+SourceFile* source_file_cache_get(SourceFileCache* cache, const DiffData* data, size_t file, const char* root);
+
+// Bytes of the text read so far and of the line indices
+size_t source_file_cache_memory_usage(const SourceFileCache* cache);
+
+#endif // SEE_CODE_SOURCE_FILE_H
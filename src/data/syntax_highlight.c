@@ -0,0 +1,822 @@
+// src/data/syntax_highlight.c
+#include "see_code/data/syntax_highlight.h"
+#include "see_code/data/diff_cold_store.h"
+#include "see_code/utils/logger.h"
+#include <stdlib.h>
+#include <string.h>
+
+// --- Языки ---
+
+typedef struct {
+    const char* name;
+    const char* const* extensions; // Заканчивается NULL
+    const char* const* keywords;   // Отсортированы по strcmp
+    size_t keyword_count;
+    const char* line_comment;      // NULL, если нет
+    const char* block_open;        // Многострочный комментарий, NULL если нет
+    const char* block_close;
+    int preprocessor;              // Директивы '#' в начале строки (C)
+    int triple_quotes;             // Строки """...""" и '''...''' (Python)
+    int template_strings;          // Строки `...` могут занимать несколько строк (JS)
+    int long_brackets;             // [[...]], [=[...]=] и --[[...]] (Lua)
+} SyntaxLanguage;
+
+#define COUNT_OF(array) (sizeof(array) / sizeof((array)[0]))
+
+static const char* const C_EXTENSIONS[] = { "c", "h", "cc", "cpp", "cxx", "c++", "hh", "hpp", "hxx", "inl", NULL };
+static const char* const C_KEYWORDS[] = {
+    "alignas", "alignof", "asm", "auto", "bool", "break", "case", "catch", "char", "char16_t",
+    "char32_t", "class", "const", "const_cast", "constexpr", "continue", "decltype", "default",
+    "delete", "do", "double", "dynamic_cast", "else", "enum", "explicit", "export", "extern",
+    "false", "float", "for", "friend", "goto", "if", "inline", "int", "long", "mutable",
+    "namespace", "new", "noexcept", "nullptr", "operator", "private", "protected", "public",
+    "register", "reinterpret_cast", "restrict", "return", "short", "signed", "sizeof", "static",
+    "static_assert", "static_cast", "struct", "switch", "template", "this", "throw", "true",
+    "try", "typedef", "typeid", "typename", "union", "unsigned", "using", "virtual", "void",
+    "volatile", "wchar_t", "while"
+};
+
+static const char* const LUA_EXTENSIONS[] = { "lua", NULL };
+static const char* const LUA_KEYWORDS[] = {
+    "and", "break", "do", "else", "elseif", "end", "false", "for", "function", "goto", "if",
+    "in", "local", "nil", "not", "or", "repeat", "return", "then", "true", "until", "while"
+};
+
+static const char* const PYTHON_EXTENSIONS[] = { "py", "pyw", "pyi", NULL };
+static const char* const PYTHON_KEYWORDS[] = {
+    "False", "None", "True", "and", "as", "assert", "async", "await", "break", "class",
+    "continue", "def", "del", "elif", "else", "except", "finally", "for", "from", "global",
+    "if", "import", "in", "is", "lambda", "nonlocal", "not", "or", "pass", "raise", "return",
+    "try", "while", "with", "yield"
+};
+
+static const char* const JS_EXTENSIONS[] = { "js", "mjs", "cjs", "jsx", "ts", "tsx", NULL };
+static const char* const JS_KEYWORDS[] = {
+    "async", "await", "break", "case", "catch", "class", "const", "continue", "debugger",
+    "default", "delete", "do", "else", "export", "extends", "false", "finally", "for",
+    "function", "if", "import", "in", "instanceof", "let", "new", "null", "of", "return",
+    "static", "super", "switch", "this", "throw", "true", "try", "typeof", "undefined", "var",
+    "void", "while", "with", "yield"
+};
+
+static const SyntaxLanguage LANGUAGES[] = {
+    { "c", C_EXTENSIONS, C_KEYWORDS, COUNT_OF(C_KEYWORDS), "//", "/*", "*/", 1, 0, 0, 0 },
+    { "lua", LUA_EXTENSIONS, LUA_KEYWORDS, COUNT_OF(LUA_KEYWORDS), "--", NULL, NULL, 0, 0, 0, 1 },
+    { "python", PYTHON_EXTENSIONS, PYTHON_KEYWORDS, COUNT_OF(PYTHON_KEYWORDS), "#", NULL, NULL, 0, 1, 0, 0 },
+    { "javascript", JS_EXTENSIONS, JS_KEYWORDS, COUNT_OF(JS_KEYWORDS), "//", "/*", "*/", 0, 0, 1, 0 },
+};
+
+// Язык по расширению пути (без учета регистра)
+static const SyntaxLanguage* language_for_path(const char* path, size_t length) {
+    size_t dot = length;
+    for (size_t i = length; i > 0; i--) {
+        if (path[i - 1] == '.') {
+            dot = i - 1;
+            break;
+        }
+        if (path[i - 1] == '/') {
+            break;
+        }
+    }
+    size_t extension_length = length - dot - (dot < length ? 1 : 0);
+    char extension[8];
+    if (dot == length || extension_length == 0 || extension_length >= sizeof(extension)) {
+        return NULL;
+    }
+    for (size_t i = 0; i < extension_length; i++) {
+        char c = path[dot + 1 + i];
+        extension[i] = (c >= 'A' && c <= 'Z') ? (char)(c - 'A' + 'a') : c;
+    }
+    extension[extension_length] = '\0';
+    for (size_t l = 0; l < COUNT_OF(LANGUAGES); l++) {
+        for (const char* const* e = LANGUAGES[l].extensions; *e; e++) {
+            if (strcmp(*e, extension) == 0) {
+                return &LANGUAGES[l];
+            }
+        }
+    }
+    return NULL;
+}
+
+static int is_keyword(const SyntaxLanguage* language, const char* word, size_t length) {
+    size_t lo = 0, hi = language->keyword_count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        const char* keyword = language->keywords[mid];
+        int cmp = strncmp(word, keyword, length);
+        if (cmp == 0 && keyword[length] != '\0') cmp = -1; // word - собственный префикс keyword
+        if (cmp == 0) return 1;
+        if (cmp < 0) hi = mid; else lo = mid + 1;
+    }
+    return 0;
+}
+
+// --- Токенизация строки ---
+
+// Многострочная конструкция, в которой заканчивается строка
+enum {
+    MODE_NORMAL = 0,
+    MODE_BLOCK_COMMENT,   // /* ... */
+    MODE_LONG_COMMENT,    // --[[ ... ]] (level - число '=')
+    MODE_LONG_STRING,     // [[ ... ]]
+    MODE_TRIPLE_DOUBLE,   // """ ... """
+    MODE_TRIPLE_SINGLE,   // ''' ... '''
+    MODE_TEMPLATE         // ` ... `
+};
+
+typedef struct {
+    uint8_t mode;
+    uint8_t level;
+} LineState;
+
+// Рабочие буферы потока подсветки, переиспользуются между ханками
+typedef struct {
+    SyntaxSpan* spans;
+    size_t count;
+    size_t capacity;
+    int failed;
+} SpanBuffer;
+
+static void emit_span(SpanBuffer* buffer, size_t start, size_t length, SyntaxKind kind) {
+    if (!buffer || length == 0 || buffer->failed) {
+        return;
+    }
+    if (buffer->count == buffer->capacity) {
+        size_t new_capacity = buffer->capacity ? buffer->capacity * 2 : 1024;
+        SyntaxSpan* spans = realloc(buffer->spans, new_capacity * sizeof(SyntaxSpan));
+        if (!spans) {
+            log_error("syntax_highlight: Failed to grow span buffer to %zu entries", new_capacity);
+            buffer->failed = 1;
+            return;
+        }
+        buffer->spans = spans;
+        buffer->capacity = new_capacity;
+    }
+    SyntaxSpan* span = &buffer->spans[buffer->count++];
+    span->start = (uint32_t)start;
+    span->length = (uint32_t)length;
+    span->kind = kind;
+}
+
+static int is_ident_start(unsigned char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_' || c == '$' || c >= 0x80;
+}
+
+static int is_ident_byte(unsigned char c) {
+    return is_ident_start(c) || (c >= '0' && c <= '9');
+}
+
+static int is_digit(unsigned char c) {
+    return c >= '0' && c <= '9';
+}
+
+static int starts_with(const char* text, size_t length, size_t i, const char* prefix) {
+    size_t n = strlen(prefix);
+    return length - i >= n && memcmp(text + i, prefix, n) == 0;
+}
+
+// Позиция сразу за закрывающей последовательностью или length, если ее нет
+// (*closed = 0). Символы после '\' пропускаются, если escapes установлен.
+static size_t find_close(const char* text, size_t length, size_t i, const char* close, int escapes, int* closed) {
+    size_t n = strlen(close);
+    for (; i < length; i++) {
+        if (escapes && text[i] == '\\') {
+            i++;
+            continue;
+        }
+        if (text[i] == close[0] && length - i >= n && memcmp(text + i, close, n) == 0) {
+            *closed = 1;
+            return i + n;
+        }
+    }
+    *closed = 0;
+    return length;
+}
+
+// Закрывающая скобка Lua "]" "="*level "]"
+static size_t find_long_close(const char* text, size_t length, size_t i, unsigned level, int* closed) {
+    for (; i < length; i++) {
+        if (text[i] != ']') {
+            continue;
+        }
+        size_t j = i + 1;
+        unsigned equals = 0;
+        while (j < length && text[j] == '=') {
+            j++;
+            equals++;
+        }
+        if (equals == level && j < length && text[j] == ']') {
+            *closed = 1;
+            return j + 1;
+        }
+    }
+    *closed = 0;
+    return length;
+}
+
+// Открывающая скобка Lua "[" "="* "[" в позиции i: длина и уровень, 0 если ее нет
+static size_t long_open(const char* text, size_t length, size_t i, unsigned* level) {
+    if (i >= length || text[i] != '[') {
+        return 0;
+    }
+    size_t j = i + 1;
+    unsigned equals = 0;
+    while (j < length && text[j] == '=') {
+        j++;
+        equals++;
+    }
+    if (j >= length || text[j] != '[' || equals > 255) {
+        return 0;
+    }
+    *level = equals;
+    return j + 1 - i;
+}
+
+// Продолжение многострочной конструкции с начала строки; возвращает позицию за ней
+static size_t continue_state(const char* text, size_t length, LineState* state, SpanBuffer* spans) {
+    int closed = 0;
+    size_t end = length;
+    SyntaxKind kind = SYNTAX_STRING;
+    switch (state->mode) {
+        case MODE_BLOCK_COMMENT:
+            end = find_close(text, length, 0, "*/", 0, &closed);
+            kind = SYNTAX_COMMENT;
+            break;
+        case MODE_LONG_COMMENT:
+            end = find_long_close(text, length, 0, state->level, &closed);
+            kind = SYNTAX_COMMENT;
+            break;
+        case MODE_LONG_STRING:
+            end = find_long_close(text, length, 0, state->level, &closed);
+            break;
+        case MODE_TRIPLE_DOUBLE:
+            end = find_close(text, length, 0, "\"\"\"", 1, &closed);
+            break;
+        case MODE_TRIPLE_SINGLE:
+            end = find_close(text, length, 0, "'''", 1, &closed);
+            break;
+        case MODE_TEMPLATE:
+            end = find_close(text, length, 0, "`", 1, &closed);
+            break;
+        default:
+            return 0;
+    }
+    emit_span(spans, 0, end, kind);
+    if (closed) {
+        state->mode = MODE_NORMAL;
+        state->level = 0;
+    }
+    return end;
+}
+
+// Раскрашивает одну строку; state переходит в состояние на конце строки.
+// spans может быть NULL, тогда только отслеживается состояние.
+static void tokenize_line(const SyntaxLanguage* language, const char* text, size_t length,
+                          LineState* state, SpanBuffer* spans) {
+    size_t i = continue_state(text, length, state, spans);
+    int line_start = 1; // До первого непробельного символа
+    while (i < length) {
+        const unsigned char c = (unsigned char)text[i];
+        if (c == ' ' || c == '\t' || c == '\r') {
+            i++;
+            continue;
+        }
+        const int first_token = line_start;
+        line_start = 0;
+        int closed = 0;
+        size_t end;
+        unsigned level = 0;
+        size_t open = 0;
+
+        if (language->preprocessor && first_token && c == '#') {
+            // Подсвечивается только сама директива ("#include", "# define")
+            end = i + 1;
+            while (end < length && (text[end] == ' ' || text[end] == '\t')) end++;
+            while (end < length && is_ident_byte((unsigned char)text[end])) end++;
+            emit_span(spans, i, end - i, SYNTAX_PREPROCESSOR);
+            i = end;
+            continue;
+        }
+        if (language->long_brackets && starts_with(text, length, i, "--") &&
+            (open = long_open(text, length, i + 2, &level)) > 0) {
+            end = find_long_close(text, length, i + 2 + open, level, &closed);
+            emit_span(spans, i, end - i, SYNTAX_COMMENT);
+            if (!closed) {
+                state->mode = MODE_LONG_COMMENT;
+                state->level = (uint8_t)level;
+            }
+            i = end;
+            continue;
+        }
+        if (language->block_open && starts_with(text, length, i, language->block_open)) {
+            end = find_close(text, length, i + strlen(language->block_open), language->block_close, 0, &closed);
+            emit_span(spans, i, end - i, SYNTAX_COMMENT);
+            if (!closed) {
+                state->mode = MODE_BLOCK_COMMENT;
+            }
+            i = end;
+            continue;
+        }
+        if (language->line_comment && starts_with(text, length, i, language->line_comment)) {
+            emit_span(spans, i, length - i, SYNTAX_COMMENT);
+            return;
+        }
+        if (language->triple_quotes && (c == '"' || c == '\'') && length - i >= 3 &&
+            text[i + 1] == (char)c && text[i + 2] == (char)c) {
+            end = find_close(text, length, i + 3, c == '"' ? "\"\"\"" : "'''", 1, &closed);
+            emit_span(spans, i, end - i, SYNTAX_STRING);
+            if (!closed) {
+                state->mode = c == '"' ? MODE_TRIPLE_DOUBLE : MODE_TRIPLE_SINGLE;
+            }
+            i = end;
+            continue;
+        }
+        if (c == '"' || c == '\'' || (c == '`' && language->template_strings)) {
+            const char close[2] = { (char)c, '\0' };
+            // Незакрытая обычная строка кончается с концом строки
+            end = find_close(text, length, i + 1, close, 1, &closed);
+            emit_span(spans, i, end - i, SYNTAX_STRING);
+            if (!closed && c == '`') {
+                state->mode = MODE_TEMPLATE;
+            }
+            i = end;
+            continue;
+        }
+        if (language->long_brackets && (open = long_open(text, length, i, &level)) > 0) {
+            end = find_long_close(text, length, i + open, level, &closed);
+            emit_span(spans, i, end - i, SYNTAX_STRING);
+            if (!closed) {
+                state->mode = MODE_LONG_STRING;
+                state->level = (uint8_t)level;
+            }
+            i = end;
+            continue;
+        }
+        if (is_digit(c) || (c == '.' && i + 1 < length && is_digit((unsigned char)text[i + 1]))) {
+            // Целые, дробные, шестнадцатеричные числа с суффиксами и порядком ("1e-5", "0x1p+3")
+            end = i + 1;
+            while (end < length) {
+                const unsigned char d = (unsigned char)text[end];
+                if (is_ident_byte(d) || d == '.') {
+                    end++;
+                } else if ((d == '+' || d == '-') && (text[end - 1] == 'e' || text[end - 1] == 'E' ||
+                                                      text[end - 1] == 'p' || text[end - 1] == 'P')) {
+                    end++;
+                } else {
+                    break;
+                }
+            }
+            emit_span(spans, i, end - i, SYNTAX_NUMBER);
+            i = end;
+            continue;
+        }
+        if (is_ident_start(c)) {
+            end = i + 1;
+            while (end < length && is_ident_byte((unsigned char)text[end])) end++;
+            if (is_keyword(language, text + i, end - i)) {
+                emit_span(spans, i, end - i, SYNTAX_KEYWORD);
+            }
+            i = end;
+            continue;
+        }
+        i++;
+    }
+}
+
+// --- Задания потока подсветки ---
+
+struct SyntaxJob {
+    SyntaxJob* next;
+    size_t hunk;
+    size_t first_line;
+    size_t line_count;
+    uint64_t generation;
+    const SyntaxLanguage* language;
+    // Копия строк ханка: рабочий поток не читает DiffData
+    uint32_t* offsets;  // Начало строки (с маркером) в text
+    uint32_t* lengths;  // Длина строки с маркером
+    uint8_t* types;
+    char* text;
+};
+
+// Копирует строки ханка одним блоком. Строки ханка лежат в буфере подряд.
+static SyntaxJob* create_job(const DiffData* data, size_t hunk_index, const SyntaxLanguage* language,
+                             uint64_t generation) {
+    const DiffHunk* hunk = &data->hunks[hunk_index];
+    const DiffLineTable* table = &data->lines;
+    const size_t first = hunk->first_line;
+    const size_t last = first + hunk->line_count - 1;
+    const size_t base = table->offsets[first];
+    const size_t text_size = table->offsets[last] + table->lengths[last] - base;
+    const size_t size = sizeof(SyntaxJob) + hunk->line_count * (2 * sizeof(uint32_t) + 1) + text_size;
+    SyntaxJob* job = malloc(size);
+    if (!job) {
+        log_error("syntax_highlight: Failed to allocate %zu bytes for hunk %zu", size, hunk_index);
+        return NULL;
+    }
+    job->next = NULL;
+    job->hunk = hunk_index;
+    job->first_line = first;
+    job->line_count = hunk->line_count;
+    job->generation = generation;
+    job->language = language;
+    job->offsets = (uint32_t*)(job + 1);
+    job->lengths = job->offsets + hunk->line_count;
+    job->types = (uint8_t*)(job->lengths + hunk->line_count);
+    job->text = (char*)(job->types + hunk->line_count);
+    for (size_t k = 0; k < hunk->line_count; k++) {
+        job->offsets[k] = (uint32_t)(table->offsets[first + k] - base);
+    }
+    memcpy(job->lengths, table->lengths + first, hunk->line_count * sizeof(uint32_t));
+    memcpy(job->types, table->types + first, hunk->line_count);
+    // Ханк, запрошенный заранее, может лежать в еще сжатом блоке буфера
+    diff_cold_store_pin(data->cold, base, text_size);
+    memcpy(job->text, data->buffer + base, text_size);
+    diff_cold_store_unpin(data->cold, base, text_size);
+    return job;
+}
+
+static int same_state(LineState a, LineState b) {
+    return a.mode == b.mode && a.level == b.level;
+}
+
+// Раскрашивает ханк задания; старая и новая стороны diff ведут свои состояния
+static SyntaxHunk* highlight_job(const SyntaxJob* job, SpanBuffer* spans) {
+    const size_t line_count = job->line_count;
+    uint32_t* line_offsets = malloc((line_count + 1) * sizeof(uint32_t));
+    if (!line_offsets) {
+        log_error("syntax_highlight: Failed to allocate line offsets for hunk %zu", job->hunk);
+        return NULL;
+    }
+    spans->count = 0;
+    spans->failed = 0;
+    LineState old_state = { MODE_NORMAL, 0 };
+    LineState new_state = { MODE_NORMAL, 0 };
+    for (size_t k = 0; k < line_count; k++) {
+        line_offsets[k] = (uint32_t)spans->count;
+        const char* text = job->text + job->offsets[k] + 1;
+        const size_t length = job->lengths[k] > 0 ? job->lengths[k] - 1 : 0;
+        switch ((DiffLineType)job->types[k]) {
+            case LINE_TYPE_ADD:
+                tokenize_line(job->language, text, length, &new_state, spans);
+                break;
+            case LINE_TYPE_DELETE:
+                tokenize_line(job->language, text, length, &old_state, spans);
+                break;
+            default:
+                // Строка контекста раскрашивается по новой стороне; старая сторона
+                // (например, после удаленного "/*") продолжает свое состояние
+                if (!same_state(old_state, new_state)) {
+                    tokenize_line(job->language, text, length, &old_state, NULL);
+                    tokenize_line(job->language, text, length, &new_state, spans);
+                } else {
+                    tokenize_line(job->language, text, length, &new_state, spans);
+                    old_state = new_state;
+                }
+                break;
+        }
+    }
+    line_offsets[line_count] = (uint32_t)spans->count;
+    if (spans->failed) {
+        free(line_offsets);
+        return NULL;
+    }
+
+    // Один блок: заголовок, смещения по строкам и сами отрезки
+    const size_t size = sizeof(SyntaxHunk) + (line_count + 1) * sizeof(uint32_t) + spans->count * sizeof(SyntaxSpan);
+    SyntaxHunk* result = malloc(size);
+    if (!result) {
+        log_error("syntax_highlight: Failed to allocate %zu bytes for hunk %zu", size, job->hunk);
+        free(line_offsets);
+        return NULL;
+    }
+    memset(result, 0, sizeof(SyntaxHunk));
+    result->hunk = job->hunk;
+    result->first_line = job->first_line;
+    result->line_count = line_count;
+    result->bytes = size;
+    result->span_offsets = (uint32_t*)(result + 1);
+    result->spans = (SyntaxSpan*)(result->span_offsets + line_count + 1);
+    memcpy(result->span_offsets, line_offsets, (line_count + 1) * sizeof(uint32_t));
+    if (spans->count > 0) {
+        memcpy(result->spans, spans->spans, spans->count * sizeof(SyntaxSpan));
+    }
+    free(line_offsets);
+    return result;
+}
+
+static void* worker_main(void* arg) {
+    SyntaxCache* cache = arg;
+    SpanBuffer spans = { NULL, 0, 0, 0 };
+    pthread_mutex_lock(&cache->mutex);
+    while (!cache->stopping) {
+        SyntaxJob* job = cache->pending;
+        if (!job) {
+            pthread_cond_wait(&cache->wake, &cache->mutex);
+            continue;
+        }
+        // Последний запрос первым: он ближе всего к тому, что сейчас на экране
+        cache->pending = job->next;
+        cache->pending_count--;
+        cache->running = job;
+        pthread_mutex_unlock(&cache->mutex);
+
+        SyntaxHunk* result = highlight_job(job, &spans);
+
+        pthread_mutex_lock(&cache->mutex);
+        cache->running = NULL;
+        if (result && job->generation == cache->generation) {
+            result->bucket_next = cache->done;
+            cache->done = result;
+            cache->updated = 1;
+        } else {
+            free(result); // diff сменился, пока ханк раскрашивался
+        }
+        free(job);
+    }
+    pthread_mutex_unlock(&cache->mutex);
+    free(spans.spans);
+    return NULL;
+}
+
+// --- LRU-кэш ---
+
+static size_t bucket_of(size_t hunk) {
+    return hunk % SYNTAX_CACHE_BUCKETS;
+}
+
+static void lru_unlink(SyntaxCache* cache, SyntaxHunk* entry) {
+    if (entry->prev) entry->prev->next = entry->next; else cache->head = entry->next;
+    if (entry->next) entry->next->prev = entry->prev; else cache->tail = entry->prev;
+    entry->prev = NULL;
+    entry->next = NULL;
+}
+
+static void lru_push_front(SyntaxCache* cache, SyntaxHunk* entry) {
+    entry->prev = NULL;
+    entry->next = cache->head;
+    if (cache->head) cache->head->prev = entry; else cache->tail = entry;
+    cache->head = entry;
+}
+
+static void remove_entry(SyntaxCache* cache, SyntaxHunk* entry) {
+    SyntaxHunk** link = &cache->buckets[bucket_of(entry->hunk)];
+    while (*link != entry) link = &(*link)->bucket_next;
+    *link = entry->bucket_next;
+    lru_unlink(cache, entry);
+    cache->count--;
+    cache->bytes -= entry->bytes;
+    free(entry);
+}
+
+static SyntaxHunk* find_entry(SyntaxCache* cache, const DiffHunk* diff_hunk, size_t hunk) {
+    for (SyntaxHunk* entry = cache->buckets[bucket_of(hunk)]; entry; entry = entry->bucket_next) {
+        if (entry->hunk != hunk) {
+            continue;
+        }
+        if (entry->first_line != diff_hunk->first_line || entry->line_count != diff_hunk->line_count) {
+            // Ханк с этим номером уже другой (diff перезагружен без очистки кэша)
+            remove_entry(cache, entry);
+            return NULL;
+        }
+        return entry;
+    }
+    return NULL;
+}
+
+// Переносит готовые ханки рабочего потока в LRU и укладывается в бюджет памяти
+static void collect_done(SyntaxCache* cache) {
+    pthread_mutex_lock(&cache->mutex);
+    SyntaxHunk* done = cache->done;
+    cache->done = NULL;
+    pthread_mutex_unlock(&cache->mutex);
+    while (done) {
+        SyntaxHunk* entry = done;
+        done = entry->bucket_next;
+        const DiffHunk* diff_hunk = entry->hunk < cache->data->hunk_count ? &cache->data->hunks[entry->hunk] : NULL;
+        if (!diff_hunk || find_entry(cache, diff_hunk, entry->hunk)) {
+            free(entry); // Ханка уже нет или он раскрашен повторно
+            continue;
+        }
+        entry->bucket_next = cache->buckets[bucket_of(entry->hunk)];
+        cache->buckets[bucket_of(entry->hunk)] = entry;
+        lru_push_front(cache, entry);
+        cache->count++;
+        cache->bytes += entry->bytes;
+    }
+    while (cache->bytes > SYNTAX_CACHE_BUDGET && cache->count > 1) {
+        remove_entry(cache, cache->tail);
+    }
+}
+
+static void free_jobs(SyntaxJob* job) {
+    while (job) {
+        SyntaxJob* next = job->next;
+        free(job);
+        job = next;
+    }
+}
+
+int syntax_cache_init(SyntaxCache* cache) {
+    if (!cache) {
+        return 0;
+    }
+    memset(cache, 0, sizeof(SyntaxCache));
+    if (pthread_mutex_init(&cache->mutex, NULL) != 0) {
+        log_error("syntax_highlight: Failed to initialize mutex");
+        return 0;
+    }
+    if (pthread_cond_init(&cache->wake, NULL) != 0) {
+        log_error("syntax_highlight: Failed to initialize condition variable");
+        pthread_mutex_destroy(&cache->mutex);
+        return 0;
+    }
+    if (pthread_create(&cache->thread, NULL, worker_main, cache) != 0) {
+        log_error("syntax_highlight: Failed to start worker thread");
+        pthread_cond_destroy(&cache->wake);
+        pthread_mutex_destroy(&cache->mutex);
+        return 0;
+    }
+    return 1;
+}
+
+// Выбрасывает очередь и готовые, но не собранные ханки
+static void drop_jobs(SyntaxCache* cache) {
+    pthread_mutex_lock(&cache->mutex);
+    SyntaxJob* pending = cache->pending;
+    SyntaxHunk* done = cache->done;
+    cache->pending = NULL;
+    cache->pending_count = 0;
+    cache->done = NULL;
+    cache->generation++; // Результат задания, которое сейчас выполняется, будет выброшен
+    pthread_mutex_unlock(&cache->mutex);
+    free_jobs(pending);
+    while (done) {
+        SyntaxHunk* next = done->bucket_next;
+        free(done);
+        done = next;
+    }
+}
+
+void syntax_cache_clear(SyntaxCache* cache) {
+    if (!cache) {
+        return;
+    }
+    drop_jobs(cache);
+    while (cache->head) {
+        SyntaxHunk* entry = cache->head;
+        cache->head = entry->next;
+        free(entry);
+    }
+    memset(cache->buckets, 0, sizeof(cache->buckets));
+    cache->tail = NULL;
+    cache->count = 0;
+    cache->bytes = 0;
+    cache->data = NULL;
+}
+
+void syntax_cache_remap(SyntaxCache* cache, const DiffData* previous, const DiffData* data) {
+    if (!cache) {
+        return;
+    }
+    if (cache->data != previous || !previous || !data) {
+        syntax_cache_clear(cache);
+        return;
+    }
+    // Задания ссылаются на старые номера ханков; нужные ханки запросятся снова
+    drop_jobs(cache);
+    memset(cache->buckets, 0, sizeof(cache->buckets));
+    SyntaxHunk* entry = cache->head;
+    while (entry) {
+        SyntaxHunk* next = entry->next;
+        const size_t hunk = diff_data_reused_hunk(data, previous, entry->hunk);
+        if (hunk == DIFF_NOT_REUSED) {
+            lru_unlink(cache, entry);
+            cache->count--;
+            cache->bytes -= entry->bytes;
+            free(entry);
+        } else {
+            entry->hunk = hunk;
+            entry->first_line = data->hunks[hunk].first_line;
+            entry->bucket_next = cache->buckets[bucket_of(hunk)];
+            cache->buckets[bucket_of(hunk)] = entry;
+        }
+        entry = next;
+    }
+    cache->data = data;
+}
+
+void syntax_cache_destroy(SyntaxCache* cache) {
+    if (!cache) {
+        return;
+    }
+    pthread_mutex_lock(&cache->mutex);
+    cache->stopping = 1;
+    pthread_cond_signal(&cache->wake);
+    pthread_mutex_unlock(&cache->mutex);
+    pthread_join(cache->thread, NULL);
+    syntax_cache_clear(cache);
+    pthread_cond_destroy(&cache->wake);
+    pthread_mutex_destroy(&cache->mutex);
+}
+
+// Язык файла, которому принадлежит ханк
+static const SyntaxLanguage* language_of_hunk(const DiffData* data, size_t hunk) {
+    // Последний файл, начинающийся не позже ханка (у файлов без ханков first_hunk
+    // совпадает с first_hunk следующего файла)
+    size_t lo = 0, hi = data->file_count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (data->files[mid].first_hunk <= hunk) lo = mid + 1; else hi = mid;
+    }
+    if (lo == 0) {
+        return NULL;
+    }
+    const DiffFile* file = &data->files[lo - 1];
+    if (hunk >= file->first_hunk + file->hunk_count) {
+        return NULL;
+    }
+    diff_cold_store_pin(data->cold, file->path.offset, file->path.length);
+    const SyntaxLanguage* language = language_for_path(diff_data_span_ptr(data, file->path), file->path.length);
+    diff_cold_store_unpin(data->cold, file->path.offset, file->path.length);
+    return language;
+}
+
+// Ставит ханк в очередь, если его там еще нет и он сейчас не раскрашивается
+static void request_hunk(SyntaxCache* cache, const DiffData* data, size_t hunk, const SyntaxLanguage* language) {
+    pthread_mutex_lock(&cache->mutex);
+    int queued = cache->running && cache->running->hunk == hunk && cache->running->generation == cache->generation;
+    for (SyntaxJob* job = cache->pending; job && !queued; job = job->next) {
+        queued = job->hunk == hunk;
+    }
+    const uint64_t generation = cache->generation;
+    pthread_mutex_unlock(&cache->mutex);
+    if (queued) {
+        return;
+    }
+    // Копия строк снимается без блокировки, рабочий поток ее не ждет
+    SyntaxJob* job = create_job(data, hunk, language, generation);
+    if (!job) {
+        return;
+    }
+    SyntaxJob* dropped = NULL;
+    pthread_mutex_lock(&cache->mutex);
+    job->next = cache->pending;
+    cache->pending = job;
+    cache->pending_count++;
+    if (cache->pending_count > SYNTAX_MAX_PENDING) {
+        // Самый старый запрос уже, скорее всего, ушел с экрана
+        SyntaxJob** link = &cache->pending;
+        while ((*link)->next) link = &(*link)->next;
+        dropped = *link;
+        *link = NULL;
+        cache->pending_count--;
+    }
+    pthread_cond_signal(&cache->wake);
+    pthread_mutex_unlock(&cache->mutex);
+    free(dropped);
+}
+
+const SyntaxHunk* syntax_cache_get(SyntaxCache* cache, const DiffData* data, size_t hunk) {
+    if (!cache || !data || hunk >= data->hunk_count) {
+        return NULL;
+    }
+    if (cache->data != data) {
+        syntax_cache_clear(cache);
+        cache->data = data;
+    }
+    const DiffHunk* diff_hunk = &data->hunks[hunk];
+    SyntaxHunk* entry = find_entry(cache, diff_hunk, hunk);
+    if (!entry) {
+        const SyntaxLanguage* language = language_of_hunk(data, hunk);
+        if (!language || diff_hunk->line_count == 0) {
+            return NULL;
+        }
+        const size_t last = diff_hunk->first_line + diff_hunk->line_count - 1;
+        const size_t hunk_bytes = data->lines.offsets[last] + data->lines.lengths[last] -
+                                  data->lines.offsets[diff_hunk->first_line];
+        if (hunk_bytes > SYNTAX_MAX_HUNK_BYTES) {
+            return NULL;
+        }
+        collect_done(cache);
+        entry = find_entry(cache, diff_hunk, hunk);
+        if (!entry) {
+            request_hunk(cache, data, hunk, language);
+            return NULL;
+        }
+    }
+    lru_unlink(cache, entry);
+    lru_push_front(cache, entry);
+    return entry;
+}
+
+int syntax_cache_take_updates(SyntaxCache* cache) {
+    if (!cache) {
+        return 0;
+    }
+    pthread_mutex_lock(&cache->mutex);
+    int updated = cache->updated;
+    cache->updated = 0;
+    pthread_mutex_unlock(&cache->mutex);
+    return updated;
+}
@@ -0,0 +1,115 @@
+// src/data/syntax_highlight.h
+#ifndef SEE_CODE_SYNTAX_HIGHLIGHT_H
+#define SEE_CODE_SYNTAX_HIGHLIGHT_H
+
+#include "see_code/data/diff_data.h"
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Syntax colouring of diff lines.
+//
+// The language of a file is picked by the extension of DiffFile.path
+// (C/C++, Lua, Python, JavaScript). A hunk is tokenized as a whole so that
+// block comments and multi-line strings carry over from line to line; the
+// old side (context and '-' lines) and the new side (context and '+' lines)
+// keep separate states. A hunk is assumed to start outside any comment or
+// string, since the text above it is not part of the diff.
+//
+// Hunks are tokenized on a background thread. syntax_cache_get() never
+// waits: a hunk that is not ready yet is queued (the most recent request is
+// served first, old ones are dropped when the queue is full) and drawn plain
+// until syntax_cache_take_updates() reports that its spans arrived. The
+// worker gets a copy of the hunk's text, so the diff may change at any time;
+// call syntax_cache_clear() when it does.
+//
+// Finished hunks are kept in an LRU bounded by SYNTAX_CACHE_BUDGET bytes.
+
+typedef enum {
+    SYNTAX_PLAIN = 0,
+    SYNTAX_KEYWORD,
+    SYNTAX_STRING,
+    SYNTAX_NUMBER,
+    SYNTAX_COMMENT,
+    SYNTAX_PREPROCESSOR
+} SyntaxKind;
+
+// Coloured bytes of a line, relative to the first byte after the marker.
+// Bytes outside every span are SYNTAX_PLAIN.
+typedef struct {
+    uint32_t start;
+    uint32_t length;
+    uint32_t kind; // SyntaxKind
+} SyntaxSpan;
+
+// Memory the cached hunks may take, in bytes
+#define SYNTAX_CACHE_BUDGET (4 * 1024 * 1024)
+// Requests waiting for the worker; the oldest one is dropped beyond this
+#define SYNTAX_MAX_PENDING 16
+// Larger hunks are not highlighted (their copy and spans would not pay off)
+#define SYNTAX_MAX_HUNK_BYTES (1024 * 1024)
+#define SYNTAX_CACHE_BUCKETS 256
+
+typedef struct SyntaxHunk {
+    size_t hunk;           // Index in DiffData.hunks
+    size_t first_line;     // Copy of the hunk's rows, to detect a replaced diff
+    size_t line_count;
+    size_t bytes;          // Memory charged against the budget
+    // Spans of line k of the hunk are spans[span_offsets[k] .. span_offsets[k + 1])
+    uint32_t* span_offsets;
+    SyntaxSpan* spans;
+    // LRU list (most recent first) and hash bucket chain
+    struct SyntaxHunk* prev;
+    struct SyntaxHunk* next;
+    struct SyntaxHunk* bucket_next;
+} SyntaxHunk;
+
+typedef struct SyntaxJob SyntaxJob;
+
+typedef struct {
+    // Owned by the thread calling syntax_cache_get()
+    const DiffData* data;  // Diff the cached hunks belong to
+    SyntaxHunk* buckets[SYNTAX_CACHE_BUCKETS];
+    SyntaxHunk* head;      // Most recently used
+    SyntaxHunk* tail;      // Evicted first
+    size_t count;
+    size_t bytes;
+    // Shared with the worker, under mutex
+    pthread_mutex_t mutex;
+    pthread_cond_t wake;
+    pthread_t thread;
+    SyntaxJob* pending;    // Newest first
+    size_t pending_count;
+    SyntaxJob* running;    // Job the worker is tokenizing
+    SyntaxHunk* done;      // Finished hunks not yet moved into the LRU
+    uint64_t generation;   // Bumped by syntax_cache_clear(), older results are dropped
+    int updated;
+    int stopping;
+} SyntaxCache;
+
+// Starts the worker thread. Returns 1 on success, 0 on failure.
+int syntax_cache_init(SyntaxCache* cache);
+// Stops the worker and frees everything
+void syntax_cache_destroy(SyntaxCache* cache);
+// Drops every cached and queued hunk (call when the diff is replaced or reloaded)
+void syntax_cache_clear(SyntaxCache* cache);
+// Keeps the highlighted hunks of files that data, reloaded from previous,
+// copied unchanged (under their new indices) and drops everything else
+void syntax_cache_remap(SyntaxCache* cache, const DiffData* previous, const DiffData* data);
+
+// Returns the spans of a hunk if they are ready, otherwise queues the hunk
+// for the worker and returns NULL. Also returns NULL for hunks of files in an
+// unknown language. The result stays valid until the next call on the same
+// cache.
+const SyntaxHunk* syntax_cache_get(SyntaxCache* cache, const DiffData* data, size_t hunk);
+
+// Returns 1 once after the worker finished hunks since the last call
+int syntax_cache_take_updates(SyntaxCache* cache);
+
+// Spans of line k of the hunk (k is relative to hunk->first_line)
+static inline const SyntaxSpan* syntax_hunk_line_spans(const SyntaxHunk* hunk, size_t k, size_t* count) {
+    *count = hunk->span_offsets[k + 1] - hunk->span_offsets[k];
+    return hunk->spans + hunk->span_offsets[k];
+}
+
+#endif // SEE_CODE_SYNTAX_HIGHLIGHT_H
@@ -0,0 +1,307 @@
+// src/gui/layout_index.c
+#include "see_code/gui/layout_index.h"
+#include "see_code/core/config.h" // Для констант разметки
+#include "see_code/utils/logger.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Смещение первого ханка от верха блока файла (заголовок файла и отступ под ним)
+#define FILE_BODY_OFFSET ((double)FILE_HEADER_HEIGHT + MARGIN)
+
+// --- Дерево Фенвика ---
+// Позиции 1..count хранятся в tree[0..count-1]
+
+static size_t lowest_bit(size_t pos) {
+    return pos & (~pos + 1);
+}
+
+static void fenwick_add(double* tree, size_t count, size_t element, double delta) {
+    for (size_t pos = element + 1; pos <= count; pos += lowest_bit(pos)) {
+        tree[pos - 1] += delta;
+    }
+}
+
+// Сумма первых n элементов
+static double fenwick_prefix(const double* tree, size_t n) {
+    double sum = 0.0;
+    for (size_t pos = n; pos > 0; pos &= pos - 1) {
+        sum += tree[pos - 1];
+    }
+    return sum;
+}
+
+// Построение за O(n): каждый узел добавляет свою сумму родителю
+static void fenwick_build(double* tree, const double* values, size_t count) {
+    memcpy(tree, values, count * sizeof(double));
+    for (size_t pos = 1; pos <= count; pos++) {
+        size_t parent = pos + lowest_bit(pos);
+        if (parent <= count) {
+            tree[parent - 1] += tree[pos - 1];
+        }
+    }
+}
+
+// Дописывает элемент count (values[count] уже записан)
+static void fenwick_append(double* tree, const double* values, size_t count) {
+    size_t pos = count + 1;
+    tree[pos - 1] = values[count] + fenwick_prefix(tree, count) - fenwick_prefix(tree, pos - lowest_bit(pos));
+}
+
+// Сколько первых элементов целиком лежат не дальше *y, то есть индекс элемента,
+// который содержит *y. В *y остается смещение внутри этого элемента.
+static size_t fenwick_search(const double* tree, size_t count, double* y) {
+    size_t step = 1;
+    while (step * 2 <= count) step *= 2;
+    size_t pos = 0;
+    for (; step > 0; step >>= 1) {
+        if (pos + step <= count && tree[pos + step - 1] <= *y) {
+            pos += step;
+            *y -= tree[pos - 1];
+        }
+    }
+    return pos;
+}
+
+// --- Высоты элементов (повторяют порядок отрисовки в ui_manager_render) ---
+
+static uint32_t context_rows(const LayoutIndex* index, size_t global) {
+    return global < index->context_capacity ? index->hunk_context[global] : 0;
+}
+
+static double hunk_height(const LayoutIndex* index, size_t global) {
+    const DiffHunk* hunk = &index->data->hunks[global];
+    double height = (double)HUNK_HEADER_HEIGHT + HUNK_PADDING;
+    if (!hunk->is_collapsed) {
+        // Строки рабочего дерева, раскрытые над ханком, рисуются перед его строками;
+        // в режиме "рядом" удаления и добавления делят ряды
+        const size_t rows = index->side_by_side ? hunk->row_count : hunk->line_count;
+        height += ((double)context_rows(index, global) + rows) * LINE_HEIGHT + HUNK_PADDING;
+    }
+    return height;
+}
+
+static double file_height(const LayoutIndex* index, const DiffFile* file) {
+    double height = FILE_BODY_OFFSET + MARGIN;
+    if (!file->is_collapsed) {
+        height += fenwick_prefix(index->hunk_tree + file->first_hunk, file->hunk_count);
+    }
+    return height;
+}
+
+// Высоты ханков файла и дерево над ними
+static void build_hunks(LayoutIndex* index, const DiffFile* file) {
+    double* heights = index->hunk_heights + file->first_hunk;
+    for (size_t j = 0; j < file->hunk_count; j++) {
+        heights[j] = hunk_height(index, file->first_hunk + j);
+    }
+    fenwick_build(index->hunk_tree + file->first_hunk, heights, file->hunk_count);
+}
+
+static int grow(double** first, double** second, size_t* capacity, size_t needed) {
+    if (needed <= *capacity) {
+        return 1;
+    }
+    size_t new_capacity = *capacity ? *capacity * 2 : 256;
+    if (new_capacity < needed) new_capacity = needed;
+    double* a = realloc(*first, new_capacity * sizeof(double));
+    if (a) *first = a;
+    double* b = realloc(*second, new_capacity * sizeof(double));
+    if (b) *second = b;
+    if (!a || !b) {
+        log_error("layout_index: Failed to grow index to %zu entries", new_capacity);
+        return 0;
+    }
+    *capacity = new_capacity;
+    return 1;
+}
+
+void layout_index_init(LayoutIndex* index) {
+    if (!index) {
+        return;
+    }
+    memset(index, 0, sizeof(LayoutIndex));
+}
+
+void layout_index_destroy(LayoutIndex* index) {
+    if (!index) {
+        return;
+    }
+    free(index->file_heights);
+    free(index->file_tree);
+    free(index->hunk_heights);
+    free(index->hunk_tree);
+    free(index->hunk_context);
+    memset(index, 0, sizeof(LayoutIndex));
+}
+
+void layout_index_reset(LayoutIndex* index, const DiffData* data) {
+    if (!index) {
+        return;
+    }
+    // Память остается для следующей синхронизации
+    index->data = data;
+    index->file_count = 0;
+    index->hunk_count = 0;
+    // Раскрытый контекст относится к ханкам прежнего diff
+    if (index->hunk_context) {
+        memset(index->hunk_context, 0, index->context_capacity * sizeof(uint32_t));
+    }
+}
+
+int layout_index_sync(LayoutIndex* index, const DiffData* data) {
+    if (!index) {
+        return 0;
+    }
+    if (data != index->data || !data || data->file_count < index->file_count) {
+        layout_index_reset(index, data);
+    }
+    if (!data || data->file_count == index->file_count) {
+        return 1;
+    }
+    if (!grow(&index->file_heights, &index->file_tree, &index->file_capacity, data->file_count) ||
+        !grow(&index->hunk_heights, &index->hunk_tree, &index->hunk_capacity, data->hunk_count)) {
+        return 0;
+    }
+    // Опубликованные файлы только дописываются в конец (см. DiffStreamParser)
+    for (size_t i = index->file_count; i < data->file_count; i++) {
+        const DiffFile* file = &data->files[i];
+        build_hunks(index, file);
+        index->file_heights[i] = file_height(index, file);
+        fenwick_append(index->file_tree, index->file_heights, i);
+    }
+    index->file_count = data->file_count;
+    index->hunk_count = data->hunk_count;
+    return 1;
+}
+
+void layout_index_set_side_by_side(LayoutIndex* index, int side_by_side) {
+    if (!index || index->side_by_side == (side_by_side ? 1 : 0)) {
+        return;
+    }
+    index->side_by_side = side_by_side ? 1 : 0;
+    // Высоты пересчитываются при следующей синхронизации; в отличие от сброса,
+    // раскрытый контекст относится к тем же ханкам и остается
+    index->file_count = 0;
+    index->hunk_count = 0;
+}
+
+void layout_index_update_file(LayoutIndex* index, size_t file) {
+    if (!index || !index->data || file >= index->file_count) {
+        return; // Еще не проиндексирован: высота посчитается при синхронизации
+    }
+    double height = file_height(index, &index->data->files[file]);
+    fenwick_add(index->file_tree, index->file_count, file, height - index->file_heights[file]);
+    index->file_heights[file] = height;
+}
+
+void layout_index_update_file_hunks(LayoutIndex* index, size_t file) {
+    if (!index || !index->data || file >= index->file_count) {
+        return;
+    }
+    // Ячейки ханков файла учтены в hunk_capacity еще при синхронизации (data->hunk_count)
+    build_hunks(index, &index->data->files[file]);
+    layout_index_update_file(index, file);
+}
+
+void layout_index_update_hunk(LayoutIndex* index, size_t file, size_t hunk) {
+    if (!index || !index->data || file >= index->file_count) {
+        return;
+    }
+    const DiffFile* diff_file = &index->data->files[file];
+    if (hunk >= diff_file->hunk_count) {
+        return;
+    }
+    size_t global = diff_file->first_hunk + hunk;
+    double height = hunk_height(index, global);
+    fenwick_add(index->hunk_tree + diff_file->first_hunk, diff_file->hunk_count, hunk,
+                height - index->hunk_heights[global]);
+    index->hunk_heights[global] = height;
+    layout_index_update_file(index, file);
+}
+
+uint32_t layout_index_hunk_context(const LayoutIndex* index, size_t file, size_t hunk) {
+    if (!index || !index->data || file >= index->file_count || hunk >= index->data->files[file].hunk_count) {
+        return 0;
+    }
+    return context_rows(index, index->data->files[file].first_hunk + hunk);
+}
+
+int layout_index_set_hunk_context(LayoutIndex* index, size_t file, size_t hunk, uint32_t rows) {
+    if (!index || !index->data || file >= index->file_count || hunk >= index->data->files[file].hunk_count) {
+        return 0;
+    }
+    size_t global = index->data->files[file].first_hunk + hunk;
+    if (global >= index->context_capacity) {
+        // Массив заводится при первом раскрытии: большинство видов его не раскрывают
+        size_t capacity = index->hunk_capacity;
+        uint32_t* grown = realloc(index->hunk_context, capacity * sizeof(uint32_t));
+        if (!grown) {
+            log_error("layout_index: Failed to allocate context rows for %zu hunks", capacity);
+            return 0;
+        }
+        memset(grown + index->context_capacity, 0, (capacity - index->context_capacity) * sizeof(uint32_t));
+        index->hunk_context = grown;
+        index->context_capacity = capacity;
+    }
+    index->hunk_context[global] = rows;
+    layout_index_update_hunk(index, file, hunk);
+    return 1;
+}
+
+size_t layout_index_memory_usage(const LayoutIndex* index) {
+    return index ? 2 * (index->file_capacity + index->hunk_capacity) * sizeof(double) +
+                   index->context_capacity * sizeof(uint32_t) : 0;
+}
+
+double layout_index_total_height(const LayoutIndex* index) {
+    return index ? fenwick_prefix(index->file_tree, index->file_count) : 0.0;
+}
+
+double layout_index_file_top(const LayoutIndex* index, size_t file) {
+    if (!index || file > index->file_count) {
+        return 0.0;
+    }
+    return fenwick_prefix(index->file_tree, file);
+}
+
+double layout_index_hunk_top(const LayoutIndex* index, size_t file, size_t hunk) {
+    if (!index || !index->data || file >= index->file_count) {
+        return 0.0;
+    }
+    const DiffFile* diff_file = &index->data->files[file];
+    if (hunk > diff_file->hunk_count) hunk = diff_file->hunk_count;
+    return fenwick_prefix(index->file_tree, file) + FILE_BODY_OFFSET +
+           fenwick_prefix(index->hunk_tree + diff_file->first_hunk, hunk);
+}
+
+LayoutPosition layout_index_locate(const LayoutIndex* index, double y) {
+    LayoutPosition position;
+    memset(&position, 0, sizeof(position));
+    if (!index || !index->data || index->file_count == 0) {
+        return position;
+    }
+    if (y < 0.0) y = 0.0;
+
+    double offset = y;
+    size_t file = fenwick_search(index->file_tree, index->file_count, &offset);
+    if (file >= index->file_count) {
+        // Ниже конца содержимого: последний файл
+        file = index->file_count - 1;
+    }
+    position.file = file;
+    position.file_top = fenwick_prefix(index->file_tree, file);
+    position.hunk_top = position.file_top + FILE_BODY_OFFSET;
+    offset = y - position.hunk_top;
+
+    const DiffFile* diff_file = &index->data->files[file];
+    if (!diff_file->is_collapsed && diff_file->hunk_count > 0 && offset > 0.0) {
+        const double* tree = index->hunk_tree + diff_file->first_hunk;
+        size_t hunk = fenwick_search(tree, diff_file->hunk_count, &offset);
+        if (hunk >= diff_file->hunk_count) {
+            hunk = diff_file->hunk_count - 1;
+        }
+        position.hunk = hunk;
+        position.hunk_top += fenwick_prefix(tree, hunk);
+    }
+    return position;
+}
@@ -0,0 +1,87 @@
+// src/gui/layout_index.h
+#ifndef SEE_CODE_LAYOUT_INDEX_H
+#define SEE_CODE_LAYOUT_INDEX_H
+
+#include "see_code/data/diff_data.h"
+#include <stddef.h>
+#include <stdint.h>
+
+// Prefix sums of the vertical layout of a diff, so the first visible row
+// can be found by binary search instead of walking everything above it.
+//
+// Two levels of Fenwick trees: one over file heights, and one per file
+// over the heights of its hunks (stored back to back, indexed like
+// DiffData.hunks). Collapsing a hunk or a file is an O(log n) update.
+//
+// Content coordinates start at the top of the first file header;
+// the renderer adds its top MARGIN and the scroll offset.
+typedef struct {
+    const DiffData* data;  // Diff the index was built for
+    double* file_heights;  // Current height of every file block
+    double* file_tree;     // Fenwick tree over file_heights
+    size_t file_count;     // Files of data indexed so far
+    size_t file_capacity;
+    double* hunk_heights;  // Current height of every hunk block
+    double* hunk_tree;     // Fenwick tree per file over its hunk segment
+    size_t hunk_count;
+    size_t hunk_capacity;
+    uint32_t* hunk_context; // Working-tree lines shown above each hunk (NULL until the first expansion)
+    size_t context_capacity;
+    int side_by_side;       // Hunks take DiffHunk.row_count rows instead of line_count
+} LayoutIndex;
+
+// Position of a content y coordinate
+typedef struct {
+    size_t file;        // File containing y
+    size_t hunk;        // First hunk of that file to draw (relative to the file)
+    double file_top;    // Content y of the file header
+    double hunk_top;    // Content y of that hunk's header
+} LayoutPosition;
+
+void layout_index_init(LayoutIndex* index);
+void layout_index_destroy(LayoutIndex* index);
+
+// Drops everything indexed so far; the next sync starts over for data.
+void layout_index_reset(LayoutIndex* index, const DiffData* data);
+
+// Indexes files published since the last call (data may still be streaming in).
+// Rebuilds from scratch if data was replaced or shrank. Returns 1 on success.
+int layout_index_sync(LayoutIndex* index, const DiffData* data);
+
+// Switches between the unified and the side-by-side layout. The heights are
+// rebuilt by the next sync; expanded context is kept.
+void layout_index_set_side_by_side(LayoutIndex* index, int side_by_side);
+
+// Recomputes a file's height after its is_collapsed flag changed.
+void layout_index_update_file(LayoutIndex* index, size_t file);
+
+// Indexes the hunks of a file after they were parsed on demand
+// (see diff_parser_parse_file()) and recomputes the file's height.
+void layout_index_update_file_hunks(LayoutIndex* index, size_t file);
+
+// Recomputes a hunk's height after its is_collapsed flag changed.
+// hunk is relative to the file.
+void layout_index_update_hunk(LayoutIndex* index, size_t file, size_t hunk);
+
+// Lines of unchanged context shown above a hunk, read from the working tree
+// (hunk is relative to the file). Setting them updates the hunk's height;
+// returns 0 if the hunk is not indexed yet or memory ran out.
+uint32_t layout_index_hunk_context(const LayoutIndex* index, size_t file, size_t hunk);
+int layout_index_set_hunk_context(LayoutIndex* index, size_t file, size_t hunk, uint32_t rows);
+
+// Bytes held by the height arrays and trees.
+size_t layout_index_memory_usage(const LayoutIndex* index);
+
+// Height of all indexed files.
+double layout_index_total_height(const LayoutIndex* index);
+
+// Content y of a file header, and of the header of one of its hunks
+// (hunk is relative to the file). The file must be indexed.
+double layout_index_file_top(const LayoutIndex* index, size_t file);
+double layout_index_hunk_top(const LayoutIndex* index, size_t file, size_t hunk);
+
+// Finds the file and hunk that contain content coordinate y.
+// The index must contain at least one file.
+LayoutPosition layout_index_locate(const LayoutIndex* index, double y);
+
+#endif // SEE_CODE_LAYOUT_INDEX_H
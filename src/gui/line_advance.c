@@ -0,0 +1,234 @@
+// src/gui/line_advance.c
+#include "see_code/gui/line_advance.h"
+#include "see_code/utils/logger.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+// --- Построение индекса ---
+
+// Начало i-го шага, сдвинутое вперед до начала символа UTF-8: байты
+// продолжения не бывают началом символа, так что сюда всегда приходит и
+// посимвольный проход от начала строки
+static size_t checkpoint_offset(const char* text, size_t length, size_t i) {
+    size_t offset = i * LINE_ADVANCE_STRIDE;
+    if (offset >= length) {
+        return length;
+    }
+    while (offset < length && ((unsigned char)text[offset] & 0xC0) == 0x80) offset++;
+    return offset;
+}
+
+static LineAdvanceIndex* build_index(Renderer* renderer, const DiffData* data, size_t line) {
+    const size_t length = data->lines.lengths[line] - 1;
+    const char* text = data->buffer + data->lines.offsets[line] + 1;
+    const size_t count = (length + LINE_ADVANCE_STRIDE - 1) / LINE_ADVANCE_STRIDE + 1;
+    // Запись и контрольные точки одним блоком
+    LineAdvanceIndex* entry = malloc(sizeof(LineAdvanceIndex) + count * sizeof(uint32_t));
+    if (!entry) {
+        log_error("line_advance: Failed to allocate index for line %zu (%zu bytes)", line, length);
+        return NULL;
+    }
+    memset(entry, 0, sizeof(LineAdvanceIndex));
+    entry->line = line;
+    entry->offset = data->lines.offsets[line];
+    entry->length = data->lines.lengths[line];
+    entry->checkpoint_count = count;
+    entry->checkpoints = (uint32_t*)(entry + 1);
+    // Продвижения глифов целые при масштабе 1.0, поэтому сумма в uint32_t точна
+    uint32_t advance = 0;
+    entry->checkpoints[0] = 0;
+    size_t start = 0;
+    for (size_t i = 1; i < count; i++) {
+        size_t end = checkpoint_offset(text, length, i);
+        advance += (uint32_t)renderer_measure_text_n(renderer, text + start, end - start, 1.0f);
+        entry->checkpoints[i] = advance;
+        start = end;
+    }
+    return entry;
+}
+
+// --- LRU-кэш ---
+
+static size_t bucket_of(size_t line) {
+    return line % (LINE_ADVANCE_CACHE_LINES * 2);
+}
+
+static void lru_unlink(LineAdvanceCache* cache, LineAdvanceIndex* entry) {
+    if (entry->prev) entry->prev->next = entry->next; else cache->head = entry->next;
+    if (entry->next) entry->next->prev = entry->prev; else cache->tail = entry->prev;
+    entry->prev = NULL;
+    entry->next = NULL;
+}
+
+static void lru_push_front(LineAdvanceCache* cache, LineAdvanceIndex* entry) {
+    entry->prev = NULL;
+    entry->next = cache->head;
+    if (cache->head) cache->head->prev = entry; else cache->tail = entry;
+    cache->head = entry;
+}
+
+static void remove_entry(LineAdvanceCache* cache, LineAdvanceIndex* entry) {
+    LineAdvanceIndex** link = &cache->buckets[bucket_of(entry->line)];
+    while (*link != entry) link = &(*link)->bucket_next;
+    *link = entry->bucket_next;
+    lru_unlink(cache, entry);
+    cache->count--;
+    free(entry);
+}
+
+void line_advance_cache_init(LineAdvanceCache* cache) {
+    if (!cache) {
+        return;
+    }
+    memset(cache, 0, sizeof(LineAdvanceCache));
+}
+
+void line_advance_cache_clear(LineAdvanceCache* cache) {
+    if (!cache) {
+        return;
+    }
+    while (cache->head) {
+        LineAdvanceIndex* entry = cache->head;
+        cache->head = entry->next;
+        free(entry);
+    }
+    memset(cache->buckets, 0, sizeof(cache->buckets));
+    cache->tail = NULL;
+    cache->count = 0;
+    cache->data = NULL;
+}
+
+void line_advance_cache_remap(LineAdvanceCache* cache, const DiffData* previous, const DiffData* data) {
+    if (!cache) {
+        return;
+    }
+    if (cache->data != previous || !previous || !data) {
+        line_advance_cache_clear(cache);
+        return;
+    }
+    // Текст строки тот же, сдвинулись только ее номер и место в буфере
+    memset(cache->buckets, 0, sizeof(cache->buckets));
+    LineAdvanceIndex* entry = cache->head;
+    while (entry) {
+        LineAdvanceIndex* next = entry->next;
+        const size_t line = diff_data_reused_line(data, previous, entry->line);
+        if (line == DIFF_NOT_REUSED) {
+            lru_unlink(cache, entry);
+            cache->count--;
+            free(entry);
+        } else {
+            entry->line = line;
+            entry->offset = data->lines.offsets[line];
+            entry->bucket_next = cache->buckets[bucket_of(line)];
+            cache->buckets[bucket_of(line)] = entry;
+        }
+        entry = next;
+    }
+    cache->data = data;
+}
+
+void line_advance_cache_destroy(LineAdvanceCache* cache) {
+    line_advance_cache_clear(cache);
+}
+
+const LineAdvanceIndex* line_advance_cache_get(LineAdvanceCache* cache, Renderer* renderer,
+                                               const DiffData* data, size_t line) {
+    if (!cache || !renderer || !data || line >= data->line_count) {
+        return NULL;
+    }
+    // Моноширинный шрифт и печатный ASCII: позиции считаются по столбцам
+    const uint32_t column_advance = (uint32_t)renderer_get_column_width(renderer, 1.0f);
+    if (column_advance > 0 && diff_data_line_is_plain(data, line)) {
+        memset(&cache->columns, 0, sizeof(LineAdvanceIndex));
+        cache->columns.line = line;
+        cache->columns.offset = data->lines.offsets[line];
+        cache->columns.length = data->lines.lengths[line];
+        cache->columns.column_advance = column_advance;
+        return &cache->columns;
+    }
+    if (data->lines.lengths[line] < LINE_ADVANCE_MIN_LENGTH + 1) {
+        return NULL;
+    }
+    if (cache->data != data) {
+        line_advance_cache_clear(cache);
+        cache->data = data;
+    }
+
+    for (LineAdvanceIndex* entry = cache->buckets[bucket_of(line)]; entry; entry = entry->bucket_next) {
+        if (entry->line != line) {
+            continue;
+        }
+        if (entry->offset != data->lines.offsets[line] || entry->length != data->lines.lengths[line]) {
+            // Строка с этим номером уже другая (diff перезагружен без очистки кэша)
+            remove_entry(cache, entry);
+            break;
+        }
+        lru_unlink(cache, entry);
+        lru_push_front(cache, entry);
+        return entry;
+    }
+
+    LineAdvanceIndex* entry = build_index(renderer, data, line);
+    if (!entry) {
+        return NULL;
+    }
+    if (cache->count >= LINE_ADVANCE_CACHE_LINES) {
+        remove_entry(cache, cache->tail);
+    }
+    entry->bucket_next = cache->buckets[bucket_of(line)];
+    cache->buckets[bucket_of(line)] = entry;
+    lru_push_front(cache, entry);
+    cache->count++;
+    return entry;
+}
+
+// --- Запросы ---
+
+float line_advance_at(const LineAdvanceIndex* index, Renderer* renderer,
+                      const char* text, size_t length, size_t offset, float scale) {
+    if (offset > length) offset = length;
+    if (!index) {
+        return renderer_measure_text_n(renderer, text, offset, scale);
+    }
+    if (index->column_advance) {
+        return (float)offset * index->column_advance * scale;
+    }
+    // Ближайшая контрольная точка слева и остаток меньше шага
+    size_t i = offset / LINE_ADVANCE_STRIDE;
+    if (i >= index->checkpoint_count) i = index->checkpoint_count - 1;
+    size_t start = checkpoint_offset(text, length, i);
+    while (i > 0 && start > offset) {
+        start = checkpoint_offset(text, length, --i);
+    }
+    return index->checkpoints[i] * scale +
+           renderer_measure_text_n(renderer, text + start, offset - start, scale);
+}
+
+size_t line_advance_locate(const LineAdvanceIndex* index, Renderer* renderer,
+                           const char* text, size_t length, float x, float scale, float* glyph_x) {
+    size_t start = 0;
+    float base = 0.0f;
+    if (index && index->column_advance) {
+        // Первый столбец, начинающийся не левее x
+        const float column = index->column_advance * scale;
+        size_t found = x > 0.0f ? (size_t)ceilf(x / column) : 0;
+        if (found > length) found = length;
+        if (glyph_x) *glyph_x = found * column;
+        return found;
+    }
+    if (index && x > 0.0f) {
+        // Последняя контрольная точка левее x: искомый глиф не дальше следующей
+        size_t lo = 0, hi = index->checkpoint_count - 1;
+        while (lo < hi) {
+            size_t mid = lo + (hi - lo + 1) / 2;
+            if (index->checkpoints[mid] * scale < x) lo = mid; else hi = mid - 1;
+        }
+        start = checkpoint_offset(text, length, lo);
+        base = index->checkpoints[lo] * scale;
+    }
+    float offset_x = 0.0f;
+    size_t found = start + renderer_locate_text_n(renderer, text + start, length - start, scale, x - base, &offset_x);
+    if (glyph_x) *glyph_x = base + offset_x;
+    return found;
+}
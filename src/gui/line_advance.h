@@ -0,0 +1,86 @@
+// src/gui/line_advance.h
+#ifndef SEE_CODE_LINE_ADVANCE_H
+#define SEE_CODE_LINE_ADVANCE_H
+
+#include "see_code/gui/renderer.h"
+#include "see_code/data/diff_data.h"
+#include <stddef.h>
+#include <stdint.h>
+
+// Cumulative glyph advances of long diff lines, for horizontal scrolling.
+//
+// For a line of LINE_ADVANCE_MIN_LENGTH bytes or more, the advance (at scale
+// 1.0) of every LINE_ADVANCE_STRIDE-byte prefix of its text is measured once
+// and kept in a small LRU. The first glyph at a horizontal offset is then
+// found by binary search over these checkpoints plus a scan of at most one
+// stride, so drawing a scrolled line costs the screen width, not the line
+// length. Shorter lines are scanned from their first byte.
+//
+// With a monospace font, lines of printable ASCII (see
+// diff_data_line_is_plain()) need no measuring at all: byte offsets are
+// display columns, so positions are computed directly from the column width.
+//
+// Offsets are relative to the first byte after the '+'/'-'/' ' marker.
+// Checkpoints of lines with UTF-8 text are moved forward to the start of
+// the next character, so every checkpoint is a character boundary.
+
+// Lines shorter than this are not indexed
+#define LINE_ADVANCE_MIN_LENGTH 512
+// Bytes between two checkpoints
+#define LINE_ADVANCE_STRIDE 64
+// Maximum number of lines kept in a LineAdvanceCache
+#define LINE_ADVANCE_CACHE_LINES 256
+
+typedef struct LineAdvanceIndex {
+    size_t line;        // Index in DiffData.lines
+    uint32_t offset;    // Copy of the line's span, to detect a replaced diff
+    uint32_t length;
+    // checkpoints[i] is the advance of the first i * LINE_ADVANCE_STRIDE
+    // bytes (up to a character boundary); the last one is the advance of
+    // the whole text
+    size_t checkpoint_count;
+    uint32_t* checkpoints;
+    // Nonzero for a printable ASCII line in a monospace font: the advance of
+    // n bytes is n * column_advance and there are no checkpoints
+    uint32_t column_advance;
+    // LRU list (most recent first) and hash bucket chain
+    struct LineAdvanceIndex* prev;
+    struct LineAdvanceIndex* next;
+    struct LineAdvanceIndex* bucket_next;
+} LineAdvanceIndex;
+
+typedef struct {
+    const DiffData* data;  // Diff the cached lines belong to
+    LineAdvanceIndex* buckets[LINE_ADVANCE_CACHE_LINES * 2];
+    LineAdvanceIndex* head;  // Most recently used
+    LineAdvanceIndex* tail;  // Evicted first
+    size_t count;
+    LineAdvanceIndex columns; // Returned for lines measured by columns
+} LineAdvanceCache;
+
+void line_advance_cache_init(LineAdvanceCache* cache);
+void line_advance_cache_destroy(LineAdvanceCache* cache);
+// Drops every cached line (call when the diff is replaced or reloaded)
+void line_advance_cache_clear(LineAdvanceCache* cache);
+// Keeps the lines of files that data, reloaded from previous, copied
+// unchanged (under their new indices) and drops the rest
+void line_advance_cache_remap(LineAdvanceCache* cache, const DiffData* previous, const DiffData* data);
+
+// Returns the advance index of a line, measuring it on the first request.
+// Returns NULL for lines shorter than LINE_ADVANCE_MIN_LENGTH (they need no
+// index) unless they are measured by columns, for out of range lines and
+// when memory ran out. The result stays
+// valid until the next call on the same cache.
+const LineAdvanceIndex* line_advance_cache_get(LineAdvanceCache* cache, Renderer* renderer,
+                                               const DiffData* data, size_t line);
+
+// Advance of the first `offset` bytes of text. index may be NULL.
+float line_advance_at(const LineAdvanceIndex* index, Renderer* renderer,
+                      const char* text, size_t length, size_t offset, float scale);
+
+// First byte whose glyph starts at or after x (length if none does);
+// *glyph_x receives that glyph's position. index may be NULL.
+size_t line_advance_locate(const LineAdvanceIndex* index, Renderer* renderer,
+                           const char* text, size_t length, float x, float scale, float* glyph_x);
+
+#endif // SEE_CODE_LINE_ADVANCE_H
@@ -227,6 +227,30 @@ void renderer_draw_text(Renderer* renderer, const char* text, float x, float y,
     text_renderer_draw_text(renderer, text, x, y, scale, color, max_width);
 }
 
+void renderer_draw_text_n(Renderer* renderer, const char* text, size_t length, float x, float y, float scale, uint32_t color, float max_width) {
+    text_renderer_draw_text_n(renderer, text, length, x, y, scale, color, max_width);
+}
+
+float renderer_measure_text_n(Renderer* renderer, const char* text, size_t length, float scale) {
+    return text_renderer_measure_text_n(renderer, text, length, scale);
+}
+
+size_t renderer_locate_text_n(Renderer* renderer, const char* text, size_t length, float scale, float x, float* glyph_x) {
+    return text_renderer_locate_text_n(renderer, text, length, scale, x, glyph_x);
+}
+
+void renderer_draw_number(Renderer* renderer, uint32_t value, float right_x, float y, float scale, uint32_t color) {
+    text_renderer_draw_number(renderer, value, right_x, y, scale, color);
+}
+
+float renderer_get_digit_width(Renderer* renderer, float scale) {
+    return text_renderer_digit_width(renderer, scale);
+}
+
+float renderer_get_column_width(Renderer* renderer, float scale) {
+    return text_renderer_column_width(renderer, scale);
+}
+
 int renderer_get_width(const Renderer* renderer) {
     return renderer ? renderer->width : 0;
 }
@@ -5,6 +5,7 @@
 #include <EGL/egl.h>
 #include <GLES2/gl2.h>
 #include <stdint.h> // Для uint32_t
+#include <stddef.h> // Для size_t
 
 typedef struct Renderer Renderer;
 
@@ -24,6 +25,20 @@ void renderer_draw_quad(Renderer* renderer, float x, float y, float width, float
 void renderer_draw_textured_quad(Renderer* renderer, float x, float y, float w, float h, float u0, float v0, float u1, float v1, uint32_t color);
 // --- ИЗМЕНЕНИЕ: Добавлен параметр max_width для обрезки текста ---
 void renderer_draw_text(Renderer* renderer, const char* text, float x, float y, float scale, uint32_t color, float max_width);
+// Рисует ровно length байт (текст не обязан заканчиваться '\0')
+void renderer_draw_text_n(Renderer* renderer, const char* text, size_t length, float x, float y, float scale, uint32_t color, float max_width);
+// Ширина length байт текста в пикселях (без отрисовки)
+float renderer_measure_text_n(Renderer* renderer, const char* text, size_t length, float scale);
+// Первый байт, глиф которого начинается не левее x (для горизонтальной прокрутки);
+// его позиция записывается в *glyph_x
+size_t renderer_locate_text_n(Renderer* renderer, const char* text, size_t length, float scale, float x, float* glyph_x);
+// Рисует число, выровненное по правому краю right_x (для столбцов номеров строк)
+void renderer_draw_number(Renderer* renderer, uint32_t value, float right_x, float y, float scale, uint32_t color);
+// Ширина одной цифры в renderer_draw_number
+float renderer_get_digit_width(Renderer* renderer, float scale);
+// Ширина столбца моноширинного шрифта: строка из n столбцов (см. diff_scan_text)
+// занимает n таких ширин. 0, если шрифт пропорциональный
+float renderer_get_column_width(Renderer* renderer, float scale);
 
 // --- Геттеры ---
 int renderer_get_width(const Renderer* renderer);
@@ -4,11 +4,30 @@
 #include "see_code/gui/renderer.h"
 #include "see_code/utils/logger.h"
 #include "see_code/core/config.h"
+#include "see_code/data/diff_data.h"
+#include "see_code/utils/utf8.h"
 #include <stdlib.h>
 #include <string.h>
 #include <ft2build.h>
 #include FT_FREETYPE_H
 
+// Не-ASCII глифы: открытая адресация по коду символа. Заполняется не больше
+// чем на 3/4; символы сверх этого рисуются заменяющим глифом.
+#define EXTRA_GLYPH_SLOTS 1024
+
+struct glyph_cache_entry {
+    int is_loaded; // 1 - в атласе, -1 - загрузить не удалось (больше не пробуем)
+    float u0, v0, u1, v1;
+    int width, height;
+    int bearing_x, bearing_y;
+    int advance_x;
+};
+
+struct extra_glyph {
+    uint32_t codepoint; // 0 - слот свободен
+    struct glyph_cache_entry glyph;
+};
+
 struct TextRendererInternalData {
     int is_freetype_initialized;
     FT_Library ft_library;
@@ -22,20 +41,22 @@ struct TextRendererInternalData {
     int atlas_pen_y;
     int atlas_row_height;
 
-    struct {
-        int is_loaded;
-        float u0, v0, u1, v1;
-        int width, height;
-        int bearing_x, bearing_y;
-        int advance_x;
-    } glyph_cache[96];
+    struct glyph_cache_entry glyph_cache[96];
+    struct extra_glyph extra_glyphs[EXTRA_GLYPH_SLOTS];
+    size_t extra_glyph_count;
+    // Глиф для неверного UTF-8 и символов, не поместившихся в кэш
+    struct glyph_cache_entry replacement;
+    // Продвижение столбца моноширинного шрифта (0 - шрифт пропорциональный)
+    int column_advance;
+    // Цифры загружаются в атлас при инициализации; номера строк рисуются
+    // в ячейках одинаковой ширины, чтобы столбцы выравнивались по правому краю
+    int digit_advance;
 };
 
-static int load_glyph_into_atlas(struct TextRendererInternalData* tr_data, unsigned long char_code) {
-    if (!tr_data || !tr_data->is_freetype_initialized || char_code < 32 || char_code > 126) return 0;
-    int cache_index = char_code - 32;
-    if (tr_data->glyph_cache[cache_index].is_loaded) return 1;
-
+// Растеризует символ в атлас и заполняет glyph. Догружается только
+// прямоугольник глифа, а не весь атлас.
+static int rasterize_glyph(struct TextRendererInternalData* tr_data, unsigned long char_code,
+                           struct glyph_cache_entry* glyph) {
     if (FT_Load_Char(tr_data->ft_face, char_code, FT_LOAD_RENDER)) return 0;
 
     FT_GlyphSlot slot = tr_data->ft_face->glyph;
@@ -50,12 +71,11 @@ static int load_glyph_into_atlas(struct TextRendererInternalData* tr_data, unsig
 
     if (tr_data->atlas_pen_y + h + 1 > tr_data->atlas_height) return 0;
     
+    unsigned char* origin = tr_data->texture_atlas_data + tr_data->atlas_pen_y * tr_data->atlas_width + tr_data->atlas_pen_x;
     for (int y = 0; y < h; y++) {
-        memcpy(tr_data->texture_atlas_data + (tr_data->atlas_pen_y + y) * tr_data->atlas_width + tr_data->atlas_pen_x,
-               slot->bitmap.buffer + y * slot->bitmap.pitch, w);
+        memcpy(origin + y * tr_data->atlas_width, slot->bitmap.buffer + y * slot->bitmap.pitch, w);
     }
     
-    struct glyph_cache_entry* glyph = &tr_data->glyph_cache[cache_index];
     glyph->is_loaded = 1;
     glyph->u0 = (float)(tr_data->atlas_pen_x) / tr_data->atlas_width;
     glyph->v0 = (float)(tr_data->atlas_pen_y) / tr_data->atlas_height;
@@ -67,16 +87,83 @@ static int load_glyph_into_atlas(struct TextRendererInternalData* tr_data, unsig
     glyph->bearing_y = slot->bitmap_top;
     glyph->advance_x = slot->advance.x >> 6;
 
+    if (w > 0 && h > 0) {
+        glBindTexture(GL_TEXTURE_2D, tr_data->texture_atlas_id);
+        if (slot->bitmap.pitch == w) {
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+            glTexSubImage2D(GL_TEXTURE_2D, 0, tr_data->atlas_pen_x, tr_data->atlas_pen_y, w, h,
+                            GL_ALPHA, GL_UNSIGNED_BYTE, slot->bitmap.buffer);
+        } else {
+            // Строки битмапа с отступами: GLES2 не умеет шаг строки, грузим атлас целиком
+            glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, tr_data->atlas_width, tr_data->atlas_height, GL_ALPHA, GL_UNSIGNED_BYTE, tr_data->texture_atlas_data);
+        }
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+
     tr_data->atlas_pen_x += w + 1;
     if (h > tr_data->atlas_row_height) tr_data->atlas_row_height = h;
-    
-    glBindTexture(GL_TEXTURE_2D, tr_data->texture_atlas_id);
-    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, tr_data->atlas_width, tr_data->atlas_height, GL_ALPHA, GL_UNSIGNED_BYTE, tr_data->texture_atlas_data);
-    glBindTexture(GL_TEXTURE_2D, 0);
-
     return 1;
 }
 
+static int load_glyph_into_atlas(struct TextRendererInternalData* tr_data, unsigned long char_code) {
+    if (!tr_data || !tr_data->is_freetype_initialized || char_code < 32 || char_code > 126) return 0;
+    int cache_index = char_code - 32;
+    if (tr_data->glyph_cache[cache_index].is_loaded) return 1;
+    return rasterize_glyph(tr_data, char_code, &tr_data->glyph_cache[cache_index]);
+}
+
+// Глиф не-ASCII символа: из кэша или растеризуется при первой встрече
+static const struct glyph_cache_entry* extra_glyph(struct TextRendererInternalData* tr_data, uint32_t codepoint) {
+    size_t slot = (codepoint * 2654435761u) & (EXTRA_GLYPH_SLOTS - 1);
+    while (tr_data->extra_glyphs[slot].codepoint != 0 && tr_data->extra_glyphs[slot].codepoint != codepoint) {
+        slot = (slot + 1) & (EXTRA_GLYPH_SLOTS - 1);
+    }
+    struct extra_glyph* entry = &tr_data->extra_glyphs[slot];
+    if (entry->codepoint == 0) {
+        if (tr_data->extra_glyph_count >= EXTRA_GLYPH_SLOTS / 4 * 3) {
+            return &tr_data->replacement;
+        }
+        entry->codepoint = codepoint;
+        tr_data->extra_glyph_count++;
+        if (!rasterize_glyph(tr_data, codepoint, &entry->glyph)) {
+            entry->glyph.is_loaded = -1;
+        }
+    }
+    return entry->glyph.is_loaded > 0 ? &entry->glyph : &tr_data->replacement;
+}
+
+// Следующий символ текста, *p сдвигается за него. Печатный ASCII берется из
+// таблицы одним сравнением; остальное декодируется как UTF-8. Табуляция -
+// это пробел с *repeat = DIFF_TAB_WIDTH (ширина не зависит от позиции, поэтому
+// куски строки можно измерять по отдельности), неверный байт - заменяющий
+// глиф, управляющие байты - NULL (без продвижения).
+static inline const struct glyph_cache_entry* next_glyph(struct TextRendererInternalData* tr_data,
+                                                         const char** p, const char* end, int* repeat) {
+    const unsigned char c = (unsigned char)**p;
+    *repeat = 1;
+    if (c - 32u <= 126u - 32u) {
+        (*p)++;
+        return load_glyph_into_atlas(tr_data, c) ? &tr_data->glyph_cache[c - 32] : NULL;
+    }
+    if (c == '\t') {
+        (*p)++;
+        *repeat = DIFF_TAB_WIDTH;
+        return load_glyph_into_atlas(tr_data, ' ') ? &tr_data->glyph_cache[0] : NULL;
+    }
+    if (c < 0x80) {
+        (*p)++;
+        return NULL;
+    }
+    uint32_t codepoint;
+    size_t sequence = utf8_decode(*p, (size_t)(end - *p), &codepoint);
+    if (sequence == 0) {
+        (*p)++;
+        return &tr_data->replacement;
+    }
+    *p += sequence;
+    return extra_glyph(tr_data, codepoint);
+}
+
 int text_renderer_init(Renderer* renderer, const char* font_path_hint) {
     struct TextRendererInternalData* tr_data = calloc(1, sizeof(struct TextRendererInternalData));
     if (!tr_data) return 0;
@@ -112,6 +199,24 @@ font_loaded:
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
     glBindTexture(GL_TEXTURE_2D, 0);
 
+    // Заменяющий глиф: U+FFFD, если он есть в шрифте, иначе '?'
+    if (FT_Get_Char_Index(tr_data->ft_face, UTF8_REPLACEMENT) == 0 ||
+        !rasterize_glyph(tr_data, UTF8_REPLACEMENT, &tr_data->replacement)) {
+        if (load_glyph_into_atlas(tr_data, '?')) {
+            tr_data->replacement = tr_data->glyph_cache['?' - ASCII_PRINTABLE_START];
+        }
+    }
+    if (FT_IS_FIXED_WIDTH(tr_data->ft_face) && load_glyph_into_atlas(tr_data, ' ')) {
+        tr_data->column_advance = tr_data->glyph_cache[0].advance_x;
+    }
+
+    for (unsigned long digit = '0'; digit <= '9'; digit++) {
+        if (load_glyph_into_atlas(tr_data, digit) &&
+            tr_data->glyph_cache[digit - ASCII_PRINTABLE_START].advance_x > tr_data->digit_advance) {
+            tr_data->digit_advance = tr_data->glyph_cache[digit - ASCII_PRINTABLE_START].advance_x;
+        }
+    }
+
     renderer->text_internal_data_private = tr_data;
     return 1;
 }
@@ -129,24 +234,22 @@ void text_renderer_cleanup(Renderer* renderer) {
 }
 
 // --- ИЗМЕНЕННАЯ ФУНКЦИЯ ---
-void text_renderer_draw_text(Renderer* renderer, const char* text, float x, float y, float scale, uint32_t color, float max_width) {
+// Рисует ровно length байт текста: строки diff - это срезы общего буфера без '\0'
+void text_renderer_draw_text_n(Renderer* renderer, const char* text, size_t length, float x, float y, float scale, uint32_t color, float max_width) {
     if (!renderer || !renderer->text_internal_data_private || !text) return;
     struct TextRendererInternalData* tr_data = (struct TextRendererInternalData*)renderer->text_internal_data_private;
-
     if (!tr_data->is_freetype_initialized) return;
-
     float cursor_x = x;
-    for (const char* p = text; *p; p++) {
-        if (!load_glyph_into_atlas(tr_data, *p)) continue;
-        
-        struct glyph_cache_entry* glyph = &tr_data->glyph_cache[(unsigned char)*p - 32];
-        
+    for (const char* p = text, *end = text + length; p < end;) {
+        int repeat;
+        const struct glyph_cache_entry* glyph = next_glyph(tr_data, &p, end, &repeat);
+        if (!glyph) continue;
+        const float advance = glyph->advance_x * repeat * scale;
         // --- УЛУЧШЕНИЕ: Проверяем, помещается ли следующий символ ---
-        if (max_width > 0 && (cursor_x + glyph->advance_x * scale) > x + max_width) {
+        if (max_width > 0 && (cursor_x + advance) > x + max_width) {
             // Можно добавить отрисовку "..." здесь, если нужно
             break; 
         }
-
         if (glyph->width > 0 && glyph->height > 0) {
             float x_pos = cursor_x + glyph->bearing_x * scale;
             float y_pos = y - (glyph->height - glyph->bearing_y) * scale;
@@ -155,11 +258,82 @@ void text_renderer_draw_text(Renderer* renderer, const char* text, float x, floa
             renderer_draw_textured_quad(renderer, x_pos, y_pos, w, h,
                                       glyph->u0, glyph->v0, glyph->u1, glyph->v1, color);
         }
-        
-        cursor_x += glyph->advance_x * scale;
+        cursor_x += advance;
     }
 }
 
+// Ширина текста в пикселях: сумма продвижений глифов, как при отрисовке
+float text_renderer_measure_text_n(Renderer* renderer, const char* text, size_t length, float scale) {
+    if (!renderer || !renderer->text_internal_data_private || !text) return 0.0f;
+    struct TextRendererInternalData* tr_data = (struct TextRendererInternalData*)renderer->text_internal_data_private;
+    if (!tr_data->is_freetype_initialized) return 0.0f;
+    float width = 0.0f;
+    for (const char* p = text, *end = text + length; p < end;) {
+        int repeat;
+        const struct glyph_cache_entry* glyph = next_glyph(tr_data, &p, end, &repeat);
+        if (glyph) width += glyph->advance_x * repeat * scale;
+    }
+    return width;
+}
+
+// Первый байт, глиф которого начинается не левее x (length, если такого нет);
+// в *glyph_x записывается позиция этого глифа. Результат - всегда начало символа UTF-8
+size_t text_renderer_locate_text_n(Renderer* renderer, const char* text, size_t length, float scale, float x, float* glyph_x) {
+    float width = 0.0f;
+    size_t i = 0;
+    struct TextRendererInternalData* tr_data = renderer ? (struct TextRendererInternalData*)renderer->text_internal_data_private : NULL;
+    if (tr_data && tr_data->is_freetype_initialized && text) {
+        const char* end = text + length;
+        while (i < length && width < x) {
+            const char* p = text + i;
+            int repeat;
+            const struct glyph_cache_entry* glyph = next_glyph(tr_data, &p, end, &repeat);
+            if (glyph) width += glyph->advance_x * repeat * scale;
+            i = (size_t)(p - text);
+        }
+    }
+    if (glyph_x) *glyph_x = width;
+    return i;
+}
+
+float text_renderer_digit_width(Renderer* renderer, float scale) {
+    if (!renderer || !renderer->text_internal_data_private) return 0.0f;
+    struct TextRendererInternalData* tr_data = (struct TextRendererInternalData*)renderer->text_internal_data_private;
+    return tr_data->digit_advance * scale;
+}
+
+float text_renderer_column_width(Renderer* renderer, float scale) {
+    if (!renderer || !renderer->text_internal_data_private) return 0.0f;
+    struct TextRendererInternalData* tr_data = (struct TextRendererInternalData*)renderer->text_internal_data_private;
+    return tr_data->column_advance * scale;
+}
+
+// Число справа налево по готовым глифам цифр: без форматирования строки и без загрузки глифов
+void text_renderer_draw_number(Renderer* renderer, uint32_t value, float right_x, float y, float scale, uint32_t color) {
+    if (!renderer || !renderer->text_internal_data_private) return;
+    struct TextRendererInternalData* tr_data = (struct TextRendererInternalData*)renderer->text_internal_data_private;
+    if (!tr_data->is_freetype_initialized) return;
+    const float cell = tr_data->digit_advance * scale;
+    float cell_x = right_x;
+    do {
+        struct glyph_cache_entry* glyph = &tr_data->glyph_cache['0' + value % 10 - ASCII_PRINTABLE_START];
+        cell_x -= cell;
+        if (glyph->is_loaded && glyph->width > 0 && glyph->height > 0) {
+            // Узкие цифры центрируются в ячейке
+            float x_pos = cell_x + (cell - glyph->advance_x * scale) * 0.5f + glyph->bearing_x * scale;
+            float y_pos = y - (glyph->height - glyph->bearing_y) * scale;
+            renderer_draw_textured_quad(renderer, x_pos, y_pos, glyph->width * scale, glyph->height * scale,
+                                        glyph->u0, glyph->v0, glyph->u1, glyph->v1, color);
+        }
+        value /= 10;
+    } while (value > 0);
+}
+
+void text_renderer_draw_text(Renderer* renderer, const char* text, float x, float y, float scale, uint32_t color, float max_width) {
+    if (!text) return;
+    text_renderer_draw_text_n(renderer, text, strlen(text), x, y, scale, color, max_width);
+}
+
 GLuint renderer_get_font_atlas_texture(const Renderer* renderer) {
     if (!renderer || !renderer->text_internal_data_private) return 0;
     struct TextRendererInternalData* tr_data = (struct TextRendererInternalData*)renderer->text_internal_data_private;
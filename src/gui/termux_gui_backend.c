@@ -6,6 +6,7 @@
 #include "see_code/gui/renderer/gl_primitives.h" // Для рисования квадратов
 #include "see_code/gui/renderer/text_renderer.h" // Для рендеринга текста, если нужно
 #include "see_code/data/diff_data.h" // Для доступа к DiffData
+#include "see_code/data/diff_cold_store.h"
 #include "see_code/utils/logger.h"
 #include "see_code/core/config.h" // Для констант виджетов и других настроек
 #include "see_code/gui/widgets.h" // Для TextInputState и ButtonState
@@ -238,6 +239,14 @@ int termux_gui_backend_init(TermuxGUIBackend* backend) {
     return 1;
 }
 
+// Копирует срез буфера diff в строку с '\0' для API termux-gui (обрезает слишком длинные строки)
+static const char* span_to_cstr(const DiffData* data, DiffSpan span, char* out, size_t out_size) {
+    size_t length = span.length < out_size - 1 ? span.length : out_size - 1;
+    memcpy(out, diff_data_span_ptr(data, span), length);
+    out[length] = '\0';
+    return out;
+}
+
 // --- РЕАЛИЗАЦИЯ termux_gui_backend_render_diff БЕЗ ЗАГЛУШЕК ---
 void termux_gui_backend_render_diff(TermuxGUIBackend* backend, const DiffData* data) {
     if (!backend || !backend->initialized || !data) {
@@ -254,12 +263,18 @@ void termux_gui_backend_render_diff(TermuxGUIBackend* backend, const DiffData* d
     const int file_header_height = 30;
     const int screen_width = 1080; // Assume screen width
     const int screen_height = 1920; // Assume screen height
+    char text[1024]; // Временный буфер для текста View
 
     for (size_t i = 0; i < data->file_count; i++) {
         const DiffFile* file = &data->files[i];
-        if (file->path) {
+        if (file->path.length > 0) {
+            // Текст diff может быть сжат (diff_cold_store): читается только то, что
+            // выводится - путь каждого файла и секции раскрытых файлов
+            diff_cold_store_pin(data->cold, file->path.offset, file->path.length);
+            span_to_cstr(data, file->path, text, sizeof(text));
+            diff_cold_store_unpin(data->cold, file->path.offset, file->path.length);
             // Create a TextView for the file path
-            void* file_header_view = g_tgui_textview_create(backend->activity, file->path);
+            void* file_header_view = g_tgui_textview_create(backend->activity, text);
             if (file_header_view) {
                 g_tgui_view_set_position(file_header_view, x_margin, y_pos, screen_width - 2 * x_margin, file_header_height);
                 g_tgui_view_set_text_size(file_header_view, 18); // Larger font for file headers
@@ -267,17 +282,18 @@ void termux_gui_backend_render_diff(TermuxGUIBackend* backend, const DiffData* d
                 g_tgui_view_set_background_color(file_header_view, 0xFFEEEEEE); // Light gray background
                 g_tgui_view_set_id(file_header_view, backend->view_counter++); // Unique ID for file header
             }
-            log_debug("Rendering file: %s (Fallback)", file->path);
+            log_debug("Rendering file: %s (Fallback)", text);
         }
 
         y_pos += file_header_height + 10; // Spacing
 
         if (!file->is_collapsed) { // Only render hunks if file is expanded
+            diff_cold_store_pin(data->cold, file->section.offset, file->section.length);
             for (size_t j = 0; j < file->hunk_count; j++) {
-                const DiffHunk* hunk = &file->hunks[j];
-                if (hunk->header) {
+                const DiffHunk* hunk = &diff_data_file_hunks(data, file)[j];
+                if (hunk->header.length > 0) {
                     // Create a Button for the hunk header (collapsible)
-                    void* hunk_btn = g_tgui_button_create(backend->activity, hunk->header);
+                    void* hunk_btn = g_tgui_button_create(backend->activity, span_to_cstr(data, hunk->header, text, sizeof(text)));
                     if (hunk_btn) {
                          g_tgui_view_set_position(hunk_btn, x_margin + 10, y_pos, screen_width - 2 * (x_margin + 10), hunk_header_height);
                          g_tgui_view_set_text_size(hunk_btn, 14);
@@ -286,7 +302,7 @@ void termux_gui_backend_render_diff(TermuxGUIBackend* backend, const DiffData* d
                          // Assign an ID for event handling: file_index * 10000 + hunk_index
                          g_tgui_view_set_id(hunk_btn, i * 10000 + j);
                     }
-                    log_debug("  Rendering hunk: %s (Fallback)", hunk->header);
+                    log_debug("  Rendering hunk: %s (Fallback)", text);
                 }
 
                 y_pos += hunk_header_height + 5;
@@ -294,23 +310,23 @@ void termux_gui_backend_render_diff(TermuxGUIBackend* backend, const DiffData* d
                 if (!hunk->is_collapsed) { // Only render lines if hunk is expanded
                     // Render lines
                     for (size_t k = 0; k < hunk->line_count; k++) {
-                        const DiffLine* line = &hunk->lines[k];
-                        if (line->content) {
+                        const DiffLine line = diff_data_line(data, hunk->first_line + k);
+                        if (line.content.length > 0) {
                             // Create a TextView for the line content
-                            void* line_view = g_tgui_textview_create(backend->activity, line->content);
+                            void* line_view = g_tgui_textview_create(backend->activity, span_to_cstr(data, line.content, text, sizeof(text)));
                             if (line_view) {
                                 g_tgui_view_set_position(line_view, x_margin + 20, y_pos, screen_width - 2 * (x_margin + 20), line_height);
                                 g_tgui_view_set_text_size(line_view, 12);
                                 // Set color based on line type
                                 uint32_t color = 0xFF000000; // Default black
                                 uint32_t bg_color = 0xFFFFFFFF; // Default white background
-                                if (line->type == LINE_TYPE_ADD) {
+                                if (line.type == LINE_TYPE_ADD) {
                                     color = 0xFF00AA00; // Green text
                                     bg_color = 0xFFEEFFEE; // Light green background
-                                } else if (line->type == LINE_TYPE_DELETE) {
+                                } else if (line.type == LINE_TYPE_DELETE) {
                                     color = 0xFFAA0000; // Red text
                                     bg_color = 0xFFFFEEEE; // Light red background
-                                } else if (line->type == LINE_TYPE_CONTEXT) {
+                                } else if (line.type == LINE_TYPE_CONTEXT) {
                                     color = 0xFF888888; // Gray text
                                     bg_color = 0xFFF8F8F8; // Very light gray background
                                 }
@@ -319,7 +335,7 @@ void termux_gui_backend_render_diff(TermuxGUIBackend* backend, const DiffData* d
                                 // Assign an ID for potential future interaction
                                 g_tgui_view_set_id(line_view, backend->view_counter++);
                             }
-                            log_debug("    Line (%d): %.50s... (Fallback)", line->type, line->content);
+                            log_debug("    Line (%d): %.50s... (Fallback)", line.type, text);
                             y_pos += line_height + 2;
                         }
                     }
@@ -328,6 +344,7 @@ void termux_gui_backend_render_diff(TermuxGUIBackend* backend, const DiffData* d
                 // Add some spacing after hunk
                 y_pos += 5;
             }
+            diff_cold_store_unpin(data->cold, file->section.offset, file->section.length);
         } // if (!file->is_collapsed)
 
         // Add spacing after file
@@ -54,7 +54,8 @@ void termux_gui_backend_destroy(TermuxGUIBackend* backend);
  *
  * Creates native Android views to display the diff data. This includes
  * file headers, hunk headers (as buttons), and individual diff lines
- * with appropriate colors.
+ * with appropriate colors. Diff text held by data->cold is pinned while it
+ * is read: the path of every file and the section of every expanded file.
  *
  * @param backend The initialized backend instance.
  * @param data The diff data to render. Can be NULL (will show empty state).
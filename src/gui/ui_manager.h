@@ -13,15 +13,71 @@ typedef struct ButtonState ButtonState;
 
 // Forward declaration
 typedef struct UIManager UIManager;
+// Layout index, render caches and scroll offsets of one diff
+typedef struct UIDiffView UIDiffView;
 
 // UI Manager functions
 UIManager* ui_manager_create(Renderer* renderer);
 void ui_manager_destroy(UIManager* ui_manager);
+// Shows data in the current view, dropping the view's layout and caches
+// (call after the diff was loaded or reloaded)
 void ui_manager_set_diff_data(UIManager* ui_manager, DiffData* data);
+// Same for data rebuilt from previous (still alive): render caches of the
+// files it copied unchanged are kept (see DiffData.reused_files)
+void ui_manager_reload_diff_data(UIManager* ui_manager, const DiffData* previous, DiffData* data);
+
+// Views let the owner of several diffs switch between them without
+// rebuilding the layout index or losing the scroll position. A view's caches
+// stay valid only while its diff is unchanged: after changing a diff that is
+// not shown, call ui_diff_view_reset() (or ui_diff_view_reload() when it was
+// rebuilt from a previous version).
+UIDiffView* ui_diff_view_create(void);
+void ui_diff_view_destroy(UIDiffView* view);
+void ui_diff_view_reset(UIDiffView* view, const DiffData* data);
+void ui_diff_view_reload(UIDiffView* view, const DiffData* previous, const DiffData* data);
+// Bytes held by the view (the caches are bounded LRUs and not counted)
+size_t ui_diff_view_memory_usage(const UIDiffView* view);
+// Shows data with the layout, caches and scroll offsets kept in view
+// (NULL means the UI manager's own view). The view must outlive its use.
+void ui_manager_show_view(UIManager* ui_manager, DiffData* data, UIDiffView* view);
+// Text drawn next to the menu button (e.g. the name of the shown diff)
+void ui_manager_set_title(UIManager* ui_manager, const char* title);
+// Returns 1 once after the menu button was pressed
+int ui_manager_take_menu_request(UIManager* ui_manager);
+void ui_manager_update(UIManager* ui_manager, float delta_time);
+// The search scans diff_data on worker threads without a lock: pause it
+// before changing the data, and resume it after new files were appended
+// (ui_manager_set_diff_data restarts it on its own)
+void ui_manager_pause_search(UIManager* ui_manager);
+void ui_manager_resume_search(UIManager* ui_manager);
 void ui_manager_update_layout(UIManager* ui_manager, float scroll_y);
+// Horizontal scroll of line text, clamped to the longest line of the last
+// frame; returns the offset actually applied
+float ui_manager_set_scroll_x(UIManager* ui_manager, float scroll_x);
+// Scroll offsets, which search navigation may change
+float ui_manager_get_scroll_y(const UIManager* ui_manager);
+float ui_manager_get_scroll_x(const UIManager* ui_manager);
 void ui_manager_render(UIManager* ui_manager);
 int ui_manager_handle_touch(UIManager* ui_manager, float x, float y);
 float ui_manager_get_content_height(UIManager* ui_manager);
+// Collapse or expand a file / a hunk (hunk index is relative to the file).
+// Expanding a file of a lazily loaded diff parses its hunks first.
+void ui_manager_set_file_collapsed(UIManager* ui_manager, size_t file, int collapsed);
+void ui_manager_set_hunk_collapsed(UIManager* ui_manager, size_t file, size_t hunk, int collapsed);
+// Parses the hunks of a file of a lazily loaded diff if that was not done yet
+// (see diff_parser_parse_file()) and indexes them. Returns 0 on failure.
+int ui_manager_parse_file(UIManager* ui_manager, size_t file);
+// Unified layout, or old and new text in two panes next to each other. The
+// side-by-side rows are built by the parser, so switching needs no reparse.
+void ui_manager_set_side_by_side(UIManager* ui_manager, int side_by_side);
+int ui_manager_is_side_by_side(const UIManager* ui_manager);
+// Directory the diff's paths are relative to, for reading context lines
+// from the working tree (NULL means the current directory)
+void ui_manager_set_work_tree(UIManager* ui_manager, const char* path);
+// Shows CONTEXT_EXPAND_LINES more unchanged lines above a hunk, read from
+// the working-tree file. Refuses (returns 0) when there is nothing left to
+// show or the file no longer matches the diff.
+int ui_manager_expand_hunk_context(UIManager* ui_manager, size_t file, size_t hunk);
 
 // --- НОВАЯ ФУНКЦИЯ ДЛЯ ОБРАБОТКИ КЛАВИШ (New) ---
 void ui_manager_handle_key(UIManager* ui_manager, int key_code);
@@ -1,31 +1,21 @@
 // src/gui/ui_manager_core.c
 #include "see_code/gui/ui_manager.h"
+#include "see_code/gui/ui_manager_internal.h"
 #include "see_code/gui/renderer.h"
 #include "see_code/gui/termux_gui_backend.h"
+#include "see_code/data/diff_parser.h" // Разбор файлов ленивой загрузки
 #include "see_code/gui/widgets.h" // Для новых виджетов
 #include "see_code/utils/logger.h"
 #include "see_code/core/config.h" // Для констант
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
 // Предполагаем, что эта функция существует в app.c для получения времени
 extern unsigned long long app_get_time_millis(void);
 
-// --- Внутренняя структура менеджера UI ---
-// Определяем структуру здесь, так как она приватная для этого модуля
-struct UIManager {
-    Renderer* renderer; // Может быть NULL, если используется Termux-GUI
-    TermuxGUIBackend* termux_backend; // Backend для fallback
-    DiffData* diff_data;
-    float scroll_y;
-    float content_height;
-    RendererType active_renderer;
-    int needs_redraw;
-    // --- ПОЛЯ ДЛЯ НОВЫХ ВИДЖЕТОВ ---
-    TextInputState* input_field;  // Указатель на состояние текстового поля ввода
-    ButtonState* menu_button;     // Указатель на состояние кнопки "..."
-    // --- КОНЕЦ ПОЛЕЙ ДЛЯ НОВЫХ ВИДЖЕТОВ ---
-};
+// Структура UIManager определена в ui_manager_internal.h,
+// общем для всех файлов модуля
 
 // Вспомогательная функция для определения типа рендерера
 static RendererType ui_manager_determine_renderer_type(const UIManager* ui_manager) {
@@ -35,6 +25,70 @@ static RendererType ui_manager_determine_renderer_type(const UIManager* ui_manag
     return RENDERER_TYPE_UNKNOWN;
 }
 
+// --- Состояние просмотра diff ---
+
+UIDiffView* ui_diff_view_create(void) {
+    UIDiffView* view = malloc(sizeof(UIDiffView));
+    if (!view) {
+        log_error("Failed to allocate memory for UIDiffView");
+        return NULL;
+    }
+    memset(view, 0, sizeof(UIDiffView));
+    layout_index_init(&view->layout);
+    intraline_cache_init(&view->intraline);
+    moved_lines_init(&view->moved);
+    line_advance_cache_init(&view->advances);
+    source_file_cache_init(&view->sources);
+    return view;
+}
+
+void ui_diff_view_destroy(UIDiffView* view) {
+    if (!view) {
+        return;
+    }
+    layout_index_destroy(&view->layout);
+    intraline_cache_destroy(&view->intraline);
+    moved_lines_destroy(&view->moved);
+    line_advance_cache_destroy(&view->advances);
+    source_file_cache_destroy(&view->sources);
+    free(view);
+}
+
+void ui_diff_view_reset(UIDiffView* view, const DiffData* data) {
+    if (!view) {
+        return;
+    }
+    // Индекс разметки строится заново; файлы, приходящие потоком, дописываются в него при отрисовке
+    layout_index_reset(&view->layout, data);
+    // Номера ханков после перезагрузки указывают на другие ханки
+    intraline_cache_clear(&view->intraline);
+    moved_lines_clear(&view->moved);
+    line_advance_cache_clear(&view->advances);
+    // Файл мог измениться вместе с diff; раскрытый контекст сброшен вместе с разметкой
+    source_file_cache_clear(&view->sources);
+    // Прокрутка сохраняется и ограничивается новой высотой при отрисовке
+}
+
+void ui_diff_view_reload(UIDiffView* view, const DiffData* previous, const DiffData* data) {
+    if (!view) {
+        return;
+    }
+    layout_index_reset(&view->layout, data);
+    // Кэши неизменившихся файлов переходят на их новые номера ханков и строк
+    intraline_cache_remap(&view->intraline, previous, data);
+    line_advance_cache_remap(&view->advances, previous, data);
+    // Перенос блоков зависит от всех файлов сразу и ищется заново
+    moved_lines_clear(&view->moved);
+    source_file_cache_clear(&view->sources);
+}
+
+size_t ui_diff_view_memory_usage(const UIDiffView* view) {
+    return view ? sizeof(UIDiffView) + layout_index_memory_usage(&view->layout) +
+                  source_file_cache_memory_usage(&view->sources) + moved_lines_memory_usage(&view->moved) : 0;
+}
+
+// --- Создание и уничтожение ---
+
 UIManager* ui_manager_create(Renderer* renderer) {
     UIManager* ui_manager = malloc(sizeof(UIManager));
     if (!ui_manager) {
@@ -44,10 +98,28 @@ UIManager* ui_manager_create(Renderer* renderer) {
     memset(ui_manager, 0, sizeof(UIManager));
     ui_manager->renderer = renderer;
     ui_manager->termux_backend = NULL; // Будет установлен позже, если используется fallback
-    ui_manager->scroll_y = 0.0f;
     ui_manager->content_height = 0.0f;
     ui_manager->needs_redraw = 1;
     ui_manager->diff_data = NULL;
+    ui_manager->own_view = ui_diff_view_create();
+    if (!ui_manager->own_view) {
+        free(ui_manager);
+        return NULL;
+    }
+    ui_manager->view = ui_manager->own_view;
+    if (!diff_search_init(&ui_manager->search)) {
+        log_error("Failed to initialize diff search");
+        ui_diff_view_destroy(ui_manager->own_view);
+        free(ui_manager);
+        return NULL;
+    }
+    if (!syntax_cache_init(&ui_manager->syntax)) {
+        log_error("Failed to start syntax highlighter");
+        diff_search_destroy(&ui_manager->search);
+        ui_diff_view_destroy(ui_manager->own_view);
+        free(ui_manager);
+        return NULL;
+    }
     ui_manager->active_renderer = ui_manager_determine_renderer_type(ui_manager);
 
     // --- ИНИЦИАЛИЗАЦИЯ ВИДЖЕТОВ ---
@@ -66,6 +138,9 @@ UIManager* ui_manager_create(Renderer* renderer) {
         if (ui_manager->menu_button) free(ui_manager->menu_button);
         ui_manager->input_field = NULL;
         ui_manager->menu_button = NULL;
+        diff_search_destroy(&ui_manager->search);
+        syntax_cache_destroy(&ui_manager->syntax);
+        ui_diff_view_destroy(ui_manager->own_view);
         free(ui_manager);
         return NULL;
     }
@@ -86,6 +161,9 @@ UIManager* ui_manager_create(Renderer* renderer) {
         free(ui_manager->menu_button);
         ui_manager->input_field = NULL;
         ui_manager->menu_button = NULL;
+        diff_search_destroy(&ui_manager->search);
+        syntax_cache_destroy(&ui_manager->syntax);
+        ui_diff_view_destroy(ui_manager->own_view);
         free(ui_manager);
         return NULL;
         // --- КОНЕЦ ИСПРАВЛЕНИЯ ---
@@ -111,6 +189,9 @@ UIManager* ui_manager_create(Renderer* renderer) {
         free(ui_manager->menu_button);
         ui_manager->input_field = NULL;
         ui_manager->menu_button = NULL;
+        diff_search_destroy(&ui_manager->search);
+        syntax_cache_destroy(&ui_manager->syntax);
+        ui_diff_view_destroy(ui_manager->own_view);
         free(ui_manager);
         return NULL;
         // --- КОНЕЦ ИСПРАВЛЕНИЯ ---
@@ -140,6 +221,12 @@ void ui_manager_destroy(UIManager* ui_manager) {
     }
     // --- КОНЕЦ ОЧИСТКИ ВИДЖЕТОВ ---
 
+    // Виды вкладок принадлежат их владельцу, здесь уничтожается только свой
+    ui_diff_view_destroy(ui_manager->own_view);
+    // Ждет рабочих поиска: они читают diff_data
+    diff_search_destroy(&ui_manager->search);
+    syntax_cache_destroy(&ui_manager->syntax);
+    free(ui_manager->work_tree);
     // Освобождаем саму структуру
     free(ui_manager);
     log_info("UIManager destroyed");
@@ -150,21 +237,121 @@ void ui_manager_set_diff_data(UIManager* ui_manager, DiffData* data) {
         return;
     }
     ui_manager->diff_data = data;
+    ui_diff_view_reset(ui_manager->view, data);
+    syntax_cache_clear(&ui_manager->syntax);
+    // Текущий запрос ищется заново уже в новых данных
+    diff_search_stop(&ui_manager->search);
+    diff_search_refresh(&ui_manager->search, data, 0);
     ui_manager->needs_redraw = 1; // Требуется перерисовка
-    // content_height будет обновлен в ui_manager_update_layout
+}
+
+void ui_manager_reload_diff_data(UIManager* ui_manager, const DiffData* previous, DiffData* data) {
+    if (!ui_manager) {
+        return;
+    }
+    ui_manager->diff_data = data;
+    ui_diff_view_reload(ui_manager->view, previous, data);
+    syntax_cache_remap(&ui_manager->syntax, previous, data);
+    diff_search_stop(&ui_manager->search);
+    diff_search_refresh(&ui_manager->search, data, 0);
+    ui_manager->needs_redraw = 1;
+}
+
+void ui_manager_show_view(UIManager* ui_manager, DiffData* data, UIDiffView* view) {
+    if (!ui_manager) {
+        return;
+    }
+    // Разметка и кэши вида остаются от прошлого показа этого diff
+    ui_manager->view = view ? view : ui_manager->own_view;
+    // Вид мог быть размечен в другом режиме, пока был скрыт
+    layout_index_set_side_by_side(&ui_manager->view->layout, ui_manager->side_by_side);
+    ui_manager->diff_data = data;
+    // Кэш подсветки общий: он сам очищается при смене diff
+    diff_search_stop(&ui_manager->search);
+    diff_search_refresh(&ui_manager->search, data, 0);
+    ui_manager->needs_redraw = 1;
+}
+
+void ui_manager_set_title(UIManager* ui_manager, const char* title) {
+    if (!ui_manager) {
+        return;
+    }
+    snprintf(ui_manager->title, sizeof(ui_manager->title), "%s", title ? title : "");
+    ui_manager->needs_redraw = 1;
+}
+
+int ui_manager_take_menu_request(UIManager* ui_manager) {
+    if (!ui_manager || !ui_manager->menu_requested) {
+        return 0;
+    }
+    ui_manager->menu_requested = 0;
+    return 1;
+}
+
+void ui_manager_update(UIManager* ui_manager, float delta_time) {
+    (void)delta_time;
+    if (!ui_manager) {
+        return;
+    }
+    // Поиск публикует результаты из пула потоков, кадр перерисовывается по мере их прихода
+    if (diff_search_take_updates(&ui_manager->search)) {
+        ui_manager->needs_redraw = 1;
+    }
+    // Строки, раскрашенные в фоне, перерисовываются уже в цвете
+    if (syntax_cache_take_updates(&ui_manager->syntax)) {
+        ui_manager->needs_redraw = 1;
+    }
+    // Перенесенные блоки ищутся в фоне; найденные раскрашиваются следующим кадром
+    if (ui_manager->view && moved_lines_take_updates(&ui_manager->view->moved)) {
+        ui_manager->needs_redraw = 1;
+    }
+}
+
+void ui_manager_pause_search(UIManager* ui_manager) {
+    if (!ui_manager) {
+        return;
+    }
+    diff_search_stop(&ui_manager->search);
+}
+
+void ui_manager_resume_search(UIManager* ui_manager) {
+    if (!ui_manager) {
+        return;
+    }
+    diff_search_refresh(&ui_manager->search, ui_manager->diff_data, 1);
 }
 
 void ui_manager_update_layout(UIManager* ui_manager, float scroll_y) {
     if (!ui_manager) {
         return;
     }
-    ui_manager->scroll_y = scroll_y;
-    // Пересчитываем высоту содержимого
-    // TODO: Реализовать логику расчета высоты содержимого
-    // ui_manager->content_height = calculate_content_height(ui_manager);
+    ui_manager->view->scroll_y = scroll_y;
+    ui_manager->content_height = ui_manager_get_content_height(ui_manager);
     ui_manager->needs_redraw = 1; // Требуется перерисовка
 }
 
+float ui_manager_get_scroll_y(const UIManager* ui_manager) {
+    return ui_manager ? ui_manager->view->scroll_y : 0.0f;
+}
+
+float ui_manager_get_scroll_x(const UIManager* ui_manager) {
+    return ui_manager ? ui_manager->view->scroll_x : 0.0f;
+}
+
+// Сдвиг ограничен длиной самой длинной строки, показанной в последнем кадре
+float ui_manager_set_scroll_x(UIManager* ui_manager, float scroll_x) {
+    if (!ui_manager) {
+        return 0.0f;
+    }
+    if (scroll_x > ui_manager->view->max_scroll_x) scroll_x = ui_manager->view->max_scroll_x;
+    if (scroll_x < 0.0f) scroll_x = 0.0f;
+    if (scroll_x != ui_manager->view->scroll_x) {
+        ui_manager->view->scroll_x = scroll_x;
+        ui_manager->needs_redraw = 1;
+    }
+    return scroll_x;
+}
+
 // Функция для получения типа рендерера, с которым работает UI Manager
 RendererType ui_manager_get_renderer_type(const UIManager* ui_manager) {
     return ui_manager_determine_renderer_type(ui_manager);
@@ -187,7 +374,177 @@ float ui_manager_get_content_height(UIManager* ui_manager) {
     if (!ui_manager) {
         return 0.0f;
     }
-    // TODO: Реализовать логику расчета высоты содержимого
-    // return ui_manager->content_height;
-    return 1000.0f; // Заглушка
+    // Верхний отступ + все файлы, включая пришедшие с последней синхронизации
+    layout_index_sync(&ui_manager->view->layout, ui_manager->diff_data);
+    return (float)(MARGIN + layout_index_total_height(&ui_manager->view->layout));
+}
+
+// --- Сворачивание ---
+// Флаг хранится в DiffData, индекс разметки обновляется за O(log n)
+
+int ui_manager_parse_file(UIManager* ui_manager, size_t file) {
+    if (!ui_manager || !ui_manager->diff_data || file >= ui_manager->diff_data->file_count) {
+        return 0;
+    }
+    DiffData* data = ui_manager->diff_data;
+    if (diff_data_file_is_parsed(&data->files[file])) {
+        return 1;
+    }
+    // Поиск не останавливается: неразобранный файл он ищет по тексту секции с теми же
+    // номерами строк, а ячейки читает только после флага разбора
+    if (!diff_parser_parse_file(data, file)) {
+        log_error("Failed to parse hunks of file %zu", file);
+        return 0;
+    }
+    layout_index_sync(&ui_manager->view->layout, data);
+    layout_index_update_file_hunks(&ui_manager->view->layout, file);
+    // Перенесенные блоки не пересчитываются: файл хеширован по тексту секции
+    // с теми же номерами строк
+    ui_manager->needs_redraw = 1;
+    return 1;
+}
+
+void ui_manager_set_file_collapsed(UIManager* ui_manager, size_t file, int collapsed) {
+    if (!ui_manager || !ui_manager->diff_data || file >= ui_manager->diff_data->file_count) {
+        return;
+    }
+    if (!collapsed && !ui_manager_parse_file(ui_manager, file)) {
+        return;
+    }
+    // Флаг читает и поток сокета, собирающий новую версию diff
+    __atomic_store_n(&ui_manager->diff_data->files[file].is_collapsed, collapsed ? 1 : 0, __ATOMIC_RELAXED);
+    layout_index_update_file(&ui_manager->view->layout, file);
+    ui_manager->needs_redraw = 1;
+}
+
+void ui_manager_set_hunk_collapsed(UIManager* ui_manager, size_t file, size_t hunk, int collapsed) {
+    if (!ui_manager || !ui_manager->diff_data || file >= ui_manager->diff_data->file_count) {
+        return;
+    }
+    DiffFile* diff_file = &ui_manager->diff_data->files[file];
+    if (hunk >= diff_file->hunk_count) {
+        return;
+    }
+    __atomic_store_n(&diff_data_file_hunks(ui_manager->diff_data, diff_file)[hunk].is_collapsed,
+                     collapsed ? 1 : 0, __ATOMIC_RELAXED);
+    layout_index_update_hunk(&ui_manager->view->layout, file, hunk);
+    ui_manager->needs_redraw = 1;
+}
+
+// --- Режим "рядом" ---
+
+void ui_manager_set_side_by_side(UIManager* ui_manager, int side_by_side) {
+    if (!ui_manager || ui_manager->side_by_side == (side_by_side ? 1 : 0)) {
+        return;
+    }
+    ui_manager->side_by_side = side_by_side ? 1 : 0;
+    UIDiffView* view = ui_manager->view;
+    LayoutIndex* layout = &view->layout;
+    // Ханк, заголовок которого был вверху экрана, остается на том же месте
+    LayoutPosition top;
+    memset(&top, 0, sizeof(top));
+    const int has_layout = ui_manager->diff_data && layout_index_sync(layout, ui_manager->diff_data) && layout->file_count > 0;
+    if (has_layout) {
+        top = layout_index_locate(layout, (double)view->scroll_y - MARGIN);
+    }
+    layout_index_set_side_by_side(layout, ui_manager->side_by_side);
+    if (has_layout && layout_index_sync(layout, ui_manager->diff_data)) {
+        const double scroll = view->scroll_y + layout_index_hunk_top(layout, top.file, top.hunk) - top.hunk_top;
+        view->scroll_y = scroll > 0.0 ? (float)scroll : 0.0f;
+    }
+    // Ширина текста изменилась: предел прокрутки посчитает следующий кадр
+    view->scroll_x = 0.0f;
+    ui_manager->needs_redraw = 1;
+}
+
+int ui_manager_is_side_by_side(const UIManager* ui_manager) {
+    return ui_manager ? ui_manager->side_by_side : 0;
+}
+
+// --- Контекст из рабочего дерева ---
+
+void ui_manager_set_work_tree(UIManager* ui_manager, const char* path) {
+    if (!ui_manager) {
+        return;
+    }
+    free(ui_manager->work_tree);
+    ui_manager->work_tree = path && path[0] ? strdup(path) : NULL;
+    if (path && path[0] && !ui_manager->work_tree) {
+        log_error("Failed to copy work tree path %s", path);
+    }
+}
+
+// Номер первой строки новой версии, которую показывает ханк (или перед которой
+// он удаляет строки), и номер первой строки после него
+static uint32_t hunk_new_first(const DiffHunk* hunk) {
+    return hunk->new_count ? hunk->new_start : hunk->new_start + 1;
+}
+
+static uint32_t hunk_new_end(const DiffHunk* hunk) {
+    return hunk->new_count ? hunk->new_start + hunk->new_count : hunk->new_start + 1;
+}
+
+// Строка файла совпадает с первой строкой ханка в новой версии: иначе файл
+// изменился после diff (или diff сравнивает не с рабочим деревом) и номера строк врут
+static int source_matches_hunk(const DiffData* data, const DiffHunk* hunk, SourceFile* source) {
+    const DiffLineTable* table = &data->lines;
+    for (size_t k = 0; k < hunk->line_count; k++) {
+        const size_t line = hunk->first_line + k;
+        if (!table->new_numbers[line]) {
+            continue;
+        }
+        const char* text = NULL;
+        size_t length = 0;
+        if (!source_file_line(source, table->new_numbers[line], &text, &length)) {
+            return 0;
+        }
+        // В diff строка идет после префикса '+' или ' ', '\r' перед переводом строки остается в ней
+        const size_t diff_length = table->lengths[line] > 1 ? table->lengths[line] - 1 : 0;
+        const char* diff_text = data->buffer + table->offsets[line] + 1;
+        return diff_length == length && memcmp(diff_text, text, length) == 0;
+    }
+    return 1; // Ханк только удаляет строки: сверять нечего
+}
+
+int ui_manager_expand_hunk_context(UIManager* ui_manager, size_t file, size_t hunk) {
+    if (!ui_manager || !ui_manager->diff_data || file >= ui_manager->diff_data->file_count) {
+        return 0;
+    }
+    const DiffData* data = ui_manager->diff_data;
+    const DiffFile* diff_file = &data->files[file];
+    if (hunk >= diff_file->hunk_count) {
+        return 0;
+    }
+    UIDiffView* view = ui_manager->view;
+    layout_index_sync(&view->layout, data);
+    const DiffHunk* hunks = diff_data_file_hunks(data, diff_file);
+    // Разрыв между концом предыдущего ханка и началом этого в новой версии файла
+    const uint32_t gap_start = hunk > 0 ? hunk_new_end(&hunks[hunk - 1]) : 1;
+    const uint32_t first = hunk_new_first(&hunks[hunk]);
+    const uint32_t shown = layout_index_hunk_context(&view->layout, file, hunk);
+    if (first <= gap_start + shown) {
+        return 0; // Разрыв уже раскрыт целиком
+    }
+    uint32_t rows = first - gap_start - shown;
+    if (rows > CONTEXT_EXPAND_LINES) rows = CONTEXT_EXPAND_LINES;
+
+    SourceFile* source = source_file_cache_get(&view->sources, data, file, ui_manager->work_tree);
+    const char* text = NULL;
+    size_t length = 0;
+    if (!source || !source_file_line(source, first - 1, &text, &length)) {
+        log_warn("Cannot expand context of hunk %zu: file %zu is not readable in the work tree", hunk, file);
+        return 0;
+    }
+    if (!source_matches_hunk(data, &hunks[hunk], source)) {
+        log_warn("Cannot expand context of hunk %zu: file %zu differs from the diff", hunk, file);
+        return 0;
+    }
+    if (!layout_index_set_hunk_context(&view->layout, file, hunk, shown + rows)) {
+        return 0;
+    }
+    if (hunks[hunk].is_collapsed) {
+        ui_manager_set_hunk_collapsed(ui_manager, file, hunk, 0);
+    }
+    ui_manager->needs_redraw = 1;
+    return 1;
 }
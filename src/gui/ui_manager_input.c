@@ -1,10 +1,95 @@
 // src/gui/ui_manager_input.c
 #include "see_code/gui/ui_manager.h"
+#include "see_code/gui/ui_manager_internal.h"
 #include "see_code/gui/widgets.h" // Для новых виджетов
 #include "see_code/utils/logger.h"
+#include "see_code/core/config.h" // Для размеров строк и ханков
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 
+// --- Переход к строке ---
+
+// Ханк файла, в котором лежит строка (бинарный поиск по first_line)
+static size_t find_line_hunk(const DiffData* data, const DiffFile* file, size_t line) {
+    const DiffHunk* hunks = diff_data_file_hunks(data, file);
+    size_t lo = 0, hi = file->hunk_count;
+    while (hi - lo > 1) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (hunks[mid].first_line <= line) lo = mid; else hi = mid;
+    }
+    return lo;
+}
+
+// Ряд строки k ханка: в общем виде это сама строка, в режиме "рядом" -
+// ряд таблицы выравнивания, где она стоит
+static size_t hunk_line_row(const UIManager* ui_manager, const DiffHunk* hunk, size_t k) {
+    if (!ui_manager->side_by_side) {
+        return k;
+    }
+    const DiffLineTable* table = &ui_manager->diff_data->lines;
+    for (size_t r = 0; r < hunk->row_count; r++) {
+        if (table->row_left[hunk->first_line + r] == k || table->row_right[hunk->first_line + r] == k) {
+            return r;
+        }
+    }
+    return 0;
+}
+
+// Раскрывает файл и ханк строки и прокручивает так, чтобы она оказалась
+// на трети высоты экрана
+static void reveal_line(UIManager* ui_manager, size_t file_index, size_t line) {
+    DiffData* data = ui_manager->diff_data;
+    // Пара перенесенной строки может лежать в файле, который еще не разобран
+    if (!ui_manager_parse_file(ui_manager, file_index) || data->files[file_index].hunk_count == 0) {
+        return;
+    }
+    layout_index_sync(&ui_manager->view->layout, data);
+    DiffFile* file = &data->files[file_index];
+    if (file->is_collapsed) {
+        ui_manager_set_file_collapsed(ui_manager, file_index, 0);
+    }
+    size_t hunk = find_line_hunk(data, file, line);
+    const DiffHunk* diff_hunk = &diff_data_file_hunks(data, file)[hunk];
+    if (diff_hunk->is_collapsed) {
+        ui_manager_set_hunk_collapsed(ui_manager, file_index, hunk, 0);
+    }
+    const uint32_t context_rows = layout_index_hunk_context(&ui_manager->view->layout, file_index, hunk);
+    const double y = layout_index_hunk_top(&ui_manager->view->layout, file_index, hunk) + HUNK_HEADER_HEIGHT + HUNK_PADDING +
+                     ((double)context_rows + hunk_line_row(ui_manager, diff_hunk, line - diff_hunk->first_line)) * LINE_HEIGHT;
+    const float view_height = ui_manager->renderer ? renderer_get_height(ui_manager->renderer) : WINDOW_HEIGHT_DEFAULT;
+    double scroll = y - view_height / 3.0;
+    ui_manager->view->scroll_y = scroll > 0.0 ? (float)scroll : 0.0f;
+    ui_manager->needs_redraw = 1;
+}
+
+// Строка ханка под точкой касания (SIZE_MAX над строками, на раскрытом
+// контексте и на пустой половине ряда "рядом")
+static size_t touched_line(const UIManager* ui_manager, const LayoutPosition* position, double content_y, float x) {
+    const DiffData* data = ui_manager->diff_data;
+    const DiffHunk* hunk = &diff_data_file_hunks(data, &data->files[position->file])[position->hunk];
+    if (hunk->is_collapsed) {
+        return SIZE_MAX;
+    }
+    const double rows_y = content_y - position->hunk_top - HUNK_HEADER_HEIGHT - HUNK_PADDING;
+    const uint32_t context_rows = layout_index_hunk_context(&ui_manager->view->layout, position->file, position->hunk);
+    if (rows_y < (double)context_rows * LINE_HEIGHT) {
+        return SIZE_MAX;
+    }
+    const size_t row = (size_t)(rows_y / LINE_HEIGHT) - context_rows;
+    if (!ui_manager->side_by_side) {
+        return row < hunk->line_count ? hunk->first_line + row : SIZE_MAX;
+    }
+    if (row >= hunk->row_count) {
+        return SIZE_MAX;
+    }
+    // Половины ряда делят экран пополам
+    const float screen_width = ui_manager->renderer ? renderer_get_width(ui_manager->renderer) : WINDOW_WIDTH_DEFAULT;
+    const DiffLineTable* table = &data->lines;
+    const uint32_t cell = x < screen_width / 2 ? table->row_left[hunk->first_line + row] : table->row_right[hunk->first_line + row];
+    return cell == DIFF_ROW_FILLER ? SIZE_MAX : hunk->first_line + cell;
+}
+
 // --- ОБНОВЛЕННЫЕ ФУНКЦИИ ОБРАБОТКИ ВВОДА ---
 
 int ui_manager_handle_touch(UIManager* ui_manager, float x, float y) {
@@ -22,9 +107,8 @@ int ui_manager_handle_touch(UIManager* ui_manager, float x, float y) {
         widget_handled = button_handle_click(ui_manager->menu_button, x, y);
         if (widget_handled) {
             log_info("Menu button clicked!");
-            // TODO: Добавить логику обработки нажатия кнопки (открытие меню и т.д.)
-            // Например, можно вызвать callback или установить флаг в ui_manager
-            // ui_manager->menu_button_pressed = 1;
+            // Событие забирает владелец UI (переключение вкладок diff)
+            ui_manager->menu_requested = 1;
         }
     }
     // Если событие было обработано виджетом, возвращаем 1
@@ -34,18 +118,82 @@ int ui_manager_handle_touch(UIManager* ui_manager, float x, float y) {
     }
     // --- КОНЕЦ ОБРАБОТКИ СОБЫТИЙ ВИДЖЕТОВ ---
 
-    // TODO: Добавить обработку кликов по diff-данным, если они есть
-    // Это сложная логика, которая уже может существовать в оригинальном ui_manager_input.c
-    // Пример:
-    // if (ui_manager->diff_data) {
-    //     // Логика обработки кликов по файлам/ханкам/строкам
-    //     // ...
-    //     // ui_manager->needs_redraw = 1; // Если состояние diff изменилось
-    // }
-    
+    // Касание заголовка файла сворачивает или разворачивает его (файлы большого diff
+    // загружаются свернутыми), касание заголовка ханка раскрывает строки рабочего дерева над ним
+    if (ui_manager->diff_data && ui_manager->diff_data->file_count > 0) {
+        LayoutIndex* layout = &ui_manager->view->layout;
+        layout_index_sync(layout, ui_manager->diff_data);
+        const double content_y = (double)ui_manager->view->scroll_y + y - MARGIN;
+        const LayoutPosition position = layout_index_locate(layout, content_y);
+        const DiffFile* file = &ui_manager->diff_data->files[position.file];
+        if (content_y >= position.file_top && content_y < position.file_top + FILE_HEADER_HEIGHT) {
+            ui_manager_set_file_collapsed(ui_manager, position.file, !file->is_collapsed);
+            return 1;
+        }
+        if (!file->is_collapsed && file->hunk_count > 0 &&
+            content_y >= position.hunk_top && content_y < position.hunk_top + HUNK_HEADER_HEIGHT) {
+            return ui_manager_expand_hunk_context(ui_manager, position.file, position.hunk);
+        }
+        // Касание перенесенной строки переходит к ее паре в другом месте diff
+        if (!file->is_collapsed && file->hunk_count > 0) {
+            const size_t line = touched_line(ui_manager, &position, content_y, x);
+            const uint32_t counterpart = line != SIZE_MAX ? moved_lines_counterpart(&ui_manager->view->moved, line) : MOVED_NONE;
+            if (counterpart != MOVED_NONE) {
+                reveal_line(ui_manager, diff_data_line_file(ui_manager->diff_data, counterpart), counterpart);
+                return 1;
+            }
+        }
+    }
+
     return widget_handled; // 0, если никто не обработал
 }
 
+// --- Поиск ---
+
+// Показывает совпадение: путь файла или строку, которую по горизонтали
+// покажет следующий кадр
+static void reveal_match(UIManager* ui_manager, const DiffSearchMatch* match) {
+    DiffData* data = ui_manager->diff_data;
+    if (!data || match->file >= data->file_count) {
+        return;
+    }
+    // Совпадение в файле, который еще не разобран, найдено по тексту секции:
+    // файл разбирается, и строка совпадения занимает свою ячейку
+    if (!match->is_path && ui_manager_parse_file(ui_manager, match->file) && data->files[match->file].hunk_count > 0) {
+        reveal_line(ui_manager, match->file, match->line);
+        ui_manager->search_reveal = 1;
+        return;
+    }
+    layout_index_sync(&ui_manager->view->layout, data);
+    const double y = match->is_path ? layout_index_file_top(&ui_manager->view->layout, match->file) : 0.0;
+    const float view_height = ui_manager->renderer ? renderer_get_height(ui_manager->renderer) : WINDOW_HEIGHT_DEFAULT;
+    double scroll = y - view_height / 3.0;
+    ui_manager->view->scroll_y = scroll > 0.0 ? (float)scroll : 0.0f;
+    ui_manager->needs_redraw = 1;
+}
+
+// Перезапускает поиск, если текст поля ввода изменился (а не только курсор)
+static void sync_search_query(UIManager* ui_manager) {
+    const char* text = text_input_get_text(ui_manager->input_field);
+    size_t length = text_input_get_length(ui_manager->input_field);
+    size_t query_length = 0;
+    const char* query = diff_search_query(&ui_manager->search, &query_length);
+    if (length == query_length && (length == 0 || memcmp(text, query, length) == 0)) {
+        return;
+    }
+    // Старый проход отменяется без ожидания, результаты нового приходят по мере готовности
+    diff_search_start(&ui_manager->search, ui_manager->diff_data, text, length);
+    ui_manager->search_reveal = 0;
+    ui_manager->needs_redraw = 1;
+}
+
+static void step_search(UIManager* ui_manager, int direction) {
+    const DiffSearchMatch* match = diff_search_step(&ui_manager->search, direction);
+    if (match) {
+        reveal_match(ui_manager, match);
+    }
+}
+
 // --- НОВАЯ ФУНКЦИЯ ДЛЯ ОБРАБОТКИ КЛАВИШ ---
 void ui_manager_handle_key(UIManager* ui_manager, int key_code) {
     if (!ui_manager) {
@@ -57,20 +205,23 @@ void ui_manager_handle_key(UIManager* ui_manager, int key_code) {
         if (changed) {
              log_debug("Key event handled by text input widget, state changed");
              ui_manager->needs_redraw = 1; // Устанавливаем флаг перерисовки
+             sync_search_query(ui_manager);
         }
     }
-    // TODO: Добавить обработку специальных клавиш
-    // Например, для навигации по diff-данным, если фокус не на текстовом поле
-    // if (!ui_manager->input_field || !ui_manager->input_field->is_focused) {
-    //     switch(key_code) {
-    //         case 0x10000: // Влево
-    //             // Логика прокрутки или навигации
-    //             break;
-    //         case 0x10001: // Вправо
-    //             // Логика прокрутки или навигации
-    //             break;
-    //         // ... другие клавиши
-    //     }
-    // }
+    // Навигация по совпадениям: Enter и "вниз" - следующее, "вверх" - предыдущее
+    // (в многострочном поле Enter вставляет перевод строки)
+    int multiline = ui_manager->input_field && ui_manager->input_field->multiline;
+    switch (key_code) {
+        case '\n':
+        case '\r':
+            if (!multiline) step_search(ui_manager, 1);
+            break;
+        case 0x10003: // Вниз
+            step_search(ui_manager, 1);
+            break;
+        case 0x10002: // Вверх
+            step_search(ui_manager, -1);
+            break;
+    }
 }
 // --- КОНЕЦ НОВОЙ ФУНКЦИИ ---
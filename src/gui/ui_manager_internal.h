@@ -0,0 +1,50 @@
+// src/gui/ui_manager_internal.h
+#ifndef SEE_CODE_UI_MANAGER_INTERNAL_H
+#define SEE_CODE_UI_MANAGER_INTERNAL_H
+
+// Приватное определение UIManager для файлов модуля ui_manager_*.c
+#include "see_code/gui/ui_manager.h"
+#include "see_code/gui/layout_index.h"
+#include "see_code/data/intraline_diff.h"
+#include "see_code/data/moved_lines.h"
+#include "see_code/gui/line_advance.h"
+#include "see_code/data/diff_search.h"
+#include "see_code/data/syntax_highlight.h"
+#include "see_code/data/source_file.h"
+
+// Состояние просмотра одного diff: индекс разметки, кэши отрисовки и прокрутка.
+// Вкладки хранят его, пока показан другой diff.
+struct UIDiffView {
+    LayoutIndex layout; // Префиксные суммы высот файлов и ханков diff
+    IntralineCache intraline; // Изменения слов в недавно показанных ханках
+    MovedLines moved;          // Блоки, перенесенные в другое место diff, и их пары
+    LineAdvanceCache advances; // Продвижения глифов длинных строк для горизонтальной прокрутки
+    SourceFileCache sources;   // Файлы рабочего дерева, из которых раскрывается контекст ханков
+    float scroll_y;
+    float scroll_x;     // Сдвиг текста строк влево, в пикселях
+    float max_scroll_x; // Наибольший сдвиг, при котором видна самая длинная строка последнего кадра
+};
+
+struct UIManager {
+    Renderer* renderer; // Может быть NULL, если используется Termux-GUI
+    TermuxGUIBackend* termux_backend; // Backend для fallback
+    DiffData* diff_data;
+    UIDiffView* view;     // Состояние просмотра diff_data
+    UIDiffView* own_view; // Вид по умолчанию, если владелец diff не передал свой
+    DiffSearch search;  // Поиск по тексту из поля ввода, идет в пуле потоков
+    SyntaxCache syntax; // Раскраска ханков рядом с экраном, считается в фоновом потоке
+    int search_reveal;  // Текущее совпадение еще нужно показать по горизонтали
+    char* work_tree;    // Корень, от которого отсчитываются пути diff (NULL - текущий каталог)
+    int side_by_side;   // Старая и новая версии в двух половинах экрана
+    float content_height;
+    RendererType active_renderer;
+    int needs_redraw;
+    // --- ПОЛЯ ДЛЯ НОВЫХ ВИДЖЕТОВ ---
+    TextInputState* input_field;  // Указатель на состояние текстового поля ввода
+    ButtonState* menu_button;     // Указатель на состояние кнопки "..."
+    int menu_requested;           // Кнопка нажата, владелец UI еще не забрал событие
+    char title[64];               // Подпись слева от кнопки (имя вкладки)
+    // --- КОНЕЦ ПОЛЕЙ ДЛЯ НОВЫХ ВИДЖЕТОВ ---
+};
+
+#endif // SEE_CODE_UI_MANAGER_INTERNAL_H
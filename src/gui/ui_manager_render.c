@@ -1,11 +1,18 @@
 // src/gui/ui_manager_render.c
 #include "see_code/gui/ui_manager.h"
+#include "see_code/gui/ui_manager_internal.h"
 #include "see_code/gui/renderer.h"
 #include "see_code/gui/termux_gui_backend.h"
 #include "see_code/gui/widgets.h" // Для новых виджетов
 #include "see_code/utils/logger.h"
 #include "see_code/core/config.h" // Для констант
 #include "see_code/data/diff_data.h"
+#include "see_code/data/diff_cold_store.h"
+#include "see_code/data/intraline_diff.h"
+#include "see_code/gui/line_advance.h"
+#include "see_code/data/diff_search.h"
+#include "see_code/data/syntax_highlight.h"
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <math.h> // Для fminf, fmaxf
@@ -21,6 +28,432 @@ static RendererType ui_manager_determine_renderer_type(const UIManager* ui_manag
     return RENDERER_TYPE_UNKNOWN;
 }
 
+// Рисует подложку под байтами [start, end) текста строки, сдвинутого на scroll_x
+// и обрезанного по [text_x, text_right). Возвращает 0, если диапазон начинается
+// правее видимой части (следующие диапазоны строки тоже не видны).
+static int draw_text_range(Renderer* renderer, const LineAdvanceIndex* advance,
+                           const char* text, size_t length, size_t start, size_t end,
+                           float text_x, float text_right, float scroll_x, float y, uint32_t color) {
+    float x0 = text_x - scroll_x + line_advance_at(advance, renderer, text, length, start, 1.0f);
+    if (x0 >= text_right) {
+        return 0; // Дальше текст обрезан
+    }
+    float x1 = text_x - scroll_x + line_advance_at(advance, renderer, text, length, end, 1.0f);
+    if (x1 <= text_x) {
+        return 1; // Диапазон левее видимой части строки
+    }
+    if (x0 < text_x) x0 = text_x;
+    if (x1 > text_right) x1 = text_right;
+    renderer_draw_quad(renderer, x0, y, x1 - x0, LINE_HEIGHT, color);
+    return 1;
+}
+
+static uint32_t syntax_color(uint32_t kind, uint32_t plain_color) {
+    switch ((SyntaxKind)kind) {
+        case SYNTAX_KEYWORD: return COLOR_SYNTAX_KEYWORD;
+        case SYNTAX_STRING: return COLOR_SYNTAX_STRING;
+        case SYNTAX_NUMBER: return COLOR_SYNTAX_NUMBER;
+        case SYNTAX_COMMENT: return COLOR_SYNTAX_COMMENT;
+        case SYNTAX_PREPROCESSOR: return COLOR_SYNTAX_PREPROCESSOR;
+        default: return plain_color;
+    }
+}
+
+// Рисует текст строки с байта first отрезками цветов подсветки синтаксиса.
+// Ширина каждого отрезка меряется не дальше правого края, поэтому длинные
+// строки стоят ширину экрана.
+static void draw_highlighted_text(Renderer* renderer, const char* text, size_t length, size_t first,
+                                  const SyntaxSpan* spans, size_t span_count,
+                                  float x, float y, float max_width, uint32_t plain_color) {
+    const float right = x + max_width;
+    size_t s = 0;
+    while (s < span_count && spans[s].start + spans[s].length <= first) s++;
+    size_t pos = first;
+    while (pos < length && x < right) {
+        size_t end = length;
+        uint32_t color = plain_color;
+        if (s < span_count && spans[s].start <= pos) {
+            end = spans[s].start + spans[s].length;
+            color = syntax_color(spans[s].kind, plain_color);
+            s++;
+        } else if (s < span_count) {
+            end = spans[s].start;
+        }
+        if (end > length) end = length;
+        renderer_draw_text_n(renderer, text + pos, end - pos, x, y, 1.0f, color, right - x);
+        float width = 0.0f;
+        renderer_locate_text_n(renderer, text + pos, end - pos, 1.0f, right - x, &width);
+        x += width;
+        pos = end;
+    }
+}
+
+// Положение столбцов строки на экране. В режиме "рядом" поля описывают
+// левую половину (старую версию), правая сдвинута на pane_offset.
+typedef struct {
+    float row_x;        // Фон строки
+    float row_width;
+    float old_number_x; // Правые края номеров старой и новой версии
+    float new_number_x;
+    float text_x;       // Начало и ширина видимой части текста
+    float text_width;
+    float pane_offset;  // 0 в общем виде
+} RowGeometry;
+
+static RowGeometry row_geometry(float screen_width, float gutter_column, int side_by_side) {
+    RowGeometry geometry;
+    geometry.row_x = MARGIN + 20;
+    geometry.old_number_x = geometry.row_x + gutter_column - GUTTER_PADDING;
+    if (side_by_side) {
+        // В каждой половине один столбец номеров
+        geometry.row_width = (screen_width - 2 * (MARGIN + 20) - SPLIT_PANE_GAP) / 2;
+        geometry.pane_offset = geometry.row_width + SPLIT_PANE_GAP;
+        geometry.new_number_x = geometry.old_number_x + geometry.pane_offset;
+        geometry.text_x = geometry.row_x + gutter_column + 5;
+        geometry.text_width = geometry.row_width - gutter_column - 5;
+    } else {
+        geometry.row_width = screen_width - 2 * (MARGIN + 20);
+        geometry.pane_offset = 0.0f;
+        geometry.new_number_x = geometry.row_x + 2 * gutter_column - GUTTER_PADDING;
+        geometry.text_x = geometry.row_x + 2 * gutter_column + 5;
+        geometry.text_width = screen_width - 2 * MARGIN - 20 - 2 * gutter_column;
+    }
+    return geometry;
+}
+
+// Данные кадра, общие для всех строк, и кэши ханка, строки которого рисуются
+typedef struct {
+    const DiffSearchMatch* current_match; // Совпадение, на котором стоит навигация
+    float widest_overflow; // Насколько самая длинная видимая строка шире своей области
+    int reveal_scrolled;   // Кадр сдвинул прокрутку к совпадению поиска
+    size_t hunk;           // Глобальный индекс ханка
+    const SyntaxHunk* syntax;
+    const IntralineHunk* intraline;
+    int intraline_requested;
+} LineDrawState;
+
+static void line_colors(DiffLineType type, MovedMark moved, uint32_t* text_color, uint32_t* bg_color) {
+    if (moved != MOVED_MARK_NONE && type != LINE_TYPE_CONTEXT) {
+        const int alt = moved == MOVED_MARK_BLOCK_ALT;
+        if (type == LINE_TYPE_ADD) {
+            *text_color = COLOR_MOVED_ADD_TEXT;
+            *bg_color = alt ? COLOR_MOVED_ADD_BG_ALT : COLOR_MOVED_ADD_BG;
+        } else {
+            *text_color = COLOR_MOVED_DEL_TEXT;
+            *bg_color = alt ? COLOR_MOVED_DEL_BG_ALT : COLOR_MOVED_DEL_BG;
+        }
+        return;
+    }
+    switch (type) {
+        case LINE_TYPE_ADD:
+            *text_color = 0xFF00FF00; // Зеленый
+            *bg_color = 0xFF002200;   // Темно-зеленый фон
+            break;
+        case LINE_TYPE_DELETE:
+            *text_color = 0xFFFF0000; // Красный
+            *bg_color = 0xFF220000;   // Темно-красный фон
+            break;
+        default:
+            *text_color = 0xFFAAAAAA; // Серый
+            *bg_color = 0xFF111111;   // Почти черный фон
+            break;
+    }
+}
+
+// Рисует текст строки line (k-й в ханке) с подсветкой изменений слов, совпадений
+// поиска и синтаксиса в области [text_x, text_x + text_width), сдвинутой на scroll_x
+static void draw_line_text(UIManager* ui_manager, LineDrawState* state, size_t line, size_t k,
+                           float text_x, float text_width, float y, uint32_t line_color) {
+    Renderer* renderer = ui_manager->renderer;
+    const DiffLineTable* table = &ui_manager->diff_data->lines;
+    const float scroll_x = ui_manager->view->scroll_x;
+    // Текст строки без первого символа ('+', '-', ' ') для чистоты отображения
+    const char* display_text = ui_manager->diff_data->buffer + table->offsets[line] + 1;
+    const size_t text_length = table->lengths[line] > 1 ? table->lengths[line] - 1 : 0;
+    // Длинные строки индексируются по продвижениям глифов: и первый видимый
+    // глиф, и полная ширина находятся без прохода по всей строке
+    const LineAdvanceIndex* advance = line_advance_cache_get(&ui_manager->view->advances, renderer,
+                                                             ui_manager->diff_data, line);
+    const float full_width = line_advance_at(advance, renderer, display_text, text_length, text_length, 1.0f);
+    if (full_width - text_width > state->widest_overflow) {
+        state->widest_overflow = full_width - text_width;
+    }
+    // Подсвечиваем измененные слова парных -/+ строк
+    if (table->types[line] != LINE_TYPE_CONTEXT && text_length > 0) {
+        if (!state->intraline_requested) {
+            state->intraline = intraline_cache_get(&ui_manager->view->intraline, ui_manager->diff_data, state->hunk);
+            state->intraline_requested = 1;
+        }
+        if (state->intraline) {
+            size_t range_count = 0;
+            const IntralineRange* ranges = intraline_hunk_line_ranges(state->intraline, k, &range_count);
+            const uint32_t word_color = table->types[line] == LINE_TYPE_ADD ? COLOR_ADD_WORD : COLOR_DEL_WORD;
+            for (size_t r = 0; r < range_count; r++) {
+                if (!draw_text_range(renderer, advance, display_text, text_length,
+                                     ranges[r].start, ranges[r].start + ranges[r].length,
+                                     text_x, text_x + text_width, scroll_x, y, word_color)) {
+                    break;
+                }
+            }
+        }
+    }
+    // Совпадения поиска поверх изменений слов
+    size_t match_count = 0;
+    const DiffSearchMatch* matches = diff_search_line_matches(&ui_manager->search, line, &match_count);
+    for (size_t m = 0; m < match_count; m++) {
+        const int is_current = &matches[m] == state->current_match;
+        if (is_current && ui_manager->search_reveal) {
+            // Переход к совпадению за пределами видимой части строки
+            const float x0 = line_advance_at(advance, renderer, display_text, text_length, matches[m].start, 1.0f);
+            const float x1 = line_advance_at(advance, renderer, display_text, text_length,
+                                             matches[m].start + matches[m].length, 1.0f);
+            if (x0 < scroll_x || x1 > scroll_x + text_width) {
+                const float target = x0 - text_width / 3;
+                ui_manager->view->scroll_x = target > 0.0f ? target : 0.0f;
+                state->reveal_scrolled = 1;
+            }
+            ui_manager->search_reveal = 0;
+        }
+        if (!draw_text_range(renderer, advance, display_text, text_length,
+                             matches[m].start, matches[m].start + matches[m].length,
+                             text_x, text_x + text_width, scroll_x, y,
+                             is_current ? COLOR_SEARCH_CURRENT : COLOR_SEARCH_MATCH) &&
+            !ui_manager->search_reveal) {
+            break;
+        }
+    }
+    // Рисуем текст строки, начиная с первого глифа, целиком попадающего в видимую часть
+    if (text_length > 0) {
+        float glyph_x = 0.0f;
+        size_t first = 0;
+        if (scroll_x > 0.0f) {
+            first = line_advance_locate(advance, renderer, display_text, text_length, scroll_x, 1.0f, &glyph_x);
+        }
+        if (first < text_length) {
+            const float shift = glyph_x - scroll_x;
+            size_t span_count = 0;
+            const SyntaxSpan* spans = state->syntax ? syntax_hunk_line_spans(state->syntax, k, &span_count) : NULL;
+            if (span_count > 0) {
+                draw_highlighted_text(renderer, display_text, text_length, first, spans, span_count,
+                                      text_x + shift, y + LINE_HEIGHT - 5, text_width - shift, line_color);
+            } else {
+                renderer_draw_text_n(renderer, display_text + first, text_length - first,
+                                     text_x + shift, y + LINE_HEIGHT - 5, 1.0f, line_color, text_width - shift);
+            }
+        }
+    }
+}
+
+// У первой строки перенесенного блока справа пишется, где его пара:
+// "moved to файл:строка" у удаленного, "moved from файл:строка" у добавленного.
+// Касание строки блока переходит к паре (см. ui_manager_handle_touch).
+static void draw_moved_link(UIManager* ui_manager, size_t line, float right, float y, float max_width, uint32_t bg_color) {
+    const MovedLines* moved = &ui_manager->view->moved;
+    if (!moved_lines_block_start(moved, line)) {
+        return;
+    }
+    const DiffData* data = ui_manager->diff_data;
+    const uint32_t counterpart = moved_lines_counterpart(moved, line);
+    const DiffFile* file = &data->files[diff_data_line_file(data, counterpart)];
+    // Файл пары может быть далеко от экрана, и его путь уже сжат
+    diff_cold_store_pin(data->cold, file->path.offset, file->path.length);
+    // Только имя файла: полный путь не поместится рядом с текстом строки
+    const char* path = diff_data_span_ptr(data, file->path);
+    size_t name = file->path.length;
+    while (name > 0 && path[name - 1] != '/') name--;
+    const int is_add = data->lines.types[line] == LINE_TYPE_ADD;
+    char label[128];
+    int length = snprintf(label, sizeof(label), "%s %.*s", is_add ? "moved from" : "moved to",
+                          (int)(file->path.length - name), path + name);
+    // Номера строк у файла, который еще не разобран, не заполнены: только имя
+    if (length > 0 && (size_t)length < sizeof(label) && diff_data_file_is_parsed(file)) {
+        length += snprintf(label + length, sizeof(label) - (size_t)length, ":%u",
+                           is_add ? data->lines.old_numbers[counterpart] : data->lines.new_numbers[counterpart]);
+    }
+    diff_cold_store_unpin(data->cold, file->path.offset, file->path.length);
+    if (length <= 0) {
+        return;
+    }
+    if ((size_t)length >= sizeof(label)) length = (int)sizeof(label) - 1;
+    float width = renderer_measure_text_n(ui_manager->renderer, label, (size_t)length, 1.0f);
+    if (width > max_width) width = max_width;
+    renderer_draw_quad(ui_manager->renderer, right - width - 10, y, width + 10, LINE_HEIGHT, bg_color);
+    renderer_draw_text_n(ui_manager->renderer, label, (size_t)length, right - width - 5, y + LINE_HEIGHT - 5,
+                         1.0f, COLOR_MOVED_LINK, width);
+}
+
+// Строка ханка в общем виде: фон, оба номера и текст
+static void draw_unified_line(UIManager* ui_manager, LineDrawState* state, const RowGeometry* geometry,
+                              size_t line, size_t k, float y) {
+    Renderer* renderer = ui_manager->renderer;
+    const DiffLineTable* table = &ui_manager->diff_data->lines;
+    uint32_t line_color, bg_color;
+    line_colors((DiffLineType)table->types[line], moved_lines_mark(&ui_manager->view->moved, line), &line_color, &bg_color);
+    renderer_draw_quad(renderer, geometry->row_x, y, geometry->row_width, LINE_HEIGHT, bg_color);
+    // Номера строк: готовые глифы цифр, без форматирования в кадре
+    if (table->old_numbers[line]) {
+        renderer_draw_number(renderer, table->old_numbers[line], geometry->old_number_x, y + LINE_HEIGHT - 5,
+                             1.0f, COLOR_LINE_NUMBER);
+    }
+    if (table->new_numbers[line]) {
+        renderer_draw_number(renderer, table->new_numbers[line], geometry->new_number_x, y + LINE_HEIGHT - 5,
+                             1.0f, COLOR_LINE_NUMBER);
+    }
+    draw_line_text(ui_manager, state, line, k, geometry->text_x, geometry->text_width, y, line_color);
+    draw_moved_link(ui_manager, line, geometry->row_x + geometry->row_width, y, geometry->text_width / 2, bg_color);
+}
+
+// Ряд ханка в режиме "рядом": слева строка старой версии, справа новой,
+// пустая половина закрашивается заполнителем
+static void draw_split_row(UIManager* ui_manager, LineDrawState* state, const RowGeometry* geometry,
+                           const DiffHunk* hunk, size_t row, float y) {
+    Renderer* renderer = ui_manager->renderer;
+    const DiffLineTable* table = &ui_manager->diff_data->lines;
+    const uint32_t cells[2] = { table->row_left[hunk->first_line + row], table->row_right[hunk->first_line + row] };
+    for (int side = 0; side < 2; side++) {
+        const float offset = side ? geometry->pane_offset : 0.0f;
+        if (cells[side] == DIFF_ROW_FILLER) {
+            renderer_draw_quad(renderer, geometry->row_x + offset, y, geometry->row_width, LINE_HEIGHT, COLOR_ROW_FILLER);
+            continue;
+        }
+        const size_t line = hunk->first_line + cells[side];
+        uint32_t line_color, bg_color;
+        line_colors((DiffLineType)table->types[line], moved_lines_mark(&ui_manager->view->moved, line), &line_color, &bg_color);
+        renderer_draw_quad(renderer, geometry->row_x + offset, y, geometry->row_width, LINE_HEIGHT, bg_color);
+        const uint32_t number = side ? table->new_numbers[line] : table->old_numbers[line];
+        renderer_draw_number(renderer, number, side ? geometry->new_number_x : geometry->old_number_x,
+                             y + LINE_HEIGHT - 5, 1.0f, COLOR_LINE_NUMBER);
+        draw_line_text(ui_manager, state, line, cells[side], geometry->text_x + offset, geometry->text_width, y, line_color);
+        draw_moved_link(ui_manager, line, geometry->row_x + offset + geometry->row_width, y, geometry->text_width / 2, bg_color);
+    }
+}
+
+// Рисует rows строк рабочего дерева, раскрытых над ханком, начиная с y
+// (в режиме "рядом" - в обеих половинах). Строки выше экрана пропускаются
+// арифметикой; если файл больше не читается, остается пустое место, чтобы
+// не сдвигать разметку. Возвращает y под ними.
+static float draw_context_rows(UIManager* ui_manager, size_t file, const DiffHunk* hunk, uint32_t rows, float y,
+                               const RowGeometry* geometry) {
+    Renderer* renderer = ui_manager->renderer;
+    const float screen_height = renderer_get_height(renderer);
+    const float scroll_x = ui_manager->view->scroll_x;
+    const int panes = ui_manager->side_by_side ? 2 : 1;
+    SourceFile* source = source_file_cache_get(&ui_manager->view->sources, ui_manager->diff_data, file,
+                                               ui_manager->work_tree);
+    // Номера строк над ханком: в старой версии они сдвинуты на ту же величину, что и первая строка ханка
+    const uint32_t new_first = hunk->new_count ? hunk->new_start : hunk->new_start + 1;
+    const uint32_t old_first = hunk->old_count ? hunk->old_start : hunk->old_start + 1;
+    uint32_t r = 0;
+    if (y < -LINE_HEIGHT) {
+        uint32_t skip = (uint32_t)ceilf((-LINE_HEIGHT - y) / LINE_HEIGHT);
+        if (skip > rows) skip = rows;
+        r = skip;
+        y += skip * LINE_HEIGHT;
+    }
+    for (; r < rows && y <= screen_height; r++, y += LINE_HEIGHT) {
+        const uint32_t new_number = new_first - rows + r;
+        for (int pane = 0; pane < panes; pane++) {
+            renderer_draw_quad(renderer, geometry->row_x + pane * geometry->pane_offset, y, geometry->row_width,
+                               LINE_HEIGHT, COLOR_BACKGROUND);
+        }
+        if (old_first > new_first - new_number) {
+            renderer_draw_number(renderer, old_first - (new_first - new_number), geometry->old_number_x,
+                                 y + LINE_HEIGHT - 5, 1.0f, COLOR_LINE_NUMBER);
+        }
+        renderer_draw_number(renderer, new_number, geometry->new_number_x, y + LINE_HEIGHT - 5, 1.0f, COLOR_LINE_NUMBER);
+        const char* text = NULL;
+        size_t length = 0;
+        if (!source || !source_file_line(source, new_number, &text, &length) || length == 0) {
+            continue;
+        }
+        float glyph_x = 0.0f;
+        size_t first = 0;
+        if (scroll_x > 0.0f) {
+            first = renderer_locate_text_n(renderer, text, length, 1.0f, scroll_x, &glyph_x);
+        }
+        if (first < length) {
+            const float shift = glyph_x - scroll_x;
+            for (int pane = 0; pane < panes; pane++) {
+                renderer_draw_text_n(renderer, text + first, length - first,
+                                     geometry->text_x + pane * geometry->pane_offset + shift, y + LINE_HEIGHT - 5,
+                                     1.0f, COLOR_CONTEXT_LINE, geometry->text_width - shift);
+            }
+        }
+    }
+    return y + (float)(rows - r) * LINE_HEIGHT;
+}
+
+// Счетчик совпадений поиска "номер/всего" у правого края поля ввода
+// ("+" в конце, пока поиск еще идет)
+static void draw_search_status(UIManager* ui_manager) {
+    size_t query_length = 0;
+    diff_search_query(&ui_manager->search, &query_length);
+    if (query_length == 0) {
+        return;
+    }
+    char status[48];
+    int length = snprintf(status, sizeof(status), "%zu/%zu%s",
+                          diff_search_current_number(&ui_manager->search),
+                          diff_search_match_count(&ui_manager->search),
+                          diff_search_is_running(&ui_manager->search) ? "+" : "");
+    if (length <= 0) {
+        return;
+    }
+    const TextInputState* input = ui_manager->input_field;
+    const float width = renderer_measure_text_n(ui_manager->renderer, status, (size_t)length, 1.0f);
+    renderer_draw_text_n(ui_manager->renderer, status, (size_t)length,
+                         input->x + input->width - width - 10.0f, input->y + 20.0f,
+                         1.0f, INPUT_FIELD_PLACEHOLDER_COLOR, width);
+}
+
+// Число добавленных и удаленных строк файла у правого края его заголовка
+// (известно и до разбора ханков). Возвращает занятую ширину.
+static float draw_file_stats(UIManager* ui_manager, const DiffFile* file, float right, float baseline) {
+    char additions[24];
+    char deletions[24];
+    const int add_length = snprintf(additions, sizeof(additions), "+%zu", file->additions);
+    const int del_length = snprintf(deletions, sizeof(deletions), " -%zu", file->deletions);
+    if (add_length <= 0 || del_length <= 0) {
+        return 0.0f;
+    }
+    const float add_width = renderer_measure_text_n(ui_manager->renderer, additions, (size_t)add_length, 1.0f);
+    const float del_width = renderer_measure_text_n(ui_manager->renderer, deletions, (size_t)del_length, 1.0f);
+    renderer_draw_text_n(ui_manager->renderer, additions, (size_t)add_length, right - add_width - del_width, baseline,
+                         1.0f, COLOR_FILE_ADDITIONS, add_width);
+    renderer_draw_text_n(ui_manager->renderer, deletions, (size_t)del_length, right - del_width, baseline,
+                         1.0f, COLOR_FILE_DELETIONS, del_width);
+    return add_width + del_width;
+}
+
+// Название показанного diff слева от кнопки меню
+static void draw_title(UIManager* ui_manager) {
+    const size_t length = strlen(ui_manager->title);
+    if (length == 0) {
+        return;
+    }
+    const ButtonState* button = ui_manager->menu_button;
+    const float width = renderer_measure_text_n(ui_manager->renderer, ui_manager->title, length, 1.0f);
+    renderer_draw_text_n(ui_manager->renderer, ui_manager->title, length,
+                         button->x - width - MARGIN, button->y + 20.0f,
+                         1.0f, INPUT_FIELD_PLACEHOLDER_COLOR, width);
+}
+
+// Сообщает хранилищу холодных блоков байты, которые прочтет кадр: секции файлов
+// от первого видимого до следующего за последним (подсветка заранее читает
+// следующий ханк, а он может начинаться в следующем файле)
+static void update_cold_view(UIManager* ui_manager, const LayoutPosition* start) {
+    const DiffData* data = ui_manager->diff_data;
+    if (!data->cold) {
+        return;
+    }
+    const double bottom = (double)ui_manager->view->scroll_y + renderer_get_height(ui_manager->renderer);
+    size_t last = layout_index_locate(&ui_manager->view->layout, bottom).file + 1;
+    if (last >= data->file_count) last = data->file_count - 1;
+    const size_t offset = data->files[start->file].section.offset;
+    const DiffSpan end = data->files[last].section;
+    diff_cold_store_set_view(data->cold, offset, end.offset + end.length - offset);
+}
+
 // --- ОСНОВНАЯ ФУНКЦИЯ РЕНДЕРИНГА ---
 void ui_manager_render(UIManager* ui_manager) {
     if (!ui_manager) {
@@ -28,6 +461,8 @@ void ui_manager_render(UIManager* ui_manager) {
     }
 
     RendererType renderer_type = ui_manager_determine_renderer_type(ui_manager);
+    // Кадр сдвинул прокрутку к совпадению поиска и должен быть перерисован
+    int reveal_scrolled = 0;
 
     if (renderer_type == RENDERER_TYPE_GLES2 && ui_manager->renderer) {
         // --- РЕНДЕРИНГ ЧЕРЕЗ GLES2 ---
@@ -36,119 +471,156 @@ void ui_manager_render(UIManager* ui_manager) {
 
         // 2. Рендерим основной diff (если есть)
         if (ui_manager->diff_data && ui_manager->diff_data->file_count > 0) {
-            float current_y = MARGIN - ui_manager->scroll_y; // Начальная позиция Y с учетом прокрутки
             const float screen_width = renderer_get_width(ui_manager->renderer);
             const float max_text_width = screen_width - 2 * MARGIN;
+            const float digit_width = renderer_get_digit_width(ui_manager->renderer, 1.0f);
+            // Текущее совпадение поиска: его строку кадр прокручивает по горизонтали в видимую часть;
+            // самая длинная видимая строка задает предел горизонтальной прокрутки
+            LineDrawState state;
+            memset(&state, 0, sizeof(state));
+            state.current_match = diff_search_current(&ui_manager->search);
+            const DiffSearchMatch* current_match = state.current_match;
+            // Последний ханк, строки которого рисовались в кадре
+            size_t last_hunk = SIZE_MAX;
 
-            for (size_t i = 0; i < ui_manager->diff_data->file_count; i++) {
-                const DiffFile* file = &ui_manager->diff_data->files[i];
+            // Первый видимый файл и ханк находятся бинарным поиском по индексу разметки,
+            // поэтому стоимость кадра не зависит от того, как далеко прокручен diff.
+            // Файлы, опубликованные потоковым парсером после прошлого кадра, дописываются в индекс.
+            layout_index_sync(&ui_manager->view->layout, ui_manager->diff_data);
+            // Новые файлы хешируются здесь же, а перенесенные блоки ищутся в фоне
+            moved_lines_update(&ui_manager->view->moved, ui_manager->diff_data);
+            const LayoutPosition start = layout_index_locate(&ui_manager->view->layout, (double)ui_manager->view->scroll_y - MARGIN);
+            update_cold_view(ui_manager, &start);
+            // Сумма считается в double: на больших diff координаты не помещаются в точность float
+            float current_y = (float)((double)MARGIN - ui_manager->view->scroll_y + start.file_top);
 
+            for (size_t i = start.file; i < ui_manager->diff_data->file_count; i++) {
+                const DiffFile* file = &ui_manager->diff_data->files[i];
                 // Проверяем, виден ли файл на экране
                 if (current_y > renderer_get_height(ui_manager->renderer) + HUNK_HEADER_HEIGHT) {
                     break; // Файл полностью ниже экрана, выходим из цикла
                 }
-                if (current_y < -FILE_HEADER_HEIGHT) {
-                    // Файл полностью выше экрана, пропускаем его отрисовку, но увеличиваем current_y
-                    current_y += FILE_HEADER_HEIGHT + MARGIN;
-                    if (!file->is_collapsed) {
-                        for (size_t j = 0; j < file->hunk_count; j++) {
-                            const DiffHunk* hunk = &file->hunks[j];
-                            current_y += HUNK_HEADER_HEIGHT + HUNK_PADDING;
-                            if (!hunk->is_collapsed) {
-                                current_y += hunk->line_count * LINE_HEIGHT + HUNK_PADDING;
-                            }
-                        }
+                // Развернутый файл ленивой загрузки разбирается, когда доходит до экрана;
+                // его высота растет ниже текущей позиции, поэтому кадр рисует его уже целиком
+                if (!file->is_collapsed && !diff_data_file_is_parsed(file) && !ui_manager_parse_file(ui_manager, i)) {
+                    ui_manager_set_file_collapsed(ui_manager, i, 1); // Не повторять разбор каждый кадр
+                }
+                // Ширина столбцов номеров строк по самому большому номеру файла (он в последнем ханке)
+                float gutter_column = 0.0f;
+                if (file->hunk_count > 0) {
+                    const DiffHunk* last_hunk = &diff_data_file_hunks(ui_manager->diff_data, file)[file->hunk_count - 1];
+                    uint32_t max_number = last_hunk->old_start + last_hunk->old_count;
+                    if (last_hunk->new_start + last_hunk->new_count > max_number) {
+                        max_number = last_hunk->new_start + last_hunk->new_count;
+                    }
+                    int digits = 1;
+                    while (max_number >= 10) {
+                        max_number /= 10;
+                        digits++;
                     }
-                    current_y += MARGIN;
-                    continue; // Переходим к следующему файлу
+                    gutter_column = digits * digit_width + 2 * GUTTER_PADDING;
                 }
+                const RowGeometry geometry = row_geometry(screen_width, gutter_column, ui_manager->side_by_side);
 
-                // Рисуем заголовок файла
-                if (file->path) {
+                // Рисуем заголовок файла (у первого файла он может быть уже выше экрана)
+                if (file->path.length > 0 && current_y > -FILE_HEADER_HEIGHT) {
                     renderer_draw_quad(ui_manager->renderer,
                                        MARGIN, current_y,
                                        screen_width - 2 * MARGIN, FILE_HEADER_HEIGHT,
                                        COLOR_FILE_HEADER);
-                    renderer_draw_text(ui_manager->renderer, file->path,
-                                       MARGIN + 5, current_y + FILE_HEADER_HEIGHT - 5,
-                                       1.0f, 0xFFFFFFFF, max_text_width);
+                    const float stats_width = draw_file_stats(ui_manager, file, screen_width - MARGIN - 5,
+                                                              current_y + FILE_HEADER_HEIGHT - 5);
+                    const float path_width = max_text_width - stats_width - 10;
+                    // Совпадения поиска в пути подсвечиваются под текстом
+                    const char* path = diff_data_span_ptr(ui_manager->diff_data, file->path);
+                    size_t path_match_count = 0;
+                    const DiffSearchMatch* path_matches = diff_search_path_matches(&ui_manager->search, i, file->first_line,
+                                                                                   &path_match_count);
+                    for (size_t m = 0; m < path_match_count; m++) {
+                        const uint32_t color = &path_matches[m] == current_match ? COLOR_SEARCH_CURRENT : COLOR_SEARCH_MATCH;
+                        if (!draw_text_range(ui_manager->renderer, NULL, path, file->path.length,
+                                             path_matches[m].start, path_matches[m].start + path_matches[m].length,
+                                             MARGIN + 5, MARGIN + 5 + path_width, 0.0f, current_y, color)) {
+                            break;
+                        }
+                    }
+                    renderer_draw_text_n(ui_manager->renderer, path, file->path.length,
+                                         MARGIN + 5, current_y + FILE_HEADER_HEIGHT - 5,
+                                         1.0f, 0xFFFFFFFF, path_width);
                 }
                 current_y += FILE_HEADER_HEIGHT + MARGIN;
 
                 if (!file->is_collapsed) {
-                    for (size_t j = 0; j < file->hunk_count; j++) {
-                        const DiffHunk* hunk = &file->hunks[j];
+                    size_t first_hunk = 0;
+                    if (i == start.file && start.hunk > 0) {
+                        // Ханки выше экрана пропускаются целиком
+                        first_hunk = start.hunk;
+                        current_y = (float)((double)MARGIN - ui_manager->view->scroll_y + start.hunk_top);
+                    }
+                    for (size_t j = first_hunk; j < file->hunk_count; j++) {
+                        const DiffHunk* hunk = &diff_data_file_hunks(ui_manager->diff_data, file)[j];
 
                         // Проверяем, виден ли ханк на экране
                         if (current_y > renderer_get_height(ui_manager->renderer) + LINE_HEIGHT) {
                             break; // Ханк полностью ниже экрана
                         }
-                        if (current_y < -HUNK_HEADER_HEIGHT) {
+                        // Строки рабочего дерева, раскрытые касанием заголовка, рисуются над строками ханка
+                        const uint32_t context_rows = layout_index_hunk_context(&ui_manager->view->layout, i, j);
+                        float hunk_height = HUNK_HEADER_HEIGHT + HUNK_PADDING;
+                        if (!hunk->is_collapsed) {
+                            hunk_height += (context_rows + (ui_manager->side_by_side ? hunk->row_count : hunk->line_count)) * LINE_HEIGHT +
+                                           HUNK_PADDING;
+                        }
+                        if (current_y + hunk_height < 0) {
                             // Ханк полностью выше экрана, пропускаем его отрисовку, но увеличиваем current_y
-                            current_y += HUNK_HEADER_HEIGHT + HUNK_PADDING;
-                            if (!hunk->is_collapsed) {
-                                current_y += hunk->line_count * LINE_HEIGHT + HUNK_PADDING;
-                            }
+                            current_y += hunk_height;
                             continue; // Переходим к следующему ханку
                         }
 
-                        // Рисуем заголовок ханка
-                        if (hunk->header) {
+                        // Рисуем заголовок ханка (он может быть выше экрана, когда видны только строки)
+                        if (hunk->header.length > 0 && current_y > -HUNK_HEADER_HEIGHT) {
                             renderer_draw_quad(ui_manager->renderer,
                                                MARGIN + 10, current_y,
                                                screen_width - 2 * (MARGIN + 10), HUNK_HEADER_HEIGHT,
                                                COLOR_HUNK_HEADER);
-                            renderer_draw_text(ui_manager->renderer, hunk->header,
-                                               MARGIN + 15, current_y + HUNK_HEADER_HEIGHT - 5,
-                                               1.0f, 0xFFFFFFFF, max_text_width - 10);
+                            renderer_draw_text_n(ui_manager->renderer,
+                                                 diff_data_span_ptr(ui_manager->diff_data, hunk->header), hunk->header.length,
+                                                 MARGIN + 15, current_y + HUNK_HEADER_HEIGHT - 5,
+                                                 1.0f, 0xFFFFFFFF, max_text_width - 10);
                         }
                         current_y += HUNK_HEADER_HEIGHT + HUNK_PADDING;
 
                         if (!hunk->is_collapsed) {
-                            // Рисуем строки ханка
-                            for (size_t k = 0; k < hunk->line_count; k++) {
-                                const DiffLine* line = &hunk->lines[k];
-
+                            if (context_rows > 0) {
+                                current_y = draw_context_rows(ui_manager, i, hunk, context_rows, current_y, &geometry);
+                            }
+                            // Рисуем строки ханка (в режиме "рядом" - ряды таблицы выравнивания, собранной
+                            // парсером). Столбцы таблицы строк читаются подряд; ряды выше экрана
+                            // пропускаются арифметикой, без обращения к ним
+                            const size_t row_count = ui_manager->side_by_side ? hunk->row_count : hunk->line_count;
+                            size_t k = 0;
+                            if (current_y < -LINE_HEIGHT) {
+                                size_t skip = (size_t)ceilf((-LINE_HEIGHT - current_y) / LINE_HEIGHT);
+                                if (skip > row_count) skip = row_count;
+                                k = skip;
+                                current_y += skip * LINE_HEIGHT;
+                            }
+                            // Изменения слов считаются только для ханков, чьи -/+ строки попали на экран;
+                            // пока фоновый поток не раскрасил ханк, строки рисуются одним цветом
+                            state.hunk = file->first_hunk + j;
+                            state.intraline = NULL;
+                            state.intraline_requested = 0;
+                            state.syntax = syntax_cache_get(&ui_manager->syntax, ui_manager->diff_data, state.hunk);
+                            last_hunk = state.hunk;
+                            for (; k < row_count; k++) {
                                 // Проверяем, видна ли строка на экране
                                 if (current_y > renderer_get_height(ui_manager->renderer)) {
                                     break; // Строка полностью ниже экрана
                                 }
-                                if (current_y < -LINE_HEIGHT) {
-                                    // Строка полностью выше экрана, пропускаем ее отрисовку
-                                    current_y += LINE_HEIGHT;
-                                    continue;
-                                }
-
-                                uint32_t line_color = 0xFFFFFFFF; // Белый по умолчанию
-                                uint32_t bg_color = COLOR_BACKGROUND; // Темный фон по умолчанию
-
-                                switch (line->type) {
-                                    case LINE_TYPE_ADD:
-                                        line_color = 0xFF00FF00; // Зеленый
-                                        bg_color = 0xFF002200;   // Темно-зеленый фон
-                                        break;
-                                    case LINE_TYPE_DELETE:
-                                        line_color = 0xFFFF0000; // Красный
-                                        bg_color = 0xFF220000;   // Темно-красный фон
-                                        break;
-                                    case LINE_TYPE_CONTEXT:
-                                        line_color = 0xFFAAAAAA; // Серый
-                                        bg_color = 0xFF111111;   // Почти черный фон
-                                        break;
-                                }
-
-                                // Рисуем фон строки
-                                renderer_draw_quad(ui_manager->renderer,
-                                                   MARGIN + 20, current_y,
-                                                   screen_width - 2 * (MARGIN + 20), LINE_HEIGHT,
-                                                   bg_color);
-                                // Рисуем текст строки
-                                if (line->content && strlen(line->content) > 0) {
-                                    // Обрезаем первый символ ('+', '-', ' ') для чистоты отображения
-                                    const char* display_text = line->content[0] == ' ' || line->content[0] == '+' || line->content[0] == '-' ? line->content + 1 : line->content;
-                                    renderer_draw_text(ui_manager->renderer, display_text,
-                                                       MARGIN + 25, current_y + LINE_HEIGHT - 5,
-                                                       1.0f, line_color, max_text_width - 20);
+                                if (ui_manager->side_by_side) {
+                                    draw_split_row(ui_manager, &state, &geometry, hunk, k, current_y);
+                                } else {
+                                    draw_unified_line(ui_manager, &state, &geometry, hunk->first_line + k, k, current_y);
                                 }
                                 current_y += LINE_HEIGHT;
                             }
@@ -158,6 +630,14 @@ void ui_manager_render(UIManager* ui_manager) {
                 } // if (!file->is_collapsed)
                 current_y += MARGIN; // Отступ после файла
             } // for (file)
+            ui_manager->view->max_scroll_x = state.widest_overflow;
+            reveal_scrolled = state.reveal_scrolled;
+            // Следующий ханк раскрашивается заранее, чтобы прокрутка вниз сразу показывала цвет
+            if (last_hunk != SIZE_MAX) {
+                syntax_cache_get(&ui_manager->syntax, ui_manager->diff_data, last_hunk + 1);
+            }
+            // Переход к совпадению действует один кадр (строка могла не попасть на экран)
+            ui_manager->search_reveal = 0;
         } else {
             // Рисуем сообщение, что diff пуст
             renderer_draw_text(ui_manager->renderer, "No diff data available", 50, 100, 1.0f, 0xFFFFFFFF, 300);
@@ -166,15 +646,20 @@ void ui_manager_render(UIManager* ui_manager) {
         // 3. Рендерим виджеты
         if (ui_manager->input_field) {
             text_input_render(ui_manager->input_field, ui_manager->renderer);
+            draw_search_status(ui_manager);
         }
         if (ui_manager->menu_button) {
             button_render(ui_manager->menu_button, ui_manager->renderer);
+            draw_title(ui_manager);
         }
 
     } else if (renderer_type == RENDERER_TYPE_TERMUX_GUI && ui_manager->termux_backend) {
         // --- РЕНДЕРИНГ ЧЕРЕЗ TERMUX-GUI ---
         // 1. Рендерим основной diff (если есть)
         if (ui_manager->diff_data && ui_manager->diff_data->file_count > 0) {
+            // Прокрутки у бэкенда нет: вида в хранилище холодных блоков нет тоже, а то,
+            // что бэкенд читает, он закрепляет сам (пути файлов и раскрытые файлы)
+            diff_cold_store_set_view(ui_manager->diff_data->cold, 0, 0);
             termux_gui_backend_render_diff(ui_manager->termux_backend, ui_manager->diff_data);
         } else {
             // Можно добавить отрисовку сообщения "No diff data" через Termux-GUI
@@ -193,7 +678,7 @@ void ui_manager_render(UIManager* ui_manager) {
         log_error("UIManager: No valid renderer available for rendering");
     }
 
-    // Сброс флага перерисовки после рендеринга
-    ui_manager->needs_redraw = 0;
+    // Сброс флага перерисовки после рендеринга (кроме кадра, сдвинувшего прокрутку)
+    ui_manager->needs_redraw = reveal_scrolled;
 }
 // --- КОНЕЦ ОСНОВНОЙ ФУНКЦИИ РЕНДЕРИНГА ---
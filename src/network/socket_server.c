@@ -15,9 +15,15 @@ struct SocketServer {
     int server_fd;
     volatile int running; // Добавлено volatile для потокобезопасности
     SocketDataCallback callback;
+    // Потоковая доставка (если заданы, используются вместо callback)
+    SocketStreamBeginCallback on_stream_begin;
+    SocketStreamChunkCallback on_stream_chunk;
+    SocketStreamEndCallback on_stream_end;
     pthread_mutex_t mutex;
 };
 
+#define SOCKET_RECV_CHUNK_SIZE (64 * 1024)
+
 SocketServer* socket_server_create(const char* socket_path, SocketDataCallback callback) {
     if (!socket_path || !callback) {
         log_error("Invalid arguments to socket_server_create");
@@ -73,6 +79,52 @@ void socket_server_destroy(SocketServer* server) {
     log_info("Socket server destroyed");
 }
 
+void socket_server_set_stream_callbacks(SocketServer* server,
+                                        SocketStreamBeginCallback on_begin,
+                                        SocketStreamChunkCallback on_chunk,
+                                        SocketStreamEndCallback on_end) {
+    if (!server) {
+        return;
+    }
+    server->on_stream_begin = on_begin;
+    server->on_stream_chunk = on_chunk;
+    server->on_stream_end = on_end;
+}
+
+// Потоковый прием: каждый кусок сразу отдается парсеру, ничего не накапливаем
+static void receive_streaming(SocketServer* server, int client_fd) {
+    char* chunk = malloc(SOCKET_RECV_CHUNK_SIZE);
+    if (!chunk) {
+        log_error("Failed to allocate receive buffer");
+        return;
+    }
+    size_t total_bytes = 0;
+    ssize_t bytes_received;
+    int ok = 1;
+
+    if (server->on_stream_begin) {
+        server->on_stream_begin();
+    }
+    while ((bytes_received = recv(client_fd, chunk, SOCKET_RECV_CHUNK_SIZE, 0)) > 0) {
+        total_bytes += bytes_received;
+        if (total_bytes > MAX_MESSAGE_SIZE) {
+            log_warn("Message size exceeded limit (%d bytes), disconnecting client", MAX_MESSAGE_SIZE);
+            ok = 0;
+            break;
+        }
+        server->on_stream_chunk(chunk, (size_t)bytes_received);
+    }
+    if (bytes_received < 0) {
+        log_error("Error receiving data from client: %s", strerror(errno));
+        ok = 0;
+    }
+    if (server->on_stream_end) {
+        server->on_stream_end(ok);
+    }
+    free(chunk);
+    log_info("Streamed %zu bytes from client", total_bytes);
+}
+
 void socket_server_run(SocketServer* server) {
     if (!server) {
         return;
@@ -120,6 +172,13 @@ void socket_server_run(SocketServer* server) {
 
         log_info("Client connected");
 
+        if (server->on_stream_chunk) {
+            receive_streaming(server, client_fd);
+            close(client_fd);
+            log_info("Client disconnected");
+            continue;
+        }
+
         // --- ЛОГИКА АККУМУЛЯЦИИ ДАННЫХ ---
         char* full_buffer = NULL;
         size_t total_bytes = 0;
@@ -157,11 +216,12 @@ void socket_server_run(SocketServer* server) {
         }
 
         if (total_bytes > 0 && server->callback) {
-            // Вызываем колбэк с полным, аккумулированным буфером
+            // Вызываем колбэк с полным, аккумулированным буфером.
+            // Буфер передается во владение колбэку - парсер хранит срезы прямо в нем.
             server->callback(full_buffer, total_bytes);
+        } else {
+            free(full_buffer);
         }
-        
-        free(full_buffer);
 
     next_client:
         close(client_fd);
@@ -3,8 +3,17 @@
 
 #include <stddef.h>
 
-// Callback function type for handling received data
-typedef void (*SocketDataCallback)(const char* data, size_t length);
+// Callback function type for handling received data.
+// Ownership of the malloc'd data buffer passes to the callback, which must free() it
+// (or hand it over, e.g. to diff_data_load_from_owned_buffer()).
+typedef void (*SocketDataCallback)(char* data, size_t length);
+
+// Streaming callbacks: the message is delivered chunk by chunk as recv() returns it.
+// on_chunk data is only valid during the call. on_end receives 1 if the client
+// closed the connection normally, 0 on a receive error or size limit.
+typedef void (*SocketStreamBeginCallback)(void);
+typedef void (*SocketStreamChunkCallback)(const char* data, size_t length);
+typedef void (*SocketStreamEndCallback)(int ok);
 
 // Socket server structure
 typedef struct SocketServer SocketServer;
@@ -14,5 +23,10 @@ SocketServer* socket_server_create(const char* socket_path, SocketDataCallback c
 void socket_server_destroy(SocketServer* server);
 void socket_server_run(SocketServer* server);
 void socket_server_stop(SocketServer* server);
+// Switches the server to streaming delivery. Must be called before socket_server_run().
+void socket_server_set_stream_callbacks(SocketServer* server,
+                                        SocketStreamBeginCallback on_begin,
+                                        SocketStreamChunkCallback on_chunk,
+                                        SocketStreamEndCallback on_end);
 
 #endif // SEE_CODE_SOCKET_SERVER_H
@@ -0,0 +1,185 @@
+// src/utils/arena.c
+#include "see_code/utils/arena.h"
+#include "see_code/utils/logger.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+struct ArenaBlock {
+    ArenaBlock* next;
+    size_t capacity; // Полезный размер блока (без заголовка)
+    size_t used;
+    // Данные идут сразу за заголовком, выровненные по ARENA_ALIGNMENT
+};
+
+#define ARENA_HEADER_SIZE ((sizeof(ArenaBlock) + ARENA_ALIGNMENT - 1) & ~(size_t)(ARENA_ALIGNMENT - 1))
+
+static unsigned char* block_data(ArenaBlock* block) {
+    return (unsigned char*)block + ARENA_HEADER_SIZE;
+}
+
+static size_t align_up(size_t value) {
+    return (value + ARENA_ALIGNMENT - 1) & ~(size_t)(ARENA_ALIGNMENT - 1);
+}
+
+static ArenaBlock* block_create(size_t capacity) {
+    ArenaBlock* block = malloc(ARENA_HEADER_SIZE + capacity);
+    if (!block) {
+        log_error("arena: Failed to allocate block of %zu bytes", capacity);
+        return NULL;
+    }
+    block->next = NULL;
+    block->capacity = capacity;
+    block->used = 0;
+    return block;
+}
+
+void arena_init(Arena* arena, size_t block_size) {
+    if (!arena) {
+        return;
+    }
+    memset(arena, 0, sizeof(Arena));
+    arena->block_size = block_size > 0 ? align_up(block_size) : ARENA_DEFAULT_BLOCK_SIZE;
+}
+
+void arena_destroy(Arena* arena) {
+    if (!arena) {
+        return;
+    }
+    ArenaBlock* block = arena->head;
+    while (block) {
+        ArenaBlock* next = block->next;
+        free(block);
+        block = next;
+    }
+    size_t block_size = arena->block_size;
+    memset(arena, 0, sizeof(Arena));
+    arena->block_size = block_size;
+}
+
+void arena_reset(Arena* arena) {
+    if (!arena) {
+        return;
+    }
+    for (ArenaBlock* block = arena->head; block; block = block->next) {
+        block->used = 0;
+    }
+    arena->current = arena->head;
+}
+
+void* arena_alloc(Arena* arena, size_t size) {
+    if (!arena) {
+        return NULL;
+    }
+    if (size == 0) {
+        size = 1;
+    }
+    if (size > SIZE_MAX - ARENA_ALIGNMENT) {
+        return NULL;
+    }
+    size = align_up(size);
+
+    // Сначала пробуем текущий блок, затем уже выделенные блоки дальше по цепочке
+    // (после arena_reset они пусты и переиспользуются)
+    for (ArenaBlock* block = arena->current; block; block = block->next) {
+        if (block->capacity - block->used >= size) {
+            void* ptr = block_data(block) + block->used;
+            block->used += size;
+            arena->current = block;
+            return ptr;
+        }
+    }
+
+    // Ни один блок не подошел: крупные запросы получают собственный блок точного размера
+    size_t capacity = size > arena->block_size ? size : arena->block_size;
+    ArenaBlock* block = block_create(capacity);
+    if (!block) {
+        return NULL;
+    }
+    if (!arena->head) {
+        arena->head = block;
+    } else {
+        ArenaBlock* tail = arena->current ? arena->current : arena->head;
+        while (tail->next) tail = tail->next;
+        tail->next = block;
+    }
+    arena->reserved += ARENA_HEADER_SIZE + capacity;
+    arena->current = block;
+    block->used = size;
+    return block_data(block);
+}
+
+void* arena_realloc(Arena* arena, void* ptr, size_t old_size, size_t new_size) {
+    if (!arena) {
+        return NULL;
+    }
+    if (!ptr) {
+        return arena_alloc(arena, new_size);
+    }
+    if (new_size <= old_size) {
+        return ptr;
+    }
+    if (new_size > SIZE_MAX - ARENA_ALIGNMENT) {
+        return NULL;
+    }
+    size_t old_aligned = align_up(old_size);
+    size_t new_aligned = align_up(new_size);
+
+    ArenaBlock* prev = NULL;
+    for (ArenaBlock* block = arena->head; block; prev = block, block = block->next) {
+        unsigned char* data = block_data(block);
+        if ((unsigned char*)ptr < data || (unsigned char*)ptr >= data + block->capacity) {
+            continue;
+        }
+        // Последнее выделение в блоке: расширяем на месте, если хватает места
+        if ((unsigned char*)ptr + old_aligned == data + block->used &&
+            block->capacity - (block->used - old_aligned) >= new_aligned) {
+            block->used += new_aligned - old_aligned;
+            return ptr;
+        }
+        // Крупное выделение, занимающее блок целиком: перевыделяем сам блок
+        if ((unsigned char*)ptr == data && block->used == old_aligned && old_aligned > arena->block_size) {
+            int was_current = arena->current == block;
+            ArenaBlock* grown = realloc(block, ARENA_HEADER_SIZE + new_aligned);
+            if (!grown) {
+                log_error("arena: Failed to grow block to %zu bytes", new_aligned);
+                return NULL;
+            }
+            arena->reserved += new_aligned - grown->capacity;
+            grown->capacity = new_aligned;
+            grown->used = new_aligned;
+            if (prev) {
+                prev->next = grown;
+            } else {
+                arena->head = grown;
+            }
+            if (was_current) {
+                arena->current = grown;
+            }
+            return block_data(grown);
+        }
+        break;
+    }
+
+    // Общий случай: новое место и копия
+    void* fresh = arena_alloc(arena, new_size);
+    if (fresh) {
+        memcpy(fresh, ptr, old_size);
+    }
+    return fresh;
+}
+
+void* arena_calloc(Arena* arena, size_t count, size_t size) {
+    if (size != 0 && count > SIZE_MAX / size) {
+        return NULL;
+    }
+    void* ptr = arena_alloc(arena, count * size);
+    if (ptr) {
+        memset(ptr, 0, count * size);
+    }
+    return ptr;
+}
+
+size_t arena_bytes_reserved(const Arena* arena) {
+    return arena ? arena->reserved : 0;
+}
@@ -0,0 +1,46 @@
+// src/utils/arena.h
+#ifndef SEE_CODE_ARENA_H
+#define SEE_CODE_ARENA_H
+
+#include <stddef.h>
+
+// Bump allocator: memory is handed out from large blocks and is only
+// released all at once. arena_reset() keeps the blocks for reuse, so
+// reloading a diff of similar size does not go back to malloc.
+typedef struct ArenaBlock ArenaBlock;
+
+typedef struct {
+    ArenaBlock* head;     // First block in the chain
+    ArenaBlock* current;  // Block allocations are bumped from
+    size_t block_size;    // Default size for new blocks
+    size_t reserved;      // Total bytes held by all blocks
+} Arena;
+
+#define ARENA_DEFAULT_BLOCK_SIZE (1024 * 1024) // 1MB
+#define ARENA_ALIGNMENT 16
+
+// Initializes an empty arena. No memory is allocated until the first arena_alloc().
+void arena_init(Arena* arena, size_t block_size);
+
+// Frees every block. The arena can be reused after arena_init().
+void arena_destroy(Arena* arena);
+
+// Marks all memory as free but keeps the blocks for subsequent allocations.
+void arena_reset(Arena* arena);
+
+// Returns ARENA_ALIGNMENT-aligned memory, or NULL on failure.
+void* arena_alloc(Arena* arena, size_t size);
+
+// Grows an allocation made from this arena. The last allocation of a block
+// is extended in place; a large allocation that owns a whole block is grown
+// with realloc(). Otherwise the data is copied into a new allocation and the
+// old space stays unused until the next reset.
+void* arena_realloc(Arena* arena, void* ptr, size_t old_size, size_t new_size);
+
+// Same as arena_alloc(), but zero-initialized.
+void* arena_calloc(Arena* arena, size_t count, size_t size);
+
+// Total bytes reserved from the system (for diagnostics).
+size_t arena_bytes_reserved(const Arena* arena);
+
+#endif // SEE_CODE_ARENA_H
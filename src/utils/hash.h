@@ -0,0 +1,46 @@
+// src/utils/hash.h
+#ifndef SEE_CODE_HASH_H
+#define SEE_CODE_HASH_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// Fast non-cryptographic 64-bit hash of a byte string: four independent
+// 8-byte lanes (32 bytes per step) so the multiplications do not wait on
+// each other, then a splitmix64-style finalizer.
+// Never returns 0, callers use that value for "not computed yet".
+
+static inline uint64_t hash_round(uint64_t h, uint64_t word) {
+    h ^= word * 0xC2B2AE3D27D4EB4FULL;
+    return ((h << 31) | (h >> 33)) * 0x9E3779B97F4A7C15ULL;
+}
+
+static inline uint64_t hash_bytes(const char* bytes, size_t length) {
+    uint64_t lanes[4] = { length, 0x243F6A8885A308D3ULL, 0x13198A2E03707344ULL, 0xA4093822299F31D0ULL };
+    size_t i = 0;
+    for (; i + 32 <= length; i += 32) {
+        uint64_t words[4];
+        memcpy(words, bytes + i, sizeof(words));
+        lanes[0] = hash_round(lanes[0], words[0]);
+        lanes[1] = hash_round(lanes[1], words[1]);
+        lanes[2] = hash_round(lanes[2], words[2]);
+        lanes[3] = hash_round(lanes[3], words[3]);
+    }
+    uint64_t h = lanes[0] ^ ((lanes[1] << 17) | (lanes[1] >> 47)) ^
+                 ((lanes[2] << 29) | (lanes[2] >> 35)) ^ ((lanes[3] << 43) | (lanes[3] >> 21));
+    for (; i + 8 <= length; i += 8) {
+        uint64_t word;
+        memcpy(&word, bytes + i, sizeof(word));
+        h = hash_round(h, word);
+    }
+    uint64_t tail = 0;
+    memcpy(&tail, bytes + i, length - i);
+    h = hash_round(h, tail);
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDULL;
+    h ^= h >> 33;
+    return h ? h : 1;
+}
+
+#endif // SEE_CODE_HASH_H
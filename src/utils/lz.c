@@ -0,0 +1,135 @@
+// src/utils/lz.c
+#include "see_code/utils/lz.h"
+#include <stdint.h>
+#include <string.h>
+
+// Таблица последних позиций по хешу 4 байт (4096 записей по 2 байта - на стеке)
+#define LZ_HASH_BITS 12
+// Поиск ускоряется на длинных участках без совпадений: шаг растет на 1 каждые 2^LZ_SKIP_SHIFT байт
+#define LZ_SKIP_SHIFT 6
+
+static uint32_t read32(const uint8_t* p) {
+    uint32_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static uint32_t hash4(uint32_t value) {
+    return (value * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+// Продолжение длины, не поместившейся в 4 бита токена: байты 255 и остаток
+static uint8_t* put_length(uint8_t* op, const uint8_t* end, size_t length) {
+    while (length >= 255) {
+        if (op >= end) return NULL;
+        *op++ = 255;
+        length -= 255;
+    }
+    if (op >= end) return NULL;
+    *op++ = (uint8_t)length;
+    return op;
+}
+
+// Пишет последовательность: литералы, затем совпадение (match_length = 0 - последняя,
+// только литералы). Возвращает NULL, если не хватило места.
+static uint8_t* put_sequence(uint8_t* op, const uint8_t* end, const uint8_t* literals, size_t literal_length,
+                             size_t match_length, size_t offset) {
+    if (op >= end) return NULL;
+    uint8_t* token = op++;
+    *token = (uint8_t)((literal_length < 15 ? literal_length : 15) << 4);
+    if (literal_length >= 15 && !(op = put_length(op, end, literal_length - 15))) return NULL;
+    if (literal_length > (size_t)(end - op)) return NULL;
+    memcpy(op, literals, literal_length);
+    op += literal_length;
+    if (match_length == 0) {
+        return op;
+    }
+    if (end - op < 2) return NULL;
+    *op++ = (uint8_t)(offset & 0xFF);
+    *op++ = (uint8_t)(offset >> 8);
+    const size_t code = match_length - LZ_MIN_MATCH;
+    *token |= (uint8_t)(code < 15 ? code : 15);
+    if (code >= 15 && !(op = put_length(op, end, code - 15))) return NULL;
+    return op;
+}
+
+size_t lz_compress(const char* src, size_t length, char* dst, size_t dst_capacity) {
+    if (length > LZ_MAX_BLOCK) {
+        return 0;
+    }
+    const uint8_t* const base = (const uint8_t*)src;
+    const uint8_t* const end = base + length;
+    uint8_t* op = (uint8_t*)dst;
+    const uint8_t* const op_end = op + dst_capacity;
+    uint16_t table[1 << LZ_HASH_BITS];
+    memset(table, 0, sizeof(table));
+
+    const uint8_t* ip = base;
+    const uint8_t* anchor = base;
+    while (length >= LZ_MIN_MATCH && ip <= end - LZ_MIN_MATCH) {
+        const uint32_t sequence = read32(ip);
+        const uint32_t h = hash4(sequence);
+        const uint8_t* ref = base + table[h];
+        table[h] = (uint16_t)(ip - base);
+        if (ref >= ip || read32(ref) != sequence) {
+            ip += 1 + ((size_t)(ip - anchor) >> LZ_SKIP_SHIFT);
+            continue;
+        }
+        size_t match = LZ_MIN_MATCH;
+        while (ip + match < end && ref[match] == ip[match]) match++;
+        op = put_sequence(op, op_end, anchor, (size_t)(ip - anchor), match, (size_t)(ip - ref));
+        if (!op) {
+            return 0;
+        }
+        ip += match;
+        anchor = ip;
+    }
+    op = put_sequence(op, op_end, anchor, (size_t)(end - anchor), 0, 0);
+    return op ? (size_t)(op - (uint8_t*)dst) : 0;
+}
+
+// Читает продолжение длины; 0 - вход кончился раньше
+static int get_length(const uint8_t** ip, const uint8_t* end, size_t* length) {
+    uint8_t byte;
+    do {
+        if (*ip >= end) return 0;
+        byte = *(*ip)++;
+        *length += byte;
+    } while (byte == 255);
+    return 1;
+}
+
+int lz_decompress(const char* src, size_t src_length, char* dst, size_t length) {
+    const uint8_t* ip = (const uint8_t*)src;
+    const uint8_t* const ip_end = ip + src_length;
+    uint8_t* op = (uint8_t*)dst;
+    uint8_t* const op_end = op + length;
+    while (ip < ip_end) {
+        const uint8_t token = *ip++;
+        size_t literal_length = token >> 4;
+        if (literal_length == 15 && !get_length(&ip, ip_end, &literal_length)) return 0;
+        if (literal_length > (size_t)(ip_end - ip) || literal_length > (size_t)(op_end - op)) return 0;
+        memcpy(op, ip, literal_length);
+        ip += literal_length;
+        op += literal_length;
+        if (ip == ip_end) {
+            break; // Последняя последовательность - только литералы
+        }
+        if (ip_end - ip < 2) return 0;
+        const size_t offset = (size_t)ip[0] | ((size_t)ip[1] << 8);
+        ip += 2;
+        size_t match_length = token & 15;
+        if (match_length == 15 && !get_length(&ip, ip_end, &match_length)) return 0;
+        match_length += LZ_MIN_MATCH;
+        if (offset == 0 || offset > (size_t)(op - (uint8_t*)dst) || match_length > (size_t)(op_end - op)) return 0;
+        const uint8_t* ref = op - offset;
+        if (offset >= match_length) {
+            memcpy(op, ref, match_length);
+            op += match_length;
+        } else {
+            // Совпадение перекрывает само себя (повтор короткого образца)
+            for (size_t i = 0; i < match_length; i++) *op++ = ref[i];
+        }
+    }
+    return op == op_end;
+}
@@ -0,0 +1,31 @@
+// src/utils/lz.h
+#ifndef SEE_CODE_LZ_H
+#define SEE_CODE_LZ_H
+
+#include <stddef.h>
+
+// Small LZ77 block codec in the LZ4 block format: sequences of literals
+// followed by a match (2-byte offset, length of at least LZ_MIN_MATCH),
+// found through a hash of the next 4 bytes. Greedy and single pass:
+// roughly a few hundred MB/s to compress and several times that to
+// decompress, which is what keeping cold data compressed in memory needs.
+//
+// Blocks are at most LZ_MAX_BLOCK bytes so that every offset fits in 16 bits.
+
+#define LZ_MAX_BLOCK (64 * 1024)
+#define LZ_MIN_MATCH 4
+
+// Worst-case compressed size of length bytes (incompressible input)
+static inline size_t lz_compress_bound(size_t length) {
+    return length + length / 255 + 16;
+}
+
+// Compresses length bytes (at most LZ_MAX_BLOCK) into dst of dst_capacity
+// bytes. Returns the compressed size, or 0 if it would not fit.
+size_t lz_compress(const char* src, size_t length, char* dst, size_t dst_capacity);
+
+// Decompresses a block that must expand to exactly length bytes.
+// Returns 1 on success, 0 if the block is malformed.
+int lz_decompress(const char* src, size_t src_length, char* dst, size_t length);
+
+#endif // SEE_CODE_LZ_H
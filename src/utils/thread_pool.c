@@ -0,0 +1,274 @@
+// src/utils/thread_pool.c
+#include "see_code/utils/thread_pool.h"
+#include "see_code/utils/logger.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+typedef struct ThreadPoolWork {
+    ThreadPoolTask task;
+    void* arg;
+    struct ThreadPoolWork* next;
+} ThreadPoolWork;
+
+struct ThreadPool {
+    pthread_t* threads;
+    size_t thread_count;
+    pthread_mutex_t mutex;
+    pthread_cond_t work_available;
+    ThreadPoolWork* head;
+    ThreadPoolWork* tail;
+    int stopping;
+};
+
+// Состояние одного parallel_for. Живет на стеке вызывающего потока,
+// поэтому тот ждет, пока все помощники, взявшие его из очереди, не выйдут.
+typedef struct {
+    ThreadPoolRangeTask task;
+    void* context;
+    size_t count;
+    size_t next;     // Следующий индекс, который еще никто не взял
+    size_t done;     // Сколько индексов уже обработано
+    size_t helpers;  // Помощники в очереди или в работе
+    pthread_mutex_t mutex;
+    pthread_cond_t finished;
+} ParallelJob;
+
+static void* worker_main(void* arg) {
+    ThreadPool* pool = (ThreadPool*)arg;
+    for (;;) {
+        pthread_mutex_lock(&pool->mutex);
+        while (!pool->head && !pool->stopping) {
+            pthread_cond_wait(&pool->work_available, &pool->mutex);
+        }
+        ThreadPoolWork* work = pool->head;
+        if (!work) {
+            // stopping и очередь пуста
+            pthread_mutex_unlock(&pool->mutex);
+            break;
+        }
+        pool->head = work->next;
+        if (!pool->head) pool->tail = NULL;
+        pthread_mutex_unlock(&pool->mutex);
+
+        work->task(work->arg);
+        free(work);
+    }
+    return NULL;
+}
+
+ThreadPool* thread_pool_create(size_t thread_count) {
+    ThreadPool* pool = calloc(1, sizeof(ThreadPool));
+    if (!pool) {
+        log_error("thread_pool: Failed to allocate pool");
+        return NULL;
+    }
+    if (pthread_mutex_init(&pool->mutex, NULL) != 0) {
+        free(pool);
+        return NULL;
+    }
+    if (pthread_cond_init(&pool->work_available, NULL) != 0) {
+        pthread_mutex_destroy(&pool->mutex);
+        free(pool);
+        return NULL;
+    }
+    if (thread_count > 0) {
+        pool->threads = calloc(thread_count, sizeof(pthread_t));
+        if (!pool->threads) {
+            log_error("thread_pool: Failed to allocate %zu threads", thread_count);
+            thread_pool_destroy(pool);
+            return NULL;
+        }
+    }
+    for (size_t i = 0; i < thread_count; i++) {
+        if (pthread_create(&pool->threads[i], NULL, worker_main, pool) != 0) {
+            // Работаем с теми потоками, что удалось создать
+            log_warn("thread_pool: Created only %zu of %zu worker threads", i, thread_count);
+            break;
+        }
+        pool->thread_count++;
+    }
+    return pool;
+}
+
+void thread_pool_destroy(ThreadPool* pool) {
+    if (!pool) {
+        return;
+    }
+    pthread_mutex_lock(&pool->mutex);
+    pool->stopping = 1;
+    pthread_cond_broadcast(&pool->work_available);
+    pthread_mutex_unlock(&pool->mutex);
+    for (size_t i = 0; i < pool->thread_count; i++) {
+        pthread_join(pool->threads[i], NULL);
+    }
+    // Без рабочих потоков задачи из очереди уже никто не выполнит
+    while (pool->head) {
+        ThreadPoolWork* work = pool->head;
+        pool->head = work->next;
+        free(work);
+    }
+    free(pool->threads);
+    pthread_cond_destroy(&pool->work_available);
+    pthread_mutex_destroy(&pool->mutex);
+    free(pool);
+}
+
+size_t thread_pool_size(const ThreadPool* pool) {
+    return pool ? pool->thread_count : 0;
+}
+
+int thread_pool_submit(ThreadPool* pool, ThreadPoolTask task, void* arg) {
+    if (!pool || !task || pool->thread_count == 0) {
+        return 0;
+    }
+    ThreadPoolWork* work = malloc(sizeof(ThreadPoolWork));
+    if (!work) {
+        log_error("thread_pool: Failed to allocate task");
+        return 0;
+    }
+    work->task = task;
+    work->arg = arg;
+    work->next = NULL;
+    pthread_mutex_lock(&pool->mutex);
+    if (pool->tail) {
+        pool->tail->next = work;
+    } else {
+        pool->head = work;
+    }
+    pool->tail = work;
+    pthread_cond_signal(&pool->work_available);
+    pthread_mutex_unlock(&pool->mutex);
+    return 1;
+}
+
+// --- parallel_for ---
+
+// Забирает индексы по одному, пока они не кончатся
+static void parallel_job_drain(ParallelJob* job) {
+    for (;;) {
+        pthread_mutex_lock(&job->mutex);
+        if (job->next >= job->count) {
+            pthread_mutex_unlock(&job->mutex);
+            return;
+        }
+        size_t index = job->next++;
+        pthread_mutex_unlock(&job->mutex);
+
+        job->task(job->context, index);
+
+        pthread_mutex_lock(&job->mutex);
+        job->done++;
+        if (job->done == job->count) {
+            pthread_cond_signal(&job->finished);
+        }
+        pthread_mutex_unlock(&job->mutex);
+    }
+}
+
+static void parallel_job_helper(void* arg) {
+    ParallelJob* job = (ParallelJob*)arg;
+    parallel_job_drain(job);
+    pthread_mutex_lock(&job->mutex);
+    job->helpers--;
+    if (job->helpers == 0) {
+        pthread_cond_signal(&job->finished);
+    }
+    pthread_mutex_unlock(&job->mutex);
+}
+
+void thread_pool_parallel_for(ThreadPool* pool, size_t count, ThreadPoolRangeTask task, void* context) {
+    if (!task || count == 0) {
+        return;
+    }
+    size_t workers = thread_pool_size(pool);
+    if (workers == 0 || count == 1) {
+        for (size_t i = 0; i < count; i++) {
+            task(context, i);
+        }
+        return;
+    }
+
+    ParallelJob job;
+    job.task = task;
+    job.context = context;
+    job.count = count;
+    job.next = 0;
+    job.done = 0;
+    job.helpers = 0;
+    pthread_mutex_init(&job.mutex, NULL);
+    pthread_cond_init(&job.finished, NULL);
+
+    // Помощников не больше, чем индексов сверх того, что возьмет сам вызывающий
+    size_t helpers = count - 1 < workers ? count - 1 : workers;
+    for (size_t i = 0; i < helpers; i++) {
+        pthread_mutex_lock(&job.mutex);
+        job.helpers++;
+        pthread_mutex_unlock(&job.mutex);
+        if (!thread_pool_submit(pool, parallel_job_helper, &job)) {
+            pthread_mutex_lock(&job.mutex);
+            job.helpers--;
+            pthread_mutex_unlock(&job.mutex);
+            break;
+        }
+    }
+
+    parallel_job_drain(&job);
+
+    // Помощники, до которых очередь так и не дошла, больше не нужны:
+    // убираем их, чтобы не ждать освобождения занятых рабочих потоков
+    size_t removed = 0;
+    pthread_mutex_lock(&pool->mutex);
+    ThreadPoolWork** link = &pool->head;
+    pool->tail = NULL;
+    while (*link) {
+        ThreadPoolWork* work = *link;
+        if (work->task == parallel_job_helper && work->arg == &job) {
+            *link = work->next;
+            free(work);
+            removed++;
+        } else {
+            pool->tail = work;
+            link = &work->next;
+        }
+    }
+    pthread_mutex_unlock(&pool->mutex);
+
+    pthread_mutex_lock(&job.mutex);
+    job.helpers -= removed;
+    while (job.done < job.count || job.helpers > 0) {
+        pthread_cond_wait(&job.finished, &job.mutex);
+    }
+    pthread_mutex_unlock(&job.mutex);
+    pthread_cond_destroy(&job.finished);
+    pthread_mutex_destroy(&job.mutex);
+}
+
+// --- Общий пул ---
+
+static pthread_mutex_t g_shared_mutex = PTHREAD_MUTEX_INITIALIZER;
+static ThreadPool* g_shared_pool = NULL;
+
+ThreadPool* thread_pool_shared(void) {
+    pthread_mutex_lock(&g_shared_mutex);
+    if (!g_shared_pool) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        // Один процессор оставляем потоку, вызывающему parallel_for
+        size_t workers = cpus > 1 ? (size_t)(cpus - 1) : 0;
+        g_shared_pool = thread_pool_create(workers);
+        if (g_shared_pool) {
+            log_debug("thread_pool: Shared pool started with %zu workers", thread_pool_size(g_shared_pool));
+        }
+    }
+    ThreadPool* pool = g_shared_pool;
+    pthread_mutex_unlock(&g_shared_mutex);
+    return pool;
+}
+
+void thread_pool_shared_shutdown(void) {
+    pthread_mutex_lock(&g_shared_mutex);
+    ThreadPool* pool = g_shared_pool;
+    g_shared_pool = NULL;
+    pthread_mutex_unlock(&g_shared_mutex);
+    thread_pool_destroy(pool);
+}
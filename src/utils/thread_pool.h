@@ -0,0 +1,40 @@
+// src/utils/thread_pool.h
+#ifndef SEE_CODE_THREAD_POOL_H
+#define SEE_CODE_THREAD_POOL_H
+
+#include <stddef.h>
+
+// Fixed set of worker threads fed from a FIFO queue.
+// Used to spread CPU-bound work (parsing, searching) across cores.
+typedef struct ThreadPool ThreadPool;
+
+typedef void (*ThreadPoolTask)(void* arg);
+// Body of a parallel loop, called once for every index in [0, count)
+typedef void (*ThreadPoolRangeTask)(void* context, size_t index);
+
+// Creates a pool with thread_count workers. A pool with zero workers is
+// valid: thread_pool_parallel_for() then runs everything on the caller.
+ThreadPool* thread_pool_create(size_t thread_count);
+
+// Finishes the queued tasks and joins the workers.
+void thread_pool_destroy(ThreadPool* pool);
+
+// Number of worker threads (not counting the caller of parallel_for).
+size_t thread_pool_size(const ThreadPool* pool);
+
+// Queues task(arg) to run on a worker. Returns 1 on success, 0 on failure.
+int thread_pool_submit(ThreadPool* pool, ThreadPoolTask task, void* arg);
+
+// Runs task(context, i) for every i in [0, count) and returns when all
+// calls have finished. The calling thread takes part in the work, so this
+// is safe to call even when every worker is busy.
+void thread_pool_parallel_for(ThreadPool* pool, size_t count, ThreadPoolRangeTask task, void* context);
+
+// Process-wide pool sized to the online CPUs (one of them is the caller),
+// created on first use. Returns NULL if it could not be created.
+ThreadPool* thread_pool_shared(void);
+
+// Destroys the shared pool; a later thread_pool_shared() creates a new one.
+void thread_pool_shared_shutdown(void);
+
+#endif // SEE_CODE_THREAD_POOL_H
@@ -0,0 +1,56 @@
+// src/utils/utf8.h
+#ifndef SEE_CODE_UTF8_H
+#define SEE_CODE_UTF8_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Code point substituted for bytes that are not valid UTF-8
+#define UTF8_REPLACEMENT 0xFFFDu
+
+/**
+ * @brief Decodes one UTF-8 sequence starting at text.
+ *
+ * Strict validation: overlong forms, surrogates, code points above
+ * U+10FFFF and truncated sequences are rejected.
+ *
+ * @param length Bytes available at text (at least 1).
+ * @return Length of the sequence (1..4) with the code point in *codepoint,
+ *         or 0 if the bytes at text are not valid UTF-8.
+ */
+static inline size_t utf8_decode(const char* text, size_t length, uint32_t* codepoint) {
+    const unsigned char* p = (const unsigned char*)text;
+    const unsigned char c = p[0];
+    if (c < 0x80) {
+        *codepoint = c;
+        return 1;
+    }
+    if (c < 0xC2) {
+        return 0; // Байт продолжения или начало overlong-формы
+    }
+    if (c < 0xE0) {
+        if (length < 2 || (p[1] & 0xC0) != 0x80) return 0;
+        *codepoint = ((uint32_t)(c & 0x1F) << 6) | (p[1] & 0x3F);
+        return 2;
+    }
+    if (c < 0xF0) {
+        // E0 не может начинать overlong-форму, ED - суррогат
+        const unsigned char low = c == 0xE0 ? 0xA0 : 0x80;
+        const unsigned char high = c == 0xED ? 0x9F : 0xBF;
+        if (length < 3 || p[1] < low || p[1] > high || (p[2] & 0xC0) != 0x80) return 0;
+        *codepoint = ((uint32_t)(c & 0x0F) << 12) | ((uint32_t)(p[1] & 0x3F) << 6) | (p[2] & 0x3F);
+        return 3;
+    }
+    if (c < 0xF5) {
+        // F0 не может начинать overlong-форму, F4 ограничивает U+10FFFF
+        const unsigned char low = c == 0xF0 ? 0x90 : 0x80;
+        const unsigned char high = c == 0xF4 ? 0x8F : 0xBF;
+        if (length < 4 || p[1] < low || p[1] > high || (p[2] & 0xC0) != 0x80 || (p[3] & 0xC0) != 0x80) return 0;
+        *codepoint = ((uint32_t)(c & 0x07) << 18) | ((uint32_t)(p[1] & 0x3F) << 12) |
+                     ((uint32_t)(p[2] & 0x3F) << 6) | (p[3] & 0x3F);
+        return 4;
+    }
+    return 0;
+}
+
+#endif // SEE_CODE_UTF8_H